@@ -0,0 +1,191 @@
+#!/bin/sh
+#
+#  codebench.sh - generated-code benchmark.
+#
+#  Compiles every kernel in kernels/ with inger, assembles
+#  and links it against the freestanding runtime.c, and
+#  runs it under perfrun. The C version of each kernel is
+#  built at -O0 and -O2 as a reference. Reports cycles,
+#  instructions and run time per kernel and variant, and
+#  the ratio to C -O2.
+#
+#  Usage: codebench.sh [kernels...]
+#
+#  Environment:
+#    INGER       compiler to benchmark (default ../compiler/inger)
+#    INGERFLAGS  extra compiler options
+#    TARGET      i386 or x86_64 (default i386); selects the
+#                defaults of KCC, AS and LD, and passes
+#                --target to inger
+#    CC          host C compiler used to build perfrun (default cc)
+#    KCC         C compiler for runtime.c and the C kernels
+#                (default "$CC -m32", or -m64 for x86_64);
+#                on i386 the C kernels do float arithmetic
+#                in SSE, as inger does
+#    AS          assembler (default "as --32 --noexecstack",
+#                or --64)
+#    LD          linker (default "ld -m elf_i386", or
+#                elf_x86_64)
+#    RUNS        runs per measurement; the best is kept (default 3)
+#    TIMEOUT     seconds allowed per run (default 60)
+#    WORKDIR     directory for build products (default: a
+#                temporary directory, removed afterwards)
+#
+#  Kernels are named by their basename (e.g. "loops").
+#  The status column reads:
+#    ok      output matches the C -O0 build
+#    wrong   output differs from the C -O0 build
+#    crash   the program was killed or exited non-zero
+#    build   compiling, assembling or linking failed
+#
+#  The ratio compares cycles when the machine provides
+#  hardware counters, CPU time (task-clock) otherwise.
+#
+
+BENCHDIR=`cd \`dirname $0\` && pwd`
+INGER=${INGER:-$BENCHDIR/../compiler/inger}
+CC=${CC:-cc}
+TARGET=${TARGET:-i386}
+case $TARGET in
+    i386)
+        KCC=${KCC:-"$CC -m32"}
+        FLOATFLAGS="-msse2 -mfpmath=sse"
+        AS=${AS:-"as --32 --noexecstack"}
+        LD=${LD:-"ld -m elf_i386"}
+        ;;
+    x86_64)
+        KCC=${KCC:-"$CC -m64"}
+        FLOATFLAGS=""
+        AS=${AS:-"as --64 --noexecstack"}
+        LD=${LD:-"ld -m elf_x86_64"}
+        ;;
+    *)
+        echo "codebench: unknown target $TARGET." >&2
+        exit 1
+        ;;
+esac
+INGERFLAGS="--target=$TARGET $INGERFLAGS"
+RUNS=${RUNS:-3}
+TIMEOUT=${TIMEOUT:-60}
+KERNELS=${*:-`cd $BENCHDIR/kernels && ls *.i | sed 's/\.i$//'`}
+
+KCFLAGS="-ffreestanding -fno-builtin -fno-pic -fno-stack-protector $FLOATFLAGS"
+
+case $INGER in
+    /*) ;;
+    *) INGER=`pwd`/$INGER ;;
+esac
+
+if [ ! -x "$INGER" ]; then
+    echo "codebench: compiler $INGER not found (set INGER)." >&2
+    exit 1
+fi
+
+if [ -z "$WORKDIR" ]; then
+    WORKDIR=`mktemp -d ${TMPDIR:-/tmp}/codebench.XXXXXX` || exit 1
+    CLEANUP=$WORKDIR
+fi
+mkdir -p $WORKDIR || exit 1
+
+$CC -O2 -o $WORKDIR/perfrun $BENCHDIR/perfrun.c || exit 1
+$KCC -O2 $KCFLAGS -c -o $WORKDIR/runtime.o $BENCHDIR/runtime.c || exit 1
+
+# Use timeout(1) when it is available.
+if command -v timeout >/dev/null 2>&1; then
+    RUN="timeout $TIMEOUT"
+else
+    RUN=""
+fi
+
+cd $WORKDIR
+
+# link <object> <program>
+link() {
+    $LD -static -e _start -o $2 runtime.o $1 >>build.log 2>&1
+}
+
+# build <kernel> <variant>: builds <kernel>.<variant>.
+build() {
+    case $2 in
+        inger)
+            cp $BENCHDIR/kernels/$1.i $BENCHDIR/kernels/*.ih . &&
+            $INGER $INGERFLAGS $1.i >$1.inger.log 2>&1 &&
+            grep -q "^0 errors" $1.inger.log &&
+            $AS -o $1.inger.o $1.s >>build.log 2>&1 &&
+            link $1.inger.o $1.inger
+            ;;
+        c-O*)
+            level=`echo $2 | sed 's/^c//'`
+            $KCC $level $KCFLAGS -c -o $1.$2.o $BENCHDIR/kernels/$1.c \
+                >>build.log 2>&1 &&
+            link $1.$2.o $1.$2
+            ;;
+    esac
+}
+
+printf "%-10s %-7s %-6s %14s %14s %10s %8s\n" \
+    kernel variant status cycles instructions ms "vs -O2"
+
+for kernel in $KERNELS; do
+    if [ ! -f $BENCHDIR/kernels/$kernel.i ]; then
+        echo "codebench: no kernel $kernel." >&2
+        continue
+    fi
+
+    # C -O0 comes first: its output is the reference for
+    # the status column of the other variants.
+    for variant in c-O0 c-O2 inger; do
+        rm -f $kernel.$variant.out $kernel.$variant.perf
+        status=ok
+        if ! build $kernel $variant; then
+            status=build
+        elif ! $RUN ./perfrun -r $RUNS -o $kernel.$variant.perf \
+                ./$kernel.$variant >$kernel.$variant.out; then
+            status=crash
+        elif [ $variant != c-O0 ] &&
+             ! cmp -s $kernel.$variant.out $kernel.c-O0.out; then
+            status=wrong
+        fi
+        echo $status >$kernel.$variant.status
+    done
+
+    # Print one line per variant, with the ratio to C -O2.
+    for variant in c-O0 c-O2 inger; do
+        touch $kernel.$variant.perf
+        awk -v k=$kernel -v v=$variant -v s=`cat $kernel.$variant.status` '
+            # Cost used for the ratio: cycles if the machine has
+            # hardware counters, CPU time or wall time otherwise.
+            function cost( file,    name, value, c, t, w ) {
+                c = t = w = ""
+                while( ( getline < file ) > 0 ) {
+                    if( $1 == "cycles" ) c = $2
+                    if( $1 == "task-clock" ) t = $2
+                    if( $1 == "seconds" ) w = $2
+                }
+                close( file )
+                if( c != "" && c != "n/a" ) return c
+                if( t != "" && t != "n/a" ) return t
+                return w
+            }
+            BEGIN {
+                cycles = instructions = "n/a"; seconds = 0
+                file = k "." v ".perf"
+                while( ( getline < file ) > 0 ) {
+                    if( $1 == "cycles" ) cycles = $2
+                    if( $1 == "instructions" ) instructions = $2
+                    if( $1 == "seconds" ) seconds = $2
+                }
+                close( file )
+                ref = cost( k ".c-O2.perf" )
+                ratio = "-"
+                if( s != "build" && ref > 0 )
+                    ratio = sprintf( "%.2f", cost( file ) / ref )
+                printf( "%-10s %-7s %-6s %14s %14s %10.2f %8s\n",
+                    k, v, s, cycles, instructions, seconds * 1000, ratio )
+            }'
+    done
+done
+
+if [ -n "$CLEANUP" ]; then
+    cd / && rm -rf $CLEANUP
+fi
@@ -0,0 +1,103 @@
+#!/bin/sh
+#
+#  compilebench.sh - compiler throughput benchmark.
+#
+#  Generates synthetic Inger modules of increasing size
+#  with ingergen, compiles each one with --time and
+#  reports lines/sec and MB/sec for every phase.
+#
+#  Usage: compilebench.sh [sizes...]
+#
+#  Environment:
+#    INGER      compiler to benchmark (default ../compiler/inger)
+#    INGERFLAGS extra compiler options, e.g. "-O1"
+#    CC         C compiler used to build ingergen (default cc)
+#    GENFLAGS   extra ingergen options, e.g. "-e 5 -n 3 -m 8"
+#    TIMEOUT    seconds allowed per compile (default 600)
+#    WORKDIR    directory for generated files (default: a
+#               temporary directory, removed afterwards)
+#
+#  Sizes are target line counts; the default scales
+#  from 1K to 10M lines. Scaling stops at the first
+#  size that fails or exceeds TIMEOUT.
+#
+
+BENCHDIR=`cd \`dirname $0\` && pwd`
+INGER=${INGER:-$BENCHDIR/../compiler/inger}
+CC=${CC:-cc}
+TIMEOUT=${TIMEOUT:-600}
+SIZES=${*:-"1000 10000 100000 1000000 10000000"}
+
+case $INGER in
+    /*) ;;
+    *) INGER=`pwd`/$INGER ;;
+esac
+
+if [ ! -x "$INGER" ]; then
+    echo "compilebench: compiler $INGER not found (set INGER)." >&2
+    exit 1
+fi
+
+if [ -z "$WORKDIR" ]; then
+    WORKDIR=`mktemp -d ${TMPDIR:-/tmp}/compilebench.XXXXXX` || exit 1
+    CLEANUP=$WORKDIR
+fi
+mkdir -p $WORKDIR || exit 1
+
+$CC -O2 -o $WORKDIR/ingergen $BENCHDIR/ingergen.c || exit 1
+
+# Use timeout(1) when it is available.
+if command -v timeout >/dev/null 2>&1; then
+    RUN="timeout $TIMEOUT"
+else
+    RUN=""
+fi
+
+# The phase column fits the longest phase name,
+# "initialization check".
+PHASEWIDTH=20
+
+cd $WORKDIR
+printf "%-10s %-12s %-${PHASEWIDTH}s %10s %12s %8s\n" \
+    lines bytes phase seconds lines/sec MB/sec
+
+for size in $SIZES; do
+    rm -f bench*.i bench*.ih bench*.i_p bench*.s
+    ./ingergen -l $size $GENFLAGS -o bench || exit 1
+
+    lines=`cat bench*.i bench*.ih 2>/dev/null | wc -l | tr -d ' '`
+    bytes=`cat bench*.i bench*.ih 2>/dev/null | wc -c | tr -d ' '`
+
+    if ! $RUN "$INGER" --time $INGERFLAGS bench.i >report.txt 2>errors.txt; then
+        echo "compilebench: compile of $lines lines failed or timed out;" \
+            "stopping." >&2
+        tail -5 errors.txt >&2
+        break
+    fi
+    if ! grep -q "^0 errors" errors.txt report.txt; then
+        echo "compilebench: generated program has errors:" >&2
+        head -5 errors.txt >&2
+        break
+    fi
+
+    # The --time table has one "phase seconds percent calls"
+    # line per phase, and a final "total seconds" line. Phase
+    # names may contain spaces.
+    awk -v lines=$lines -v bytes=$bytes -v width=$PHASEWIDTH '
+        /^phase/ { table = 1; next }
+        table && NF >= 2 {
+            if( $1 == "total" ) { name = "total"; secs = $2 }
+            else {
+                secs = $( NF - 2 ); name = $1
+                for( i = 2; i < NF - 2; i++ ) name = name " " $i
+            }
+            if( secs <= 0 ) secs = 1e-6
+            printf( "%-10d %-12d %-" width "s %10.4f %12.0f %8.2f\n",
+                lines, bytes, name, secs, lines / secs,
+                bytes / secs / 1048576 )
+        }' report.txt
+done
+
+if [ -n "$CLEANUP" ]; then
+    cd / && rm -rf $CLEANUP
+fi
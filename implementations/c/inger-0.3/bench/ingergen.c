@@ -0,0 +1,506 @@
+/*************************************************
+ *                                               *
+ *  Module: ingergen.c                           *
+ *  Description:                                 *
+ *      Generates synthetic Inger modules of a   *
+ *      tunable shape, for benchmarking the      *
+ *      compiler.                                *
+ *  Modifications:                               *
+ *                                               *
+ *************************************************
+ *                                               *
+ *   This program is free software; you can      *
+ *   redistribute it and/or modify  it under     *
+ *   the terms of the GNU General Public         *
+ *   License as published by the Free            *
+ *   Software Foundation; either version 2       *
+ *   of the License, or (at your option) any     *
+ *   later version.                              *
+ *                                               *
+ *************************************************/
+
+/*
+ *  The generated module only uses int variables, so
+ *  that it passes all semantic checks. Every function
+ *  calls only functions defined before it, and every
+ *  while loop counts a fresh local down to zero, so
+ *  the program also terminates when it is run.
+ *
+ *  Output is written to <prefix>.i, plus one header
+ *  <prefix>_<n>.ih for each import.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+
+/*************************************************
+ *                                               *
+ *  MACROS                                       *
+ *                                               *
+ *************************************************/
+
+#define MAX_NAME            256
+
+/* Functions declared in each generated header. */
+#define EXTERNS_PER_IMPORT  4
+
+#define ERR_OPEN            "ingergen: could not open %s for writing.\n"
+#define ERR_ARGUMENT        "ingergen: invalid value for -%c.\n"
+
+/*************************************************
+ *                                               *
+ *  GLOBALS                                      *
+ *                                               *
+ *************************************************/
+
+/* Shape of the generated module. */
+static int functions   = 16;    /* -f: number of functions */
+static int statements  = 20;    /* -s: statements per block */
+static int exprDepth   = 3;     /* -e: maximum expression depth */
+static int nestDepth   = 2;     /* -n: maximum block nesting */
+static int locals      = 8;     /* -i: locals per function */
+static int globals     = 8;     /* -g: global variables */
+static int imports     = 0;     /* -m: import fan-out */
+static int switchCases = 4;     /* -w: cases per switch */
+static long lines      = 0;     /* -l: target line count (0: use -f) */
+static char *prefix    = "bench";
+
+/* Random number generator state (-r seeds it). */
+static unsigned long seed = 1;
+
+/* Output state. */
+static FILE *out;
+static long linesWritten = 0;
+static int loopCounter = 0;
+
+/*************************************************
+ *                                               *
+ *  FUNCTIONS                                    *
+ *                                               *
+ *************************************************/
+
+/*
+ *  Returns a pseudo-random number in [0, n). The
+ *  generator is fixed so that output is identical
+ *  on every platform.
+ */
+static int Random( int n )
+{
+    seed = seed * 1103515245UL + 12345UL;
+    return( (int) ( ( seed >> 16 ) & 0x7fff ) % n );
+}
+
+/*
+ *  Writes [depth] levels of indentation.
+ */
+static void Indent( int depth )
+{
+    int i;
+
+    for( i = 0; i < depth; i++ )
+    {
+        fputs( "    ", out );
+    }
+}
+
+/*
+ *  Ends the current line.
+ */
+static void Newline()
+{
+    fputc( '\n', out );
+    linesWritten++;
+}
+
+/*
+ *  Writes an operand: a local, a parameter, a global
+ *  or a literal.
+ */
+static void GenerateOperand()
+{
+    switch( Random( 4 ) )
+    {
+    case 0:
+        fprintf( out, "p%d", Random( 2 ) );
+        break;
+    case 1:
+        if( globals > 0 )
+        {
+            fprintf( out, "g%d", Random( globals ) );
+            break;
+        }
+        /* fall through */
+    case 2:
+        fprintf( out, "v%d", Random( locals ) );
+        break;
+    default:
+        fprintf( out, "%d", Random( 100 ) );
+    }
+}
+
+/*
+ *  Writes an integer expression of at most [depth]
+ *  levels of binary operators.
+ */
+static void GenerateExpression( int depth )
+{
+    static char *operators[] = { "+", "-", "*", "&", "|", "^" };
+
+    if( depth <= 0 || Random( 4 ) == 0 )
+    {
+        GenerateOperand();
+        return;
+    }
+
+    fputc( '(', out );
+    GenerateExpression( depth - 1 );
+    fprintf( out, " %s ", operators[Random( 6 )] );
+    GenerateExpression( depth - 1 );
+    fputc( ')', out );
+}
+
+/*
+ *  Writes a boolean condition.
+ */
+static void GenerateCondition( int depth )
+{
+    static char *relations[] = { "<", "<=", ">", ">=", "==", "!=" };
+
+    GenerateExpression( depth );
+    fprintf( out, " %s ", relations[Random( 6 )] );
+    GenerateExpression( depth );
+    if( Random( 4 ) == 0 )
+    {
+        fprintf( out, " %s ", Random( 2 ) ? "&&" : "||" );
+        GenerateOperand();
+        fprintf( out, " %s ", relations[Random( 6 )] );
+        GenerateOperand();
+    }
+}
+
+static void GenerateBlock( int function, int depth );
+
+/*
+ *  Writes one statement at nesting level [depth] in
+ *  the body of function number [function].
+ */
+static void GenerateStatement( int function, int depth )
+{
+    int kind, i, counter, value;
+
+    /* Compound statements only below the nesting limit. */
+    kind = Random( depth < nestDepth ? 8 : 4 );
+
+    Indent( depth );
+    switch( kind )
+    {
+    case 0:
+    case 1:
+        fprintf( out, "v%d = ", Random( locals ) );
+        GenerateExpression( exprDepth );
+        fputc( ';', out );
+        Newline();
+        break;
+    case 2:
+        if( function > 0 )
+        {
+            fprintf( out, "v%d = f%d( ", Random( locals ), Random( function ) );
+            GenerateExpression( exprDepth - 1 );
+            fprintf( out, ", " );
+            GenerateExpression( exprDepth - 1 );
+            fprintf( out, " );" );
+            Newline();
+            break;
+        }
+        /* fall through */
+    case 3:
+        if( imports > 0 )
+        {
+            fprintf( out, "v%d = x%d_%d( ", Random( locals ),
+                Random( imports ), Random( EXTERNS_PER_IMPORT ) );
+            GenerateExpression( exprDepth - 1 );
+            fprintf( out, " );" );
+            Newline();
+            break;
+        }
+        if( globals > 0 )
+        {
+            fprintf( out, "g%d = ", Random( globals ) );
+        }
+        else
+        {
+            fprintf( out, "v%d = ", Random( locals ) );
+        }
+        GenerateExpression( exprDepth );
+        fputc( ';', out );
+        Newline();
+        break;
+    case 4:
+    case 5:
+        fprintf( out, "if( " );
+        GenerateCondition( exprDepth - 1 );
+        fprintf( out, " )" );
+        Newline();
+        GenerateBlock( function, depth );
+        if( Random( 2 ) )
+        {
+            Indent( depth );
+            fprintf( out, "else" );
+            Newline();
+            GenerateBlock( function, depth );
+        }
+        break;
+    case 6:
+        /* Bounded loop on a fresh counter. */
+        counter = loopCounter++;
+        fprintf( out, "int c%d = %d;", counter, 1 + Random( 10 ) );
+        Newline();
+        Indent( depth );
+        fprintf( out, "while( c%d > 0 ) do", counter );
+        Newline();
+        Indent( depth );
+        fprintf( out, "{" );
+        Newline();
+        Indent( depth + 1 );
+        fprintf( out, "c%d = c%d - 1;", counter, counter );
+        Newline();
+        for( i = 0; i < statements / 2; i++ )
+        {
+            GenerateStatement( function, depth + 1 );
+        }
+        Indent( depth );
+        fprintf( out, "}" );
+        Newline();
+        break;
+    default:
+        fprintf( out, "switch( " );
+        GenerateExpression( exprDepth - 1 );
+        fprintf( out, " )" );
+        Newline();
+        Indent( depth );
+        fprintf( out, "{" );
+        Newline();
+        for( i = 0, value = Random( 4 ); i < switchCases; i++ )
+        {
+            /* Case values are increasing, with small gaps. */
+            value += 1 + Random( 3 );
+            Indent( depth + 1 );
+            fprintf( out, "case %d", value );
+            Newline();
+            GenerateBlock( function, depth + 1 );
+        }
+        Indent( depth + 1 );
+        fprintf( out, "default" );
+        Newline();
+        GenerateBlock( function, depth + 1 );
+        Indent( depth );
+        fprintf( out, "}" );
+        Newline();
+    }
+}
+
+/*
+ *  Writes a nested block at nesting level [depth].
+ */
+static void GenerateBlock( int function, int depth )
+{
+    int i, count;
+
+    Indent( depth );
+    fprintf( out, "{" );
+    Newline();
+
+    count = 1 + Random( statements / 2 + 1 );
+    for( i = 0; i < count; i++ )
+    {
+        GenerateStatement( function, depth + 1 );
+    }
+
+    Indent( depth );
+    fprintf( out, "}" );
+    Newline();
+}
+
+/*
+ *  Writes function number [function].
+ */
+static void GenerateFunction( int function )
+{
+    int i;
+
+    fprintf( out, "f%d: int p0, p1 -> int", function );
+    Newline();
+    fprintf( out, "{" );
+    Newline();
+
+    for( i = 0; i < locals; i++ )
+    {
+        Indent( 1 );
+        fprintf( out, "int v%d = %d;", i, Random( 100 ) );
+        Newline();
+    }
+
+    loopCounter = 0;
+    for( i = 0; i < statements; i++ )
+    {
+        GenerateStatement( function, 1 );
+    }
+
+    Indent( 1 );
+    fprintf( out, "return( " );
+    GenerateExpression( exprDepth );
+    fprintf( out, " );" );
+    Newline();
+    fprintf( out, "}" );
+    Newline();
+    Newline();
+}
+
+/*
+ *  Writes header <prefix>_<n>.ih for import [n].
+ */
+static void GenerateHeader( int n )
+{
+    char name[MAX_NAME];
+    FILE *fp;
+    int i;
+
+    snprintf( name, MAX_NAME, "%s_%d.ih", prefix, n );
+    fp = fopen( name, "w" );
+    if( fp == NULL )
+    {
+        fprintf( stderr, ERR_OPEN, name );
+        exit( 1 );
+    }
+    for( i = 0; i < EXTERNS_PER_IMPORT; i++ )
+    {
+        fprintf( fp, "extern x%d_%d: int x -> int;\n", n, i );
+    }
+    fclose( fp );
+}
+
+/*
+ *  Prints usage information.
+ */
+static void ShowHelp( char *programName )
+{
+    fprintf( stdout,
+      "Usage: %s [options]\n" \
+      "Options:\n" \
+      "-f count   Number of functions (default 16)\n" \
+      "-l count   Generate functions until at least count lines\n" \
+      "-s count   Statements per block (default 20)\n" \
+      "-e depth   Maximum expression depth (default 3)\n" \
+      "-n depth   Maximum statement nesting depth (default 2)\n" \
+      "-i count   Local variables per function (default 8)\n" \
+      "-g count   Global variables (default 8)\n" \
+      "-m count   Import fan-out: number of headers (default 0)\n" \
+      "-w count   Cases per switch statement (default 4)\n" \
+      "-r seed    Random seed (default 1)\n" \
+      "-o prefix  Output file prefix (default \"bench\")\n" \
+      "\n", programName
+    );
+}
+
+/*
+ *  Parses a non-negative integer argument for option [opt].
+ */
+static long Argument( int opt, char *arg )
+{
+    char *end;
+    long value;
+
+    value = strtol( arg, &end, 10 );
+    if( *end != '\0' || value < 0 )
+    {
+        fprintf( stderr, ERR_ARGUMENT, opt );
+        exit( 1 );
+    }
+    return( value );
+}
+
+int main( int argc, char **argv )
+{
+    char name[MAX_NAME];
+    int opt, i;
+
+    while( ( opt = getopt( argc, argv, "f:l:s:e:n:i:g:m:w:r:o:h" ) ) != -1 )
+    {
+        switch( opt )
+        {
+        case 'f': functions = Argument( opt, optarg ); break;
+        case 'l': lines = Argument( opt, optarg ); break;
+        case 's': statements = Argument( opt, optarg ); break;
+        case 'e': exprDepth = Argument( opt, optarg ); break;
+        case 'n': nestDepth = Argument( opt, optarg ); break;
+        case 'i': locals = Argument( opt, optarg ); break;
+        case 'g': globals = Argument( opt, optarg ); break;
+        case 'm': imports = Argument( opt, optarg ); break;
+        case 'w': switchCases = Argument( opt, optarg ); break;
+        case 'r': seed = Argument( opt, optarg ); break;
+        case 'o': prefix = optarg; break;
+        default:
+            ShowHelp( argv[0] );
+            return( opt == 'h' ? 0 : 1 );
+        }
+    }
+
+    /* Expressions refer to at least one local. */
+    if( locals == 0 ) locals = 1;
+    if( exprDepth == 0 ) exprDepth = 1;
+    if( functions == 0 ) functions = 1;
+
+    for( i = 0; i < imports; i++ )
+    {
+        GenerateHeader( i );
+    }
+
+    snprintf( name, MAX_NAME, "%s.i", prefix );
+    out = fopen( name, "w" );
+    if( out == NULL )
+    {
+        fprintf( stderr, ERR_OPEN, name );
+        return( 1 );
+    }
+
+    fprintf( out, "/* Generated by ingergen. */" );
+    Newline();
+    fprintf( out, "module generated;" );
+    Newline();
+    Newline();
+
+    for( i = 0; i < imports; i++ )
+    {
+        fprintf( out, "#import \"%s_%d.ih\"", prefix, i );
+        Newline();
+    }
+
+    for( i = 0; i < globals; i++ )
+    {
+        fprintf( out, "int g%d = %d;", i, Random( 100 ) );
+        Newline();
+    }
+    Newline();
+
+    /* Either a fixed number of functions, or as many
+     * as needed to reach the target line count. */
+    for( i = 0; lines > 0 ? linesWritten < lines : i < functions; i++ )
+    {
+        GenerateFunction( i );
+    }
+
+    fprintf( out, "start main: void -> void" );
+    Newline();
+    fprintf( out, "{" );
+    Newline();
+    Indent( 1 );
+    fprintf( out, "int r = f%d( 1, 2 );", i - 1 );
+    Newline();
+    fprintf( out, "}" );
+    Newline();
+
+    fclose( out );
+    return( 0 );
+}
@@ -0,0 +1,18 @@
+/* C equivalent of arith.i. */
+
+void printint( int x );
+
+int main( void )
+{
+    int i = 0, x = 12345, sum = 0;
+
+    while( i < 30000000 )
+    {
+        x = ( x * 1103 + 12345 ) % 65536;
+        sum = sum + x / 7 - x % 13 + ( x << 2 ) - ( x >> 3 );
+        sum = sum & 16777215;
+        i = i + 1;
+    }
+    printint( sum );
+    return( 0 );
+}
@@ -0,0 +1,22 @@
+/* arith.i - generated-code benchmark kernel.
+   Integer arithmetic: a linear congruential generator
+   with multiply, divide, modulus and shifts.
+   Prints a checksum that must match arith.c. */
+
+module arith;
+
+#import "runtime.ih"
+
+start main: void -> void
+{
+    int i = 0, x = 12345, sum = 0;
+
+    while( i < 30000000 ) do
+    {
+        x = ( x * 1103 + 12345 ) % 65536;
+        sum = sum + x / 7 - x % 13 + ( x << 2 ) - ( x >> 3 );
+        sum = sum & 16777215;
+        i = i + 1;
+    }
+    printint( sum );
+}
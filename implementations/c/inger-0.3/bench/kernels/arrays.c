@@ -0,0 +1,39 @@
+/* C equivalent of arrays.i. */
+
+void printint( int x );
+
+int flags[100000];
+
+int main( void )
+{
+    int pass = 0, i, j, count = 0;
+
+    while( pass < 100 )
+    {
+        i = 0;
+        while( i < 100000 )
+        {
+            flags[i] = 1;
+            i = i + 1;
+        }
+        i = 2;
+        count = 0;
+        while( i < 100000 )
+        {
+            if( flags[i] == 1 )
+            {
+                count = count + 1;
+                j = i + i;
+                while( j < 100000 )
+                {
+                    flags[j] = 0;
+                    j = j + i;
+                }
+            }
+            i = i + 1;
+        }
+        pass = pass + 1;
+    }
+    printint( count );
+    return( 0 );
+}
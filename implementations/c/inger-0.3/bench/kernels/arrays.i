@@ -0,0 +1,43 @@
+/* arrays.i - generated-code benchmark kernel.
+   Array walks: the sieve of Eratosthenes over a global
+   array, repeated a hundred times.
+   Prints a checksum that must match arrays.c. */
+
+module arrays;
+
+#import "runtime.ih"
+
+int flags[100000];
+
+start main: void -> void
+{
+    int pass = 0, i, j, count = 0;
+
+    while( pass < 100 ) do
+    {
+        i = 0;
+        while( i < 100000 ) do
+        {
+            flags[i] = 1;
+            i = i + 1;
+        }
+        i = 2;
+        count = 0;
+        while( i < 100000 ) do
+        {
+            if( flags[i] == 1 )
+            {
+                count = count + 1;
+                j = i + i;
+                while( j < 100000 ) do
+                {
+                    flags[j] = 0;
+                    j = j + i;
+                }
+            }
+            i = i + 1;
+        }
+        pass = pass + 1;
+    }
+    printint( count );
+}
@@ -0,0 +1,39 @@
+/* C equivalent of calls.i. */
+
+void printint( int x );
+
+int min( int a, int b )
+{
+    if( a < b )
+    {
+        return( a );
+    }
+    return( b );
+}
+
+int max( int a, int b )
+{
+    if( a > b )
+    {
+        return( a );
+    }
+    return( b );
+}
+
+int clamp( int x, int lo, int hi )
+{
+    return( min( max( x, lo ), hi ) );
+}
+
+int main( void )
+{
+    int i = 0, sum = 0;
+
+    while( i < 10000000 )
+    {
+        sum = ( sum + clamp( i % 1000, 100, 900 ) ) & 16777215;
+        i = i + 1;
+    }
+    printint( sum );
+    return( 0 );
+}
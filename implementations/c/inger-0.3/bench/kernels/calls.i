@@ -0,0 +1,43 @@
+/* calls.i - generated-code benchmark kernel.
+   Call-heavy code: small helper functions called in a
+   loop, like samples/romannumerals.i.
+   Prints a checksum that must match calls.c. */
+
+module calls;
+
+#import "runtime.ih"
+
+min: int a; int b -> int
+{
+    if( a < b )
+    {
+        return( a );
+    }
+    return( b );
+}
+
+max: int a; int b -> int
+{
+    if( a > b )
+    {
+        return( a );
+    }
+    return( b );
+}
+
+clamp: int x; int lo; int hi -> int
+{
+    return( min( max( x, lo ), hi ) );
+}
+
+start main: void -> void
+{
+    int i = 0, sum = 0;
+
+    while( i < 10000000 ) do
+    {
+        sum = ( sum + clamp( i % 1000, 100, 900 ) ) & 16777215;
+        i = i + 1;
+    }
+    printint( sum );
+}
@@ -0,0 +1,23 @@
+/* C equivalent of floats.i. */
+
+void printfloat( float x );
+
+int main( void )
+{
+    int i = 0;
+    float x = 0.0f, y = 0.0f, sum = 0.0f;
+
+    while( i < 20000000 )
+    {
+        x = ( i % 1000 ) * 0.001f;
+        y = ( ( 0.5f * x - 1.25f ) * x + 2.0f ) * x / ( x + 1.5f );
+        sum = sum + y;
+        if( sum >= 1000.0f )
+        {
+            sum = sum - 1000.0f;
+        }
+        i = i + 1;
+    }
+    printfloat( sum );
+    return( 0 );
+}
@@ -0,0 +1,28 @@
+/* floats.i - generated-code benchmark kernel.
+   Float arithmetic: a rational function evaluated
+   with add, subtract, multiply and divide, with float
+   comparisons and int to float conversions.
+   Prints a result that must match floats.c. */
+
+module floats;
+
+#import "runtime.ih"
+
+start main: void -> void
+{
+    int i = 0;
+    float x = 0.0, y = 0.0, sum = 0.0;
+
+    while( i < 20000000 ) do
+    {
+        x = ( i % 1000 ) * 0.001;
+        y = ( ( 0.5 * x - 1.25 ) * x + 2.0 ) * x / ( x + 1.5 );
+        sum = sum + y;
+        if( sum >= 1000.0 )
+        {
+            sum = sum - 1000.0;
+        }
+        i = i + 1;
+    }
+    printfloat( sum );
+}
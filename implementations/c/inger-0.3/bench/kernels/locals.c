@@ -0,0 +1,58 @@
+/* C equivalent of locals.i. */
+
+void printint( int x );
+
+int scramble( int x )
+{
+    int a, b, c, d;
+
+    a = ( x & 1023 ) * 7919;
+    b = a ^ 255;
+    c = b + x;
+    d = c - a;
+    return( ( a + b + c + d ) & 65535 );
+}
+
+int step( int x )
+{
+    int low = -20;
+    int high = +300;
+    char letter = 'A';
+    int odd = 0;
+    float scale = -2.5;
+    float whole = -3;
+    int r;
+
+    if( x % 2 == 1 )
+    {
+        odd = 1;
+    }
+    r = low + high + letter;
+    if( odd )
+    {
+        r = r + 1;
+    }
+    if( scale < -2.0f )
+    {
+        r = r + 2;
+    }
+    if( whole == -3.0f )
+    {
+        r = r + 4;
+    }
+    return( r + x % 7 );
+}
+
+int main( void )
+{
+    int i = 0, sum = 0;
+
+    while( i < 5000000 )
+    {
+        sum = ( sum + scramble( i ) ) & 16777215;
+        sum = ( sum + step( i ) ) & 16777215;
+        i = i + 1;
+    }
+    printint( sum );
+    return( 0 );
+}
@@ -0,0 +1,64 @@
+/* locals.i - generated-code benchmark kernel.
+   Local initializers: a function whose int, char, bool
+   and float locals start from literals, some of them
+   negated, called in a loop after another function has
+   left other values on the stack.
+   Prints a checksum that must match locals.c. */
+
+module locals;
+
+#import "runtime.ih"
+
+scramble: int x -> int
+{
+    int a, b, c, d;
+
+    a = ( x & 1023 ) * 7919;
+    b = a ^ 255;
+    c = b + x;
+    d = c - a;
+    return( ( a + b + c + d ) & 65535 );
+}
+
+step: int x -> int
+{
+    int low = -20;
+    int high = +300;
+    char letter = 'A';
+    bool odd = false;
+    float scale = -2.5;
+    float whole = -3;
+    int r;
+
+    if( x % 2 == 1 )
+    {
+        odd = true;
+    }
+    r = low + high + letter;
+    if( odd )
+    {
+        r = r + 1;
+    }
+    if( scale < -2.0 )
+    {
+        r = r + 2;
+    }
+    if( whole == -3.0 )
+    {
+        r = r + 4;
+    }
+    return( r + x % 7 );
+}
+
+start main: void -> void
+{
+    int i = 0, sum = 0;
+
+    while( i < 5000000 ) do
+    {
+        sum = ( sum + scramble( i ) ) & 16777215;
+        sum = ( sum + step( i ) ) & 16777215;
+        i = i + 1;
+    }
+    printint( sum );
+}
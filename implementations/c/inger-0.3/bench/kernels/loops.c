@@ -0,0 +1,21 @@
+/* C equivalent of loops.i. */
+
+void printint( int x );
+
+int main( void )
+{
+    int i = 0, j, sum = 0;
+
+    while( i < 30000 )
+    {
+        j = 0;
+        while( j < 1000 )
+        {
+            sum = ( sum + ( i ^ j ) ) & 1048575;
+            j = j + 1;
+        }
+        i = i + 1;
+    }
+    printint( sum );
+    return( 0 );
+}
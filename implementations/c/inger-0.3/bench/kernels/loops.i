@@ -0,0 +1,24 @@
+/* loops.i - generated-code benchmark kernel.
+   Nested counted loops with a running checksum.
+   Prints a checksum that must match loops.c. */
+
+module loops;
+
+#import "runtime.ih"
+
+start main: void -> void
+{
+    int i = 0, j, sum = 0;
+
+    while( i < 30000 ) do
+    {
+        j = 0;
+        while( j < 1000 ) do
+        {
+            sum = ( sum + ( i ^ j ) ) & 1048575;
+            j = j + 1;
+        }
+        i = i + 1;
+    }
+    printint( sum );
+}
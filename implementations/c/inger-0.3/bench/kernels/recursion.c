@@ -0,0 +1,18 @@
+/* C equivalent of recursion.i. */
+
+void printint( int x );
+
+int fib( int n )
+{
+    if( n < 2 )
+    {
+        return( n );
+    }
+    return( fib( n - 1 ) + fib( n - 2 ) );
+}
+
+int main( void )
+{
+    printint( fib( 32 ) );
+    return( 0 );
+}
@@ -0,0 +1,21 @@
+/* recursion.i - generated-code benchmark kernel.
+   Doubly recursive Fibonacci, like samples/factor.i.
+   Prints a checksum that must match recursion.c. */
+
+module recursion;
+
+#import "runtime.ih"
+
+fib: int n -> int
+{
+    if( n < 2 )
+    {
+        return( n );
+    }
+    return( fib( n - 1 ) + fib( n - 2 ) );
+}
+
+start main: void -> void
+{
+    printint( fib( 32 ) );
+}
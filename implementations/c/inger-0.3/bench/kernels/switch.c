@@ -0,0 +1,52 @@
+/* C equivalent of switch.i. */
+
+void printint( int x );
+
+int main( void )
+{
+    int state = 0, i = 0, acc = 0;
+
+    while( i < 20000000 )
+    {
+        switch( state )
+        {
+        case 0:
+            acc = acc + 1;
+            state = 3;
+            break;
+        case 1:
+            acc = acc ^ 5;
+            state = 6;
+            break;
+        case 2:
+            acc = acc + 7;
+            state = 1;
+            break;
+        case 3:
+            acc = acc - 2;
+            state = 5;
+            break;
+        case 4:
+            acc = acc << 1;
+            state = 2;
+            break;
+        case 5:
+            acc = acc & 65535;
+            state = 4;
+            break;
+        case 6:
+            acc = acc + i;
+            state = 7;
+            break;
+        case 7:
+            acc = acc % 100003;
+            state = 0;
+            break;
+        default:
+            state = 0;
+        }
+        i = i + 1;
+    }
+    printint( acc );
+    return( 0 );
+}
@@ -0,0 +1,65 @@
+/* switch.i - generated-code benchmark kernel.
+   Switch dispatch: a state machine with eight dense states.
+   Prints a checksum that must match switch.c. */
+
+module dispatch;
+
+#import "runtime.ih"
+
+start main: void -> void
+{
+    int state = 0, i = 0, acc = 0;
+
+    while( i < 20000000 ) do
+    {
+        switch( state )
+        {
+            case 0
+            {
+                acc = acc + 1;
+                state = 3;
+            }
+            case 1
+            {
+                acc = acc ^ 5;
+                state = 6;
+            }
+            case 2
+            {
+                acc = acc + 7;
+                state = 1;
+            }
+            case 3
+            {
+                acc = acc - 2;
+                state = 5;
+            }
+            case 4
+            {
+                acc = acc << 1;
+                state = 2;
+            }
+            case 5
+            {
+                acc = acc & 65535;
+                state = 4;
+            }
+            case 6
+            {
+                acc = acc + i;
+                state = 7;
+            }
+            case 7
+            {
+                acc = acc % 100003;
+                state = 0;
+            }
+            default
+            {
+                state = 0;
+            }
+        }
+        i = i + 1;
+    }
+    printint( acc );
+}
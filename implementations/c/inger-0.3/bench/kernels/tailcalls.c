@@ -0,0 +1,55 @@
+/* C equivalent of tailcalls.i. */
+
+void printint( int x );
+
+int isodd( int n );
+
+int sumto( int n, int acc )
+{
+    if( n == 0 )
+    {
+        return( acc );
+    }
+    return( sumto( n - 1, ( acc + n * 3 ) & 1048575 ) );
+}
+
+int gcd( int a, int b )
+{
+    if( b == 0 )
+    {
+        return( a );
+    }
+    return( gcd( b, a % b ) );
+}
+
+int iseven( int n )
+{
+    if( n == 0 )
+    {
+        return( 1 );
+    }
+    return( isodd( n - 1 ) );
+}
+
+int isodd( int n )
+{
+    if( n == 0 )
+    {
+        return( 0 );
+    }
+    return( iseven( n - 1 ) );
+}
+
+int main( void )
+{
+    int i = 0, sum = 0;
+    while( i < 200 )
+    {
+        sum = ( sum + sumto( 50000 + i, i ) ) & 1048575;
+        sum = sum + gcd( 1000000 + i * 7919, 3000 + i * 13 );
+        sum = sum + iseven( 20000 + i );
+        i = i + 1;
+    }
+    printint( sum );
+    return( 0 );
+}
@@ -0,0 +1,60 @@
+/* tailcalls.i - generated-code benchmark kernel.
+   Recursion in tail position: a self-recursive sum
+   with an accumulator, Euclid's gcd and a pair of
+   mutually recursive functions.
+   Prints a checksum that must match tailcalls.c. */
+
+module tailcalls;
+
+#import "runtime.ih"
+
+extern isodd: int n -> int;
+
+sumto: int n, acc -> int
+{
+    if( n == 0 )
+    {
+        return( acc );
+    }
+    return( sumto( n - 1, ( acc + n * 3 ) & 1048575 ) );
+}
+
+gcd: int a, b -> int
+{
+    if( b == 0 )
+    {
+        return( a );
+    }
+    return( gcd( b, a % b ) );
+}
+
+iseven: int n -> int
+{
+    if( n == 0 )
+    {
+        return( 1 );
+    }
+    return( isodd( n - 1 ) );
+}
+
+isodd: int n -> int
+{
+    if( n == 0 )
+    {
+        return( 0 );
+    }
+    return( iseven( n - 1 ) );
+}
+
+start main: void -> void
+{
+    int i = 0, sum = 0;
+    while( i < 200 ) do
+    {
+        sum = ( sum + sumto( 50000 + i, i ) ) & 1048575;
+        sum = sum + gcd( 1000000 + i * 7919, 3000 + i * 13 );
+        sum = sum + iseven( 20000 + i );
+        i = i + 1;
+    }
+    printint( sum );
+}
@@ -0,0 +1,57 @@
+/* C equivalent of vectors.i. */
+
+void printint( int x );
+void printfloat( float x );
+
+int ia[4096];
+int ib[4096];
+int ic[4096];
+float fa[4096];
+float fb[4096];
+float fc[4096];
+
+int main( void )
+{
+    int pass = 0, i, sum = 0;
+    float fsum = 0.0f;
+
+    i = 0;
+    while( i < 4096 )
+    {
+        ib[i] = i * 13;
+        ic[i] = 4096 - i;
+        fb[i] = ( i % 100 ) * 0.25f;
+        fc[i] = 1.0f;
+        i = i + 1;
+    }
+
+    while( pass < 5000 )
+    {
+        i = 0;
+        while( i < 4096 )
+        {
+            ia[i] = ib[i] + ic[i];
+            fa[i] = fb[i] * 0.5f + fc[i];
+            i = i + 1;
+        }
+        i = 0;
+        while( i < 4095 )
+        {
+            ib[i] = ( ( ia[i] ^ ic[i + 1] ) & 65535 ) - ( ia[i] >> 2 );
+            fb[i] = ( fa[i] - fc[i] ) * 1.5f;
+            i = i + 1;
+        }
+        pass = pass + 1;
+    }
+
+    i = 0;
+    while( i < 4096 )
+    {
+        sum = ( sum * 7 + ia[i] + ib[i] ) & 16777215;
+        fsum = fsum + fa[i] + fb[i];
+        i = i + 1;
+    }
+    printint( sum );
+    printfloat( fsum );
+    return( 0 );
+}
@@ -0,0 +1,61 @@
+/* vectors.i - generated-code benchmark kernel.
+   Counted loops over int and float arrays whose
+   iterations are independent, as element-wise sums,
+   scaled sums and masks, repeated five thousand times.
+   Prints a checksum that must match vectors.c. */
+
+module vectors;
+
+#import "runtime.ih"
+
+int ia[4096];
+int ib[4096];
+int ic[4096];
+float fa[4096];
+float fb[4096];
+float fc[4096];
+
+start main: void -> void
+{
+    int pass = 0, i, sum = 0;
+    float fsum = 0.0;
+
+    i = 0;
+    while( i < 4096 ) do
+    {
+        ib[i] = i * 13;
+        ic[i] = 4096 - i;
+        fb[i] = ( i % 100 ) * 0.25;
+        fc[i] = 1.0;
+        i = i + 1;
+    }
+
+    while( pass < 5000 ) do
+    {
+        i = 0;
+        while( i < 4096 ) do
+        {
+            ia[i] = ib[i] + ic[i];
+            fa[i] = fb[i] * 0.5 + fc[i];
+            i = i + 1;
+        }
+        i = 0;
+        while( i < 4095 ) do
+        {
+            ib[i] = ( ( ia[i] ^ ic[i + 1] ) & 65535 ) - ( ia[i] >> 2 );
+            fb[i] = ( fa[i] - fc[i] ) * 1.5;
+            i = i + 1;
+        }
+        pass = pass + 1;
+    }
+
+    i = 0;
+    while( i < 4096 ) do
+    {
+        sum = ( sum * 7 + ia[i] + ib[i] ) & 16777215;
+        fsum = fsum + fa[i] + fb[i];
+        i = i + 1;
+    }
+    printint( sum );
+    printfloat( fsum );
+}
@@ -0,0 +1,298 @@
+/*************************************************
+ *                                               *
+ *  Module: perfrun.c                            *
+ *  Description:                                 *
+ *      Runs a program and reports its cycles,   *
+ *      instructions and run time, measured      *
+ *      with perf_event_open.                    *
+ *  Modifications:                               *
+ *                                               *
+ *************************************************
+ *                                               *
+ *   This program is free software; you can      *
+ *   redistribute it and/or modify  it under     *
+ *   the terms of the GNU General Public         *
+ *   License as published by the Free            *
+ *   Software Foundation; either version 2       *
+ *   of the License, or (at your option) any     *
+ *   later version.                              *
+ *                                               *
+ *************************************************/
+
+/*
+ *  Usage: perfrun [-r runs] [-o file] program [args...]
+ *
+ *  The program is run [runs] times (default 3). The
+ *  counters only count user space, and are enabled
+ *  when the program is exec'ed, so the fork and the
+ *  runner itself are not measured. The lowest value
+ *  of every counter over all runs is reported, one
+ *  "name value" line per counter:
+ *
+ *      cycles        CPU cycles
+ *      instructions  instructions retired
+ *      task-clock    CPU time in nanoseconds
+ *      seconds       wall-clock time
+ *
+ *  Counters that the kernel or the machine does not
+ *  provide (for example hardware counters in a virtual
+ *  machine, or with a restrictive perf_event_paranoid)
+ *  are reported as "n/a".
+ *
+ *  Only the first run's standard output is passed on;
+ *  later runs write to /dev/null. The exit status is
+ *  that of the last run, or 128 plus the signal
+ *  number if the program was killed.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <linux/perf_event.h>
+
+/*************************************************
+ *                                               *
+ *  MACROS                                       *
+ *                                               *
+ *************************************************/
+
+#define DEFAULT_RUNS        3
+
+#define ERR_USAGE           "usage: perfrun [-r runs] [-o file] program [args...]\n"
+#define ERR_OPEN            "perfrun: could not open %s for writing.\n"
+#define ERR_EXEC            "perfrun: could not run %s: %s\n"
+#define ERR_FORK            "perfrun: fork failed: %s\n"
+
+/*************************************************
+ *                                               *
+ *  TYPES                                        *
+ *                                               *
+ *************************************************/
+
+enum Counters
+{
+    COUNTER_CYCLES = 0,
+    COUNTER_INSTRUCTIONS,
+    COUNTER_TASK_CLOCK,
+    NR_OF_COUNTERS
+};
+
+typedef struct Counter
+{
+    char *name;
+    unsigned int type;
+    unsigned long long config;
+} Counter;
+
+/*************************************************
+ *                                               *
+ *  GLOBALS                                      *
+ *                                               *
+ *************************************************/
+
+static Counter counters[NR_OF_COUNTERS] =
+{
+    { "cycles",       PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+    { "instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+    { "task-clock",   PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK }
+};
+
+/* Lowest value seen for every counter; -1 if the
+ * counter is not available. */
+static long long best[NR_OF_COUNTERS];
+static double bestSeconds = -1;
+
+/*************************************************
+ *                                               *
+ *  STATIC FUNCTION DEFINITIONS                  *
+ *                                               *
+ *************************************************/
+
+static double Now()
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return( ts.tv_sec + ts.tv_nsec * 1e-9 );
+}
+
+/*
+ *  Opens counter [counter] for process [pid]. The
+ *  counter starts when [pid] calls exec. Returns the
+ *  file descriptor, or -1 if the counter is not
+ *  available.
+ */
+static int OpenCounter( Counter *counter, pid_t pid )
+{
+    struct perf_event_attr attr;
+
+    memset( &attr, 0, sizeof( attr ) );
+    attr.size = sizeof( attr );
+    attr.type = counter->type;
+    attr.config = counter->config;
+    attr.disabled = 1;
+    attr.enable_on_exec = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+
+    return( syscall( __NR_perf_event_open, &attr, pid, -1, -1, 0 ) );
+}
+
+/*
+ *  Runs [argv] once, and records the counters.
+ *  Returns the exit status as described above.
+ */
+static int Run( char **argv, int quiet )
+{
+    int fds[NR_OF_COUNTERS];
+    int sync[2];
+    int i, status, devnull;
+    long long value;
+    double start, seconds;
+    pid_t pid;
+    char go;
+
+    if( pipe( sync ) != 0 )
+    {
+        fprintf( stderr, ERR_FORK, strerror( errno ) );
+        exit( 1 );
+    }
+
+    pid = fork();
+    if( pid < 0 )
+    {
+        fprintf( stderr, ERR_FORK, strerror( errno ) );
+        exit( 1 );
+    }
+
+    if( pid == 0 )
+    {
+        /* Wait until the parent has attached the counters. */
+        close( sync[1] );
+        if( read( sync[0], &go, 1 ) != 1 ) _exit( 127 );
+        close( sync[0] );
+
+        if( quiet )
+        {
+            devnull = open( "/dev/null", O_WRONLY );
+            if( devnull >= 0 ) dup2( devnull, STDOUT_FILENO );
+        }
+        execvp( argv[0], argv );
+        fprintf( stderr, ERR_EXEC, argv[0], strerror( errno ) );
+        _exit( 127 );
+    }
+
+    close( sync[0] );
+    for( i = 0; i < NR_OF_COUNTERS; i++ )
+    {
+        fds[i] = OpenCounter( &counters[i], pid );
+    }
+
+    start = Now();
+    go = 1;
+    if( write( sync[1], &go, 1 ) != 1 )
+    {
+        fprintf( stderr, ERR_FORK, strerror( errno ) );
+    }
+    close( sync[1] );
+    waitpid( pid, &status, 0 );
+    seconds = Now() - start;
+
+    for( i = 0; i < NR_OF_COUNTERS; i++ )
+    {
+        if( fds[i] < 0 ) continue;
+        if( read( fds[i], &value, sizeof( value ) ) == sizeof( value ) )
+        {
+            if( best[i] < 0 || value < best[i] ) best[i] = value;
+        }
+        close( fds[i] );
+    }
+    if( bestSeconds < 0 || seconds < bestSeconds ) bestSeconds = seconds;
+
+    if( WIFSIGNALED( status ) ) return( 128 + WTERMSIG( status ) );
+    return( WEXITSTATUS( status ) );
+}
+
+static void PrintCounter( FILE *fp, char *name, long long value )
+{
+    if( value < 0 )
+    {
+        fprintf( fp, "%s n/a\n", name );
+    }
+    else
+    {
+        fprintf( fp, "%s %lld\n", name, value );
+    }
+}
+
+/*************************************************
+ *                                               *
+ *  EXPORTED FUNCTION DEFINITIONS                *
+ *                                               *
+ *************************************************/
+
+int main( int argc, char **argv )
+{
+    int runs = DEFAULT_RUNS;
+    char *outFilename = NULL;
+    FILE *fp = stderr;
+    int i, c, status = 0;
+
+    while( ( c = getopt( argc, argv, "+r:o:" ) ) != -1 )
+    {
+        switch( c )
+        {
+        case 'r':
+            runs = atoi( optarg );
+            break;
+        case 'o':
+            outFilename = optarg;
+            break;
+        default:
+            fprintf( stderr, ERR_USAGE );
+            return( 1 );
+        }
+    }
+    if( optind >= argc || runs < 1 )
+    {
+        fprintf( stderr, ERR_USAGE );
+        return( 1 );
+    }
+
+    for( i = 0; i < NR_OF_COUNTERS; i++ )
+    {
+        best[i] = -1;
+    }
+
+    for( i = 0; i < runs; i++ )
+    {
+        status = Run( argv + optind, i > 0 );
+        if( status != 0 ) break;
+    }
+
+    if( outFilename != NULL )
+    {
+        fp = fopen( outFilename, "w" );
+        if( fp == NULL )
+        {
+            fprintf( stderr, ERR_OPEN, outFilename );
+            return( 1 );
+        }
+    }
+    for( i = 0; i < NR_OF_COUNTERS; i++ )
+    {
+        PrintCounter( fp, counters[i].name, best[i] );
+    }
+    fprintf( fp, "seconds %.6f\n", bestSeconds );
+    if( fp != stderr ) fclose( fp );
+
+    return( status );
+}
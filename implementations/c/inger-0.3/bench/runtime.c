@@ -0,0 +1,221 @@
+/*************************************************
+ *                                               *
+ *  Module: runtime.c                            *
+ *  Description:                                 *
+ *      Minimal freestanding runtime for the     *
+ *      generated-code benchmarks: program       *
+ *      entry and number output, using Linux     *
+ *      system calls only.                       *
+ *  Modifications:                               *
+ *                                               *
+ *************************************************
+ *                                               *
+ *   This program is free software; you can      *
+ *   redistribute it and/or modify  it under     *
+ *   the terms of the GNU General Public         *
+ *   License as published by the Free            *
+ *   Software Foundation; either version 2       *
+ *   of the License, or (at your option) any     *
+ *   later version.                              *
+ *                                               *
+ *************************************************/
+
+/*
+ *  The benchmark kernels (both the Inger and the C
+ *  versions) are linked against this file instead of
+ *  the C library, so that only an assembler and a
+ *  linker are needed, and process startup costs the
+ *  same for every variant.
+ *
+ *  Build with:
+ *      cc -m32 -ffreestanding -fno-pic -fno-stack-protector -c runtime.c
+ *  or, for the x86_64 target, with -m64.
+ */
+
+/*************************************************
+ *                                               *
+ *  MACROS                                       *
+ *                                               *
+ *************************************************/
+
+/* Linux system call numbers. */
+#ifdef __x86_64__
+#define SYS_EXIT    60
+#define SYS_WRITE   1
+#else
+#define SYS_EXIT    1
+#define SYS_WRITE   4
+#endif
+
+#define STDOUT      1
+
+/*************************************************
+ *                                               *
+ *  FORWARD DECLARATIONS                         *
+ *                                               *
+ *************************************************/
+
+/* The Inger start function, or the C kernel's main. */
+extern int main( void );
+
+void runtime_exit( int status );
+void printint( int x );
+void printfloat( float x );
+
+/*************************************************
+ *                                               *
+ *  STATIC FUNCTION DEFINITIONS                  *
+ *                                               *
+ *************************************************/
+
+static long SystemCall3( long number, long a, long b, long c )
+{
+    long result;
+
+#ifdef __x86_64__
+    __asm__ volatile( "syscall"
+                      : "=a" ( result )
+                      : "a" ( number ), "D" ( a ), "S" ( b ), "d" ( c )
+                      : "rcx", "r11", "memory" );
+#else
+    __asm__ volatile( "int $0x80"
+                      : "=a" ( result )
+                      : "a" ( number ), "b" ( a ), "c" ( b ), "d" ( c )
+                      : "memory" );
+#endif
+    return( result );
+}
+
+/*************************************************
+ *                                               *
+ *  EXPORTED FUNCTION DEFINITIONS                *
+ *                                               *
+ *************************************************/
+
+/*
+ *  Program entry: align the stack, call main and
+ *  exit. The exit status is always 0, because the
+ *  Inger start function returns no value.
+ */
+#ifdef __x86_64__
+__asm__( ".text\n"
+         ".globl _start\n"
+         "_start:\n"
+         "\txorl\t%ebp, %ebp\n"
+         "\tandq\t$-16, %rsp\n"
+         "\tcall\tmain\n"
+         "\txorl\t%edi, %edi\n"
+         "\tcall\truntime_exit\n" );
+#else
+__asm__( ".text\n"
+         ".globl _start\n"
+         "_start:\n"
+         "\txorl\t%ebp, %ebp\n"
+         "\tandl\t$-16, %esp\n"
+         "\tcall\tmain\n"
+         "\tpushl\t$0\n"
+         "\tcall\truntime_exit\n" );
+#endif
+
+void runtime_exit( int status )
+{
+    for( ;; )
+    {
+        SystemCall3( SYS_EXIT, status, 0, 0 );
+    }
+}
+
+/*
+ *  Writes [x] in decimal to standard output,
+ *  followed by a newline (cdecl on i386, as declared
+ *  by kernels/runtime.ih).
+ */
+void printint( int x )
+{
+    char buffer[16];
+    unsigned int value;
+    int pos = sizeof( buffer );
+
+    buffer[--pos] = '\n';
+    value = ( x < 0 ) ? -(unsigned int) x : (unsigned int) x;
+    do
+    {
+        buffer[--pos] = '0' + value % 10;
+        value /= 10;
+    }
+    while( value != 0 );
+    if( x < 0 )
+    {
+        buffer[--pos] = '-';
+    }
+
+    SystemCall3( SYS_WRITE, STDOUT, (long) ( buffer + pos ), sizeof( buffer ) - pos );
+}
+
+/*
+ *  Writes [x] to standard output in the form
+ *  d.dddddde+XX, followed by a newline. Only double
+ *  arithmetic and 32-bit integers are used, so that
+ *  no support library is needed; the output does not
+ *  depend on the variant that computed [x].
+ */
+void printfloat( float x )
+{
+    char buffer[24];
+    union { float f; unsigned int bits; } u;
+    double value;
+    int exponent = 0, digits, pos = sizeof( buffer ), i;
+
+    u.f = x;
+    buffer[--pos] = '\n';
+    if( ( u.bits & 0x7f800000 ) == 0x7f800000 )
+    {
+        /* Infinity or NaN. */
+        buffer[--pos] = ( u.bits & 0x007fffff ) ? 'n' : 'f';
+        buffer[--pos] = ( u.bits & 0x007fffff ) ? 'a' : 'n';
+        buffer[--pos] = ( u.bits & 0x007fffff ) ? 'n' : 'i';
+    }
+    else
+    {
+        value = ( u.bits & 0x80000000 ) ? -(double) x : (double) x;
+        if( value != 0.0 )
+        {
+            while( value >= 10.0 )
+            {
+                value /= 10.0;
+                exponent++;
+            }
+            while( value < 1.0 )
+            {
+                value *= 10.0;
+                exponent--;
+            }
+        }
+
+        /* Seven significant digits. */
+        digits = (int) ( value * 1000000.0 + 0.5 );
+        if( digits >= 10000000 )
+        {
+            digits /= 10;
+            exponent++;
+        }
+
+        buffer[--pos] = '0' + ( exponent < 0 ? -exponent : exponent ) % 10;
+        buffer[--pos] = '0' + ( exponent < 0 ? -exponent : exponent ) / 10;
+        buffer[--pos] = ( exponent < 0 ) ? '-' : '+';
+        buffer[--pos] = 'e';
+        for( i = 0; i < 6; i++ )
+        {
+            buffer[--pos] = '0' + digits % 10;
+            digits /= 10;
+        }
+        buffer[--pos] = '.';
+        buffer[--pos] = '0' + digits;
+    }
+    if( u.bits & 0x80000000 )
+    {
+        buffer[--pos] = '-';
+    }
+
+    SystemCall3( SYS_WRITE, STDOUT, (long) ( buffer + pos ), sizeof( buffer ) - pos );
+}
@@ -0,0 +1,924 @@
+/*************************************************
+ *                                               *
+ *  Module: asm.c                                *
+ *  Description:                                 *
+ *      In-memory x86 instruction list built     *
+ *      by the code generator, and its           *
+ *      formatting as AT&T assembly.             *
+ *  Modifications:                               *
+ *                                               *
+ *************************************************
+ *                                               *
+ *   This program is free software; you can      *
+ *   redistribute it and/or modify  it under     *
+ *   the terms of the GNU General Public         *
+ *   License as published by the Free            *
+ *   Software Foundation; either version 2       *
+ *   of the License, or (at your option) any     *
+ *   later version.                              *
+ *                                               *
+ *************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include "defs.h"
+#include "asm.h"
+#include "options.h"
+
+/*************************************************
+ *                                               *
+ *  MACROS                                       *
+ *                                               *
+ *************************************************/
+
+/* Initial number of instructions in a code list. */
+#define INITIAL_CAPACITY    256
+
+/* Longest formatted instruction, directive text excluded. */
+#define MAX_LINE            128
+
+/* Longest directive. */
+#define MAX_DIRECTIVE       256
+
+/*************************************************
+ *                                               *
+ *  TYPES                                        *
+ *                                               *
+ *************************************************/
+
+typedef struct OpcodeInfo
+{
+    char *mnemonic;
+    BOOL suffix;            /* takes a b, w or l size suffix */
+} OpcodeInfo;
+
+/*************************************************
+ *                                               *
+ *  GLOBALS                                      *
+ *                                               *
+ *************************************************/
+
+/* Indexed by enum Opcodes. */
+static OpcodeInfo opcodes[NR_OF_OPCODES] =
+{
+    { "mov",   TRUE },
+    { "movzb", TRUE },
+    { "movslq", FALSE },
+    { "cmov",  FALSE },
+    { "set",   FALSE },
+    { "push",  TRUE },
+    { "pop",   TRUE },
+    { "pusha", FALSE },
+    { "popa",  FALSE },
+    { "xchg",  TRUE },
+    { "neg",   TRUE },
+    { "add",   TRUE },
+    { "sub",   TRUE },
+    { "imul",  TRUE },
+    { "idiv",  TRUE },
+    { "cltd",  FALSE },
+    { "lea",   TRUE },
+    { "xor",   TRUE },
+    { "cmp",   TRUE },
+    { "test",  TRUE },
+    { "bt",    TRUE },
+    { "and",   TRUE },
+    { "or",    TRUE },
+    { "sal",   TRUE },
+    { "sar",   TRUE },
+    { "shr",   TRUE },
+    { "movss", FALSE },
+    { "movd",  FALSE },
+    { "addss", FALSE },
+    { "subss", FALSE },
+    { "mulss", FALSE },
+    { "divss", FALSE },
+    { "xorps", FALSE },
+    { "ucomiss", FALSE },
+    { "cvtsi2ss", TRUE },
+    { "flds",  FALSE },
+    { "fstps", FALSE },
+    { "movups", FALSE },
+    { "addps", FALSE },
+    { "subps", FALSE },
+    { "mulps", FALSE },
+    { "divps", FALSE },
+    { "unpcklps", FALSE },
+    { "movlhps", FALSE },
+    { "movdqu", FALSE },
+    { "paddd", FALSE },
+    { "psubd", FALSE },
+    { "pand",  FALSE },
+    { "por",   FALSE },
+    { "pxor",  FALSE },
+    { "pslld", FALSE },
+    { "psrad", FALSE },
+    { "call",  FALSE },
+    { "j",     FALSE },
+    { "jmp",   FALSE },
+    { "leave", FALSE },
+    { "ret",   FALSE },
+    { NULL,    FALSE },
+    { NULL,    FALSE },
+    { NULL,    FALSE }
+};
+
+/* Indexed by enum Conditions. */
+static char *conditions[NR_OF_CONDITIONS] =
+{
+    "e", "ne", "g", "ge", "l", "le", "ng", "nge", "nl", "nle", "a", "ae", "b", "be", "p", "np"
+};
+
+/* Indexed by enum Conditions: the opposite condition. */
+static int inverses[NR_OF_CONDITIONS] =
+{
+    COND_NE, COND_E, COND_LE, COND_L, COND_GE, COND_G, COND_G, COND_GE, COND_L, COND_LE,
+    COND_BE, COND_B, COND_AE, COND_A, COND_NP, COND_P
+};
+
+/* Register names for 1, 2, 4 and 8 byte operands. On
+ * i386, the byte registers 4 to 7 are %ah up to %bh.
+ * SSE registers have one name. */
+static char *registers[NR_OF_REGISTERS][4] =
+{
+    { "al",   "ax",   "eax",  "rax" },
+    { "cl",   "cx",   "ecx",  "rcx" },
+    { "dl",   "dx",   "edx",  "rdx" },
+    { "bl",   "bx",   "ebx",  "rbx" },
+    { "spl",  "sp",   "esp",  "rsp" },
+    { "bpl",  "bp",   "ebp",  "rbp" },
+    { "sil",  "si",   "esi",  "rsi" },
+    { "dil",  "di",   "edi",  "rdi" },
+    { "r8b",  "r8w",  "r8d",  "r8"  },
+    { "r9b",  "r9w",  "r9d",  "r9"  },
+    { "r10b", "r10w", "r10d", "r10" },
+    { "r11b", "r11w", "r11d", "r11" },
+    { "r12b", "r12w", "r12d", "r12" },
+    { "r13b", "r13w", "r13d", "r13" },
+    { "r14b", "r14w", "r14d", "r14" },
+    { "r15b", "r15w", "r15d", "r15" },
+    { "xmm0", "xmm0", "xmm0", "xmm0" },
+    { "xmm1", "xmm1", "xmm1", "xmm1" },
+    { "xmm2", "xmm2", "xmm2", "xmm2" },
+    { "xmm3", "xmm3", "xmm3", "xmm3" },
+    { "xmm4", "xmm4", "xmm4", "xmm4" },
+    { "xmm5", "xmm5", "xmm5", "xmm5" },
+    { "xmm6", "xmm6", "xmm6", "xmm6" },
+    { "xmm7", "xmm7", "xmm7", "xmm7" }
+};
+
+static char *highByteRegisters[4] =
+{
+    "ah", "ch", "dh", "bh"
+};
+
+static AsmCode code = { NULL, 0, 0 };
+
+/*************************************************
+ *                                               *
+ *  STATIC FUNCTION DEFINITIONS                  *
+ *                                               *
+ *************************************************/
+
+static char *RegisterName( int reg, int size )
+{
+    switch( size )
+    {
+    case 1:
+        if( GetTarget() == TARGET_I386 && reg >= REG_ESP && reg <= REG_EDI )
+        {
+            return( highByteRegisters[reg - REG_ESP] );
+        }
+        return( registers[reg][0] );
+    case 2:
+        return( registers[reg][1] );
+    case 8:
+        return( registers[reg][3] );
+    default:
+        return( registers[reg][2] );
+    }
+}
+
+static char Suffix( int size )
+{
+    switch( size )
+    {
+    case 1:
+        return( 'b' );
+    case 2:
+        return( 'w' );
+    case 8:
+        return( 'q' );
+    default:
+        return( 'l' );
+    }
+}
+
+/*
+ *  Checks whether [instruction] works on the stack or
+ *  frame pointer, and so on 64-bit operands on x86_64.
+ */
+static BOOL IsStackInstruction( Instruction *instruction )
+{
+    int i;
+
+    if( instruction->opcode == ASM_PUSH || instruction->opcode == ASM_POP )
+    {
+        return( TRUE );
+    }
+    for( i = 0; i < instruction->operandCount; i++ )
+    {
+        if( instruction->operands[i].kind == OPERAND_REGISTER
+            && ( instruction->operands[i].base == REG_ESP
+                 || instruction->operands[i].base == REG_EBP ) )
+        {
+            return( TRUE );
+        }
+    }
+    return( FALSE );
+}
+
+/*
+ *  Returns a new, empty instruction at the end of
+ *  the code list.
+ */
+static Instruction *NewInstruction( int opcode, int size )
+{
+    Instruction *instruction;
+
+    if( code.count == code.capacity )
+    {
+        code.capacity = ( code.capacity == 0 ) ? INITIAL_CAPACITY : code.capacity * 2;
+        code.instructions = (Instruction *) realloc( code.instructions,
+            code.capacity * sizeof( Instruction ) );
+        if( code.instructions == NULL ) BAILOUT( ERR_NOMEM );
+    }
+
+    instruction = &code.instructions[code.count++];
+    memset( instruction, 0, sizeof( Instruction ) );
+    instruction->opcode = opcode;
+    instruction->size = size;
+    instruction->cond = COND_NONE;
+    return( instruction );
+}
+
+/*
+ *  Formats [operand] at [str]. Returns the number of
+ *  characters written.
+ */
+static int FormatOperand( char *str, Operand *operand, int size )
+{
+    char *start = str;
+
+    switch( operand->kind )
+    {
+    case OPERAND_REGISTER:
+        str += sprintf( str, "%%%s", RegisterName( operand->base, size ) );
+        break;
+    case OPERAND_IMMEDIATE:
+        str += sprintf( str, "$%ld", operand->value );
+        break;
+    case OPERAND_LABEL:
+        str += sprintf( str, ".L%ld", operand->value );
+        break;
+    case OPERAND_TABLE:
+        str += sprintf( str, "*.L%ld(,%%%s,%d)", operand->value,
+            RegisterName( operand->index, AsmWordSize() ), operand->scale );
+        break;
+    case OPERAND_MEMORY:
+        if( operand->symbol != NULL )
+        {
+            str += sprintf( str, "%s", operand->symbol );
+            if( operand->value != 0 )
+            {
+                str += sprintf( str, "%+ld", operand->value );
+            }
+        }
+        else if( operand->value != 0 )
+        {
+            str += sprintf( str, "%ld", operand->value );
+        }
+        if( operand->base != REG_NONE || operand->index != REG_NONE )
+        {
+            *str++ = '(';
+            if( operand->base != REG_NONE )
+            {
+                str += sprintf( str, "%%%s", RegisterName( operand->base, AsmWordSize() ) );
+            }
+            if( operand->index != REG_NONE )
+            {
+                str += sprintf( str, ",%%%s,%d", RegisterName( operand->index, AsmWordSize() ),
+                    operand->scale );
+            }
+            *str++ = ')';
+        }
+        else if( operand->symbol != NULL && GetTarget() == TARGET_X86_64 )
+        {
+            str += sprintf( str, "(%%rip)" );
+        }
+        break;
+    }
+    *str = '\0';
+    return( str - start );
+}
+
+/*
+ *  Formats [instruction] as a line of assembly at
+ *  [str]. Returns the number of characters written.
+ */
+static int FormatInstruction( char *str, Instruction *instruction )
+{
+    OpcodeInfo *info;
+    Operand *operand;
+    char *start = str;
+    int i, size, count;
+
+    switch( instruction->opcode )
+    {
+    case ASM_DELETED:
+        return( 0 );
+    case ASM_DIRECTIVE:
+        return( sprintf( str, "%s\n", instruction->text ) );
+    case ASM_LABEL:
+        if( instruction->operands[0].kind == OPERAND_LABEL )
+        {
+            return( sprintf( str, ".L%ld:\n", instruction->operands[0].value ) );
+        }
+        return( sprintf( str, "%s:\n", instruction->operands[0].symbol ) );
+    }
+
+    size = instruction->size;
+    if( GetTarget() == TARGET_X86_64 && IsStackInstruction( instruction ) )
+    {
+        size = 8;
+    }
+
+    info = &opcodes[instruction->opcode];
+    *str++ = '\t';
+    str += sprintf( str, "%s", info->mnemonic );
+    if( instruction->cond != COND_NONE )
+    {
+        str += sprintf( str, "%s", conditions[(int) instruction->cond] );
+    }
+    if( info->suffix == TRUE )
+    {
+        *str++ = Suffix( size );
+    }
+
+    /* The operand of a ret only records a float result
+     * register, and is not printed. */
+    count = ( instruction->opcode == ASM_RET ) ? 0 : instruction->operandCount;
+    for( i = 0; i < count; i++ )
+    {
+        operand = &instruction->operands[i];
+        str += sprintf( str, ( i == 0 ) ? "\t" : ", " );
+        switch( instruction->opcode )
+        {
+        case ASM_CALL:
+        case ASM_JMP:
+            /* Direct calls name the function; a register
+             * holds an indirect target. */
+            if( operand->kind == OPERAND_MEMORY && operand->symbol != NULL )
+            {
+                str += sprintf( str, "%s", operand->symbol );
+                continue;
+            }
+            if( operand->kind == OPERAND_REGISTER )
+            {
+                str += sprintf( str, "*%%%s", RegisterName( operand->base, AsmWordSize() ) );
+                continue;
+            }
+            break;
+        case ASM_LEA:
+            if( operand->kind == OPERAND_LABEL )
+            {
+                str += sprintf( str, ( GetTarget() == TARGET_X86_64 ) ? ".L%ld(%%rip)" : ".L%ld",
+                    operand->value );
+                continue;
+            }
+            break;
+        case ASM_MOVSLQ:
+            str += FormatOperand( str, operand, ( i == 0 ) ? 4 : 8 );
+            continue;
+        }
+        str += FormatOperand( str, operand, ( size == 8 ) ? 8 : operand->size );
+    }
+    *str++ = '\n';
+    *str = '\0';
+    return( str - start );
+}
+
+/*
+ *  Returns the mask of the registers used by
+ *  [operand]: the register itself, or the base and
+ *  index registers of a memory operand.
+ */
+static unsigned int OperandRegisters( Operand *operand )
+{
+    unsigned int mask = 0;
+
+    if( operand->kind == OPERAND_REGISTER || operand->kind == OPERAND_MEMORY
+        || operand->kind == OPERAND_TABLE )
+    {
+        if( operand->base != REG_NONE ) mask |= REGISTER_MASK( operand->base );
+        if( operand->index != REG_NONE ) mask |= REGISTER_MASK( operand->index );
+    }
+    return( mask );
+}
+
+/*
+ *  Returns the mask of the register written by
+ *  [operand], if it is a register.
+ */
+static unsigned int WrittenRegister( Operand *operand )
+{
+    if( operand->kind == OPERAND_REGISTER )
+    {
+        return( REGISTER_MASK( operand->base ) );
+    }
+    return( 0 );
+}
+
+/*
+ *  Empties the code list, freeing directive texts.
+ */
+static void ClearCode()
+{
+    int i;
+
+    for( i = 0; i < code.count; i++ )
+    {
+        if( code.instructions[i].text != NULL )
+        {
+            free( code.instructions[i].text );
+        }
+    }
+    code.count = 0;
+}
+
+/*************************************************
+ *                                               *
+ *  EXPORTED FUNCTION DEFINITIONS                *
+ *                                               *
+ *************************************************/
+
+Operand AsmReg( int reg )
+{
+    return( AsmRegSized( reg, 4 ) );
+}
+
+Operand AsmRegSized( int reg, int size )
+{
+    Operand operand;
+
+    memset( &operand, 0, sizeof( Operand ) );
+    operand.kind = OPERAND_REGISTER;
+    operand.size = size;
+    operand.base = reg;
+    operand.index = REG_NONE;
+    return( operand );
+}
+
+Operand AsmImm( long value )
+{
+    Operand operand;
+
+    memset( &operand, 0, sizeof( Operand ) );
+    operand.kind = OPERAND_IMMEDIATE;
+    operand.base = REG_NONE;
+    operand.index = REG_NONE;
+    operand.value = value;
+    return( operand );
+}
+
+Operand AsmMem( int base, long offset )
+{
+    Operand operand;
+
+    memset( &operand, 0, sizeof( Operand ) );
+    operand.kind = OPERAND_MEMORY;
+    operand.base = base;
+    operand.index = REG_NONE;
+    operand.scale = 1;
+    operand.value = offset;
+    return( operand );
+}
+
+Operand AsmMemIndex( int base, int index, int scale, long offset )
+{
+    Operand operand;
+
+    operand = AsmMem( base, offset );
+    operand.index = index;
+    operand.scale = scale;
+    return( operand );
+}
+
+Operand AsmSym( char *symbol )
+{
+    Operand operand;
+
+    operand = AsmMem( REG_NONE, 0 );
+    operand.symbol = symbol;
+    return( operand );
+}
+
+Operand AsmLabel( int label )
+{
+    Operand operand;
+
+    memset( &operand, 0, sizeof( Operand ) );
+    operand.kind = OPERAND_LABEL;
+    operand.base = REG_NONE;
+    operand.index = REG_NONE;
+    operand.value = label;
+    return( operand );
+}
+
+Operand AsmTable( int label, int index, int scale )
+{
+    Operand operand;
+
+    operand = AsmLabel( label );
+    operand.kind = OPERAND_TABLE;
+    operand.index = index;
+    operand.scale = scale;
+    return( operand );
+}
+
+void AsmEmit0( int opcode )
+{
+    NewInstruction( opcode, 4 );
+}
+
+void AsmEmit1( int opcode, int size, Operand operand )
+{
+    Instruction *instruction;
+
+    instruction = NewInstruction( opcode, size );
+    instruction->operandCount = 1;
+    instruction->operands[0] = operand;
+}
+
+void AsmEmit2( int opcode, int size, Operand source, Operand destination )
+{
+    Instruction *instruction;
+
+    instruction = NewInstruction( opcode, size );
+    instruction->operandCount = 2;
+    instruction->operands[0] = source;
+    instruction->operands[1] = destination;
+}
+
+void AsmEmitJump( int cond, int label )
+{
+    Instruction *instruction;
+
+    instruction = NewInstruction( ( cond == COND_NONE ) ? ASM_JMP : ASM_JCC, 4 );
+    instruction->cond = cond;
+    instruction->operandCount = 1;
+    instruction->operands[0] = AsmLabel( label );
+}
+
+void AsmEmitCmov( int cond, Operand source, Operand destination )
+{
+    AsmEmit2( ASM_CMOVCC, 4, source, destination );
+    code.instructions[code.count - 1].cond = cond;
+}
+
+void AsmEmitSet( int cond, Operand destination )
+{
+    AsmEmit1( ASM_SETCC, 1, destination );
+    code.instructions[code.count - 1].cond = cond;
+}
+
+int AsmInvertCondition( int cond )
+{
+    return( inverses[cond] );
+}
+
+void AsmEmitLabel( int label )
+{
+    Instruction *instruction;
+
+    instruction = NewInstruction( ASM_LABEL, 4 );
+    instruction->operands[0] = AsmLabel( label );
+}
+
+void AsmEmitGlobalLabel( char *name )
+{
+    Instruction *instruction;
+
+    instruction = NewInstruction( ASM_LABEL, 4 );
+    instruction->operands[0] = AsmSym( name );
+}
+
+void AsmEmitDirective( char *format, ... )
+{
+    Instruction *instruction;
+    char text[MAX_DIRECTIVE];
+    va_list args;
+
+    va_start( args, format );
+    vsnprintf( text, MAX_DIRECTIVE, format, args );
+    va_end( args );
+
+    instruction = NewInstruction( ASM_DIRECTIVE, 4 );
+    instruction->text = strdup( text );
+    if( instruction->text == NULL ) BAILOUT( ERR_NOMEM );
+}
+
+unsigned int AsmRegistersRead( Instruction *instruction )
+{
+    Operand *source = &instruction->operands[0];
+    Operand *destination = &instruction->operands[1];
+    unsigned int mask = 0;
+    int i;
+
+    for( i = 0; i < instruction->operandCount; i++ )
+    {
+        if( instruction->operands[i].kind == OPERAND_MEMORY
+            || instruction->operands[i].kind == OPERAND_TABLE )
+        {
+            mask |= OperandRegisters( &instruction->operands[i] );
+        }
+    }
+
+    switch( instruction->opcode )
+    {
+    case ASM_MOV:
+        mask |= OperandRegisters( source );
+        if( destination->kind == OPERAND_REGISTER && destination->size < 4 )
+        {
+            mask |= REGISTER_MASK( destination->base );
+        }
+        break;
+    case ASM_MOVZB:
+    case ASM_MOVSLQ:
+    case ASM_MOVSS:
+    case ASM_MOVD:
+    case ASM_CVTSI2SS:
+    case ASM_MOVUPS:
+    case ASM_MOVDQU:
+        mask |= OperandRegisters( source );
+        break;
+    case ASM_SETCC:
+        mask |= OperandRegisters( source );
+        break;
+    case ASM_CMOVCC:
+    case ASM_XCHG:
+    case ASM_ADD:
+    case ASM_SUB:
+    case ASM_XOR:
+    case ASM_CMP:
+    case ASM_TEST:
+    case ASM_BT:
+    case ASM_AND:
+    case ASM_OR:
+    case ASM_SAL:
+    case ASM_SAR:
+    case ASM_SHR:
+    case ASM_ADDSS:
+    case ASM_SUBSS:
+    case ASM_MULSS:
+    case ASM_DIVSS:
+    case ASM_XORPS:
+    case ASM_UCOMISS:
+    case ASM_ADDPS:
+    case ASM_SUBPS:
+    case ASM_MULPS:
+    case ASM_DIVPS:
+    case ASM_UNPCKLPS:
+    case ASM_MOVLHPS:
+    case ASM_PADDD:
+    case ASM_PSUBD:
+    case ASM_PAND:
+    case ASM_POR:
+    case ASM_PXOR:
+    case ASM_PSLLD:
+    case ASM_PSRAD:
+        mask |= OperandRegisters( source ) | OperandRegisters( destination );
+        break;
+    case ASM_PUSH:
+        mask |= OperandRegisters( source ) | REGISTER_MASK( REG_ESP );
+        break;
+    case ASM_POP:
+        mask |= REGISTER_MASK( REG_ESP );
+        break;
+    case ASM_JMP:
+        mask |= OperandRegisters( source );
+        /* A jump to a function is a tail call. */
+        if( source->kind != OPERAND_MEMORY || source->symbol == NULL ) break;
+    case ASM_CALL:
+        /* The callee may take arguments in registers. */
+        mask |= REGISTER_MASK( REG_ESP ) | REGISTER_MASK( REG_EAX )
+            | REGISTER_MASK( REG_ECX ) | REGISTER_MASK( REG_EDX );
+        if( GetTarget() == TARGET_X86_64 )
+        {
+            mask |= REGISTER_MASK( REG_ESI ) | REGISTER_MASK( REG_EDI )
+                | REGISTER_MASK( REG_R8 ) | REGISTER_MASK( REG_R9 ) | SSE_REGISTERS;
+        }
+        break;
+    case ASM_PUSHA:
+        mask |= GENERAL_REGISTERS;
+        break;
+    case ASM_NEG:
+        mask |= OperandRegisters( source );
+        break;
+    case ASM_IMUL:
+        mask |= OperandRegisters( source );
+        if( instruction->operandCount == 2 )
+        {
+            mask |= OperandRegisters( destination );
+        }
+        else
+        {
+            mask |= REGISTER_MASK( REG_EAX );
+        }
+        break;
+    case ASM_IDIV:
+        mask |= OperandRegisters( source ) | REGISTER_MASK( REG_EAX ) | REGISTER_MASK( REG_EDX );
+        break;
+    case ASM_CLTD:
+        mask |= REGISTER_MASK( REG_EAX );
+        break;
+    case ASM_LEAVE:
+        mask |= REGISTER_MASK( REG_EBP );
+        break;
+    case ASM_RET:
+        mask |= REGISTER_MASK( REG_EAX ) | REGISTER_MASK( REG_ESP );
+        if( instruction->operandCount == 1 )
+        {
+            mask |= OperandRegisters( source );
+        }
+        break;
+    }
+    return( mask );
+}
+
+unsigned int AsmRegistersWritten( Instruction *instruction )
+{
+    Operand *source = &instruction->operands[0];
+    Operand *destination = &instruction->operands[1];
+
+    switch( instruction->opcode )
+    {
+    case ASM_MOV:
+    case ASM_MOVZB:
+    case ASM_MOVSLQ:
+    case ASM_CMOVCC:
+    case ASM_ADD:
+    case ASM_SUB:
+    case ASM_XOR:
+    case ASM_AND:
+    case ASM_OR:
+    case ASM_SAL:
+    case ASM_SAR:
+    case ASM_SHR:
+    case ASM_LEA:
+    case ASM_MOVSS:
+    case ASM_MOVD:
+    case ASM_ADDSS:
+    case ASM_SUBSS:
+    case ASM_MULSS:
+    case ASM_DIVSS:
+    case ASM_XORPS:
+    case ASM_CVTSI2SS:
+    case ASM_MOVUPS:
+    case ASM_ADDPS:
+    case ASM_SUBPS:
+    case ASM_MULPS:
+    case ASM_DIVPS:
+    case ASM_UNPCKLPS:
+    case ASM_MOVLHPS:
+    case ASM_MOVDQU:
+    case ASM_PADDD:
+    case ASM_PSUBD:
+    case ASM_PAND:
+    case ASM_POR:
+    case ASM_PXOR:
+    case ASM_PSLLD:
+    case ASM_PSRAD:
+        return( WrittenRegister( destination ) );
+    case ASM_XCHG:
+        return( WrittenRegister( source ) | WrittenRegister( destination ) );
+    case ASM_NEG:
+    case ASM_SETCC:
+        return( WrittenRegister( source ) );
+    case ASM_POP:
+        return( WrittenRegister( source ) | REGISTER_MASK( REG_ESP ) );
+    case ASM_PUSH:
+    case ASM_PUSHA:
+        return( REGISTER_MASK( REG_ESP ) );
+    case ASM_POPA:
+        return( GENERAL_REGISTERS & ~REGISTER_MASK( REG_ESP ) );
+    case ASM_IMUL:
+        if( instruction->operandCount == 2 )
+        {
+            return( WrittenRegister( destination ) );
+        }
+        return( REGISTER_MASK( REG_EAX ) | REGISTER_MASK( REG_EDX ) );
+    case ASM_IDIV:
+        return( REGISTER_MASK( REG_EAX ) | REGISTER_MASK( REG_EDX ) );
+    case ASM_CLTD:
+        return( REGISTER_MASK( REG_EDX ) );
+    case ASM_CALL:
+        if( GetTarget() == TARGET_X86_64 )
+        {
+            return( REGISTER_MASK( REG_EAX ) | REGISTER_MASK( REG_ECX ) | REGISTER_MASK( REG_EDX )
+                | REGISTER_MASK( REG_ESI ) | REGISTER_MASK( REG_EDI ) | REGISTER_MASK( REG_R8 )
+                | REGISTER_MASK( REG_R9 ) | REGISTER_MASK( REG_R10 ) | REGISTER_MASK( REG_R11 )
+                | SSE_REGISTERS );
+        }
+        return( REGISTER_MASK( REG_EAX ) | REGISTER_MASK( REG_ECX ) | REGISTER_MASK( REG_EDX )
+            | SSE_REGISTERS );
+    case ASM_LEAVE:
+        return( REGISTER_MASK( REG_ESP ) | REGISTER_MASK( REG_EBP ) );
+    }
+    return( 0 );
+}
+
+BOOL AsmSameOperand( Operand *a, Operand *b )
+{
+    if( a->kind != b->kind ) return( FALSE );
+
+    switch( a->kind )
+    {
+    case OPERAND_REGISTER:
+        return( a->base == b->base && a->size == b->size );
+    case OPERAND_IMMEDIATE:
+    case OPERAND_LABEL:
+        return( a->value == b->value );
+    case OPERAND_TABLE:
+        return( a->value == b->value && a->index == b->index );
+    case OPERAND_MEMORY:
+        if( a->base != b->base || a->index != b->index || a->value != b->value )
+        {
+            return( FALSE );
+        }
+        if( a->index != REG_NONE && a->scale != b->scale )
+        {
+            return( FALSE );
+        }
+        if( a->symbol == NULL || b->symbol == NULL )
+        {
+            return( a->symbol == b->symbol );
+        }
+        return( strcmp( a->symbol, b->symbol ) == 0 );
+    }
+    return( TRUE );
+}
+
+AsmCode *AsmGetCode()
+{
+    return( &code );
+}
+
+void AsmWrite( FILE *fp )
+{
+    char *buffer;
+    int i, length, size;
+
+    /* Directives are the only lines that may be longer
+     * than MAX_LINE. */
+    size = 1;
+    for( i = 0; i < code.count; i++ )
+    {
+        if( code.instructions[i].opcode == ASM_DIRECTIVE )
+        {
+            size += strlen( code.instructions[i].text ) + 1;
+        }
+        else
+        {
+            size += MAX_LINE;
+        }
+    }
+
+    buffer = (char *) malloc( size );
+    if( buffer == NULL ) BAILOUT( ERR_NOMEM );
+
+    length = 0;
+    for( i = 0; i < code.count; i++ )
+    {
+        length += FormatInstruction( buffer + length, &code.instructions[i] );
+    }
+    fwrite( buffer, 1, length, fp );
+
+    free( buffer );
+    ClearCode();
+}
+
+void AsmFree()
+{
+    ClearCode();
+    free( code.instructions );
+    code.instructions = NULL;
+    code.capacity = 0;
+}
+
+int AsmWordSize()
+{
+    return( ( GetTarget() == TARGET_X86_64 ) ? 8 : 4 );
+}
@@ -0,0 +1,347 @@
+/*************************************************
+ *                                               *
+ *  Module: asm.h                                *
+ *  Description:                                 *
+ *      Interface to the in-memory x86           *
+ *      instruction list built by the code       *
+ *      generator.                               *
+ *  Modifications:                               *
+ *                                               *
+ *************************************************
+ *                                               *
+ *   This program is free software; you can      *
+ *   redistribute it and/or modify  it under     *
+ *   the terms of the GNU General Public         *
+ *   License as published by the Free            *
+ *   Software Foundation; either version 2       *
+ *   of the License, or (at your option) any     *
+ *   later version.                              *
+ *                                               *
+ *************************************************/
+
+#ifndef ASM_H
+#define ASM_H
+
+#include <stdio.h>
+#include "defs.h"
+
+/*************************************************
+ *                                               *
+ *  TYPES                                        *
+ *                                               *
+ *************************************************/
+
+/*
+ *  General purpose registers, numbered as in the
+ *  x86 instruction encoding. The name printed for a
+ *  register depends on the operand size (e.g. REG_EAX
+ *  prints as %al, %ax, %eax or %rax). REG_R8 up to
+ *  REG_R15 only exist on x86_64. The SSE registers
+ *  %xmm0 up to %xmm7 follow, for float values.
+ */
+enum Registers
+{
+    REG_NONE = -1,
+    REG_EAX = 0,
+    REG_ECX,
+    REG_EDX,
+    REG_EBX,
+    REG_ESP,
+    REG_EBP,
+    REG_ESI,
+    REG_EDI,
+    REG_R8,
+    REG_R9,
+    REG_R10,
+    REG_R11,
+    REG_R12,
+    REG_R13,
+    REG_R14,
+    REG_R15,
+    REG_XMM0,
+    REG_XMM1,
+    REG_XMM2,
+    REG_XMM3,
+    REG_XMM4,
+    REG_XMM5,
+    REG_XMM6,
+    REG_XMM7,
+    NR_OF_REGISTERS
+};
+
+/* Bit for register [reg] in a register mask. */
+#define REGISTER_MASK( reg )    ( 1U << ( reg ) )
+
+/* Masks of all general purpose and all SSE registers. */
+#define GENERAL_REGISTERS       ( REGISTER_MASK( REG_XMM0 ) - 1 )
+#define SSE_REGISTERS           ( REGISTER_MASK( NR_OF_REGISTERS ) - REGISTER_MASK( REG_XMM0 ) )
+
+/* Operand kinds. */
+enum OperandKinds
+{
+    OPERAND_NONE = 0,
+    OPERAND_REGISTER,       /* %reg */
+    OPERAND_IMMEDIATE,      /* $value */
+    OPERAND_MEMORY,         /* symbol+value(base,index,scale) */
+    OPERAND_LABEL,          /* .Lvalue, a local code label */
+    OPERAND_TABLE           /* *.Lvalue(,index,scale), a jump table entry */
+};
+
+/*
+ *  Opcodes. Conditional jumps, moves and sets share
+ *  one opcode each; their condition is kept in the
+ *  instruction's cond field.
+ */
+enum Opcodes
+{
+    ASM_MOV = 0,
+    ASM_MOVZB,              /* zero-extend a byte */
+    ASM_MOVSLQ,             /* sign-extend a long to a quad (x86_64) */
+    ASM_CMOVCC,
+    ASM_SETCC,
+    ASM_PUSH,
+    ASM_POP,
+    ASM_PUSHA,
+    ASM_POPA,
+    ASM_XCHG,
+    ASM_NEG,
+    ASM_ADD,
+    ASM_SUB,
+    ASM_IMUL,
+    ASM_IDIV,
+    ASM_CLTD,               /* sign-extend EAX into EDX */
+    ASM_LEA,
+    ASM_XOR,
+    ASM_CMP,
+    ASM_TEST,
+    ASM_BT,                 /* bit test, sets the carry flag */
+    ASM_AND,
+    ASM_OR,
+    ASM_SAL,
+    ASM_SAR,
+    ASM_SHR,
+    ASM_MOVSS,              /* scalar single precision (SSE) */
+    ASM_MOVD,               /* between an SSE and a general register */
+    ASM_ADDSS,
+    ASM_SUBSS,
+    ASM_MULSS,
+    ASM_DIVSS,
+    ASM_XORPS,
+    ASM_UCOMISS,            /* float compare, sets ZF, PF and CF */
+    ASM_CVTSI2SS,           /* int to float */
+    ASM_FLDS,               /* load a float on the x87 stack */
+    ASM_FSTPS,              /* store and pop the x87 stack */
+    ASM_MOVUPS,             /* packed single precision (SSE) */
+    ASM_ADDPS,
+    ASM_SUBPS,
+    ASM_MULPS,
+    ASM_DIVPS,
+    ASM_UNPCKLPS,
+    ASM_MOVLHPS,
+    ASM_MOVDQU,             /* packed int (SSE2) */
+    ASM_PADDD,
+    ASM_PSUBD,
+    ASM_PAND,
+    ASM_POR,
+    ASM_PXOR,
+    ASM_PSLLD,
+    ASM_PSRAD,
+    ASM_CALL,
+    ASM_JCC,
+    ASM_JMP,
+    ASM_LEAVE,
+    ASM_RET,
+    ASM_LABEL,              /* a local or a global label */
+    ASM_DIRECTIVE,          /* assembler directive text */
+    ASM_DELETED,            /* removed by an optimization */
+    NR_OF_OPCODES
+};
+
+/* Condition codes for ASM_JCC, ASM_CMOVCC and ASM_SETCC. */
+enum Conditions
+{
+    COND_NONE = -1,
+    COND_E = 0,
+    COND_NE,
+    COND_G,
+    COND_GE,
+    COND_L,
+    COND_LE,
+    COND_NG,
+    COND_NGE,
+    COND_NL,
+    COND_NLE,
+    COND_A,                 /* unsigned */
+    COND_AE,
+    COND_B,
+    COND_BE,
+    COND_P,                 /* parity: unordered after ucomiss */
+    COND_NP,
+    NR_OF_CONDITIONS
+};
+
+typedef struct Operand
+{
+    char kind;
+    char size;              /* register size in bytes */
+    char base;              /* register, or memory base register */
+    char index;             /* memory index register */
+    char scale;             /* memory index scale (1, 2, 4, 8) */
+    long value;             /* immediate, displacement or label */
+    char *symbol;           /* memory symbol or global label */
+} Operand;
+
+typedef struct Instruction
+{
+    short opcode;
+    char size;              /* operand size, selects the suffix */
+    char cond;              /* condition for ASM_JCC, ASM_CMOVCC, ASM_SETCC */
+    char operandCount;
+    Operand operands[2];    /* AT&T order: source, destination */
+    char *text;             /* text of an ASM_DIRECTIVE */
+} Instruction;
+
+/*
+ *  A list of instructions, in the order they are
+ *  emitted.
+ */
+typedef struct AsmCode
+{
+    Instruction *instructions;
+    int count;
+    int capacity;
+} AsmCode;
+
+/*************************************************
+ *                                               *
+ *  OPERANDS                                     *
+ *                                               *
+ *************************************************/
+
+/* A 32-bit register [reg]. */
+Operand AsmReg( int reg );
+
+/* Register [reg] with a size of [size] bytes (1 for %al). */
+Operand AsmRegSized( int reg, int size );
+
+/* An immediate value: $value. */
+Operand AsmImm( long value );
+
+/* Memory at [offset] from register [base]: offset(%base). */
+Operand AsmMem( int base, long offset );
+
+/* Memory at [offset] from [base] plus [index] times
+ * [scale]: offset(%base,%index,scale). [base] may be
+ * REG_NONE. */
+Operand AsmMemIndex( int base, int index, int scale, long offset );
+
+/* Memory at global [symbol]. */
+Operand AsmSym( char *symbol );
+
+/* Local code label [label]: .Llabel */
+Operand AsmLabel( int label );
+
+/* The target in jump table [label] at [index] times
+ * [scale], for an indirect jmp: *.Llabel(,%index,scale). */
+Operand AsmTable( int label, int index, int scale );
+
+/*************************************************
+ *                                               *
+ *  EMITTING INSTRUCTIONS                        *
+ *                                               *
+ *************************************************/
+
+/*
+ *  Appends instructions to the current code list.
+ *  [size] is the operand size in bytes; it selects the
+ *  mnemonic suffix (b, w, l or q) where the instruction
+ *  takes one. Operands are given in AT&T order.
+ *
+ *  On x86_64, push and pop, and instructions on %esp
+ *  or %ebp, are printed with 64-bit operands; memory
+ *  addresses use 64-bit registers, and a global
+ *  without an index register is addressed relative to
+ *  %rip. A register operand of jmp or call is an
+ *  indirect target (*%reg), and a label operand of lea
+ *  is the label's address.
+ */
+void AsmEmit0( int opcode );
+void AsmEmit1( int opcode, int size, Operand operand );
+void AsmEmit2( int opcode, int size, Operand source, Operand destination );
+
+/* Note: ASM_IMUL with one operand multiplies EAX into
+ * EDX:EAX; with two operands it is dst = dst * src. */
+
+/* Conditional instructions: jcc [label], cmovcc and
+ * setcc (on a byte register). */
+void AsmEmitJump( int cond, int label );
+void AsmEmitCmov( int cond, Operand source, Operand destination );
+void AsmEmitSet( int cond, Operand destination );
+
+/* Returns the condition that holds when [cond] does
+ * not. */
+int AsmInvertCondition( int cond );
+
+/* Emits local label [label] (.Llabel:). */
+void AsmEmitLabel( int label );
+
+/* Emits global label [name] (name:). */
+void AsmEmitGlobalLabel( char *name );
+
+/* Emits an assembler directive or other raw line,
+ * formatted as by printf. */
+void AsmEmitDirective( char *format, ... );
+
+/*************************************************
+ *                                               *
+ *  INSTRUCTION PROPERTIES                       *
+ *                                               *
+ *************************************************/
+
+/*
+ *  Return the masks (see REGISTER_MASK) of the
+ *  registers [instruction] reads and writes. Registers
+ *  used in memory addresses count as read. A write to
+ *  part of a register (e.g. %al) also counts as a read
+ *  of the whole register. Calls write the registers
+ *  the callee need not preserve (%eax, %ecx and %edx
+ *  for cdecl, and the SSE registers) and are taken to
+ *  read the registers that may hold arguments: %eax,
+ *  %ecx and %edx on i386, where a callee in the
+ *  module takes its first arguments there, and those
+ *  of the System V ABI on x86_64. So is a jump to a
+ *  function, which is a tail call. A ret reads %eax,
+ *  and the register of its operand if it has one: a
+ *  function that returns a float in %xmm0 is left by
+ *  "ret %xmm0", which is printed as a plain ret.
+ */
+unsigned int AsmRegistersRead( Instruction *instruction );
+unsigned int AsmRegistersWritten( Instruction *instruction );
+
+/* Returns TRUE if [a] and [b] are the same operand. */
+BOOL AsmSameOperand( Operand *a, Operand *b );
+
+/*************************************************
+ *                                               *
+ *  CODE LISTS                                   *
+ *                                               *
+ *************************************************/
+
+/* Returns the current code list. */
+AsmCode *AsmGetCode();
+
+/*
+ *  Formats all instructions of the current code list
+ *  and writes them to [fp] in a single write, then
+ *  empties the list.
+ */
+void AsmWrite( FILE *fp );
+
+/* Frees the current code list. */
+void AsmFree();
+
+/* Returns the size of a stack slot and of an address
+ * on the target: 4 on i386, 8 on x86_64. */
+int AsmWordSize();
+
+#endif
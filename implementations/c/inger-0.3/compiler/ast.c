@@ -27,6 +27,7 @@
 #include "nodenames.h"
 #include "tokenvalue.h"
 #include "typenames.h"
+#include "stats.h"
 
 /*************************************************
  *                                               *
@@ -97,6 +98,8 @@ TreeNode *CreateAstNode( int id, int lineno )
     AstNode *astNode;
 
     astNode = (AstNode *) MallocEx( sizeof( AstNode ) );
+    STAT_NODE( id );
+
     astNode->id = id;
     astNode->lineno = lineno;
     astNode->val.uintvalue = 0;
@@ -112,6 +115,8 @@ TreeNode *CreateAstNodeVal( int id, Tokenvalue val, int lineno )
     AstNode *astNode;
 
     astNode = (AstNode *) MallocEx( sizeof( AstNode ) );
+    STAT_NODE( id );
+
     astNode->id = id;
     astNode->lineno = lineno;
     astNode->val = val;
@@ -157,7 +162,7 @@ void DumpAst( char *filename, TreeNode *source )
 void SimplifyAst( TreeNode *source )
 {
     TreeNode *child;
-    ListNode *listNode;
+    ListNode *listNode, *nextNode;
  
     switch( TOAST( source )->id )
     {
@@ -169,11 +174,14 @@ void SimplifyAst( TreeNode *source )
         SimplifyAst( child );
         break;
     default:
+        /* Simplifying a child replaces its list node, so
+         * fetch the next sibling first. */
         listNode = ListFirstEx( source->children );
         while( listNode != NULL )
         {
+            nextNode = ListNextEx( listNode );
             SimplifyAst( ( TreeNode * ) listNode->data );
-            listNode = ListNextEx( listNode );
+            listNode = nextNode;
         }
     }
 }
@@ -243,6 +251,8 @@ char* GetInitializerFromDecl( TreeNode *declNode )
     {
         case INT: sprintf( initializer, "%ld", TOAST(GetTreeChild( initNode, 0 ))->val.uintvalue ); break;
         case FLOAT: sprintf( initializer, "%f", TOAST(GetTreeChild( initNode, 0 ))->val.floatvalue ); break;
+        case CHAR: sprintf( initializer, "%d", TOAST(GetTreeChild( initNode, 0 ))->val.charvalue ); break;
+        case BOOLEAN: sprintf( initializer, "%d", TOAST(GetTreeChild( initNode, 0 ))->val.boolvalue ); break;
     }
 
     /* Return the initializer string. */
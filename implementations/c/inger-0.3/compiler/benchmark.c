@@ -0,0 +1,324 @@
+/*************************************************
+ *                                               *
+ *  Module: benchmark.c                          *
+ *  Description:                                 *
+ *      Micro-benchmarks for the list, tree,     *
+ *      symbol table and type abstract data      *
+ *      types (--bench).                         *
+ *  Modifications:                               *
+ *                                               *
+ *************************************************
+ *                                               *
+ *   This program is free software; you can      *
+ *   redistribute it and/or modify  it under     *
+ *   the terms of the GNU General Public         *
+ *   License as published by the Free            *
+ *   Software Foundation; either version 2       *
+ *   of the License, or (at your option) any     *
+ *   later version.                              *
+ *                                               *
+ *************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "defs.h"
+#include "list.h"
+#include "tree.h"
+#include "types.h"
+#include "symtab.h"
+#include "stats.h"
+#include "benchmark.h"
+
+/*************************************************
+ *                                               *
+ *  MACROS                                       *
+ *                                               *
+ *************************************************/
+
+/* Workload sizes. */
+#define LIST_SIZE           100000
+#define TREE_FANOUT         1000
+#define SYMBOL_COUNTS       { 10, 100, 1000 }
+#define SCOPE_DEPTHS        { 1, 4, 16 }
+#define SYMBOL_LOOKUPS      100000
+#define TYPE_COUNT          100000
+
+#define MAX_NAME            16
+
+#define MSG_BENCH_HEADER    "%-36s %10s %12s %10s\n"
+#define MSG_BENCH_RESULT    "%-36s %10ld %12.1f %10s\n"
+
+/* Allocations made by the list, tree, symbol table
+ * and type modules, which count them with the other
+ * statistics (not in release builds). */
+#ifdef NDEBUG
+#define ALLOCATIONS()       ( 0UL )
+#else
+#define ALLOCATIONS()       ( g_statCounters[STAT_ALLOCATION] )
+#endif
+
+
+/*************************************************
+ *                                               *
+ *  GLOBALS                                      *
+ *                                               *
+ *************************************************/
+
+/* Start of the current measurement. */
+static double startTime;
+static unsigned long startAllocations;
+
+/* Keeps the compiler from removing the workloads. */
+static volatile long sink;
+
+
+/*************************************************
+ *                                               *
+ *  STATIC FUNCTION DEFINITIONS                  *
+ *                                               *
+ *************************************************/
+
+/*
+ *  Returns a monotonic time stamp in nanoseconds.
+ */
+static double Now()
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return( ts.tv_sec * 1e9 + ts.tv_nsec );
+}
+
+/*
+ *  Starts a measurement.
+ */
+static void BeginMeasurement()
+{
+    startAllocations = ALLOCATIONS();
+    startTime = Now();
+}
+
+/*
+ *  Ends a measurement of [ops] operations, and
+ *  prints the result as benchmark [name].
+ */
+static void EndMeasurement( char *name, long ops )
+{
+    double elapsed;
+    char perOp[32];
+
+    elapsed = Now() - startTime;
+
+#ifdef NDEBUG
+    sprintf( perOp, "n/a" );
+#else
+    sprintf( perOp, "%.2f", (double) ( ALLOCATIONS() - startAllocations ) / ops );
+#endif
+
+    fprintf( stdout, MSG_BENCH_RESULT, name, ops, elapsed / ops, perOp );
+}
+
+/*
+ *  Data cleanup function that does not free anything,
+ *  for lists and trees whose data is not allocated.
+ */
+static BOOL KeepData( void *data )
+{
+    return( TRUE );
+}
+
+static void BenchList()
+{
+    List *list;
+    ListNode *node;
+    long i, sum;
+
+    list = ListInit( KeepData );
+
+    BeginMeasurement();
+    for( i = 0; i < LIST_SIZE; i++ )
+    {
+        ListAppend( list, (void *) i );
+    }
+    EndMeasurement( "list append", LIST_SIZE );
+
+    BeginMeasurement();
+    sum = 0;
+    for( node = ListFirstEx( list ); node != NULL; node = ListNextEx( node ) )
+    {
+        sum += (long) node->data;
+    }
+    sink = sum;
+    EndMeasurement( "list iterate (per element)", LIST_SIZE );
+
+    /* ListSize walks the list, so time a few calls. */
+    BeginMeasurement();
+    for( i = 0; i < 100; i++ )
+    {
+        sink = ListSize( list );
+    }
+    EndMeasurement( "list size (100000 elements)", 100 );
+
+    BeginMeasurement();
+    ListFirst( list );
+    for( i = 0; i < LIST_SIZE; i++ )
+    {
+        ListUnlink( list );
+    }
+    EndMeasurement( "list unlink", LIST_SIZE );
+
+    ListPurge( list, KeepData );
+}
+
+static void BenchTree()
+{
+    TreeNode *root, *node;
+    long i;
+
+    BeginMeasurement();
+    root = CreateTreeNode( NULL );
+    for( i = 0; i < TREE_FANOUT; i++ )
+    {
+        node = CreateTreeNode( NULL );
+        AddTreeChild( root, node );
+        AddTreeChild( node, CreateTreeNode( NULL ) );
+    }
+    EndMeasurement( "tree build (per node)", 2 * TREE_FANOUT + 1 );
+
+    BeginMeasurement();
+    for( i = 0; i < TREE_FANOUT; i++ )
+    {
+        sink = (long) GetTreeChild( root, i );
+    }
+    EndMeasurement( "tree child index (1000 children)", TREE_FANOUT );
+
+    BeginMeasurement();
+    for( i = 0; i < TREE_FANOUT; i++ )
+    {
+        sink = (long) GetTreeChild( GetTreeChild( root, 0 ), 0 );
+    }
+    EndMeasurement( "tree child index (first child)", TREE_FANOUT );
+
+    RemoveTreeNode( root );
+    free( root );
+}
+
+static void BenchSymbolTable()
+{
+    static int symbolCounts[] = SYMBOL_COUNTS;
+    static int scopeDepths[] = SCOPE_DEPTHS;
+    char name[MAX_NAME], title[64];
+    char **names;
+    Symbol *symbol;
+    int c, d, i, depth, count;
+    long ops;
+
+    for( c = 0; c < sizeof( symbolCounts ) / sizeof( int ); c++ )
+    {
+        count = symbolCounts[c];
+        names = (char **) malloc( count * sizeof( char * ) );
+        if( names == NULL ) BAILOUT( ERR_NOMEM );
+        for( i = 0; i < count; i++ )
+        {
+            sprintf( name, "sym%d", i );
+            names[i] = strdup( name );
+        }
+
+        for( d = 0; d < sizeof( scopeDepths ) / sizeof( int ); d++ )
+        {
+            depth = scopeDepths[d];
+            PurgeSymbolTable();
+            InitSymbolTable();
+
+            /* Globals live in the root scope; every nested
+             * scope declares a few locals of its own. */
+            sprintf( title, "symbol insert (%d, depth %d)", count, depth );
+            BeginMeasurement();
+            for( i = 0; i < count; i++ )
+            {
+                symbol = CreateSymbol( names[i] );
+                AddType( symbol, AddSimpleType( CreateType(), INT ) );
+                AddSymbol( symbol );
+            }
+            for( i = 1; i < depth; i++ )
+            {
+                CreateScope();
+                symbol = CreateSymbol( "local" );
+                AddType( symbol, AddSimpleType( CreateType(), INT ) );
+                AddSymbol( symbol );
+            }
+            EndMeasurement( title, count + depth - 1 );
+
+            /* Look up globals from the innermost scope. */
+            sprintf( title, "symbol lookup (%d, depth %d)", count, depth );
+            ops = SYMBOL_LOOKUPS;
+            BeginMeasurement();
+            for( i = 0; i < ops; i++ )
+            {
+                sink = (long) FindSymbol( names[i % count] );
+            }
+            EndMeasurement( title, ops );
+        }
+
+        for( i = 0; i < count; i++ )
+        {
+            free( names[i] );
+        }
+        free( names );
+    }
+
+    PurgeSymbolTable();
+}
+
+static void BenchTypes()
+{
+    Type **types;
+    Type *type;
+    long i;
+
+    types = (Type **) malloc( TYPE_COUNT * sizeof( Type * ) );
+    if( types == NULL ) BAILOUT( ERR_NOMEM );
+
+    BeginMeasurement();
+    for( i = 0; i < TYPE_COUNT; i++ )
+    {
+        type = AddSimpleType( CreateType(), INT );
+        AddDimension( type, 10 );
+        AddDimension( type, 20 );
+        types[i] = type;
+    }
+    EndMeasurement( "type create (int[10][20])", TYPE_COUNT );
+
+    BeginMeasurement();
+    for( i = 0; i < TYPE_COUNT; i++ )
+    {
+        type = CopyType( types[i] );
+        DeleteType( types[i] );
+        types[i] = type;
+    }
+    EndMeasurement( "type copy and delete", TYPE_COUNT );
+
+    for( i = 0; i < TYPE_COUNT; i++ )
+    {
+        DeleteType( types[i] );
+    }
+    free( types );
+}
+
+
+/*************************************************
+ *                                               *
+ *  EXPORTED FUNCTION DEFINITIONS                *
+ *                                               *
+ *************************************************/
+
+void RunBenchmarks()
+{
+    fprintf( stdout, MSG_BENCH_HEADER, "benchmark", "ops", "ns/op", "allocs/op" );
+    BenchList();
+    BenchTree();
+    BenchSymbolTable();
+    BenchTypes();
+}
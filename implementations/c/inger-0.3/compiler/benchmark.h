@@ -0,0 +1,40 @@
+/*************************************************
+ *                                               *
+ *  Module: benchmark.h                          *
+ *  Description:                                 *
+ *      Interface to the micro-benchmarks for    *
+ *      the list, tree, symbol table and type    *
+ *      abstract data types.                     *
+ *  Modifications:                               *
+ *                                               *
+ *************************************************
+ *                                               *
+ *   This program is free software; you can      *
+ *   redistribute it and/or modify  it under     *
+ *   the terms of the GNU General Public         *
+ *   License as published by the Free            *
+ *   Software Foundation; either version 2       *
+ *   of the License, or (at your option) any     *
+ *   later version.                              *
+ *                                               *
+ *************************************************/
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include "defs.h"
+
+/*
+ *  Runs all micro-benchmarks and prints the time
+ *  (ns/op) and number of allocations (allocs/op)
+ *  per operation to the console. The workloads are
+ *  fixed, so runs before and after a change to one
+ *  of the data structures can be compared directly.
+ *
+ *  Allocations are those of the list, tree, symbol
+ *  table and type modules, and are not counted in
+ *  release builds (NDEBUG).
+ */
+void RunBenchmarks();
+
+#endif
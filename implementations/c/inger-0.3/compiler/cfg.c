@@ -0,0 +1,487 @@
+/*************************************************
+ *                                               *
+ *  Module: cfg.c                                *
+ *  Description:                                 *
+ *      Control flow graphs of function bodies,  *
+ *      with reachability and dominators.        *
+ *  Modifications:                               *
+ *                                               *
+ *************************************************
+ *                                               *
+ *   This program is free software; you can      *
+ *   redistribute it and/or modify  it under     *
+ *   the terms of the GNU General Public         *
+ *   License as published by the Free            *
+ *   Software Foundation; either version 2       *
+ *   of the License, or (at your option) any     *
+ *   later version.                              *
+ *                                               *
+ *************************************************/
+
+/*
+ *  The graph is built in one walk over the body. A
+ *  statement that leaves the block (return, break,
+ *  continue, goto) starts a new block, which has no
+ *  predecessors unless a label follows; such blocks
+ *  stay unreachable. A goto may come before its label,
+ *  so the block of a label is made when either is
+ *  first seen.
+ *
+ *  A depth-first search from the entry then marks the
+ *  reachable blocks and numbers them in reverse
+ *  postorder, and the dominators are computed with the
+ *  iterative algorithm of Cooper, Harvey and Kennedy
+ *  ("A Simple, Fast Dominance Algorithm"), which
+ *  visits the blocks in that order until nothing
+ *  changes. Without goto a body is reducible, and one
+ *  pass plus a check suffices.
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "defs.h"
+#include "nodenames.h"
+#include "symtab.h"
+#include "ast.h"
+#include "selftest.h"
+#include "cfg.h"
+
+/*************************************************
+ *                                               *
+ *  TYPES                                        *
+ *                                               *
+ *************************************************/
+
+typedef struct Label
+{
+    char *name;
+    int block;
+    BOOL placed;            /* the label statement was seen */
+} Label;
+
+/*************************************************
+ *                                               *
+ *  GLOBALS                                      *
+ *                                               *
+ *************************************************/
+
+/* The graph being built. */
+static Cfg *graph;
+
+static Label *labels = NULL;
+static int nrOfLabels, maxLabels;
+
+/*************************************************
+ *                                               *
+ *  STATIC FUNCTION DEFINITIONS                  *
+ *                                               *
+ *************************************************/
+
+static int NewBlock()
+{
+    BasicBlock *block;
+
+    if( graph->nrOfBlocks == graph->maxBlocks )
+    {
+        graph->maxBlocks = ( graph->maxBlocks == 0 ) ? 16 : graph->maxBlocks * 2;
+        graph->blocks = (BasicBlock *) realloc( graph->blocks, graph->maxBlocks * sizeof( BasicBlock ) );
+        if( graph->blocks == NULL ) BAILOUT( ERR_NOMEM );
+    }
+    block = &graph->blocks[graph->nrOfBlocks];
+    memset( block, 0, sizeof( BasicBlock ) );
+    block->dominator = -1;
+    block->order = -1;
+    return( graph->nrOfBlocks++ );
+}
+
+/* Appends [value] to array [*array] of [*count]
+ * ints, which has room for [*max]. */
+static void Append( int **array, int *count, int *max, int value )
+{
+    if( *count == *max )
+    {
+        *max = ( *max == 0 ) ? 4 : *max * 2;
+        *array = (int *) realloc( *array, *max * sizeof( int ) );
+        if( *array == NULL ) BAILOUT( ERR_NOMEM );
+    }
+    (*array)[(*count)++] = value;
+}
+
+static void AddNode( int block, TreeNode *node )
+{
+    BasicBlock *b = &graph->blocks[block];
+
+    if( b->nrOfNodes == b->maxNodes )
+    {
+        b->maxNodes = ( b->maxNodes == 0 ) ? 8 : b->maxNodes * 2;
+        b->nodes = (TreeNode **) realloc( b->nodes, b->maxNodes * sizeof( TreeNode * ) );
+        if( b->nodes == NULL ) BAILOUT( ERR_NOMEM );
+    }
+    b->nodes[b->nrOfNodes++] = node;
+}
+
+static void AddEdge( int from, int to )
+{
+    Append( &graph->blocks[from].successors, &graph->blocks[from].nrOfSuccessors,
+        &graph->blocks[from].maxSuccessors, to );
+    Append( &graph->blocks[to].predecessors, &graph->blocks[to].nrOfPredecessors,
+        &graph->blocks[to].maxPredecessors, from );
+}
+
+/* Returns the label [name], which is added if it was
+ * not seen yet. */
+static Label *GetLabel( char *name )
+{
+    int i;
+
+    for( i = 0; i < nrOfLabels; i++ )
+    {
+        if( strcmp( labels[i].name, name ) == 0 ) return( &labels[i] );
+    }
+
+    if( nrOfLabels == maxLabels )
+    {
+        maxLabels = ( maxLabels == 0 ) ? 8 : maxLabels * 2;
+        labels = (Label *) realloc( labels, maxLabels * sizeof( Label ) );
+        if( labels == NULL ) BAILOUT( ERR_NOMEM );
+    }
+    labels[nrOfLabels].name = name;
+    labels[nrOfLabels].block = NewBlock();
+    labels[nrOfLabels].placed = FALSE;
+    return( &labels[nrOfLabels++] );
+}
+
+static BOOL IsTrue( TreeNode *node )
+{
+    return( TOAST( node )->id == NODE_LIT_BOOL && TOAST( node )->val.boolvalue == TRUE );
+}
+
+/*
+ *  Adds statement [node] to the graph, starting in
+ *  [block]. [breakBlock] and [continueBlock] are where
+ *  break and continue go, or -1 outside a loop.
+ *  Returns the block control is in after [node].
+ */
+static int AddStatement( TreeNode *node, int block, int breakBlock, int continueBlock )
+{
+    ListNode *child;
+    Label *label;
+    int start, end, join, header, exit;
+
+    switch( TOAST( node )->id )
+    {
+    case NODE_BLOCK:
+        for( child = ListFirstEx( node->children ); child != NULL; child = ListNextEx( child ) )
+        {
+            block = AddStatement( (TreeNode *) child->data, block, breakBlock, continueBlock );
+        }
+        return( block );
+
+    /* Locals are initialized on function entry. */
+    case NODE_DECLBLOCK:
+    case NODE_DECLARATION:
+        return( block );
+
+    case NODE_IF:
+        AddNode( block, GetTreeChild( node, 0 ) );
+        graph->blocks[block].branch = node;
+        start = NewBlock();
+        AddEdge( block, start );
+        end = AddStatement( GetThenBlockFromIf( node ), start, breakBlock, continueBlock );
+        if( GetElseBlockFromIf( node ) != NULL )
+        {
+            start = NewBlock();
+            AddEdge( block, start );
+            block = AddStatement( GetElseBlockFromIf( node ), start, breakBlock, continueBlock );
+        }
+        join = NewBlock();
+        AddEdge( block, join );
+        AddEdge( end, join );
+        return( join );
+
+    case NODE_WHILE:
+        header = NewBlock();
+        AddEdge( block, header );
+        AddNode( header, GetTreeChild( node, 0 ) );
+        graph->blocks[header].branch = node;
+
+        /* The exit is made first, for the breaks. */
+        block = NewBlock();
+        exit = NewBlock();
+        AddEdge( header, block );
+        if( IsTrue( GetTreeChild( node, 0 ) ) == FALSE ) AddEdge( header, exit );
+        end = AddStatement( GetTreeChild( node, 1 ), block, exit, header );
+        AddEdge( end, header );
+        return( exit );
+
+    case NODE_SWITCH:
+        AddNode( block, GetTreeChild( node, 0 ) );
+        graph->blocks[block].branch = node;
+        join = NewBlock();
+        for( child = ListFirstEx( GetTreeChild( node, 1 )->children ); child != NULL;
+            child = ListNextEx( child ) )
+        {
+            start = NewBlock();
+            AddEdge( block, start );
+            end = AddStatement( GetTreeChild( (TreeNode *) child->data, 0 ), start,
+                breakBlock, continueBlock );
+            AddEdge( end, join );
+        }
+        start = NewBlock();
+        AddEdge( block, start );
+        end = AddStatement( GetTreeChild( node, 2 ), start, breakBlock, continueBlock );
+        AddEdge( end, join );
+        return( join );
+
+    case NODE_RETURN:
+        AddNode( block, node );
+        AddEdge( block, CFG_EXIT );
+        return( NewBlock() );
+
+    case NODE_BREAK:
+    case NODE_CONTINUE:
+        AddNode( block, node );
+        if( breakBlock < 0 ) return( block );
+        AddEdge( block, ( TOAST( node )->id == NODE_BREAK ) ? breakBlock : continueBlock );
+        return( NewBlock() );
+
+    case NODE_GOTO:
+        AddNode( block, node );
+        label = GetLabel( GetNameOfIdentifier( GetTreeChild( node, 0 ) ) );
+        AddEdge( block, label->block );
+        return( NewBlock() );
+
+    case NODE_LABEL:
+        /* A label defined twice starts a block of its own
+         * the second time. */
+        label = GetLabel( GetNameOfIdentifier( GetTreeChild( node, 0 ) ) );
+        join = ( label->placed == TRUE ) ? NewBlock() : label->block;
+        label->placed = TRUE;
+        AddEdge( block, join );
+        return( join );
+    }
+
+    AddNode( block, node );
+    return( block );
+}
+
+/* Marks the blocks reachable from [block], and adds
+ * each to [graph->order] after its successors. */
+static void Visit( int block )
+{
+    BasicBlock *b = &graph->blocks[block];
+    int i;
+
+    b->reachable = TRUE;
+    for( i = 0; i < b->nrOfSuccessors; i++ )
+    {
+        if( graph->blocks[b->successors[i]].reachable == FALSE ) Visit( b->successors[i] );
+    }
+    graph->order[graph->nrOfOrdered++] = block;
+}
+
+/* Returns the nearest common dominator of [a] and
+ * [b], walking up the dominators known so far. */
+static int Intersect( int a, int b )
+{
+    while( a != b )
+    {
+        while( graph->blocks[a].order > graph->blocks[b].order ) a = graph->blocks[a].dominator;
+        while( graph->blocks[b].order > graph->blocks[a].order ) b = graph->blocks[b].dominator;
+    }
+    return( a );
+}
+
+static void ComputeDominators()
+{
+    BasicBlock *b;
+    BOOL changed = TRUE;
+    int i, j, dominator, block;
+
+    graph->blocks[CFG_ENTRY].dominator = CFG_ENTRY;
+    while( changed == TRUE )
+    {
+        changed = FALSE;
+        for( i = 1; i < graph->nrOfOrdered; i++ )
+        {
+            block = graph->order[i];
+            b = &graph->blocks[block];
+            dominator = -1;
+            for( j = 0; j < b->nrOfPredecessors; j++ )
+            {
+                if( graph->blocks[b->predecessors[j]].dominator < 0 ) continue;
+                dominator = ( dominator < 0 ) ? b->predecessors[j]
+                    : Intersect( b->predecessors[j], dominator );
+            }
+            if( b->dominator != dominator )
+            {
+                b->dominator = dominator;
+                changed = TRUE;
+            }
+        }
+    }
+    graph->blocks[CFG_ENTRY].dominator = -1;
+}
+
+/*************************************************
+ *                                               *
+ *  EXPORTED FUNCTION DEFINITIONS                *
+ *                                               *
+ *************************************************/
+
+Cfg *BuildCfg( TreeNode *node )
+{
+    int block, i;
+
+    assert( TOAST( node )->id == NODE_FUNCTION && GetBlockFromFunction( node ) != NULL );
+
+    graph = (Cfg *) malloc( sizeof( Cfg ) );
+    if( graph == NULL ) BAILOUT( ERR_NOMEM );
+    graph->function = node;
+    graph->blocks = NULL;
+    graph->nrOfBlocks = graph->maxBlocks = 0;
+    nrOfLabels = 0;
+
+    NewBlock();
+    NewBlock();
+    block = NewBlock();
+    AddEdge( CFG_ENTRY, block );
+    graph->end = AddStatement( GetBlockFromFunction( node ), block, -1, -1 );
+    AddEdge( graph->end, CFG_EXIT );
+
+    /* Visit leaves the blocks in postorder. */
+    graph->order = (int *) malloc( graph->nrOfBlocks * sizeof( int ) );
+    if( graph->order == NULL ) BAILOUT( ERR_NOMEM );
+    graph->nrOfOrdered = 0;
+    Visit( CFG_ENTRY );
+    for( i = 0; i < graph->nrOfOrdered / 2; i++ )
+    {
+        block = graph->order[i];
+        graph->order[i] = graph->order[graph->nrOfOrdered - 1 - i];
+        graph->order[graph->nrOfOrdered - 1 - i] = block;
+    }
+    for( i = 0; i < graph->nrOfOrdered; i++ )
+    {
+        graph->blocks[graph->order[i]].order = i;
+    }
+    ComputeDominators();
+
+    return( graph );
+}
+
+void FreeCfg( Cfg *cfg )
+{
+    int i;
+
+    for( i = 0; i < cfg->nrOfBlocks; i++ )
+    {
+        free( cfg->blocks[i].nodes );
+        free( cfg->blocks[i].successors );
+        free( cfg->blocks[i].predecessors );
+    }
+    free( cfg->blocks );
+    free( cfg->order );
+    free( cfg );
+}
+
+BOOL Dominates( Cfg *cfg, int a, int b )
+{
+    assert( cfg->blocks[a].reachable == TRUE && cfg->blocks[b].reachable == TRUE );
+
+    while( cfg->blocks[b].order > cfg->blocks[a].order )
+    {
+        b = cfg->blocks[b].dominator;
+    }
+    return( a == b );
+}
+
+/*************************************************
+ *                                               *
+ *  TEST CODE                                    *
+ *                                               *
+ *************************************************/
+
+/* Program of the self-test: a loop with a break out
+ * of an if, and a statement after the return. */
+static char *cfgTestProgram =
+    "module cfgtest;\n"
+    "f: int x -> int\n"
+    "{\n"
+    "    int y = 0;\n"
+    "    while( x > 0 ) do\n"
+    "    {\n"
+    "        if( x == 5 )\n"
+    "        {\n"
+    "            break;\n"
+    "        }\n"
+    "        y = y + x;\n"
+    "        x = x - 1;\n"
+    "    }\n"
+    "    return( y );\n"
+    "    y = 1;\n"
+    "}\n";
+
+/* The graph of f: for each block, its number of
+ * statements, its successors and its immediate
+ * dominator, or "-" if it is unreachable. */
+static char *cfgTestGraph =
+    "0: 0 -> 2, -1\n"
+    "1: 0 ->, 5\n"
+    "2: 0 -> 3, 0\n"
+    "3: 1 -> 4 5, 2\n"
+    "4: 1 -> 6 8, 3\n"
+    "5: 1 -> 1, 3\n"
+    "6: 1 -> 5, 4\n"
+    "7: 0 -> 8, -\n"
+    "8: 2 -> 3, 4\n"
+    "9: 1 -> 1, -\n";
+
+BOOL TestCfg()
+{
+    char actual[512];
+    TreeNode *ast, *function;
+    BasicBlock *block;
+    BOOL passed;
+    Cfg *cfg;
+    int i, j, length = 0;
+
+    printf( "Testing control flow graphs...\n" );
+
+    ast = ParseTestProgram( cfgTestProgram );
+    function = ( ast == NULL ) ? NULL : EnterTestFunction( ast, "f" );
+    if( function == NULL )
+    {
+        printf( "Control flow graph test failed.\n\n" );
+        return( FALSE );
+    }
+    ExitScope();
+
+    /* Enough blocks to tell a wrong graph. */
+    cfg = BuildCfg( function );
+    for( i = 0; i < cfg->nrOfBlocks && i < 16; i++ )
+    {
+        block = &cfg->blocks[i];
+        length += sprintf( actual + length, "%d: %d ->", i, block->nrOfNodes );
+        for( j = 0; j < block->nrOfSuccessors && j < 4; j++ )
+        {
+            length += sprintf( actual + length, " %d", block->successors[j] );
+        }
+        if( block->reachable == TRUE )
+        {
+            length += sprintf( actual + length, ", %d\n", block->dominator );
+        }
+        else
+        {
+            length += sprintf( actual + length, ", -\n" );
+        }
+    }
+    FreeCfg( cfg );
+
+    printf( "%s", actual );
+    passed = ( strcmp( actual, cfgTestGraph ) == 0 );
+
+    printf( "Control flow graph test %s.\n\n", ( passed == TRUE ) ? "passed" : "failed" );
+    return( passed );
+}
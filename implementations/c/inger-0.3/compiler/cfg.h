@@ -0,0 +1,109 @@
+/*************************************************
+ *                                               *
+ *  Module: cfg.h                                *
+ *  Description:                                 *
+ *      Interface to the control flow graphs of  *
+ *      function bodies.                         *
+ *  Modifications:                               *
+ *                                               *
+ *************************************************
+ *                                               *
+ *   This program is free software; you can      *
+ *   redistribute it and/or modify  it under     *
+ *   the terms of the GNU General Public         *
+ *   License as published by the Free            *
+ *   Software Foundation; either version 2       *
+ *   of the License, or (at your option) any     *
+ *   later version.                              *
+ *                                               *
+ *************************************************/
+
+#ifndef CFG_H
+#define CFG_H
+
+#include "defs.h"
+#include "tree.h"
+
+/* The blocks every graph starts with. */
+#define CFG_ENTRY           0
+#define CFG_EXIT            1
+
+/*
+ *  A basic block: statements that run one after the
+ *  other. [nodes] are the statements in the order they
+ *  run; a block that ends in a branch (an if, while or
+ *  switch) has the branch's condition as its last node
+ *  and the branch as [branch]. Its successors are then
+ *  the targets when the condition is true and false
+ *  (a while( true ) has no false target), or the cases
+ *  of a switch followed by the default. A return, a
+ *  goto, and a break or continue in a loop are the
+ *  last node of their block.
+ */
+typedef struct BasicBlock
+{
+    TreeNode **nodes;
+    int nrOfNodes, maxNodes;
+    TreeNode *branch;
+    int *successors;
+    int nrOfSuccessors, maxSuccessors;
+    int *predecessors;
+    int nrOfPredecessors, maxPredecessors;
+    BOOL reachable;         /* from CFG_ENTRY */
+    int dominator;          /* immediate dominator, or -1 */
+    int order;              /* in reverse postorder, or -1 */
+} BasicBlock;
+
+/*
+ *  The control flow graph of a function body. Returns
+ *  lead to CFG_EXIT, and so does [end], the block where
+ *  control runs off the end of the body. [order] lists
+ *  the reachable blocks in reverse postorder: a block
+ *  comes before its successors, except along the back
+ *  edges of loops.
+ */
+typedef struct Cfg
+{
+    TreeNode *function;
+    BasicBlock *blocks;
+    int nrOfBlocks, maxBlocks;
+    int end;
+    int *order;
+    int nrOfOrdered;
+} Cfg;
+
+/*
+ *  Builds the control flow graph of function [node],
+ *  with the blocks reachable from the entry and their
+ *  dominators. Edges follow if, while (a while( true )
+ *  loop is only left by a break), switch (the cases do
+ *  not fall through), break, continue (both in the
+ *  innermost while; elsewhere they do nothing), goto,
+ *  label and return.
+ *
+ *  Pre: [node] is a NODE_FUNCTION with a block.
+ */
+Cfg *BuildCfg( TreeNode *node );
+
+/*
+ *  Frees [cfg]. The AST nodes it refers to are kept.
+ */
+void FreeCfg( Cfg *cfg );
+
+/*
+ *  Checks whether block [a] of [cfg] dominates block
+ *  [b]: every path from the entry to [b] passes
+ *  through [a]. Both blocks must be reachable.
+ */
+BOOL Dominates( Cfg *cfg, int a, int b );
+
+/*
+ *  Tests the graph and the dominators of a small
+ *  function.
+ *
+ *  Post: Returns TRUE if the test was successful,
+ *        FALSE if it failed.
+ */
+BOOL TestCfg();
+
+#endif
@@ -21,138 +21,86 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "codegen.h"
 #include "nodenames.h"
 #include "symtab.h"
 #include "ast.h"
+#include "trace.h"
+#include "asm.h"
+#include "peephole.h"
+#include "induction.h"
+#include "vectorize.h"
+#include "tailcall.h"
+#include "switchgen.h"
+#include "regalloc.h"
+#include "constfold.h"
+#include "errors.h"
+#include "options.h"
 
 
 
-/*
- * --------------------------------------------
- * 
- * ASM Interface
- * 
- * TODO: put this in a seperate module.
- *
- * -------------------------------------------
- */
+/* Returned by GenerateOperands for an operand on the stack. */
+#define SPILLED                             ( -2 )
 
-/* Data Transfer Instructions. */
-#define EMITASM_MOVL( src, dst )            ( fprintf( g_outFile, "\tmovl\t%s, %s\n", src, dst ) )
-#define EMITASM_MOVB( src, dst )            ( fprintf( g_outFile, "\tmovb\t%s, %s\n", src, dst ) )
-#define EMITASM_CMOVE( src, dst )           ( fprintf( g_outFile, "\tcmove\t%s, %s\n", src, dst ) )
-#define EMITASM_CMOVNE( src, dst )          ( fprintf( g_outFile, "\tcmovne\t%s, %s\n", src, dst ) )
-#define EMITASM_CMOVG( src, dst)            ( fprintf( g_outFile, "\tcmovg\t%s, %s\n", src, dst ) )
-#define EMITASM_CMOVGE( src, dst)           ( fprintf( g_outFile, "\tcmovge\t%s, %s\n", src, dst ) )
-#define EMITASM_CMOVL( src, dst)            ( fprintf( g_outFile, "\tcmovl\t%s, %s\n", src, dst ) )
-#define EMITASM_CMOVLE( src, dst)           ( fprintf( g_outFile, "\tcmovle\t%s, %s\n", src, dst ) )
-#define EMITASM_CMOVNLE( src, dst)          ( fprintf( g_outFile, "\tcmovnle\t%s, %s\n", src, dst ) )
-#define EMITASM_CMOVNL( src, dst)           ( fprintf( g_outFile, "\tcmovnl\t%s, %s\n", src, dst ) )
-#define EMITASM_CMOVNGE( src, dst)          ( fprintf( g_outFile, "\tcmovnge\t%s, %s\n", src, dst ) )
-#define EMITASM_CMOVNG( src, dst)           ( fprintf( g_outFile, "\tcmovng\t%s, %s\n", src, dst ) )
-#define EMITASM_PUSHL( reg )                ( fprintf( g_outFile, "\tpushl\t%s\n", reg ) )
-#define EMITASM_POPL( reg )                 ( fprintf( g_outFile, "\tpop\t%s\n", reg ) )
-#define EMITASM_PUSHAD()                    { fprintf( g_outFile, "\tpusha\n" ); }
-#define EMITASM_POPAD()                     { fprintf( g_outFile, "\tpopa\n" ); }
-#define EMITASM_XCHGL( src, dst )           ( fprintf( g_outFile, "\txchgl\t%s, %s\n", src, dst ) )
-
-/* Binary Arithmic Instructions. */
-#define EMITASM_NEG( reg )                  ( fprintf( g_outFile, "\tneg\t%s\n", reg ) )
-#define EMITASM_ADDL( src, dst )            ( fprintf( g_outFile, "\taddl\t%s, %s\n", src, dst ) )
-#define EMITASM_SUBL( src, dst )            ( fprintf( g_outFile, "\tsubl\t%s, %s\n", src, dst ) )
-#define EMITASM_IMUL( src )                 ( fprintf( g_outFile, "\timul\t%s\n", src ) )
-#define EMITASM_IDIV( src )                 ( fprintf( g_outFile, "\tidiv\t%s\n", src ) )
-#define EMITASM_XORL( src, dst )            ( fprintf( g_outFile, "\txorl\t%s, %s\n", src, dst ) )
-#define EMITASM_CMPL( src, dst )            ( fprintf( g_outFile, "\tcmpl\t%s, %s\n", src, dst ) )
-#define EMITASM_ANDL( src, dst )            ( fprintf( g_outFile, "\tandl\t%s, %s\n", src, dst ) )
-#define EMITASM_ORL( src, dst )             ( fprintf( g_outFile, "\torl\t%s, %s\n", src, dst ) )
-#define EMITASM_XORL( src, dst )            ( fprintf( g_outFile, "\txorl\t%s, %s\n", src, dst ) )
-
-/* Control Transfer Instructions. */
-#define EMITASM_CALL( func )                ( fprintf( g_outFile, "\tcall\t%s\n", func ) )
-#define EMITASM_JE( dst )                   ( fprintf( g_outFile, "\tje\t%s\n", dst ) )
-#define EMITASM_JNE( dst )                  ( fprintf( g_outFile, "\tjne\t%s\n", dst ) )
-#define EMITASM_JG( dst )                   ( fprintf( g_outFile, "\tjg\t%s\n", dst ) )
-#define EMITASM_JGE( dst )                  ( fprintf( g_outFile, "\tjge\t%s\n", dst ) )
-#define EMITSAM_JL( dst )                   ( fprintf( g_outFile, "\tjl\t%s\n", dst ) )
-#define EMITSAM_JLE( dst )                  ( fprintf( g_outFile, "\tjle\t%s\n", dst ) )
-#define EMITASM_JNG( dst )                  ( fprintf( g_outFile, "\tjng\t%s\n", dst ) )
-#define EMITASM_JNGE( dst )                 ( fprintf( g_outFile, "\tjnge\t%s\n", dst ) )
-#define EMITSAM_JNL( dst )                  ( fprintf( g_outFile, "\tjnl\t%s\n", dst ) )
-#define EMITSAM_JNLE( dst )                 ( fprintf( g_outFile, "\tjnle\t%s\n", dst ) )
-#define EMITASM_JMP( dst )                  ( fprintf( g_outFile, "\tjmp\t%s\n", dst ) )
-
-/* Shift and Rotate Instructions. */
-#define EMITASM_SALL( src, dst )            ( fprintf( g_outFile, "\tsall\t%s, %s\n", src, dst ) ) 
-#define EMITASM_SARL( src, dst )            ( fprintf( g_outFile, "\tsarl\t%s, %s\n", src, dst ) )
-
-/* Converts a register enum to a register string. */
-#define ASM_REG( reg )                      ( g_registers[reg] )
-
-/* Generates a new label name and stores it in the string. */
-#define GENERATE_LABEL( str )               ( sprintf( str, ".L%d", g_labelCount++ ) )
-
-/* Generates a string for a pointer. */
-#define ASM_POINTER( str, reg, offset )     { if( offset == 0 ) sprintf( str, "(%s)", reg ); \
-                                              else sprintf( str, "%d(%s)", offset, reg ); }
-		
-/* Generates a string for the location of a local variable on the stack. */
-#define ASM_LOCAL( str, loc )               { sprintf( str, "%d(%%ebp)", loc ); }
-
-enum REGISTERS
-{
-    EAX = 0,
-    AX,
-    AL,
-    AH,
-    EBX,
-    BX,
-    BL,
-    BH,
-    ECX,
-    CX,
-    CL,
-    CH,
-    EDX,
-    DX,
-    DL,
-    DH,
-    ESP,
-    EBP,
-    EIP
-};
+/* SSE registers for float arguments on x86_64. */
+#define NR_OF_FLOAT_ARGUMENTS               8
 
-char g_registers[19][8] = 
-{
-    "%eax", "%ax", "%al", "%ah", "%ebx", "%bx", "%bl", "%bh", "%ecx", "%cx", "%cl", "%ch",
-    "%edx", "%dx", "%dl", "%dh", "%esp", "%ebp", "%eip"
-};
+/* Label of the sign bit mask that negates a float. */
+#define SIGN_MASK                           ".LFsign"
 
+/* Alignment of the stack at calls on x86_64. */
+#define STACK_ALIGNMENT                     16
 
-/*
- * Converts an integer to a literal used in assembly code.
+/* A register list and its length. */
+#define LIST( a )                           a, sizeof( a ) / sizeof( int )
+
+
+/* Encodes a floating point value: returns its IEEE
+ * single precision bits.
  */
-static char* IntToAsmLit( int i )
+static unsigned long EncodeFloat( float value )
 {
-    static char str[32];
-    sprintf( str, "$%d", i );
-    return str;
+    unsigned int bits;
+
+    memcpy( &bits, &value, sizeof( bits ) );
+    return( bits );
 }
 
-static char *AsmAddressReg( int reg )
+
+/******************************************
+ *               TYPES                    *  
+ ******************************************/
+
+/* A function defined in the module, and its entry
+ * point for callers in the module. */
+typedef struct InternalFunction
 {
-    static char str[32];
-    sprintf( str, "(%s)", g_registers[reg] );
-    return str;
-}
+    char *name;
+    char *entry;
+} InternalFunction;
 
-/* Encodes a floating point value.
- */
-static long EncodeFloat( char *val )
+/* The registers of a target machine, each list in
+ * order of preference. */
+typedef struct Target
 {
-    return 0x00000000;
-}
+    int *temporaries;
+    int nrOfTemporaries;
+    int *calleeSaved;       /* saved by a function that writes them */
+    int nrOfCalleeSaved;
+    int *callerSaved;       /* saved around calls */
+    int nrOfCallerSaved;
+    int *arguments;         /* for the first arguments */
+    int nrOfArguments;
+    BOOL byteRegisters;     /* every register has a byte form */
+} Target;
+
+/* A float constant in .rodata. */
+typedef struct FloatConstant
+{
+    unsigned long bits;
+    char *name;             /* .LFn */
+} FloatConstant;
 
 
 /******************************************
@@ -161,10 +109,334 @@ static long EncodeFloat( char *val )
 FILE *g_outFile;
 static int g_labelCount;
 
+/* i386: temporaries that survive calls come first.
+ * Arguments in registers are only passed to functions
+ * defined in the module, as with gcc's regparm(3). */
+static int i386Temporaries[] =
+{
+    REG_EBX, REG_ESI, REG_EDI, REG_ECX, REG_EDX, REG_EAX
+};
+
+static int i386CalleeSaved[] =
+{
+    REG_EBX, REG_ESI, REG_EDI
+};
+
+static int i386CallerSaved[] =
+{
+    REG_EAX, REG_ECX, REG_EDX
+};
+
+static int i386Arguments[] =
+{
+    REG_EAX, REG_EDX, REG_ECX
+};
+
+/* x86_64 (System V ABI): there are enough registers
+ * that a call rarely finds a temporary in use, so
+ * the ones that need no saving come first. R11 is
+ * kept free as a scratch register. */
+static int x86_64Temporaries[] =
+{
+    REG_ESI, REG_EDI, REG_R8, REG_R9, REG_R10, REG_ECX, REG_EDX, REG_EAX,
+    REG_EBX, REG_R12, REG_R13, REG_R14, REG_R15
+};
+
+static int x86_64CalleeSaved[] =
+{
+    REG_EBX, REG_R12, REG_R13, REG_R14, REG_R15
+};
+
+static int x86_64CallerSaved[] =
+{
+    REG_EAX, REG_ECX, REG_EDX, REG_ESI, REG_EDI, REG_R8, REG_R9, REG_R10
+};
+
+static int x86_64Arguments[] =
+{
+    REG_EDI, REG_ESI, REG_EDX, REG_ECX, REG_R8, REG_R9
+};
+
+static Target i386Target =
+{
+    LIST( i386Temporaries ), LIST( i386CalleeSaved ), LIST( i386CallerSaved ),
+    LIST( i386Arguments ), FALSE
+};
+
+static Target x86_64Target =
+{
+    LIST( x86_64Temporaries ), LIST( x86_64CalleeSaved ), LIST( x86_64CallerSaved ),
+    LIST( x86_64Arguments ), TRUE
+};
+
+/* The target being generated for. */
+static Target *g_target;
+
+/* Registers holding values (see REGISTER_MASK). */
+static unsigned int g_usedRegisters;
+
+/* Bytes pushed since the start of the function body,
+ * for the stack alignment at calls. */
+static int g_stackDepth;
+
+/* Label of the current function's epilogue. */
+static int g_returnLabel;
+
+/* The function being generated, and the label after
+ * its prologue where a call to itself in tail
+ * position starts over. */
+static TreeNode *g_function;
+static int g_restartLabel;
+
+/* Where the tail calls of the current function
+ * restore the callee-saved registers (see
+ * GenerateTailEpilogue). */
+static int *g_tailCalls = NULL;
+static int g_nrOfTailCalls, g_maxTailCalls;
+
+/* Functions called with their first arguments in
+ * registers (see CollectInternalFunctions). */
+static InternalFunction *g_internalFunctions = NULL;
+static int g_nrOfInternalFunctions, g_maxInternalFunctions;
+
+/* The float constant pool of the module. */
+static FloatConstant *g_floatConstants = NULL;
+static int g_nrOfFloatConstants, g_maxFloatConstants;
+static BOOL g_signMaskUsed;
+
 /******************************************
  *               FORWARDS                 *  
  ******************************************/
-static void GenerateCodeForNode( TreeNode *node );
+static void GenerateApplicationCode( TreeNode *node, int reg );
+static int GenerateFloatCompare( TreeNode *node );
+
+/* Checks whether [type] is float without dimensions. */
+static BOOL IsFloatType( Type *type )
+{
+    return( type != NULL && GetSimpleType( type ) == FLOAT && ListSize( type->dimensions ) == 0 );
+}
+
+/* Checks whether the function with header [header]
+ * returns a float. */
+static BOOL ReturnsFloat( TreeNode *header )
+{
+    return( GetReturnTypeFromHeader( header ) == NODE_FLOAT
+            && GetReturnTypeDimensionsFromHeader( header ) == 0 );
+}
+
+/* Checks whether the function being generated returns
+ * a float on the x87 stack, as a C entry point does on
+ * i386. A float is returned in XMM0 otherwise. */
+static BOOL ReturnsOnX87()
+{
+    return( GetTarget() == TARGET_I386
+            && GetInternalEntry( GetNameFromHeader( GetHeaderFromFunction( g_function ) ) ) == NULL );
+}
+
+/* Checks whether expression [node] is a float. */
+BOOL IsFloat( TreeNode *node )
+{
+    return( IsFloatType( TOAST( node )->type ) );
+}
+
+/* Checks whether [node] is a comparison of floats. */
+static BOOL IsFloatComparison( TreeNode *node )
+{
+    switch( TOAST( node )->id )
+    {
+    case NODE_EQUAL:
+    case NODE_NOTEQUAL:
+    case NODE_LESS:
+    case NODE_LESSEQUAL:
+    case NODE_GREATER:
+    case NODE_GREATEREQUAL:
+        return( IsFloat( GetTreeChild( node, 0 ) ) );
+    }
+    return( FALSE );
+}
+
+/* Returns the initializer of declaration [node]
+ * without the unary minus and plus signs in front of
+ * it, and sets [negative] if the signs negate it. */
+static TreeNode *GetInitializerLiteral( TreeNode *node, BOOL *negative )
+{
+    TreeNode *literal;
+
+    literal = GetTreeChild( GetTreeChild( node, 4 ), 0 );
+    *negative = FALSE;
+    while( TOAST( literal )->id == NODE_UNARY_SUBTRACT
+           || TOAST( literal )->id == NODE_UNARY_ADD )
+    {
+        if( TOAST( literal )->id == NODE_UNARY_SUBTRACT ) *negative = !*negative;
+        literal = GetTreeChild( literal, 0 );
+    }
+    return( literal );
+}
+
+/* Returns the initial value of float declaration
+ * [node]. */
+static float GetFloatInitializer( TreeNode *node )
+{
+    TreeNode *literal;
+    BOOL negative;
+    float value;
+
+    literal = GetInitializerLiteral( node, &negative );
+    switch( TOAST( literal )->id )
+    {
+    case NODE_LIT_FLOAT:
+        value = TOAST( literal )->val.floatvalue;
+        break;
+    case NODE_LIT_INT:
+        value = (float) (int) TOAST( literal )->val.uintvalue;
+        break;
+    default:
+        value = (float) atof( GetInitializerFromDecl( node ) );
+    }
+    return( ( negative == TRUE ) ? -value : value );
+}
+
+/* Returns the initial value of int, char or bool
+ * declaration [node] as a word, as an assignment of
+ * the literal would store it. */
+static int GetWordInitializer( TreeNode *node )
+{
+    TreeNode *literal;
+    BOOL negative;
+    int value;
+
+    literal = GetInitializerLiteral( node, &negative );
+    switch( TOAST( literal )->id )
+    {
+    case NODE_LIT_INT:
+        value = (int) TOAST( literal )->val.uintvalue;
+        break;
+    case NODE_LIT_CHAR:
+        value = TOAST( literal )->val.charvalue;
+        break;
+    case NODE_LIT_BOOL:
+        value = ( TOAST( literal )->val.boolvalue == TRUE );
+        break;
+    default:
+        value = atoi( GetInitializerFromDecl( node ) );
+    }
+    return( ( negative == TRUE ) ? -value : value );
+}
+
+/*
+ * Returns the memory operand of the float with bits
+ * [bits] in the constant pool, adding it if it is
+ * not there yet.
+ */
+static Operand GetFloatConstant( unsigned long bits )
+{
+    FloatConstant *constant;
+    int i;
+
+    bits &= 0xffffffffUL;
+    for( i = 0; i < g_nrOfFloatConstants; i++ )
+    {
+        if( g_floatConstants[i].bits == bits ) return( AsmSym( g_floatConstants[i].name ) );
+    }
+
+    if( g_nrOfFloatConstants == g_maxFloatConstants )
+    {
+        g_maxFloatConstants = ( g_maxFloatConstants == 0 ) ? 16 : g_maxFloatConstants * 2;
+        g_floatConstants = (FloatConstant *) realloc( g_floatConstants,
+            g_maxFloatConstants * sizeof( FloatConstant ) );
+        if( g_floatConstants == NULL ) BAILOUT( ERR_NOMEM );
+    }
+    constant = &g_floatConstants[g_nrOfFloatConstants];
+    constant->bits = bits;
+    constant->name = (char *) malloc( 16 );
+    if( constant->name == NULL ) BAILOUT( ERR_NOMEM );
+    sprintf( constant->name, ".LF%d", g_nrOfFloatConstants++ );
+    return( AsmSym( constant->name ) );
+}
+
+/* Returns the sign bit mask, for xorps. */
+static Operand GetSignMask()
+{
+    g_signMaskUsed = TRUE;
+    return( AsmSym( SIGN_MASK ) );
+}
+
+/*
+ * Emits the float constant pool to .rodata. xorps
+ * reads 16 aligned bytes, so the sign mask is padded.
+ */
+static void GenerateFloatConstants()
+{
+    int i;
+
+    if( g_nrOfFloatConstants == 0 && g_signMaskUsed == FALSE ) return;
+
+    AsmEmitDirective( "\t.section\t.rodata" );
+    if( g_signMaskUsed == TRUE )
+    {
+        AsmEmitDirective( "\t.align 16" );
+        AsmEmitDirective( "%s:", SIGN_MASK );
+        AsmEmitDirective( "\t.long\t0x80000000, 0, 0, 0" );
+    }
+    AsmEmitDirective( "\t.align 4" );
+    for( i = 0; i < g_nrOfFloatConstants; i++ )
+    {
+        AsmEmitDirective( "%s:", g_floatConstants[i].name );
+        AsmEmitDirective( "\t.long\t0x%lx", g_floatConstants[i].bits );
+    }
+    AsmEmitDirective( "\t.text" );
+}
+
+static void FreeFloatConstants()
+{
+    int i;
+
+    for( i = 0; i < g_nrOfFloatConstants; i++ )
+    {
+        free( g_floatConstants[i].name );
+    }
+    free( g_floatConstants );
+    g_floatConstants = NULL;
+    g_nrOfFloatConstants = g_maxFloatConstants = 0;
+    g_signMaskUsed = FALSE;
+}
+
+/*
+ * Returns the number of bytes of storage needed for
+ * the variable declared by a NODE_DECLARATION node:
+ * the element size times the size of every array
+ * dimension. Pointers take an address.
+ */
+static int GetStorageSizeFromDecl( TreeNode *node )
+{
+    int references, dimensions, size, i;
+
+    references = TOAST( GetTreeChild( node, 1 ) )->val.uintvalue;
+    dimensions = GetDimensionsFromDecl( node );
+
+    if( references > 0 )
+    {
+        size = WORD_SIZE;
+    }
+    else
+    {
+        switch( GetTypeFromDecl( node ) )
+        {
+        case CHAR:
+        case BOOLEAN:
+            size = 1;
+            break;
+        default:
+            size = 4;
+        }
+    }
+
+    for( i = references; i < dimensions; i++ )
+    {
+        size *= GetDimensionSizeFromDecl( node, i );
+    }
+    return( size );
+}
 
 /* 
  * This functions counts the # of bytes 
@@ -174,7 +446,7 @@ static int CountAllocatedBytes( TreeNode *node, int byteCount )
 {
     Symbol *symbol;
     
-    int i;
+    int i, size;
   //  printf( "CountAllocatedBytes: %s\n", GetNodeName(TOAST(node)->id) );
     switch( TOAST( node )->id )
     {
@@ -184,15 +456,76 @@ static int CountAllocatedBytes( TreeNode *node, int byteCount )
 	symbol = FindSymbol( GetNameFromDecl( node ) );
 	switch( GetTypeFromDecl( node ) )
 	{
+	/* Chars and bools are loaded and stored as 32-bit
+	 * values, so they take a full slot too; arrays
+	 * take the slots of their elements, and the
+	 * location is that of the first. */
 	case INT:
 	case FLOAT:
-	    symbol->location = -( byteCount + 4 );
-	    byteCount += 4;
+	case CHAR:
+	case BOOLEAN:
+	    size = ( GetStorageSizeFromDecl( node ) + 3 ) & ~3;
+	    if( symbol->reference == TRUE )
+	    {
+		byteCount = ( byteCount + WORD_SIZE - 1 ) & -WORD_SIZE;
+	    }
+	    symbol->location = -( byteCount + size );
+	    byteCount += size;
 	    break;
+	}
+        break;
+	
+    /* Recurse. */
+    default:
+	ListFirst( node->children );
+        for( i = 0; i < ListSize( node->children ); i++ )
+        {
+            byteCount = CountAllocatedBytes( ListGet( node->children ), byteCount );
+            ListNext( node->children );
+        }
+    }
+    return byteCount;
+}
+
+
+/* 
+ * This functions initializes local variables.
+ */
+static void InitializeLocals( TreeNode *node )
+{
+    Symbol *symbol;
+    Operand destination;
+    int i;
+    
+    switch( TOAST( node )->id )
+    {
+
+    /* Generate code if this is a global declaration. */
+    case NODE_DECLARATION:
+	if( GetInitializerFromDecl( node ) == NULL ) break;
+	symbol = FindSymbol( GetNameFromDecl( node ) );
+	if( symbol->reg != REG_NONE )
+	{
+	    destination = AsmReg( symbol->reg );
+	}
+	else
+	{
+	    destination = AsmMem( REG_EBP, symbol->location );
+	}
+
+	/* A char or bool variable has a word of its own
+	 * and is read as a word, so the whole word is
+	 * stored. */
+	switch( GetTypeFromDecl( node ) )
+	{
+	case INT:
 	case CHAR:
 	case BOOLEAN:
-	    symbol->location = -( byteCount + 4 );
-	    byteCount++;
+	    AsmEmit2( ASM_MOV, 4, AsmImm( GetWordInitializer( node ) ), destination );
+	    break;
+	case FLOAT:
+	    AsmEmit2( ASM_MOV, 4, AsmImm( (int) EncodeFloat( GetFloatInitializer( node ) ) ),
+		destination );
 	    break;
 	}
         break;
@@ -202,206 +535,2823 @@ static int CountAllocatedBytes( TreeNode *node, int byteCount )
 	ListFirst( node->children );
         for( i = 0; i < ListSize( node->children ); i++ )
         {
-            byteCount = CountAllocatedBytes( ListGet( node->children ), byteCount );
-            ListNext( node->children );
+            InitializeLocals( ListGet( node->children ) );
+            ListNext( node->children );
+        }
+    }
+}
+
+
+/*
+ * Records the functions defined in [node]. Calls
+ * between them pass the first arguments in registers;
+ * every function also keeps its C entry point, since
+ * another module or C code may call it through an
+ * extern declaration.
+ */
+static void CollectInternalFunctions( TreeNode *node )
+{
+    InternalFunction *function;
+    char *name;
+    int i;
+
+    switch( TOAST( node )->id )
+    {
+    case NODE_FUNCTION:
+        if( GetBlockFromFunction( node ) == NULL ) return;
+        if( g_nrOfInternalFunctions == g_maxInternalFunctions )
+        {
+            g_maxInternalFunctions = ( g_maxInternalFunctions == 0 ) ? 16 : g_maxInternalFunctions * 2;
+            g_internalFunctions = (InternalFunction *) realloc( g_internalFunctions,
+                g_maxInternalFunctions * sizeof( InternalFunction ) );
+            if( g_internalFunctions == NULL ) BAILOUT( ERR_NOMEM );
+        }
+        name = GetNameFromHeader( GetHeaderFromFunction( node ) );
+        function = &g_internalFunctions[g_nrOfInternalFunctions++];
+        function->name = name;
+        function->entry = (char *) malloc( strlen( name ) + strlen( ".fast" ) + 1 );
+        if( function->entry == NULL ) BAILOUT( ERR_NOMEM );
+        sprintf( function->entry, "%s.fast", name );
+        return;
+
+    case NODE_GLOBAL:
+        if( IsExternFromGlobal( node ) == TRUE ) return;
+        break;
+    }
+
+    for( i = 0; i < ListSize( node->children ); i++ )
+    {
+        CollectInternalFunctions( GetTreeChild( node, i ) );
+    }
+}
+
+/*
+ * Returns the register entry point of function [name],
+ * or NULL if it is called the C way.
+ */
+char *GetInternalEntry( char *name )
+{
+    int i;
+
+    for( i = 0; i < g_nrOfInternalFunctions; i++ )
+    {
+        if( strcmp( g_internalFunctions[i].name, name ) == 0 )
+        {
+            return( g_internalFunctions[i].entry );
+        }
+    }
+    return( NULL );
+}
+
+static void FreeInternalFunctions()
+{
+    int i;
+
+    for( i = 0; i < g_nrOfInternalFunctions; i++ )
+    {
+        free( g_internalFunctions[i].entry );
+    }
+    free( g_internalFunctions );
+    g_internalFunctions = NULL;
+    g_nrOfInternalFunctions = g_maxInternalFunctions = 0;
+}
+
+/*
+ * Generates the C entry point of a function with
+ * [paramCount] parameters that is called at [entry]
+ * with its first arguments in registers. The
+ * arguments are loaded from the stack, and the code
+ * falls through into [entry]; arguments beyond the
+ * registers are pushed again for a call. With
+ * [floatResult], the result comes back from [entry]
+ * in XMM0 and is moved to the x87 stack for C
+ * callers.
+ */
+static void GenerateEntryWrapper( int paramCount, char *entry, BOOL floatResult )
+{
+    int registerCount, stackCount, i;
+
+    registerCount = paramCount < g_target->nrOfArguments ? paramCount : g_target->nrOfArguments;
+    stackCount = paramCount - registerCount;
+
+    /* Each push moves the next argument to the same
+     * offset. */
+    for( i = 0; i < stackCount; i++ )
+    {
+        AsmEmit1( ASM_PUSH, 4, AsmMem( REG_ESP, paramCount * 4 ) );
+    }
+    for( i = 0; i < registerCount; i++ )
+    {
+        AsmEmit2( ASM_MOV, 4, AsmMem( REG_ESP, ( stackCount + i + 1 ) * 4 ),
+            AsmReg( g_target->arguments[i] ) );
+    }
+    if( floatResult == TRUE )
+    {
+        /* The result goes through the slot of the first
+         * argument pushed, or a slot of its own. */
+        AsmEmit1( ASM_CALL, 4, AsmSym( entry ) );
+        if( stackCount == 0 )
+        {
+            AsmEmit2( ASM_SUB, 4, AsmImm( 4 ), ESP );
+            stackCount = 1;
+        }
+        AsmEmit2( ASM_MOVSS, 4, AsmReg( REG_XMM0 ), AsmMem( REG_ESP, 0 ) );
+        AsmEmit1( ASM_FLDS, 4, AsmMem( REG_ESP, 0 ) );
+        AsmEmit2( ASM_ADD, 4, AsmImm( stackCount * 4 ), ESP );
+        AsmEmit0( ASM_RET );
+    }
+    else if( stackCount > 0 )
+    {
+        AsmEmit1( ASM_CALL, 4, AsmSym( entry ) );
+        AsmEmit2( ASM_ADD, 4, AsmImm( stackCount * 4 ), ESP );
+        AsmEmit0( ASM_RET );
+    }
+    AsmEmitGlobalLabel( entry );
+}
+
+/*
+ * Assigns registers to the [count] arguments of a
+ * call to function [name], of which [floats] tells
+ * which are floats: regs[i] is the register of
+ * argument i, or REG_NONE if it is passed on the
+ * stack. On i386 the first arguments to a function
+ * in the module go in registers, a float as its bits;
+ * on x86_64 ints and floats each take the next
+ * register of their own kind.
+ */
+void AssignArgumentRegisters( char *name, int count, BOOL *floats, int *regs )
+{
+    int i, nrOfInts = 0, nrOfFloats = 0;
+
+    for( i = 0; i < count; i++ )
+    {
+        regs[i] = REG_NONE;
+        if( GetTarget() == TARGET_I386 )
+        {
+            if( GetInternalEntry( name ) != NULL && i < g_target->nrOfArguments )
+            {
+                regs[i] = g_target->arguments[i];
+            }
+        }
+        else if( floats[i] == TRUE )
+        {
+            if( nrOfFloats < NR_OF_FLOAT_ARGUMENTS ) regs[i] = REG_XMM0 + nrOfFloats++;
+        }
+        else if( nrOfInts < g_target->nrOfArguments )
+        {
+            regs[i] = g_target->arguments[nrOfInts++];
+        }
+    }
+}
+
+/*
+ * Pushes [operand] on the stack. x86_64 only pushes
+ * quads, so a variable is loaded into R11 first.
+ */
+void Push( Operand operand )
+{
+    if( WORD_SIZE == 8 && operand.kind == OPERAND_MEMORY )
+    {
+        AsmEmit2( ASM_MOV, 4, operand, AsmReg( REG_R11 ) );
+        operand = AsmReg( REG_R11 );
+    }
+    AsmEmit1( ASM_PUSH, 4, operand );
+    g_stackDepth += WORD_SIZE;
+}
+
+void Pop( int reg )
+{
+    AsmEmit1( ASM_POP, 4, AsmReg( reg ) );
+    g_stackDepth -= WORD_SIZE;
+}
+
+/* Pushes SSE register [reg], in a stack slot of its
+ * own. */
+static void PushFloat( int reg )
+{
+    AsmEmit2( ASM_SUB, 4, AsmImm( WORD_SIZE ), ESP );
+    AsmEmit2( ASM_MOVSS, 4, AsmReg( reg ), AsmMem( REG_ESP, 0 ) );
+    g_stackDepth += WORD_SIZE;
+}
+
+/*
+ * Releases [bytes] of stack. With [keepFlags], lea is
+ * used so that the flags are left alone.
+ */
+static void ReleaseStack( int bytes, BOOL keepFlags )
+{
+    if( keepFlags == TRUE )
+    {
+        AsmEmit2( ASM_LEA, 4, AsmMem( REG_ESP, bytes ), ESP );
+    }
+    else
+    {
+        AsmEmit2( ASM_ADD, 4, AsmImm( bytes ), ESP );
+    }
+    g_stackDepth -= bytes;
+}
+
+/* Pops SSE register [reg]; with [keepFlags], the
+ * flags are left alone. */
+static void PopFloat( int reg, BOOL keepFlags )
+{
+    AsmEmit2( ASM_MOVSS, 4, AsmMem( REG_ESP, 0 ), AsmReg( reg ) );
+    ReleaseStack( WORD_SIZE, keepFlags );
+}
+
+/*
+ * Checks whether instructions [first] up to [last]
+ * contain a call.
+ */
+static BOOL HasCalls( AsmCode *code, int first, int last )
+{
+    int i;
+
+    for( i = first; i < last; i++ )
+    {
+        if( code->instructions[i].opcode == ASM_CALL ) return( TRUE );
+    }
+    return( FALSE );
+}
+
+/*
+ * Checks whether the function in instructions
+ * [first] up to [last] can do without a frame: it
+ * makes no calls, has no locals and does not move
+ * the stack pointer, so its parameters can be
+ * addressed from ESP. The epilogues of tail calls are
+ * left out.
+ */
+static BOOL IsFrameless( AsmCode *code, int first, int last )
+{
+    Instruction *instruction;
+    int i, j, tailCall = 0;
+
+    for( i = first; i < last; i++ )
+    {
+        if( tailCall < g_nrOfTailCalls && i == g_tailCalls[tailCall] )
+        {
+            i += g_target->nrOfCalleeSaved + 1;
+            tailCall++;
+            continue;
+        }
+        instruction = &code->instructions[i];
+        switch( instruction->opcode )
+        {
+        case ASM_CALL:
+        case ASM_PUSH:
+        case ASM_POP:
+        case ASM_PUSHA:
+        case ASM_POPA:
+            return( FALSE );
+        }
+        if( ( AsmRegistersWritten( instruction ) & REGISTER_MASK( REG_ESP ) ) != 0 )
+        {
+            return( FALSE );
+        }
+        for( j = 0; j < instruction->operandCount; j++ )
+        {
+            if( instruction->operands[j].kind == OPERAND_REGISTER
+                && instruction->operands[j].base == REG_EBP ) return( FALSE );
+        }
+    }
+    return( TRUE );
+}
+
+/*
+ * This function generates the code 
+ * needed for a function declaration.
+ * The prologue saves the callee-saved registers and
+ * the epilogue restores them; once the body is known,
+ * the saves of registers it does not write are
+ * removed, and a leaf function without locals loses
+ * its frame too.
+ */
+static void GenerateFunctionCode( TreeNode *node )
+{
+    AsmCode *code = AsmGetCode();
+    TreeNode *header = GetHeaderFromFunction( node );
+    Instruction *instruction;
+    int localBytes, i, j, prologue, frame, body, epilogue, saved, paramCount;
+    int stackCount = 0, lastMove = -1, *regs;
+    unsigned int written = 0;
+    Symbol *symbol;
+    Operand destination;
+    BOOL *floats;
+    char *name, *entry;
+
+    name = GetNameFromHeader( header );
+    paramCount = GetParamCountFromHeader( header );
+    BeginTraceSpan( TRACE_FUNCTION, name );
+    g_function = node;
+    g_nrOfTailCalls = 0;
+    
+    /* Generate function start code. On i386 at -O1,
+     * callers in the module use the register entry
+     * point. */
+    AsmEmitDirective( ".globl %s", name );
+    AsmEmitDirective( "\t.type\t%s,@function", name );
+    AsmEmitGlobalLabel( name );
+    entry = GetInternalEntry( name );
+    if( entry != NULL )
+    {
+        GenerateEntryWrapper( paramCount, entry, ReturnsFloat( header ) );
+    }
+    prologue = code->count;
+    AsmEmit1( ASM_PUSH, 4, EBP );
+    AsmEmit2( ASM_MOV, 4, ESP, EBP );
+    
+    /* Enter the scope in the symbol table. */
+    EnterScope();
+
+    regs = (int *) malloc( ( paramCount + 1 ) * sizeof( int ) );
+    floats = (BOOL *) malloc( ( paramCount + 1 ) * sizeof( BOOL ) );
+    if( regs == NULL || floats == NULL ) BAILOUT( ERR_NOMEM );
+    for( i = 0; i < paramCount; i++ )
+    {
+        floats[i] = IsFloatType( GetSymbolType( GetParamNameFromHeader( header, i ) ) );
+    }
+    AssignArgumentRegisters( name, paramCount, floats, regs );
+
+    /* Parameters passed on the stack are above the return
+     * address. */
+    localBytes = CountAllocatedBytes( GetBlockFromFunction( node ), 0 );
+    //printf( "paramcount: %d\n", GetParamCountFromHeader( GetHeaderFromFunction(node) ) );
+    for( i = 0; i < paramCount; i++ )
+    {
+        if( regs[i] != REG_NONE ) continue;
+        symbol = FindSymbol( GetParamNameFromHeader( header, i ) );
+	symbol->location = ( stackCount++ + 2 ) * WORD_SIZE;
+	//printf( "symbol: %d\n", symbol->location );
+    }
+
+    /* Keep scalar locals and parameters in registers, which
+     * are then not available as temporaries. */
+    g_usedRegisters = 0;
+    if( GetOptimizationLevel() >= 1 )
+    {
+        g_usedRegisters = AllocateVariableRegisters( node );
+    }
+
+    /* Parameters passed in registers that are not kept in
+     * one get a slot below the locals. */
+    for( i = 0; i < paramCount; i++ )
+    {
+        if( regs[i] == REG_NONE ) continue;
+        symbol = FindSymbol( GetParamNameFromHeader( header, i ) );
+        if( symbol->reg == REG_NONE && symbol->reference == TRUE )
+        {
+            localBytes = ( localBytes + 2 * WORD_SIZE - 1 ) & -WORD_SIZE;
+            symbol->location = -localBytes;
+        }
+        else if( symbol->reg == REG_NONE )
+        {
+            localBytes += 4;
+            symbol->location = -localBytes;
+        }
+    }
+
+    /* Allocate space on the stack for local variables (the
+     * size is set once the saved registers are known). The
+     * locals sit directly below EBP, so the registers are
+     * saved below them. */
+    frame = code->count;
+    AsmEmit2( ASM_SUB, 4, AsmImm( localBytes ), ESP );
+    for( i = 0; i < g_target->nrOfCalleeSaved; i++ )
+    {
+        AsmEmit1( ASM_PUSH, 4, AsmReg( g_target->calleeSaved[i] ) );
+    }
+
+    /* Move the parameters to where they are kept. On i386,
+     * EDX holds an argument and may hold a variable, so a
+     * move to an argument register comes last. Floats are
+     * kept in memory. */
+    body = code->count;
+    for( i = 0; i < paramCount; i++ )
+    {
+        symbol = FindSymbol( GetParamNameFromHeader( header, i ) );
+        if( regs[i] == REG_NONE )
+        {
+            if( symbol->reg != REG_NONE )
+            {
+                AsmEmit2( ASM_MOV, 4, AsmMem( REG_EBP, symbol->location ), AsmReg( symbol->reg ) );
+            }
+            continue;
+        }
+        if( regs[i] >= REG_XMM0 )
+        {
+            AsmEmit2( ASM_MOVSS, 4, AsmReg( regs[i] ), AsmMem( REG_EBP, symbol->location ) );
+            continue;
+        }
+        if( symbol->reg == regs[i] ) continue;
+        for( j = 0; j < paramCount; j++ )
+        {
+            if( regs[j] != REG_NONE && symbol->reg == regs[j] ) lastMove = i;
+        }
+        if( lastMove == i ) continue;
+        destination = ( symbol->reg != REG_NONE ) ? AsmReg( symbol->reg ) : AsmMem( REG_EBP, symbol->location );
+        AsmEmit2( ASM_MOV, ( symbol->reference == TRUE ) ? WORD_SIZE : 4, AsmReg( regs[i] ), destination );
+    }
+    if( lastMove >= 0 )
+    {
+        symbol = FindSymbol( GetParamNameFromHeader( header, lastMove ) );
+        AsmEmit2( ASM_MOV, 4, AsmReg( regs[lastMove] ), AsmReg( symbol->reg ) );
+    }
+    free( regs );
+    free( floats );
+    if( GetOptimizationLevel() >= 1 )
+    {
+        g_restartLabel = GenerateLabel();
+        AsmEmitLabel( g_restartLabel );
+    }
+    InitializeLocals( GetBlockFromFunction( node ) );
+
+    /* Generate code for function implementation. */
+    g_returnLabel = GenerateLabel();
+    g_stackDepth = 0;
+    GenerateCodeForNode( GetBlockFromFunction( node ) );
+
+    /* Leave scope in the symbol table. */
+    ExitScope();
+    g_usedRegisters = 0;
+
+    /* Generate function return code. The return value
+     * is in EAX, or a float in XMM0, which the ret then
+     * reads. */
+    AsmEmitLabel( g_returnLabel );
+    epilogue = code->count;
+    for( i = g_target->nrOfCalleeSaved - 1; i >= 0; i-- )
+    {
+        AsmEmit1( ASM_POP, 4, AsmReg( g_target->calleeSaved[i] ) );
+    }
+    AsmEmit0( ASM_LEAVE );
+    if( ReturnsFloat( header ) == TRUE && ReturnsOnX87() == FALSE )
+    {
+        AsmEmit1( ASM_RET, 4, AsmReg( REG_XMM0 ) );
+    }
+    else
+    {
+        AsmEmit0( ASM_RET );
+    }
+    AsmEmitDirective( "" );
+
+    /* Only save the registers the body writes, not
+     * counting the restores before tail calls. */
+    for( i = body, j = 0; i < epilogue; i++ )
+    {
+        if( j < g_nrOfTailCalls && i == g_tailCalls[j] )
+        {
+            i += g_target->nrOfCalleeSaved - 1;
+            j++;
+            continue;
+        }
+        written |= AsmRegistersWritten( &code->instructions[i] );
+    }
+    saved = 0;
+    for( i = 0; i < g_target->nrOfCalleeSaved; i++ )
+    {
+        if( ( written & REGISTER_MASK( g_target->calleeSaved[i] ) ) != 0 )
+        {
+            saved++;
+            continue;
+        }
+        code->instructions[body - g_target->nrOfCalleeSaved + i].opcode = ASM_DELETED;
+        code->instructions[epilogue + g_target->nrOfCalleeSaved - 1 - i].opcode = ASM_DELETED;
+        for( j = 0; j < g_nrOfTailCalls; j++ )
+        {
+            code->instructions[g_tailCalls[j] + g_target->nrOfCalleeSaved - 1 - i].opcode = ASM_DELETED;
+        }
+    }
+
+    /* Without a frame, the parameters are found above
+     * the return address and the saved registers. */
+    if( localBytes == 0 && IsFrameless( code, body, epilogue ) == TRUE )
+    {
+        code->instructions[prologue].opcode = ASM_DELETED;
+        code->instructions[prologue + 1].opcode = ASM_DELETED;
+        code->instructions[epilogue + g_target->nrOfCalleeSaved].opcode = ASM_DELETED;
+        for( i = 0; i < g_nrOfTailCalls; i++ )
+        {
+            code->instructions[g_tailCalls[i] + g_target->nrOfCalleeSaved].opcode = ASM_DELETED;
+        }
+        for( i = body; i < epilogue; i++ )
+        {
+            instruction = &code->instructions[i];
+            for( j = 0; j < instruction->operandCount; j++ )
+            {
+                if( instruction->operands[j].kind == OPERAND_MEMORY
+                    && instruction->operands[j].base == REG_EBP )
+                {
+                    instruction->operands[j].base = REG_ESP;
+                    instruction->operands[j].value += WORD_SIZE * saved - WORD_SIZE;
+                }
+            }
+        }
+    }
+
+    /* On x86_64 the body starts with the stack aligned,
+     * so that calls can keep it aligned. */
+    else if( GetTarget() == TARGET_X86_64 && HasCalls( code, body, epilogue ) == TRUE )
+    {
+        while( ( localBytes + WORD_SIZE * saved ) % STACK_ALIGNMENT != 0 )
+        {
+            localBytes += 4;
+        }
+    }
+    if( localBytes > 0 )
+    {
+        code->instructions[frame].operands[0].value = localBytes;
+    }
+    else
+    {
+        code->instructions[frame].opcode = ASM_DELETED;
+    }
+
+    /* Optimize and write the function's code. */
+    if( GetOptimizationLevel() >= 1 )
+    {
+        OptimizePeephole( AsmGetCode() );
+    }
+    AsmWrite( g_outFile );
+
+    EndTraceSpan();
+}
+
+/* 
+ * Recursive function that traverses the global
+ * declarations of a module and generates assembly
+ * code for them. Function bodies are not entered:
+ * their declarations are locals.
+ */
+static void GenerateGlobalDeclCodeForNode( TreeNode *node )
+{
+    int i, size;
+    SimpleType type;
+    TreeNode *initNode;
+    char *name, *initializer;
+
+    switch( TOAST( node )->id )
+    {
+
+    /* Generate code if this is a global declaration. */
+    case NODE_DECLARATION:
+	/* The initializer must be a constant. */
+	initNode = GetTreeChild( node, 4 );
+	if( GetNrOfChildren( initNode ) > 0 )
+	{
+	    switch( TOAST( FoldConstants( GetTreeChild( initNode, 0 ) ) )->id )
+	    {
+	    case NODE_LIT_INT:
+	    case NODE_LIT_FLOAT:
+	    case NODE_LIT_CHAR:
+	    case NODE_LIT_BOOL:
+	    case NODE_LIT_STRING:
+		break;
+	    default:
+		AddError( "initializer of global variable is not constant", TOAST( node )->lineno );
+	    }
+	}
+
+	type = GetTypeFromDecl( node );
+	name = GetNameFromDecl( node );
+	initializer = GetInitializerFromDecl( node );
+	size = GetStorageSizeFromDecl( node );
+
+	AsmEmitDirective( ".globl %s", name );
+	AsmEmitDirective( "\t.align 4" );
+	AsmEmitDirective( "\t.type\t%s,@object", name );
+	AsmEmitDirective( "\t.size\t%s,%d", name, size );
+	AsmEmitGlobalLabel( name );
+	if( GetDimensionsFromDecl( node ) > 0 || initializer == NULL )
+	{
+	    AsmEmitDirective( "\t.zero\t%d", size );
+	}
+	else if( type == INT )
+	{
+	    AsmEmitDirective( "\t.long\t%s", initializer );
+	}
+	else if( type == FLOAT )
+	{
+	    AsmEmitDirective( "\t.long\t0x%lx", EncodeFloat( GetFloatInitializer( node ) ) );
+	}
+	else
+	{
+	    AsmEmitDirective( "\t.byte\t%s", initializer );
+	}
+        break;
+
+    /* Extern declarations are defined elsewhere, and
+     * functions hold no global declarations. */
+    case NODE_GLOBAL:
+	if( IsExternFromGlobal( node ) == TRUE )
+	{
+	    break;
+	}
+	/* Fall through. */
+    case NODE_MODULE:
+    case NODE_DECLBLOCK:
+	ListFirst( node->children );
+        for( i = 0; i < ListSize( node->children ); i++ )
+        {
+            GenerateGlobalDeclCodeForNode( ListGet( node->children ) );
+            ListNext( node->children );
+        }
+	break;
+    }
+}
+
+
+
+/*
+ * --------------------------------------------
+ *
+ * Expressions
+ *
+ * Expressions are evaluated into a register given
+ * by the caller. Binary operators evaluate the
+ * operand that needs the most registers first
+ * (Sethi-Ullman numbering), so that the other
+ * operand can be evaluated with fewer registers
+ * in use. Temporaries come from a pool of all
+ * general purpose registers; when it runs dry, the
+ * first operand is pushed on the stack instead.
+ * Literals and variables are used as immediate or
+ * memory operands directly.
+ *
+ * -------------------------------------------
+ */
+
+int GenerateLabel()
+{
+    return( g_labelCount++ );
+}
+
+TreeNode *GetCurrentFunction()
+{
+    return( g_function );
+}
+
+int GetRestartLabel()
+{
+    return( g_restartLabel );
+}
+
+int GetStackDepth()
+{
+    return( g_stackDepth );
+}
+
+/* Allocates a register from the pool, not one of
+ * the registers in [exclude]. Returns REG_NONE if
+ * no register is free. */
+int AllocateRegister( unsigned int exclude )
+{
+    int i;
+
+    for( i = 0; i < g_target->nrOfTemporaries; i++ )
+    {
+        if( ( ( g_usedRegisters | exclude ) & REGISTER_MASK( g_target->temporaries[i] ) ) == 0 )
+        {
+            g_usedRegisters |= REGISTER_MASK( g_target->temporaries[i] );
+            return( g_target->temporaries[i] );
+        }
+    }
+    return( REG_NONE );
+}
+
+void FreeRegister( int reg )
+{
+    g_usedRegisters &= ~REGISTER_MASK( reg );
+}
+
+void ReserveRegister( int reg )
+{
+    g_usedRegisters |= REGISTER_MASK( reg );
+}
+
+BOOL IsRegisterUsed( int reg )
+{
+    return( ( g_usedRegisters & REGISTER_MASK( reg ) ) != 0 );
+}
+
+static BOOL IsRegisterOperand( Operand operand, int reg )
+{
+    return( operand.kind == OPERAND_REGISTER && operand.base == reg );
+}
+
+/*
+ * If [node] is a literal or a variable, stores the
+ * operand for it in [operand] and returns TRUE.
+ */
+BOOL GetLeafOperand( TreeNode *node, Operand *operand )
+{
+    Symbol *symbol;
+
+    switch( TOAST( node )->id )
+    {
+    case NODE_LIT_INT:
+        *operand = AsmImm( (int) TOAST( node )->val.uintvalue );
+        return( TRUE );
+    case NODE_LIT_BOOL:
+        *operand = AsmImm( TOAST( node )->val.boolvalue == TRUE );
+        return( TRUE );
+    case NODE_LIT_CHAR:
+        *operand = AsmImm( TOAST( node )->val.charvalue );
+        return( TRUE );
+    case NODE_LIT_FLOAT:
+        /* Its bits; SSE instructions take it from the
+         * constant pool instead. */
+        *operand = AsmImm( (int) EncodeFloat( TOAST( node )->val.floatvalue ) );
+        return( TRUE );
+    case NODE_LIT_IDENTIFIER:
+        symbol = FindSymbol( GetNameOfIdentifier( node ) );
+        if( symbol->global == TRUE )
+        {
+            *operand = AsmSym( symbol->name );
+        }
+        else if( symbol->reg != REG_NONE )
+        {
+            *operand = AsmReg( symbol->reg );
+        }
+        else
+        {
+            *operand = AsmMem( REG_EBP, symbol->location );
+        }
+        return( TRUE );
+    }
+    return( FALSE );
+}
+
+/*
+ * Returns the Sethi-Ullman number of [node]: the
+ * number of registers needed to evaluate it. A leaf
+ * needs no register when it is the right operand
+ * ([left] is FALSE), because it is used as an
+ * operand directly. Calls and expressions that are
+ * not handled here count as needing all registers,
+ * so they are evaluated first.
+ */
+static int GetRegisterNeed( TreeNode *node, BOOL left )
+{
+    Operand operand;
+    int leftNeed, rightNeed;
+
+    if( GetLeafOperand( node, &operand ) == TRUE )
+    {
+        return( left == TRUE ? 1 : 0 );
+    }
+
+    switch( TOAST( node )->id )
+    {
+    case NODE_UNARY_SUBTRACT:
+        return( GetRegisterNeed( GetTreeChild( node, 0 ), TRUE ) );
+
+    case NODE_BINARY_ADD:
+    case NODE_BINARY_SUBTRACT:
+    case NODE_MULTIPLY:
+    case NODE_DIVIDE:
+    case NODE_MODULUS:
+    case NODE_BITWISE_AND:
+    case NODE_BITWISE_OR:
+    case NODE_BITWISE_XOR:
+    case NODE_BITWISE_LSHIFT:
+    case NODE_BITWISE_RSHIFT:
+    case NODE_EQUAL:
+    case NODE_NOTEQUAL:
+    case NODE_LESS:
+    case NODE_LESSEQUAL:
+    case NODE_GREATER:
+    case NODE_GREATEREQUAL:
+        leftNeed = GetRegisterNeed( GetTreeChild( node, 0 ), TRUE );
+        rightNeed = GetRegisterNeed( GetTreeChild( node, 1 ), FALSE );
+        if( leftNeed == rightNeed ) return( leftNeed + 1 );
+        return( leftNeed > rightNeed ? leftNeed : rightNeed );
+    }
+    return( g_target->nrOfTemporaries );
+}
+
+/*
+ * Evaluates the left operand of binary operator
+ * [node] into [reg], and stores the right operand in
+ * [right]: a leaf operand, a temporary register, or
+ * the top of the stack. Returns the temporary
+ * register, which the caller must free, SPILLED if
+ * the right operand is on the stack (the caller must
+ * pop it), or REG_NONE.
+ */
+static int GenerateOperands( TreeNode *node, int reg, Operand *right )
+{
+    TreeNode *leftNode, *rightNode;
+    int temp;
+
+    leftNode = GetTreeChild( node, 0 );
+    rightNode = GetTreeChild( node, 1 );
+
+    if( GetLeafOperand( rightNode, right ) == TRUE )
+    {
+        GenerateExpression( leftNode, reg );
+        return( REG_NONE );
+    }
+
+    if( GetRegisterNeed( rightNode, FALSE ) > GetRegisterNeed( leftNode, TRUE ) )
+    {
+        /* Right operand first. */
+        temp = AllocateRegister( 0 );
+        if( temp == REG_NONE )
+        {
+            GenerateExpression( rightNode, reg );
+            Push( AsmReg( reg ) );
+            GenerateExpression( leftNode, reg );
+            *right = AsmMem( REG_ESP, 0 );
+            return( SPILLED );
+        }
+        GenerateExpression( rightNode, temp );
+        GenerateExpression( leftNode, reg );
+    }
+    else
+    {
+        /* Left operand first. */
+        GenerateExpression( leftNode, reg );
+        temp = AllocateRegister( 0 );
+        if( temp == REG_NONE )
+        {
+            Push( AsmReg( reg ) );
+            GenerateExpression( rightNode, reg );
+            AsmEmit2( ASM_XCHG, 4, AsmMem( REG_ESP, 0 ), AsmReg( reg ) );
+            *right = AsmMem( REG_ESP, 0 );
+            return( SPILLED );
+        }
+        GenerateExpression( rightNode, temp );
+    }
+    *right = AsmReg( temp );
+    return( temp );
+}
+
+/*
+ * Releases the right operand returned by
+ * GenerateOperands.
+ */
+static void FreeOperand( int temp )
+{
+    if( temp == SPILLED )
+    {
+        ReleaseStack( WORD_SIZE, FALSE );
+    }
+    else if( temp != REG_NONE )
+    {
+        FreeRegister( temp );
+    }
+}
+
+/*
+ * Generates code for binary operator [node] that
+ * maps onto instruction [opcode]: reg = reg op right.
+ */
+static void GenerateBinaryCode( TreeNode *node, int opcode, int reg )
+{
+    Operand right;
+    int temp;
+
+    temp = GenerateOperands( node, reg, &right );
+    AsmEmit2( opcode, 4, right, AsmReg( reg ) );
+    FreeOperand( temp );
+}
+
+/*
+ * Returns the condition that comparison [node] tests,
+ * or COND_NONE if [node] is not a comparison.
+ */
+static int GetComparisonCondition( TreeNode *node )
+{
+    switch( TOAST( node )->id )
+    {
+    case NODE_EQUAL:
+        return( COND_E );
+    case NODE_NOTEQUAL:
+        return( COND_NE );
+    case NODE_LESS:
+        return( COND_L );
+    case NODE_LESSEQUAL:
+        return( COND_LE );
+    case NODE_GREATER:
+        return( COND_G );
+    case NODE_GREATEREQUAL:
+        return( COND_GE );
+    }
+    return( COND_NONE );
+}
+
+/* Returns the condition [cond] with its operands
+ * swapped: a < b is b > a. */
+static int SwapCondition( int cond )
+{
+    switch( cond )
+    {
+    case COND_G:
+        return( COND_L );
+    case COND_GE:
+        return( COND_LE );
+    case COND_L:
+        return( COND_G );
+    case COND_LE:
+        return( COND_GE );
+    }
+    return( cond );
+}
+
+/*
+ * Emits the cmp for comparison [node], evaluating
+ * operands into [reg] as needed, and returns the
+ * condition that then holds when the comparison is
+ * true. Returns the right operand as for
+ * GenerateOperands; a spilled operand must be popped
+ * without touching the flags.
+ */
+static int GenerateCompare( TreeNode *node, int reg, int *temp )
+{
+    Operand left, right;
+    int cond;
+
+    if( IsFloatComparison( node ) == TRUE )
+    {
+        *temp = REG_NONE;
+        return( GenerateFloatCompare( node ) );
+    }
+
+    cond = GetComparisonCondition( node );
+
+    /* Two leaves are compared directly, if one of them
+     * may be the destination of cmp. */
+    if( GetLeafOperand( GetTreeChild( node, 0 ), &left ) == TRUE
+        && GetLeafOperand( GetTreeChild( node, 1 ), &right ) == TRUE
+        && ( left.kind == OPERAND_REGISTER || right.kind == OPERAND_REGISTER
+             || ( left.kind == OPERAND_IMMEDIATE ) != ( right.kind == OPERAND_IMMEDIATE ) ) )
+    {
+        *temp = REG_NONE;
+        if( left.kind == OPERAND_IMMEDIATE
+            || ( left.kind == OPERAND_MEMORY && right.kind == OPERAND_REGISTER ) )
+        {
+            AsmEmit2( ASM_CMP, 4, left, right );
+            return( SwapCondition( cond ) );
+        }
+        AsmEmit2( ASM_CMP, 4, right, left );
+        return( cond );
+    }
+
+    *temp = GenerateOperands( node, reg, &right );
+    AsmEmit2( ASM_CMP, 4, right, AsmReg( reg ) );
+    return( cond );
+}
+
+/*
+ * Releases the right operand of a comparison, leaving
+ * the flags intact.
+ */
+static void FreeCompareOperand( int temp )
+{
+    if( temp == SPILLED )
+    {
+        ReleaseStack( WORD_SIZE, TRUE );
+    }
+    else
+    {
+        FreeOperand( temp );
+    }
+}
+
+/*
+ * Emits the jump to [label] taken if condition [cond]
+ * of comparison [node] holds. After ucomiss, unordered
+ * operands (a NaN) set ZF as well as PF; they are not
+ * equal.
+ */
+static void GenerateCompareJump( TreeNode *node, int cond, int label )
+{
+    int skip;
+
+    if( IsFloatComparison( node ) == FALSE || ( cond != COND_E && cond != COND_NE ) )
+    {
+        AsmEmitJump( cond, label );
+    }
+    else if( cond == COND_NE )
+    {
+        AsmEmitJump( COND_P, label );
+        AsmEmitJump( COND_NE, label );
+    }
+    else
+    {
+        skip = GenerateLabel();
+        AsmEmitJump( COND_P, skip );
+        AsmEmitJump( COND_E, label );
+        AsmEmitLabel( skip );
+    }
+}
+
+/*
+ * Generates code for comparison [node]: reg is 1 if
+ * the comparison holds (does not hold if [invert] is
+ * TRUE), and 0 otherwise. setcc needs a byte
+ * register, which ESI and EDI do not have on i386.
+ * Float equality needs two flags, so it branches.
+ */
+static void GenerateComparisonCode( TreeNode *node, BOOL invert, int reg )
+{
+    int cond, temp, byte, label;
+
+    cond = GenerateCompare( node, reg, &temp );
+    FreeCompareOperand( temp );
+    if( invert == TRUE ) cond = AsmInvertCondition( cond );
+
+    byte = reg;
+    if( IsFloatComparison( node ) == TRUE && ( cond == COND_E || cond == COND_NE ) )
+    {
+        byte = REG_NONE;
+    }
+    else if( g_target->byteRegisters == FALSE && ( reg == REG_ESI || reg == REG_EDI ) )
+    {
+        byte = AllocateRegister( REGISTER_MASK( REG_ESI ) | REGISTER_MASK( REG_EDI ) );
+    }
+    if( byte != REG_NONE )
+    {
+        AsmEmitSet( cond, AsmRegSized( byte, 1 ) );
+        AsmEmit2( ASM_MOVZB, 4, AsmRegSized( byte, 1 ), AsmReg( reg ) );
+        if( byte != reg ) FreeRegister( byte );
+    }
+    else
+    {
+        /* mov leaves the flags alone. */
+        label = GenerateLabel();
+        AsmEmit2( ASM_MOV, 4, AsmImm( 1 ), AsmReg( reg ) );
+        GenerateCompareJump( node, cond, label );
+        AsmEmit2( ASM_MOV, 4, AsmImm( 0 ), AsmReg( reg ) );
+        AsmEmitLabel( label );
+    }
+}
+
+/*
+ * Generates code for condition [node] that jumps to
+ * [label] if the condition is [jumpIf], and falls
+ * through otherwise. Operands are evaluated in [reg],
+ * which the caller allocates. Comparisons become a
+ * cmp and a conditional jump. && and || branch on each
+ * operand in turn, and ! swaps the jump sense, so no
+ * intermediate 0/1 value is computed.
+ */
+static void GenerateConditionCode( TreeNode *node, BOOL jumpIf, int label, int reg )
+{
+    Operand operand;
+    int cond, temp, skip;
+
+    switch( TOAST( node )->id )
+    {
+    case NODE_LIT_BOOL:
+        if( TOAST( node )->val.boolvalue == jumpIf ) AsmEmitJump( COND_NONE, label );
+        return;
+
+    case NODE_NOT:
+        GenerateConditionCode( GetTreeChild( node, 0 ), !jumpIf, label, reg );
+        return;
+
+    case NODE_LOGICAL_AND:
+    case NODE_LOGICAL_OR:
+        /* a && b jumps if false as soon as a is false,
+         * a || b jumps if true as soon as a is true.
+         * Otherwise a skips to the false (true) exit
+         * past b. */
+        if( ( TOAST( node )->id == NODE_LOGICAL_AND ) == !jumpIf )
+        {
+            GenerateConditionCode( GetTreeChild( node, 0 ), jumpIf, label, reg );
+            GenerateConditionCode( GetTreeChild( node, 1 ), jumpIf, label, reg );
+        }
+        else
+        {
+            skip = GenerateLabel();
+            GenerateConditionCode( GetTreeChild( node, 0 ), !jumpIf, skip, reg );
+            GenerateConditionCode( GetTreeChild( node, 1 ), jumpIf, label, reg );
+            AsmEmitLabel( skip );
+        }
+        return;
+    }
+
+    if( GetComparisonCondition( node ) != COND_NONE )
+    {
+        cond = GenerateCompare( node, reg, &temp );
+        FreeCompareOperand( temp );
+    }
+    else
+    {
+        /* A variable is tested where it is. */
+        if( GetLeafOperand( node, &operand ) == FALSE || operand.kind == OPERAND_IMMEDIATE )
+        {
+            GenerateExpression( node, reg );
+            operand = AsmReg( reg );
+        }
+        if( operand.kind == OPERAND_REGISTER )
+        {
+            AsmEmit2( ASM_TEST, 4, operand, operand );
+        }
+        else
+        {
+            AsmEmit2( ASM_CMP, 4, AsmImm( 0 ), operand );
+        }
+        cond = COND_NE;
+    }
+    GenerateCompareJump( node, ( jumpIf == TRUE ) ? cond : AsmInvertCondition( cond ), label );
+}
+
+/*
+ * Generates the condition of an if or while statement:
+ * jumps to [label] if [node] is [jumpIf].
+ */
+static void GenerateBranchCode( TreeNode *node, BOOL jumpIf, int label )
+{
+    BOOL eaxUsed = IsRegisterUsed( REG_EAX );
+
+    g_usedRegisters |= REGISTER_MASK( REG_EAX );
+    GenerateConditionCode( node, jumpIf, label, REG_EAX );
+    if( eaxUsed == FALSE ) FreeRegister( REG_EAX );
+}
+
+/*
+ * Generates code for &&, || or ! [node]: reg is 1 if
+ * it holds, and 0 otherwise. The negation of a
+ * comparison is a comparison, and the negation of a
+ * plain value flips its lowest bit; everything else
+ * branches to code that sets reg.
+ */
+static void GenerateLogicalCode( TreeNode *node, int reg )
+{
+    TreeNode *operand;
+    int label, end;
+
+    if( TOAST( node )->id == NODE_NOT )
+    {
+        operand = GetTreeChild( node, 0 );
+        if( GetComparisonCondition( operand ) != COND_NONE )
+        {
+            GenerateComparisonCode( operand, TRUE, reg );
+            return;
+        }
+        switch( TOAST( operand )->id )
+        {
+        case NODE_NOT:
+        case NODE_LOGICAL_AND:
+        case NODE_LOGICAL_OR:
+            break;
+        default:
+            GenerateExpression( operand, reg );
+            AsmEmit2( ASM_XOR, 4, AsmImm( 1 ), AsmReg( reg ) );
+            return;
+        }
+    }
+
+    label = GenerateLabel();
+    end = GenerateLabel();
+    GenerateConditionCode( node, FALSE, label, reg );
+    AsmEmit2( ASM_MOV, 4, AsmImm( 1 ), AsmReg( reg ) );
+    AsmEmitJump( COND_NONE, end );
+    AsmEmitLabel( label );
+    AsmEmit2( ASM_MOV, 4, AsmImm( 0 ), AsmReg( reg ) );
+    AsmEmitLabel( end );
+}
+
+/*
+ * If [node] is an int literal, stores its value in
+ * [value] and returns TRUE.
+ */
+BOOL GetIntConstant( TreeNode *node, int *value )
+{
+    if( TOAST( node )->id != NODE_LIT_INT ) return( FALSE );
+    *value = (int) TOAST( node )->val.uintvalue;
+    return( TRUE );
+}
+
+/* Returns k if [value] is 2^k, and -1 otherwise. */
+int GetLog2( unsigned int value )
+{
+    int k;
+
+    if( value == 0 || ( value & ( value - 1 ) ) != 0 ) return( -1 );
+    for( k = 0; ( value >> k ) != 1; k++ ) ;
+    return( k );
+}
+
+/*
+ * Returns a register other than [reg] for a scratch
+ * value. If none is free, one is saved on the stack
+ * and [saved] is set to TRUE.
+ */
+int BorrowRegister( int reg, BOOL *saved )
+{
+    int temp;
+
+    temp = AllocateRegister( 0 );
+    *saved = ( temp == REG_NONE );
+    if( temp == REG_NONE )
+    {
+        temp = ( reg == REG_EAX ) ? REG_ECX : REG_EAX;
+        Push( AsmReg( temp ) );
+    }
+    return( temp );
+}
+
+void ReturnRegister( int temp, BOOL saved )
+{
+    if( saved == TRUE )
+    {
+        Pop( temp );
+    }
+    else
+    {
+        FreeRegister( temp );
+    }
+}
+
+/*
+ * Multiplies [reg] by [factor] with shifts, lea and
+ * add or sub, if that takes at most three
+ * instructions. Returns FALSE, emitting nothing,
+ * otherwise.
+ */
+static BOOL GenerateMultiplyByConstant( int reg, int factor )
+{
+    unsigned int magnitude, odd;
+    int shift, k, cost, first = 0, second = 0, temp;
+
+    if( factor == 0 ) return( FALSE );
+    magnitude = ( factor < 0 ) ? -(unsigned int) factor : (unsigned int) factor;
+    for( shift = 0; ( magnitude & ( 1u << shift ) ) == 0; shift++ ) ;
+    odd = magnitude >> shift;
+
+    /* odd = first * second with both 1, 3, 5 or 9
+     * takes a lea each; 2^k + 1 and 2^k - 1 take a
+     * copy, a shift and an add or sub. */
+    k = -1;
+    if( odd == 1 )
+    {
+        cost = 0;
+    }
+    else if( odd == 3 || odd == 5 || odd == 9 )
+    {
+        first = odd;
+        cost = 1;
+    }
+    else if( odd % 3 == 0 && ( odd / 3 == 3 || odd / 3 == 5 || odd / 3 == 9 ) )
+    {
+        first = 3;
+        second = odd / 3;
+        cost = 2;
+    }
+    else if( odd % 5 == 0 && ( odd / 5 == 5 || odd / 5 == 9 ) )
+    {
+        first = 5;
+        second = odd / 5;
+        cost = 2;
+    }
+    else if( odd == 81 )
+    {
+        first = 9;
+        second = 9;
+        cost = 2;
+    }
+    else if( GetLog2( odd - 1 ) > 0 || GetLog2( odd + 1 ) > 0 )
+    {
+        k = ( GetLog2( odd - 1 ) > 0 ) ? GetLog2( odd - 1 ) : GetLog2( odd + 1 );
+        cost = 3;
+    }
+    else
+    {
+        return( FALSE );
+    }
+    if( shift > 0 ) cost++;
+    if( factor < 0 ) cost++;
+    if( cost > 3 ) return( FALSE );
+
+    if( k > 0 )
+    {
+        temp = AllocateRegister( 0 );
+        if( temp == REG_NONE ) return( FALSE );
+        AsmEmit2( ASM_MOV, 4, AsmReg( reg ), AsmReg( temp ) );
+        AsmEmit2( ASM_SAL, 4, AsmImm( k ), AsmReg( reg ) );
+        AsmEmit2( ( odd == ( 1u << k ) + 1 ) ? ASM_ADD : ASM_SUB, 4, AsmReg( temp ), AsmReg( reg ) );
+        FreeRegister( temp );
+    }
+    if( first != 0 )
+    {
+        AsmEmit2( ASM_LEA, 4, AsmMemIndex( reg, reg, first - 1, 0 ), AsmReg( reg ) );
+    }
+    if( second != 0 )
+    {
+        AsmEmit2( ASM_LEA, 4, AsmMemIndex( reg, reg, second - 1, 0 ), AsmReg( reg ) );
+    }
+    if( shift > 0 )
+    {
+        AsmEmit2( ASM_SAL, 4, AsmImm( shift ), AsmReg( reg ) );
+    }
+    if( factor < 0 )
+    {
+        AsmEmit1( ASM_NEG, 4, AsmReg( reg ) );
+    }
+    return( TRUE );
+}
+
+/*
+ * Generates code for multiplication [node]. At -O1,
+ * a constant factor is applied with shifts and lea
+ * where that is cheaper than imul.
+ */
+static void GenerateMultiplyCode( TreeNode *node, int reg )
+{
+    TreeNode *leftNode, *rightNode;
+    int factor;
+
+    leftNode = GetTreeChild( node, 0 );
+    rightNode = GetTreeChild( node, 1 );
+
+    if( GetOptimizationLevel() >= 1 )
+    {
+        if( GetIntConstant( rightNode, &factor ) == TRUE )
+        {
+            GenerateExpression( leftNode, reg );
+        }
+        else if( GetIntConstant( leftNode, &factor ) == TRUE )
+        {
+            GenerateExpression( rightNode, reg );
+        }
+        else
+        {
+            GenerateBinaryCode( node, ASM_IMUL, reg );
+            return;
+        }
+        if( GenerateMultiplyByConstant( reg, factor ) == FALSE )
+        {
+            AsmEmit2( ASM_IMUL, 4, AsmImm( factor ), AsmReg( reg ) );
+        }
+        return;
+    }
+    GenerateBinaryCode( node, ASM_IMUL, reg );
+}
+
+/*
+ * Computes the magic number [magic] and shift [shift]
+ * for signed division by [divisor]: the quotient is
+ * the high word of x * magic, corrected by x when
+ * magic and the divisor differ in sign, shifted right
+ * by [shift], plus one if negative (see Hacker's
+ * Delight, 10-1).
+ *
+ * Pre: divisor is not -1, 0 or 1.
+ */
+static void ComputeMagic( int divisor, int *magic, int *shift )
+{
+    const unsigned int two31 = 0x80000000u;
+    unsigned int ad, anc, delta, q1, r1, q2, r2, t;
+    int p;
+
+    ad = ( divisor < 0 ) ? -(unsigned int) divisor : (unsigned int) divisor;
+    t = two31 + ( (unsigned int) divisor >> 31 );
+    anc = t - 1 - t % ad;
+    p = 31;
+    q1 = two31 / anc;
+    r1 = two31 - q1 * anc;
+    q2 = two31 / ad;
+    r2 = two31 - q2 * ad;
+    do
+    {
+        p++;
+        q1 = 2 * q1;
+        r1 = 2 * r1;
+        if( r1 >= anc )
+        {
+            q1++;
+            r1 -= anc;
+        }
+        q2 = 2 * q2;
+        r2 = 2 * r2;
+        if( r2 >= ad )
+        {
+            q2++;
+            r2 -= ad;
+        }
+        delta = ad - r2;
+    } while( q1 < delta || ( q1 == delta && r1 == 0 ) );
+
+    *magic = (int) ( q2 + 1 );
+    if( divisor < 0 ) *magic = -*magic;
+    *shift = p - 32;
+}
+
+/*
+ * Divides [reg] by 2^[k] (negated if [negative]), or
+ * takes the remainder. Negative dividends are biased
+ * by 2^k - 1 so the quotient rounds toward zero.
+ */
+static void GeneratePowerOfTwoDivision( int reg, int k, BOOL negative, BOOL modulus )
+{
+    BOOL saved;
+    int temp;
+
+    if( k == 0 )
+    {
+        if( modulus == TRUE )
+        {
+            AsmEmit2( ASM_MOV, 4, AsmImm( 0 ), AsmReg( reg ) );
+        }
+        else if( negative == TRUE )
+        {
+            AsmEmit1( ASM_NEG, 4, AsmReg( reg ) );
+        }
+        return;
+    }
+
+    temp = BorrowRegister( reg, &saved );
+    AsmEmit2( ASM_MOV, 4, AsmReg( reg ), AsmReg( temp ) );
+    if( k > 1 )
+    {
+        AsmEmit2( ASM_SAR, 4, AsmImm( 31 ), AsmReg( temp ) );
+    }
+    AsmEmit2( ASM_SHR, 4, AsmImm( 32 - k ), AsmReg( temp ) );
+    if( modulus == TRUE )
+    {
+        /* x - ( ( x + bias ) & -2^k ) */
+        AsmEmit2( ASM_ADD, 4, AsmReg( reg ), AsmReg( temp ) );
+        AsmEmit2( ASM_AND, 4, AsmImm( -( 1L << k ) ), AsmReg( temp ) );
+        AsmEmit2( ASM_SUB, 4, AsmReg( temp ), AsmReg( reg ) );
+    }
+    else
+    {
+        AsmEmit2( ASM_ADD, 4, AsmReg( temp ), AsmReg( reg ) );
+        AsmEmit2( ASM_SAR, 4, AsmImm( k ), AsmReg( reg ) );
+        if( negative == TRUE ) AsmEmit1( ASM_NEG, 4, AsmReg( reg ) );
+    }
+    ReturnRegister( temp, saved );
+}
+
+/*
+ * Divides [reg] by [divisor], or takes the remainder,
+ * by multiplying with the magic number of the
+ * divisor. The product is in EDX:EAX, so EAX and EDX
+ * are saved when they hold other values, as for idiv.
+ */
+static void GenerateMagicDivision( int reg, int divisor, BOOL modulus )
+{
+    Operand dividend;
+    unsigned int usedRegisters;
+    int magic, shift, temp = REG_NONE, i, pushed = 0;
+    int saved[2];
+    int nrOfSaved = 0;
+
+    ComputeMagic( divisor, &magic, &shift );
+
+    /* The dividend is needed after the multiplication:
+     * keep it out of EAX and EDX. */
+    if( reg == REG_EAX || reg == REG_EDX )
+    {
+        temp = AllocateRegister( REGISTER_MASK( REG_EAX ) | REGISTER_MASK( REG_EDX ) );
+        if( temp == REG_NONE )
+        {
+            Push( AsmReg( reg ) );
+            dividend = AsmMem( REG_ESP, 0 );
+        }
+        else
+        {
+            AsmEmit2( ASM_MOV, 4, AsmReg( reg ), AsmReg( temp ) );
+            dividend = AsmReg( temp );
+        }
+    }
+    else
+    {
+        dividend = AsmReg( reg );
+    }
+
+    if( reg != REG_EAX && IsRegisterUsed( REG_EAX ) ) saved[nrOfSaved++] = REG_EAX;
+    if( reg != REG_EDX && IsRegisterUsed( REG_EDX ) ) saved[nrOfSaved++] = REG_EDX;
+    for( i = 0; i < nrOfSaved; i++ )
+    {
+        Push( AsmReg( saved[i] ) );
+        pushed += WORD_SIZE;
+    }
+    if( dividend.kind == OPERAND_MEMORY ) dividend.value += pushed;
+
+    AsmEmit2( ASM_MOV, 4, AsmImm( magic ), EAX );
+    AsmEmit1( ASM_IMUL, 4, dividend );
+    if( divisor > 0 && magic < 0 ) AsmEmit2( ASM_ADD, 4, dividend, EDX );
+    if( divisor < 0 && magic > 0 ) AsmEmit2( ASM_SUB, 4, dividend, EDX );
+    if( shift > 0 ) AsmEmit2( ASM_SAR, 4, AsmImm( shift ), EDX );
+    AsmEmit2( ASM_MOV, 4, EDX, EAX );
+    AsmEmit2( ASM_SHR, 4, AsmImm( 31 ), EAX );
+    AsmEmit2( ASM_ADD, 4, EAX, EDX );
+
+    if( modulus == TRUE )
+    {
+        /* x - q * divisor */
+        usedRegisters = g_usedRegisters;
+        g_usedRegisters |= REGISTER_MASK( REG_EAX ) | REGISTER_MASK( REG_EDX );
+        if( GenerateMultiplyByConstant( REG_EDX, divisor ) == FALSE )
+        {
+            AsmEmit2( ASM_IMUL, 4, AsmImm( divisor ), EDX );
+        }
+        g_usedRegisters = usedRegisters;
+        AsmEmit2( ASM_MOV, 4, dividend, EAX );
+        AsmEmit2( ASM_SUB, 4, EDX, EAX );
+        if( reg != REG_EAX ) AsmEmit2( ASM_MOV, 4, EAX, AsmReg( reg ) );
+    }
+    else
+    {
+        if( reg != REG_EDX ) AsmEmit2( ASM_MOV, 4, EDX, AsmReg( reg ) );
+    }
+
+    for( i = nrOfSaved - 1; i >= 0; i-- )
+    {
+        Pop( saved[i] );
+    }
+    if( dividend.kind == OPERAND_MEMORY )
+    {
+        ReleaseStack( WORD_SIZE, FALSE );
+    }
+    else if( temp != REG_NONE )
+    {
+        FreeRegister( temp );
+    }
+}
+
+/*
+ * Generates code for division or modulus [node]
+ * ([modulus] is TRUE for the remainder). idiv divides
+ * EDX:EAX, so EAX and EDX are saved around it when
+ * they hold other values.
+ */
+static void GenerateDivisionCode( TreeNode *node, BOOL modulus, int reg )
+{
+    Operand divisor;
+    int temp, i, pushed = 0;
+    int saved[2];
+    int nrOfSaved = 0;
+    int constant;
+
+    /* Division by a constant needs no idiv. */
+    if( GetOptimizationLevel() >= 1
+        && GetIntConstant( GetTreeChild( node, 1 ), &constant ) == TRUE && constant != 0 )
+    {
+        GenerateExpression( GetTreeChild( node, 0 ), reg );
+        i = GetLog2( ( constant < 0 ) ? -(unsigned int) constant : (unsigned int) constant );
+        if( i >= 0 )
+        {
+            GeneratePowerOfTwoDivision( reg, i, constant < 0, modulus );
+        }
+        else
+        {
+            GenerateMagicDivision( reg, constant, modulus );
+        }
+        return;
+    }
+
+    temp = GenerateOperands( node, reg, &divisor );
+
+    /* idiv takes no immediate, and the divisor must not
+     * be in EAX or EDX: put it on the stack. */
+    if( divisor.kind == OPERAND_IMMEDIATE
+        || IsRegisterOperand( divisor, REG_EAX ) || IsRegisterOperand( divisor, REG_EDX ) )
+    {
+        Push( divisor );
+        FreeOperand( temp );
+        temp = SPILLED;
+        divisor = AsmMem( REG_ESP, 0 );
+    }
+
+    if( reg != REG_EAX && IsRegisterUsed( REG_EAX ) ) saved[nrOfSaved++] = REG_EAX;
+    if( reg != REG_EDX && IsRegisterUsed( REG_EDX ) ) saved[nrOfSaved++] = REG_EDX;
+    for( i = 0; i < nrOfSaved; i++ )
+    {
+        Push( AsmReg( saved[i] ) );
+        pushed += WORD_SIZE;
+    }
+    if( divisor.kind == OPERAND_MEMORY && divisor.base == REG_ESP )
+    {
+        divisor.value += pushed;
+    }
+
+    if( reg != REG_EAX )
+    {
+        AsmEmit2( ASM_MOV, 4, AsmReg( reg ), EAX );
+    }
+    AsmEmit0( ASM_CLTD ); /* Sign-extend EAX into EDX. */
+    AsmEmit1( ASM_IDIV, 4, divisor );
+    if( modulus == TRUE )
+    {
+        if( reg != REG_EDX ) AsmEmit2( ASM_MOV, 4, EDX, AsmReg( reg ) );
+    }
+    else
+    {
+        if( reg != REG_EAX ) AsmEmit2( ASM_MOV, 4, EAX, AsmReg( reg ) );
+    }
+
+    for( i = nrOfSaved - 1; i >= 0; i-- )
+    {
+        Pop( saved[i] );
+    }
+    FreeOperand( temp );
+}
+
+/*
+ * Generates code for shift [node] (instruction
+ * [opcode]). A shift count that is not a constant
+ * must be in CL.
+ */
+static void GenerateShiftCode( TreeNode *node, int opcode, int reg )
+{
+    TreeNode *leftNode, *rightNode;
+    int other;
+
+    leftNode = GetTreeChild( node, 0 );
+    rightNode = GetTreeChild( node, 1 );
+
+    /* The result cannot be computed in ECX itself:
+     * compute it elsewhere and move it. */
+    if( reg == REG_ECX )
+    {
+        other = AllocateRegister( REGISTER_MASK( REG_ECX ) );
+        if( other != REG_NONE )
+        {
+            GenerateShiftCode( node, opcode, other );
+            AsmEmit2( ASM_MOV, 4, AsmReg( other ), ECX );
+            FreeRegister( other );
+        }
+        else
+        {
+            /* Borrow EAX, which never holds a variable. */
+            Push( EAX );
+            GenerateShiftCode( node, opcode, REG_EAX );
+            AsmEmit2( ASM_MOV, 4, EAX, ECX );
+            Pop( REG_EAX );
+        }
+        return;
+    }
+
+    if( TOAST( rightNode )->id == NODE_LIT_INT )
+    {
+        GenerateExpression( leftNode, reg );
+        AsmEmit2( opcode, 4, AsmImm( TOAST( rightNode )->val.uintvalue & 31 ), AsmReg( reg ) );
+    }
+    else if( IsRegisterUsed( REG_ECX ) == FALSE )
+    {
+        g_usedRegisters |= REGISTER_MASK( REG_ECX );
+        if( GetRegisterNeed( rightNode, FALSE ) > GetRegisterNeed( leftNode, TRUE ) )
+        {
+            GenerateExpression( rightNode, REG_ECX );
+            GenerateExpression( leftNode, reg );
+        }
+        else
+        {
+            GenerateExpression( leftNode, reg );
+            GenerateExpression( rightNode, REG_ECX );
+        }
+        AsmEmit2( opcode, 4, CL, AsmReg( reg ) );
+        FreeRegister( REG_ECX );
+    }
+    else
+    {
+        /* ECX holds another value: save it. */
+        GenerateExpression( leftNode, reg );
+        Push( ECX );
+        GenerateExpression( rightNode, REG_ECX );
+        AsmEmit2( opcode, 4, CL, AsmReg( reg ) );
+        Pop( REG_ECX );
+    }
+}
+
+/*
+ * -------------------------------------------
+ *
+ * Arrays
+ *
+ * An element is addressed as base + index * size,
+ * with x86 scaled-index addressing. The indexes of a
+ * multi-dimensional array are folded into one, with
+ * the row strides applied at compile time: a[i][j]
+ * of int a[10][20] takes index i * 20 + j, so only
+ * the row index is multiplied (by shifts and lea
+ * where possible). Constant indexes, and constants
+ * added to an index, go in the displacement. An
+ * array parameter holds the address of the elements.
+ *
+ * -------------------------------------------
+ */
+
+/* Checks whether expression [node] is an address: an
+ * array, or a row of one. */
+BOOL IsAddress( TreeNode *node )
+{
+    return( TOAST( node )->type != NULL && ListSize( TOAST( node )->type->dimensions ) > 0 );
+}
+
+/* Returns the size of an element of [type]: chars and
+ * bools take a byte. */
+int GetElementSize( Type *type )
+{
+    SimpleType simpleType = GetSimpleType( type );
+
+    return( ( simpleType == CHAR || simpleType == BOOLEAN ) ? 1 : 4 );
+}
+
+/* Returns the number of indexes of indexer [node]. */
+int CountIndexes( TreeNode *node )
+{
+    int count = 0;
+
+    for( ; TOAST( node )->id == NODE_INDEXER; node = GetTreeChild( node, 0 ) )
+    {
+        count++;
+    }
+    return( count );
+}
+
+/* Returns the variable that [node] indexes. */
+TreeNode *GetIndexedVariable( TreeNode *node )
+{
+    while( TOAST( node )->id == NODE_INDEXER )
+    {
+        node = GetTreeChild( node, 0 );
+    }
+    return( node );
+}
+
+/*
+ * Splits index [node] into an expression and a
+ * constant [offset] added to it (x + c, x - c or c).
+ * Returns the expression, or NULL for a constant.
+ */
+TreeNode *SplitIndex( TreeNode *node, int *offset )
+{
+    int value;
+
+    *offset = 0;
+    if( GetIntConstant( node, offset ) == TRUE ) return( NULL );
+    switch( TOAST( node )->id )
+    {
+    case NODE_BINARY_ADD:
+        if( GetIntConstant( GetTreeChild( node, 0 ), offset ) == TRUE ) return( GetTreeChild( node, 1 ) );
+        /* Fall through. */
+    case NODE_BINARY_SUBTRACT:
+        if( GetIntConstant( GetTreeChild( node, 1 ), &value ) == TRUE )
+        {
+            *offset = ( TOAST( node )->id == NODE_BINARY_ADD ) ? value : -value;
+            return( GetTreeChild( node, 0 ) );
+        }
+    }
+    return( node );
+}
+
+/*
+ * Returns the stride, in elements, of index [index]
+ * of variable [symbol]: the product of the sizes of
+ * the dimensions that follow it.
+ */
+int GetStride( Symbol *symbol, int index )
+{
+    Type *type;
+    int stride = 1, i;
+
+    type = (Type *) ListFirstEx( symbol->types )->data;
+    for( i = index + 1; i < ListSize( type->dimensions ); i++ )
+    {
+        stride *= GetDimension( type, i );
+    }
+    return( stride );
+}
+
+/* Returns the displacement, in bytes, of the constants
+ * added to the indexes of indexer [node]. */
+int GetIndexDisplacement( Symbol *symbol, TreeNode *node )
+{
+    int displacement = 0, size, offset, i;
+
+    size = GetElementSize( TOAST( node )->type );
+    for( i = CountIndexes( node ) - 1; i >= 0; i--, node = GetTreeChild( node, 0 ) )
+    {
+        SplitIndex( GetTreeChild( node, 1 ), &offset );
+        displacement += offset * GetStride( symbol, i ) * size;
+    }
+    return( displacement );
+}
+
+/*
+ * Checks whether expressions [a] and [b] are the same:
+ * the same operators on the same literals and
+ * variables. Either may be NULL.
+ */
+BOOL IsSameExpression( TreeNode *a, TreeNode *b )
+{
+    ListNode *x, *y;
+
+    if( a == NULL || b == NULL ) return( a == b );
+    if( TOAST( a )->id != TOAST( b )->id ) return( FALSE );
+    switch( TOAST( a )->id )
+    {
+    case NODE_LIT_INT:
+        return( TOAST( a )->val.uintvalue == TOAST( b )->val.uintvalue );
+    case NODE_LIT_BOOL:
+        return( TOAST( a )->val.boolvalue == TOAST( b )->val.boolvalue );
+    case NODE_LIT_CHAR:
+        return( TOAST( a )->val.charvalue == TOAST( b )->val.charvalue );
+    case NODE_LIT_FLOAT:
+        return( EncodeFloat( TOAST( a )->val.floatvalue ) == EncodeFloat( TOAST( b )->val.floatvalue ) );
+    case NODE_LIT_IDENTIFIER:
+        return( FindSymbol( GetNameOfIdentifier( a ) ) == FindSymbol( GetNameOfIdentifier( b ) ) );
+    }
+    for( x = ListFirstEx( a->children ), y = ListFirstEx( b->children ); x != NULL && y != NULL;
+         x = ListNextEx( x ), y = ListNextEx( y ) )
+    {
+        if( IsSameExpression( (TreeNode *) x->data, (TreeNode *) y->data ) == FALSE ) return( FALSE );
+    }
+    return( x == NULL && y == NULL );
+}
+
+/* Checks whether [node] is variable [symbol]. */
+BOOL IsVariable( TreeNode *node, Symbol *symbol )
+{
+    return( node != NULL && TOAST( node )->id == NODE_LIT_IDENTIFIER
+            && FindSymbol( GetNameOfIdentifier( node ) ) == symbol );
+}
+
+/* Multiplies [reg] by constant [factor]. */
+static void GenerateScale( int reg, int factor )
+{
+    if( factor != 1 && GenerateMultiplyByConstant( reg, factor ) == FALSE )
+    {
+        AsmEmit2( ASM_IMUL, 4, AsmImm( factor ), AsmReg( reg ) );
+    }
+}
+
+/*
+ * Returns the register that can serve as the index
+ * of indexer [node] as it is, and stores its [scale]:
+ * on i386, a variable in a register that is the one
+ * index not constant, with a stride that scaled
+ * addressing covers. Returns REG_NONE otherwise. (On
+ * x86_64 an index must be sign-extended first.)
+ */
+int GetIndexRegister( Symbol *symbol, TreeNode *node, int *scale )
+{
+    TreeNode *index, *variable = NULL;
+    int size, offset, i;
+
+    if( GetTarget() != TARGET_I386 ) return( REG_NONE );
+    size = GetElementSize( TOAST( node )->type );
+    for( i = CountIndexes( node ) - 1; i >= 0; i--, node = GetTreeChild( node, 0 ) )
+    {
+        index = SplitIndex( GetTreeChild( node, 1 ), &offset );
+        if( index == NULL ) continue;
+        if( variable != NULL ) return( REG_NONE );
+        variable = index;
+        *scale = GetStride( symbol, i ) * size;
+    }
+    if( variable == NULL || TOAST( variable )->id != NODE_LIT_IDENTIFIER || GetLog2( *scale ) < 0
+        || GetLog2( *scale ) > 3 )
+    {
+        return( REG_NONE );
+    }
+    return( FindSymbol( GetNameOfIdentifier( variable ) )->reg );
+}
+
+/*
+ * Checks whether the address of indexer [node] takes
+ * a register to compute.
+ */
+static BOOL NeedsAddressRegister( TreeNode *node )
+{
+    Symbol *symbol;
+    int offset, scale, i;
+
+    if( FindReduction( node ) != NULL ) return( FALSE );
+    symbol = FindSymbol( GetNameOfIdentifier( GetIndexedVariable( node ) ) );
+    if( symbol->reference == TRUE ) return( TRUE );
+    if( GetIndexRegister( symbol, node, &scale ) != REG_NONE ) return( FALSE );
+    for( i = CountIndexes( node ); i > 0; i--, node = GetTreeChild( node, 0 ) )
+    {
+        if( SplitIndex( GetTreeChild( node, 1 ), &offset ) != NULL ) return( TRUE );
+    }
+    return( FALSE );
+}
+
+/*
+ * Generates code for the address of the element (or
+ * row) that indexer [node] selects, and returns it as
+ * a memory operand. [reg] is allocated by the caller,
+ * and holds the index or the base address if needed
+ * (see NeedsAddressRegister); other registers are
+ * left intact.
+ */
+Operand GenerateElementOperand( TreeNode *node, int reg )
+{
+    TreeNode *indexer, *index;
+    Symbol *symbol;
+    Reduction *reduction;
+    Operand operand;
+    long displacement;
+    int count, size, offset, stride, scale, temp, i;
+    BOOL indexed = FALSE, saved;
+
+    symbol = FindSymbol( GetNameOfIdentifier( GetIndexedVariable( node ) ) );
+    count = CountIndexes( node );
+    size = GetElementSize( TOAST( node )->type );
+    if( symbol->reference == TRUE && ListSize( GetSymbolType( symbol->name )->dimensions ) > 1 )
+    {
+        AddError( "multi-dimensional array parameters cannot be indexed", TOAST( node )->lineno );
+    }
+
+    /* An element of a loop's reduction is at a constant
+     * distance from the pointer. */
+    displacement = GetIndexDisplacement( symbol, node );
+    reduction = FindReduction( node );
+    if( reduction != NULL )
+    {
+        return( AsmMem( reduction->reg, displacement - GetIndexDisplacement( symbol, reduction->element ) ) );
+    }
+
+    GetLeafOperand( GetIndexedVariable( node ), &operand );
+    if( GetIndexRegister( symbol, node, &scale ) != REG_NONE )
+    {
+        if( symbol->reference == TRUE )
+        {
+            AsmEmit2( ASM_MOV, WORD_SIZE, operand, AsmReg( reg ) );
+            operand = AsmMem( reg, 0 );
+        }
+        operand.value += displacement;
+        operand.index = GetIndexRegister( symbol, node, &scale );
+        operand.scale = scale;
+        return( operand );
+    }
+
+    /* The last index is outermost. */
+    indexer = node;
+    for( i = count - 1; i >= 0; i--, indexer = GetTreeChild( indexer, 0 ) )
+    {
+        stride = GetStride( symbol, i );
+        index = SplitIndex( GetTreeChild( indexer, 1 ), &offset );
+        if( index == NULL ) continue;
+
+        if( indexed == FALSE )
+        {
+            GenerateExpression( index, reg );
+            GenerateScale( reg, stride );
+            indexed = TRUE;
+        }
+        else
+        {
+            temp = BorrowRegister( reg, &saved );
+            GenerateExpression( index, temp );
+            GenerateScale( temp, stride );
+            AsmEmit2( ASM_ADD, 4, AsmReg( temp ), AsmReg( reg ) );
+            ReturnRegister( temp, saved );
+        }
+    }
+
+    /* Addresses are quads on x86_64. */
+    if( indexed == TRUE && WORD_SIZE == 8 )
+    {
+        AsmEmit2( ASM_MOVSLQ, 8, AsmReg( reg ), AsmReg( reg ) );
+    }
+
+    if( symbol->reference == TRUE )
+    {
+        /* base + index * size, in [reg]. */
+        if( indexed == TRUE )
+        {
+            if( size > 1 ) AsmEmit2( ASM_SAL, WORD_SIZE, AsmImm( GetLog2( size ) ), AsmReg( reg ) );
+            AsmEmit2( ASM_ADD, WORD_SIZE, operand, AsmReg( reg ) );
+        }
+        else
+        {
+            AsmEmit2( ASM_MOV, WORD_SIZE, operand, AsmReg( reg ) );
+        }
+        return( AsmMem( reg, displacement ) );
+    }
+
+    operand.value += displacement;
+    if( indexed == TRUE )
+    {
+        operand.index = reg;
+        operand.scale = size;
+    }
+    return( operand );
+}
+
+/*
+ * Returns the operand of element [node] as
+ * GenerateElementOperand, borrowing a register other
+ * than [reg] for its address if needed; [temp] and
+ * [saved] are for ReturnElementOperand.
+ */
+static Operand BorrowElementOperand( TreeNode *node, int reg, int *temp, BOOL *saved )
+{
+    *temp = REG_NONE;
+    if( NeedsAddressRegister( node ) == TRUE ) *temp = BorrowRegister( reg, saved );
+    return( GenerateElementOperand( node, *temp ) );
+}
+
+static void ReturnElementOperand( int temp, BOOL saved )
+{
+    if( temp != REG_NONE ) ReturnRegister( temp, saved );
+}
+
+/*
+ * Generates code that stores the value of indexer
+ * [node] in [reg]: the element, or the address of a
+ * row.
+ */
+static void GenerateIndexerCode( TreeNode *node, int reg )
+{
+    Operand operand;
+
+    operand = GenerateElementOperand( node, reg );
+    if( IsAddress( node ) == TRUE )
+    {
+        AsmEmit2( ASM_LEA, WORD_SIZE, operand, AsmReg( reg ) );
+    }
+    else if( GetElementSize( TOAST( node )->type ) == 1 )
+    {
+        AsmEmit2( ASM_MOVZB, 4, operand, AsmReg( reg ) );
+    }
+    else
+    {
+        AsmEmit2( ASM_MOV, 4, operand, AsmReg( reg ) );
+    }
+}
+
+/*
+ * Generates code that stores the address that
+ * expression [node] stands for in [reg]: the address
+ * of an array, the one a parameter holds, or that of
+ * a row.
+ */
+static void GenerateAddressCode( TreeNode *node, int reg )
+{
+    Symbol *symbol;
+    Operand operand;
+
+    if( TOAST( node )->id == NODE_INDEXER )
+    {
+        GenerateIndexerCode( node, reg );
+        return;
+    }
+    symbol = FindSymbol( GetNameOfIdentifier( node ) );
+    GetLeafOperand( node, &operand );
+    AsmEmit2( ( symbol->reference == TRUE ) ? ASM_MOV : ASM_LEA, WORD_SIZE, operand, AsmReg( reg ) );
+}
+
+/*
+ * Generates code for assignment [node] to an array
+ * element. The value assigned is left in [reg], or,
+ * if [reg] is REG_NONE, is not needed. A byte is
+ * stored from a register that has a byte form.
+ */
+static void GenerateElementAssignment( TreeNode *node, int reg )
+{
+    TreeNode *element;
+    Operand source, destination;
+    int size, value, temp;
+    BOOL saved, valueSaved = FALSE, free = FALSE;
+
+    element = GetTreeChild( node, 0 );
+    size = GetElementSize( TOAST( element )->type );
+
+    if( reg == REG_NONE && GetLeafOperand( GetTreeChild( node, 1 ), &source ) == TRUE
+        && source.kind == OPERAND_IMMEDIATE )
+    {
+        destination = BorrowElementOperand( element, REG_NONE, &temp, &saved );
+        if( size == 1 ) source.value &= 0xff;
+        AsmEmit2( ASM_MOV, size, source, destination );
+        ReturnElementOperand( temp, saved );
+        return;
+    }
+
+    value = reg;
+    if( value == REG_NONE || ( size == 1 && g_target->byteRegisters == FALSE
+                               && ( value == REG_ESI || value == REG_EDI ) ) )
+    {
+        value = AllocateRegister( REGISTER_MASK( REG_ESI ) | REGISTER_MASK( REG_EDI ) );
+        free = ( value != REG_NONE );
+        if( value == REG_NONE )
+        {
+            value = ( reg == REG_EAX ) ? REG_ECX : REG_EAX;
+            Push( AsmReg( value ) );
+            valueSaved = TRUE;
+        }
+    }
+
+    GenerateExpression( GetTreeChild( node, 1 ), value );
+    destination = BorrowElementOperand( element, value, &temp, &saved );
+    AsmEmit2( ASM_MOV, size, AsmRegSized( value, size ), destination );
+    ReturnElementOperand( temp, saved );
+
+    if( reg != REG_NONE && value != reg )
+    {
+        AsmEmit2( ( size == 1 ) ? ASM_MOVZB : ASM_MOV, 4, AsmRegSized( value, size ), AsmReg( reg ) );
+    }
+    if( free == TRUE ) FreeRegister( value );
+    if( valueSaved == TRUE ) Pop( value );
+}
+
+/*
+ * Returns the mask of the registers that code for
+ * [node] takes for fixed uses, saving them if they
+ * hold a value: the ones a call destroys, EAX and EDX
+ * for a division, ECX for a shift.
+ */
+unsigned int GetFixedRegisters( TreeNode *node )
+{
+    ListNode *child;
+    unsigned int mask = 0;
+    int i;
+
+    switch( TOAST( node )->id )
+    {
+    case NODE_APPLICATION:
+        for( i = 0; i < g_target->nrOfCallerSaved; i++ )
+        {
+            mask |= REGISTER_MASK( g_target->callerSaved[i] );
+        }
+        break;
+    case NODE_DIVIDE:
+    case NODE_MODULUS:
+        mask = REGISTER_MASK( REG_EAX ) | REGISTER_MASK( REG_EDX );
+        break;
+    case NODE_BITWISE_LSHIFT:
+    case NODE_BITWISE_RSHIFT:
+        mask = REGISTER_MASK( REG_ECX );
+        break;
+    }
+    for( child = ListFirstEx( node->children ); child != NULL; child = ListNextEx( child ) )
+    {
+        mask |= GetFixedRegisters( (TreeNode *) child->data );
+    }
+    return( mask );
+}
+
+/*
+ * Allocates a register for a pointer that lives
+ * through a loop, while two temporaries remain. The
+ * loop's code must not take it for a fixed use (see
+ * GetFixedRegisters): registers saved that way are
+ * free in between. Neither are EAX and ECX taken,
+ * which BorrowRegister saves and uses when no
+ * register is free. Returns REG_NONE if there is
+ * none.
+ */
+int AllocatePointerRegister( unsigned int fixed )
+{
+    int reg = REG_NONE, free = 0, temporary, i;
+
+    fixed |= REGISTER_MASK( REG_EAX ) | REGISTER_MASK( REG_ECX );
+    for( i = 0; i < g_target->nrOfTemporaries; i++ )
+    {
+        temporary = g_target->temporaries[i];
+        if( IsRegisterUsed( temporary ) == TRUE ) continue;
+        free++;
+        if( reg == REG_NONE && ( fixed & REGISTER_MASK( temporary ) ) == 0 ) reg = temporary;
+    }
+    if( reg == REG_NONE || free < 3 ) return( REG_NONE );
+    g_usedRegisters |= REGISTER_MASK( reg );
+    return( reg );
+}
+
+/*
+ * Generates code that stores the value of [node],
+ * which GenerateCodeForNode leaves in EAX, in [reg]
+ * by instruction [opcode]. EAX is saved around it
+ * when it holds another value.
+ */
+static void GenerateEaxExpression( TreeNode *node, int opcode, int reg )
+{
+    if( reg != REG_EAX && IsRegisterUsed( REG_EAX ) )
+    {
+        Push( EAX );
+        FreeRegister( REG_EAX );
+        GenerateCodeForNode( node );
+        AsmEmit2( opcode, 4, EAX, AsmReg( reg ) );
+        Pop( REG_EAX );
+        g_usedRegisters |= REGISTER_MASK( REG_EAX );
+    }
+    else
+    {
+        GenerateCodeForNode( node );
+        if( opcode != ASM_MOV || reg != REG_EAX ) AsmEmit2( opcode, 4, EAX, AsmReg( reg ) );
+    }
+}
+
+/*
+ * -------------------------------------------
+ *
+ * Float expressions are evaluated in the SSE
+ * registers XMM0 to XMM7 with the scalar single
+ * precision instructions, in the same way as int
+ * expressions: binary operators evaluate the operand
+ * that needs the most registers first, and when no
+ * register is free the first operand is saved on the
+ * stack. Float constants are read from a pool in
+ * .rodata, and ucomiss compares. Float variables
+ * stay in memory.
+ *
+ * -------------------------------------------
+ */
+
+/* Allocates a free SSE register. Returns REG_NONE
+ * if none is free. */
+int AllocateFloatRegister()
+{
+    int reg;
+
+    for( reg = REG_XMM0; reg <= REG_XMM7; reg++ )
+    {
+        if( IsRegisterUsed( reg ) == FALSE )
+        {
+            g_usedRegisters |= REGISTER_MASK( reg );
+            return( reg );
+        }
+    }
+    return( REG_NONE );
+}
+
+/*
+ * Returns an SSE register other than [reg] for a
+ * scratch value. If none is free, one is saved on
+ * the stack and [saved] is set to TRUE.
+ */
+static int BorrowFloatRegister( int reg, BOOL *saved )
+{
+    int temp;
+
+    temp = AllocateFloatRegister();
+    *saved = ( temp == REG_NONE );
+    if( temp == REG_NONE )
+    {
+        temp = ( reg == REG_XMM0 ) ? REG_XMM1 : REG_XMM0;
+        PushFloat( temp );
+    }
+    return( temp );
+}
+
+/* Gives back [temp] from BorrowFloatRegister, leaving
+ * the flags intact. */
+static void ReturnFloatRegister( int temp, BOOL saved )
+{
+    if( saved == TRUE )
+    {
+        PopFloat( temp, TRUE );
+    }
+    else
+    {
+        FreeRegister( temp );
+    }
+}
+
+/*
+ * Evaluates float [leftNode] into [reg], and stores
+ * [rightNode] in [right]: a memory operand, or a
+ * scratch register. Returns the scratch register,
+ * which the caller must give back with
+ * FreeFloatOperand, or REG_NONE.
+ */
+static int GenerateFloatOperands( TreeNode *leftNode, TreeNode *rightNode, int reg,
+                                  Operand *right, BOOL *saved )
+{
+    int temp;
+
+    *saved = FALSE;
+    if( GetLeafOperand( rightNode, right ) == TRUE )
+    {
+        if( right->kind == OPERAND_IMMEDIATE ) *right = GetFloatConstant( (unsigned long) right->value );
+        GenerateFloatExpression( leftNode, reg );
+        return( REG_NONE );
+    }
+
+    if( GetRegisterNeed( rightNode, FALSE ) > GetRegisterNeed( leftNode, TRUE ) )
+    {
+        /* Right operand first. */
+        temp = BorrowFloatRegister( reg, saved );
+        GenerateFloatExpression( rightNode, temp );
+        GenerateFloatExpression( leftNode, reg );
+    }
+    else
+    {
+        /* Left operand first. */
+        GenerateFloatExpression( leftNode, reg );
+        temp = BorrowFloatRegister( reg, saved );
+        GenerateFloatExpression( rightNode, temp );
+    }
+    *right = AsmReg( temp );
+    return( temp );
+}
+
+static void FreeFloatOperand( int temp, BOOL saved )
+{
+    if( temp != REG_NONE ) ReturnFloatRegister( temp, saved );
+}
+
+/*
+ * Generates code for float operator [node] that maps
+ * onto instruction [opcode]: reg = reg op right.
+ */
+static void GenerateFloatBinaryCode( TreeNode *node, int opcode, int reg )
+{
+    Operand right;
+    BOOL saved;
+    int temp;
+
+    temp = GenerateFloatOperands( GetTreeChild( node, 0 ), GetTreeChild( node, 1 ), reg, &right, &saved );
+    AsmEmit2( opcode, 4, right, AsmReg( reg ) );
+    FreeFloatOperand( temp, saved );
+}
+
+/*
+ * Generates code for float assignment [node]; the
+ * value assigned is left in [reg].
+ */
+static void GenerateFloatAssignment( TreeNode *node, int reg )
+{
+    Operand destination;
+    BOOL saved;
+    int temp;
+
+    GenerateFloatExpression( GetTreeChild( node, 1 ), reg );
+    if( TOAST( GetTreeChild( node, 0 ) )->id == NODE_INDEXER )
+    {
+        destination = BorrowElementOperand( GetTreeChild( node, 0 ), REG_NONE, &temp, &saved );
+        AsmEmit2( ASM_MOVSS, 4, AsmReg( reg ), destination );
+        ReturnElementOperand( temp, saved );
+        return;
+    }
+    GetLeafOperand( GetTreeChild( node, 0 ), &destination );
+    AsmEmit2( ASM_MOVSS, 4, AsmReg( reg ), destination );
+}
+
+/*
+ * Generates the ucomiss for float comparison [node].
+ * Returns the condition to test: ucomiss sets the
+ * flags like an unsigned compare, and an unordered
+ * result (a NaN) sets ZF, PF and CF. Less is tested
+ * as greater with the operands swapped, so that it
+ * fails for a NaN.
+ */
+static int GenerateFloatCompare( TreeNode *node )
+{
+    TreeNode *leftNode, *rightNode;
+    Operand right;
+    BOOL saved, tempSaved;
+    int cond, reg, temp;
+
+    leftNode = GetTreeChild( node, 0 );
+    rightNode = GetTreeChild( node, 1 );
+    cond = GetComparisonCondition( node );
+    if( cond == COND_L || cond == COND_LE )
+    {
+        leftNode = GetTreeChild( node, 1 );
+        rightNode = GetTreeChild( node, 0 );
+        cond = SwapCondition( cond );
+    }
+    if( cond == COND_G ) cond = COND_A;
+    if( cond == COND_GE ) cond = COND_AE;
+
+    reg = BorrowFloatRegister( REG_NONE, &saved );
+    temp = GenerateFloatOperands( leftNode, rightNode, reg, &right, &tempSaved );
+    AsmEmit2( ASM_UCOMISS, 4, right, AsmReg( reg ) );
+    FreeFloatOperand( temp, tempSaved );
+    ReturnFloatRegister( reg, saved );
+    return( cond );
+}
+
+/*
+ * Generates code that returns the value of float
+ * expression [node]: in XMM0 on x86_64 and from the
+ * register entry point on i386, and on top of the
+ * x87 stack from a C entry point on i386.
+ */
+static void GenerateFloatReturn( TreeNode *node )
+{
+    Operand operand;
+    BOOL x87;
+
+    x87 = ReturnsOnX87();
+    if( x87 == TRUE && GetLeafOperand( node, &operand ) == TRUE )
+    {
+        if( operand.kind == OPERAND_IMMEDIATE ) operand = GetFloatConstant( (unsigned long) operand.value );
+        AsmEmit1( ASM_FLDS, 4, operand );
+        return;
+    }
+
+    g_usedRegisters |= REGISTER_MASK( REG_XMM0 );
+    GenerateFloatExpression( node, REG_XMM0 );
+    FreeRegister( REG_XMM0 );
+    if( x87 == TRUE )
+    {
+        PushFloat( REG_XMM0 );
+        AsmEmit1( ASM_FLDS, 4, AsmMem( REG_ESP, 0 ) );
+        ReleaseStack( WORD_SIZE, FALSE );
+    }
+}
+
+/*
+ * Generates code that stores the value of float
+ * expression [node] in SSE register [reg]. [reg] must
+ * be allocated by the caller.
+ */
+void GenerateFloatExpression( TreeNode *node, int reg )
+{
+    Operand operand;
+    BOOL saved;
+    int temp;
+
+    if( GetLeafOperand( node, &operand ) == TRUE )
+    {
+        if( operand.kind == OPERAND_IMMEDIATE && operand.value == 0 )
+        {
+            AsmEmit2( ASM_XORPS, 4, AsmReg( reg ), AsmReg( reg ) );
+            return;
+        }
+        if( operand.kind == OPERAND_IMMEDIATE ) operand = GetFloatConstant( (unsigned long) operand.value );
+        AsmEmit2( ASM_MOVSS, 4, operand, AsmReg( reg ) );
+        return;
+    }
+
+    switch( TOAST( node )->id )
+    {
+    case NODE_APPLICATION:
+        GenerateApplicationCode( node, reg );
+        break;
+    case NODE_INDEXER:
+        operand = BorrowElementOperand( node, REG_NONE, &temp, &saved );
+        AsmEmit2( ASM_MOVSS, 4, operand, AsmReg( reg ) );
+        ReturnElementOperand( temp, saved );
+        break;
+    case NODE_ASSIGN:
+        GenerateFloatAssignment( node, reg );
+        break;
+    case NODE_INT_TO_FLOAT:
+    case NODE_CHAR_TO_FLOAT:
+        /* cvtsi2ss reads an int from a register or
+         * memory. */
+        if( GetLeafOperand( GetTreeChild( node, 0 ), &operand ) == TRUE
+            && ( operand.kind == OPERAND_REGISTER
+                 || ( operand.kind == OPERAND_MEMORY && TOAST( node )->id == NODE_INT_TO_FLOAT ) ) )
+        {
+            AsmEmit2( ASM_CVTSI2SS, 4, operand, AsmReg( reg ) );
+            break;
+        }
+        temp = BorrowRegister( REG_NONE, &saved );
+        GenerateExpression( GetTreeChild( node, 0 ), temp );
+        AsmEmit2( ASM_CVTSI2SS, 4, AsmReg( temp ), AsmReg( reg ) );
+        ReturnRegister( temp, saved );
+        break;
+    case NODE_UNARY_ADD:
+        GenerateFloatExpression( GetTreeChild( node, 0 ), reg );
+        break;
+    case NODE_UNARY_SUBTRACT:
+        GenerateFloatExpression( GetTreeChild( node, 0 ), reg );
+        AsmEmit2( ASM_XORPS, 4, GetSignMask(), AsmReg( reg ) );
+        break;
+    case NODE_BINARY_ADD:
+        GenerateFloatBinaryCode( node, ASM_ADDSS, reg );
+        break;
+    case NODE_BINARY_SUBTRACT:
+        GenerateFloatBinaryCode( node, ASM_SUBSS, reg );
+        break;
+    case NODE_MULTIPLY:
+        GenerateFloatBinaryCode( node, ASM_MULSS, reg );
+        break;
+    case NODE_DIVIDE:
+        GenerateFloatBinaryCode( node, ASM_DIVSS, reg );
+        break;
+
+    /* Other expressions leave their bits in EAX. */
+    default:
+        GenerateEaxExpression( node, ASM_MOVD, reg );
+    }
+}
+
+/*
+ *  Generates code for function calling. The result
+ *  is moved to [reg]. EAX, ECX, EDX and the SSE
+ *  registers do not survive a call, so they are saved
+ *  around it when they hold other values. A float
+ *  result comes back in XMM0, except from a C entry
+ *  point on i386, where it is on the x87 stack.
+ */
+static void GenerateApplicationCode( TreeNode *node, int reg )
+{
+    unsigned int usedRegisters = g_usedRegisters;
+    int saved[NR_OF_REGISTERS];
+    int nrOfSaved = 0, argumentCount, stackBytes = 0, padding = 0, scratch;
+    int i;
+    int *regs;
+    BOOL *floats;
+    char *name, *entry;
+
+    /* Save the registers the callee may destroy. */
+    for( i = 0; i < g_target->nrOfCallerSaved; i++ )
+    {
+        if( g_target->callerSaved[i] != reg && IsRegisterUsed( g_target->callerSaved[i] ) )
+        {
+            saved[nrOfSaved++] = g_target->callerSaved[i];
+        }
+    }
+    for( i = REG_XMM0; i <= REG_XMM7; i++ )
+    {
+        if( i != reg && IsRegisterUsed( i ) ) saved[nrOfSaved++] = i;
+    }
+    for( i = 0; i < nrOfSaved; i++ )
+    {
+        if( saved[i] >= REG_XMM0 )
+        {
+            PushFloat( saved[i] );
+        }
+        else
+        {
+            Push( AsmReg( saved[i] ) );
         }
+        FreeRegister( saved[i] );
     }
-    return byteCount;
-}
 
+    /* The first arguments go in registers: on i386 only to
+     * functions defined in the module. */
+    name = GetNameFromApplication( node );
+    entry = GetInternalEntry( name );
+    argumentCount = GetArgumentCountFromApplication( node );
+    regs = (int *) malloc( ( argumentCount + 1 ) * sizeof( int ) );
+    floats = (BOOL *) malloc( ( argumentCount + 1 ) * sizeof( BOOL ) );
+    if( regs == NULL || floats == NULL ) BAILOUT( ERR_NOMEM );
+    for( i = 0; i < argumentCount; i++ )
+    {
+        floats[i] = IsFloat( GetArgumentFromApplication( node, i ) );
+    }
+    AssignArgumentRegisters( name, argumentCount, floats, regs );
+    for( i = 0; i < argumentCount; i++ )
+    {
+        if( regs[i] == REG_NONE ) stackBytes += WORD_SIZE;
+    }
 
-/* 
- * This functions initializes local variables.
- */
-static void InitializeLocals( TreeNode *node )
-{
-    Symbol *symbol;
-    int i;
-    char str[64];
+    /* On x86_64 the stack is aligned at the call. */
+    if( GetTarget() == TARGET_X86_64 && ( g_stackDepth + stackBytes ) % STACK_ALIGNMENT != 0 )
+    {
+        padding = STACK_ALIGNMENT - ( g_stackDepth + stackBytes ) % STACK_ALIGNMENT;
+        AsmEmit2( ASM_SUB, 4, AsmImm( padding ), ESP );
+        g_stackDepth += padding;
+    }
+
+    /* Generate the code that pushes the arguments from right 
+     * to left on the stack (c-style function calling). A
+     * float is pushed as its bits. */
+    scratch = ( reg < REG_XMM0 ) ? reg : REG_EAX;
+    g_usedRegisters |= REGISTER_MASK( scratch );
+    for( i = argumentCount - 1; i >= 0; i-- )
+    {
+        if( regs[i] != REG_NONE ) continue;
+        GenerateExpression( GetArgumentFromApplication( node, i ), scratch );
+        Push( AsmReg( scratch ) );
+    }
+    if( scratch != reg ) FreeRegister( scratch );
+
+    /* An argument register is kept from the temporaries
+     * from the time it is loaded. */
+    for( i = argumentCount - 1; i >= 0; i-- )
+    {
+        if( regs[i] == REG_NONE ) continue;
+        g_usedRegisters |= REGISTER_MASK( regs[i] );
+        if( regs[i] >= REG_XMM0 )
+        {
+            GenerateFloatExpression( GetArgumentFromApplication( node, i ), regs[i] );
+        }
+        else
+        {
+            GenerateExpression( GetArgumentFromApplication( node, i ), regs[i] );
+        }
+    }
+    free( regs );
+    free( floats );
     
-    switch( TOAST( node )->id )
+    /* Generate the code that calls the function, and restore the
+     * stack pointer after returning. */
+    AsmEmit1( ASM_CALL, 4, AsmSym( entry != NULL ? entry : name ) );
+    if( reg >= REG_XMM0 && GetTarget() == TARGET_I386 && entry == NULL )
+    {
+        /* The result moves from the x87 stack through
+         * memory. */
+        if( stackBytes == 0 )
+        {
+            AsmEmit2( ASM_SUB, 4, AsmImm( WORD_SIZE ), ESP );
+            g_stackDepth += WORD_SIZE;
+            padding += WORD_SIZE;
+        }
+        AsmEmit1( ASM_FSTPS, 4, AsmMem( REG_ESP, 0 ) );
+        AsmEmit2( ASM_MOVSS, 4, AsmMem( REG_ESP, 0 ), AsmReg( reg ) );
+    }
+    else if( reg > REG_XMM0 )
+    {
+        AsmEmit2( ASM_MOVSS, 4, AsmReg( REG_XMM0 ), AsmReg( reg ) );
+    }
+    if( stackBytes + padding > 0 )
+    {
+        ReleaseStack( stackBytes + padding, FALSE );
+    }
+    if( reg < REG_XMM0 && reg != REG_EAX )
     {
+        AsmEmit2( ASM_MOV, 4, EAX, AsmReg( reg ) );
+    }
 
-    /* Generate code if this is a global declaration. */
-    case NODE_DECLARATION:
-	symbol = FindSymbol( GetNameFromDecl( node ) );
-	switch( GetTypeFromDecl( node ) )
-	{
-	case INT:
-	    if( GetInitializerFromDecl( node ) != NULL )
-	    {
-		sprintf( str, "%d(%s)", symbol->location, ASM_REG(EBP) );
-		EMITASM_MOVL( IntToAsmLit( atoi(GetInitializerFromDecl( node ) )), str );
-	    }
-	    break;
-	case FLOAT:
-	    break;
-	case CHAR:
-	    break;
-	case BOOLEAN:
-	    break;
-	}
-        break;
-	
-    /* Recurse. */
-    default:
-	ListFirst( node->children );
-        for( i = 0; i < ListSize( node->children ); i++ )
+    for( i = nrOfSaved - 1; i >= 0; i-- )
+    {
+        if( saved[i] >= REG_XMM0 )
         {
-            InitializeLocals( ListGet( node->children ) );
-            ListNext( node->children );
+            PopFloat( saved[i], FALSE );
+        }
+        else
+        {
+            Pop( saved[i] );
         }
     }
+    g_usedRegisters = usedRegisters;
 }
 
-
 /*
- * This function generates the code 
- * needed for a function declaration.
+ * Generates code that stores the value of expression
+ * [node] in register [reg]. [reg] must be allocated
+ * by the caller; other registers in use are left
+ * intact.
  */
-static void GenerateFunctionCode( TreeNode *node )
+void GenerateExpression( TreeNode *node, int reg )
 {
-    int localBytes, i;
-    Symbol *symbol;
+    Operand operand;
 
-    
-    /* Generate function start code. */
-    fprintf( g_outFile, ".globl %s\n", GetNameFromHeader( GetHeaderFromFunction(node) ) );
-    fprintf( g_outFile, "\t.type\t%s,@function\n", GetNameFromHeader( GetHeaderFromFunction(node) ) );
-    fprintf( g_outFile, "%s:\n", GetNameFromHeader( GetHeaderFromFunction(node) ) );
-    EMITASM_PUSHL( ASM_REG(EBP) );
-    EMITASM_MOVL( ASM_REG(ESP), ASM_REG(EBP) );
-    EMITASM_PUSHAD();
-    
-    /* Enter the scope in the symbol table. */
-    EnterScope();
+    BOOL saved;
+    int temp;
 
-    /* Allocate space on the stack for local variables. */
-    localBytes = CountAllocatedBytes( GetBlockFromFunction( node ), 0 );
-    EMITASM_SUBL( IntToAsmLit(localBytes), ASM_REG(ESP) );
-    InitializeLocals( GetBlockFromFunction( node ) );
-    //printf( "paramcount: %d\n", GetParamCountFromHeader( GetHeaderFromFunction(node) ) );
-    for( i = 0; i < GetParamCountFromHeader( GetHeaderFromFunction( node ) ); i++ )
+    /* An array, or a row of one, stands for its
+     * address. */
+    if( IsAddress( node ) == TRUE )
     {
-        symbol = FindSymbol( GetParamNameFromHeader( GetHeaderFromFunction( node ), i ) );
-	symbol->location = (i + 2) * 4;
-	//printf( "symbol: %d\n", symbol->location );
+        GenerateAddressCode( node, reg );
+        return;
     }
 
-    /* Generate code for function implementation. */
-    GenerateCodeForNode( GetBlockFromFunction( node ) );
+    if( GetLeafOperand( node, &operand ) == TRUE )
+    {
+        AsmEmit2( ASM_MOV, 4, operand, AsmReg( reg ) );
+        return;
+    }
 
-    /* Leave scope in the symbol table. */
-    ExitScope();
+    /* A float is evaluated in an SSE register, and its
+     * bits moved to [reg]. */
+    if( IsFloat( node ) == TRUE )
+    {
+        temp = BorrowFloatRegister( REG_NONE, &saved );
+        GenerateFloatExpression( node, temp );
+        AsmEmit2( ASM_MOVD, 4, AsmReg( temp ), AsmReg( reg ) );
+        ReturnFloatRegister( temp, saved );
+        return;
+    }
+
+    switch( TOAST( node )->id )
+    {
+    case NODE_APPLICATION:
+        GenerateApplicationCode( node, reg );
+        break;
+    case NODE_INDEXER:
+        GenerateIndexerCode( node, reg );
+        break;
+    case NODE_ASSIGN:
+        if( TOAST( GetTreeChild( node, 0 ) )->id == NODE_INDEXER )
+        {
+            GenerateElementAssignment( node, reg );
+        }
+        else
+        {
+            GenerateEaxExpression( node, ASM_MOV, reg );
+        }
+        break;
+    case NODE_UNARY_SUBTRACT:
+        GenerateExpression( GetTreeChild( node, 0 ), reg );
+        AsmEmit1( ASM_NEG, 4, AsmReg( reg ) );
+        break;
+    case NODE_BINARY_ADD:
+        GenerateBinaryCode( node, ASM_ADD, reg );
+        break;
+    case NODE_BINARY_SUBTRACT:
+        GenerateBinaryCode( node, ASM_SUB, reg );
+        break;
+    case NODE_MULTIPLY:
+        GenerateMultiplyCode( node, reg );
+        break;
+    case NODE_BITWISE_AND:
+        GenerateBinaryCode( node, ASM_AND, reg );
+        break;
+    case NODE_BITWISE_OR:
+        GenerateBinaryCode( node, ASM_OR, reg );
+        break;
+    case NODE_BITWISE_XOR:
+        GenerateBinaryCode( node, ASM_XOR, reg );
+        break;
+    case NODE_DIVIDE:
+        GenerateDivisionCode( node, FALSE, reg );
+        break;
+    case NODE_MODULUS:
+        GenerateDivisionCode( node, TRUE, reg );
+        break;
+    case NODE_BITWISE_LSHIFT:
+        GenerateShiftCode( node, ASM_SAL, reg );
+        break;
+    case NODE_BITWISE_RSHIFT:
+        GenerateShiftCode( node, ASM_SAR, reg );
+        break;
+    case NODE_EQUAL:
+    case NODE_NOTEQUAL:
+    case NODE_LESS:
+    case NODE_LESSEQUAL:
+    case NODE_GREATER:
+    case NODE_GREATEREQUAL:
+        GenerateComparisonCode( node, FALSE, reg );
+        break;
+    case NODE_LOGICAL_AND:
+    case NODE_LOGICAL_OR:
+    case NODE_NOT:
+        GenerateLogicalCode( node, reg );
+        break;
 
-    /* Generate function return code. */
-    EMITASM_POPAD();
-    //EMITASM_POPL( ASM_REG(EBP) );
-    fprintf( g_outFile, "\tleave\n" );
-    fprintf( g_outFile, "\tret\n\n" );
+    /* Other expressions leave their value in EAX. */
+    default:
+        GenerateEaxExpression( node, ASM_MOV, reg );
+    }
 }
 
 /*
- *  Generates code for function calling.
+ * Checks whether expression [node] reads variable
+ * [symbol].
  */
-static void GenerateApplicationCode( TreeNode *node )
+BOOL ReadsVariable( TreeNode *node, Symbol *symbol )
 {
-    /* Generate the code that pushes the arguments from right 
-     * to left on the stack (c-style function calling). */
-    int i = 0;
-    for( i = GetArgumentCountFromApplication( node )-1; i >= 0; i-- )
+    ListNode *child;
+
+    if( TOAST( node )->id == NODE_LIT_IDENTIFIER )
     {
-        GenerateCodeForNode( GetArgumentFromApplication( node, i ) );
-        fprintf( g_outFile, "\tpushl\t%%eax\n" );
+        return( FindSymbol( GetNameOfIdentifier( node ) ) == symbol );
     }
-    
-    /* Generate the code that calls the function, and restore the
-     * stack pointer after returning. */
-    fprintf( g_outFile, "\tcall\t%s\n", GetNameFromApplication( node ) );
-    if( GetArgumentCountFromApplication(node) != 0 )
-	fprintf( g_outFile, "\taddl\t$%d, %%esp\n", GetArgumentCountFromApplication( node )*4 );
+    for( child = ListFirstEx( node->children ); child != NULL; child = ListNextEx( child ) )
+    {
+        if( ReadsVariable( (TreeNode *) child->data, symbol ) == TRUE ) return( TRUE );
+    }
+    return( FALSE );
 }
 
-
-
 /*
- *  Generates code used by all comparison codes.
- *   (Comparison functions use a conditional move and need a 0
- *   and a 1 in EBX and ECX)
+ * Generates code that stores the value of expression
+ * [node] in EAX, at statement level.
  */
-static void GenerateInitializingComparisonCode()
+void GenerateExpressionCode( TreeNode *node )
 {
-    EMITASM_MOVL( IntToAsmLit(0), ASM_REG(EBX) );
-    EMITASM_MOVL( IntToAsmLit(1), ASM_REG(ECX) );
+    BOOL eaxUsed = IsRegisterUsed( REG_EAX );
+
+    g_usedRegisters |= REGISTER_MASK( REG_EAX );
+    GenerateExpression( node, REG_EAX );
+    if( eaxUsed == FALSE ) FreeRegister( REG_EAX );
 }
 
 
-/* 
- * Recursive function that traverses the AST and
- * generates assembly code for the global
- * declarations.
+/*
+ * Generates the epilogue of a tail call, which
+ * restores the callee-saved registers and the frame
+ * of the current function. The saves that the
+ * function turns out not to need are removed from it
+ * along with those of the function's own epilogue.
  */
-static void GenerateGlobalDeclCodeForNode( TreeNode *node )
+void GenerateTailEpilogue()
 {
+    AsmCode *code = AsmGetCode();
     int i;
-    SimpleType type;
-    char *name;
-    Symbol *symbol;
 
-    //printf( "GenerateGlobalDeclCodeForNode: %s\n", GetNodeName( TOAST(node)->id )  );
-    switch( TOAST( node )->id )
+    if( g_nrOfTailCalls == g_maxTailCalls )
     {
-
-    /* Generate code if this is a global declaration. */
-    case NODE_DECLARATION:
-	type = GetTypeFromDecl( node );
-	name = GetNameFromDecl( node );
-	symbol = FindSymbol( name );
-	if( symbol != NULL )
-	{
-	    fprintf( g_outFile, ".globl %s\n", name );
-	    if( type == INT || type== FLOAT )
-    	    {
-                fprintf( g_outFile, "\t.align 4\n" );
-	        fprintf( g_outFile, "\t.type\t%s,@object\n", name );
-	        fprintf( g_outFile, "\t.size\t%s,4\n", name );
-	        fprintf( g_outFile, "%s:\n", name );
-	        if( type == INT )
-		{
-	    	    fprintf( g_outFile, "\t.long\t%s\n", GetInitializerFromDecl( node ) );
-		}
-	        else if( type == FLOAT )
-		{
-	            fprintf( g_outFile, "\t.long\t%lx\n", EncodeFloat( GetInitializerFromDecl( node ) ) );
-		}
-	    }
-	}
-        break;
-	
-    /* Generate no code for other nodes, but recurse for all
-     * children. */
-    default:
-	ListFirst( node->children );
-        for( i = 0; i < ListSize( node->children ); i++ )
-        {
-            GenerateGlobalDeclCodeForNode( ListGet( node->children ) );
-            ListNext( node->children );
-        }
+        g_maxTailCalls = ( g_maxTailCalls == 0 ) ? 16 : g_maxTailCalls * 2;
+        g_tailCalls = (int *) realloc( g_tailCalls, g_maxTailCalls * sizeof( int ) );
+        if( g_tailCalls == NULL ) BAILOUT( ERR_NOMEM );
     }
+    g_tailCalls[g_nrOfTailCalls++] = code->count;
+    for( i = g_target->nrOfCalleeSaved - 1; i >= 0; i-- )
+    {
+        AsmEmit1( ASM_POP, 4, AsmReg( g_target->calleeSaved[i] ) );
+    }
+    AsmEmit0( ASM_LEAVE );
 }
 
-
-
 /*
  *  Recursive function that traverses the AST and
  *  generates the assembly code at each node.
  */
-static void GenerateCodeForNode( TreeNode *node )
+void GenerateCodeForNode( TreeNode *node )
 {
     Symbol *symbol;
+    Operand operand;
     int i = 0;
-    char label1[32], label2[32];
-    char str[32];
+    int label1, label2, reg, reductions;
+    BOOL saved;
     
 
     /* Determine the type of this node and generate the
@@ -430,267 +3380,160 @@ static void GenerateCodeForNode( TreeNode *node )
 	*/
         break;
 
-    /* Generates code for a function call. */
-    case NODE_APPLICATION:
-        GenerateApplicationCode( node );
-	break;
-    
     /* Generates code for an if statement. */
     case NODE_IF:
-	GenerateCodeForNode( GetTreeChild( node, 0 ) );
-	EMITASM_CMPL( IntToAsmLit(0), ASM_REG(EAX) );
-	sprintf( label1, ".L%d", g_labelCount++ );
+	label1 = GenerateLabel();
+	GenerateBranchCode( GetTreeChild( node, 0 ), FALSE, label1 );
 	if( GetElseBlockFromIf(node) == NULL )
 	{
-	    EMITASM_JE( label1 );
 	    GenerateCodeForNode( GetThenBlockFromIf( node ) );
-	    fprintf( g_outFile, "%s:\n", label1 );
+	    AsmEmitLabel( label1 );
 	}
 	else
 	{
-	    sprintf( label2, ".L%d", g_labelCount++ );
-	    EMITASM_JE( label1 );
+	    label2 = GenerateLabel();
 	    GenerateCodeForNode( GetThenBlockFromIf( node ) );
-	    EMITASM_JMP( label2 );
-	    fprintf( g_outFile, "%s:\n", label1 );
+	    AsmEmitJump( COND_NONE, label2 );
+	    AsmEmitLabel( label1 );
 	    GenerateCodeForNode( GetElseBlockFromIf( node ) );
-	    fprintf( g_outFile, "%s:\n", label2 );
+	    AsmEmitLabel( label2 );
 	}
 	break;
 	
     /* Generate code for a while loop. */
     case NODE_WHILE:
-	GENERATE_LABEL( label1 );
-	fprintf( g_outFile, "%s:\n", label1 );
-	GenerateCodeForNode( GetExpressionFromWhile( node ) );
-	EMITASM_CMPL( IntToAsmLit(0), ASM_REG(EAX) );
-	GENERATE_LABEL( label2 );
-        EMITASM_JE( label2 );
+	label1 = GenerateLabel();
+	label2 = GenerateLabel();
+	if( GetOptimizationLevel() >= 1 )
+	{
+	    /* Rotated: a guard, then the body with the test at
+	     * the bottom, so an iteration takes one branch. */
+	    GenerateBranchCode( GetExpressionFromWhile( node ), FALSE, label2 );
+	    if( GenerateVectorLoop( node ) == TRUE )
+	    {
+		/* Fewer than VECTOR_LANES iterations are left. */
+		GenerateBranchCode( GetExpressionFromWhile( node ), FALSE, label2 );
+	    }
+	    reductions = StartReductions( node );
+	    AsmEmitDirective( LOOP_ALIGNMENT );
+	    AsmEmitLabel( label1 );
+	    GenerateCodeForNode( GetBlockFromWhile( node ) );
+	    GenerateBranchCode( GetExpressionFromWhile( node ), TRUE, label1 );
+	    EndReductions( reductions );
+	    AsmEmitLabel( label2 );
+	    break;
+	}
+	AsmEmitLabel( label1 );
+	GenerateBranchCode( GetExpressionFromWhile( node ), FALSE, label2 );
 	GenerateCodeForNode( GetBlockFromWhile( node ) );
-	EMITASM_JMP( label1 );
-	fprintf( g_outFile, "%s:\n", label2 );
+	AsmEmitJump( COND_NONE, label1 );
+	AsmEmitLabel( label2 );
 	break;
 	
+    /* Return from the function, with the value in EAX,
+     * or a float in XMM0 or on the x87 stack (see
+     * GenerateFloatReturn). At -O1 a call returned is
+     * a tail call. */
+    case NODE_RETURN:
+	if( ListSize( node->children ) > 0 && GetOptimizationLevel() >= 1
+	    && GenerateTailCall( GetTreeChild( node, 0 ) ) == TRUE )
+	{
+	    break;
+	}
+	if( ListSize( node->children ) > 0 && IsFloat( GetTreeChild( node, 0 ) ) == TRUE )
+	{
+	    GenerateFloatReturn( GetTreeChild( node, 0 ) );
+	}
+	else if( ListSize( node->children ) > 0 )
+	{
+	    GenerateExpressionCode( GetTreeChild( node, 0 ) );
+	}
+	AsmEmitJump( COND_NONE, g_returnLabel );
+	break;
+
+    /* Generate code for a switch statement. */
+    case NODE_SWITCH:
+	GenerateSwitchCode( node );
+	break;
+
     /* Generate code for an assignment. */
     case NODE_ASSIGN:
-	/* Put the result of the assignment expression in EBX. */
-	GenerateCodeForNode( GetTreeChild( node, 1 ) );
+	if( IsFloat( GetTreeChild( node, 0 ) ) == TRUE )
+	{
+	    reg = BorrowFloatRegister( REG_NONE, &saved );
+	    GenerateFloatAssignment( node, reg );
+	    ReturnFloatRegister( reg, saved );
+	    break;
+	}
+	if( TOAST( GetTreeChild( node, 0 ) )->id == NODE_INDEXER )
+	{
+	    GenerateElementAssignment( node, REG_NONE );
+	    break;
+	}
 	symbol = FindSymbol( TOAST( GetTreeChild( node, 0 ) )->val.identifier );
+	if( symbol->reg != REG_NONE )
+	{
+	    /* Evaluate straight into the variable's register,
+	     * unless the expression reads the old value. */
+	    if( ReadsVariable( GetTreeChild( node, 1 ), symbol ) == FALSE
+		|| GetLeafOperand( GetTreeChild( node, 1 ), &operand ) == TRUE )
+	    {
+		GenerateExpression( GetTreeChild( node, 1 ), symbol->reg );
+	    }
+	    else
+	    {
+		GenerateExpressionCode( GetTreeChild( node, 1 ) );
+		AsmEmit2( ASM_MOV, 4, EAX, AsmReg( symbol->reg ) );
+	    }
+	    GenerateReductionSteps( node );
+	    break;
+	}
+	/* Put the result of the assignment expression in EAX. */
+	GenerateExpressionCode( GetTreeChild( node, 1 ) );
 	if( symbol->global == TRUE )
 	{
-	    EMITASM_MOVL( ASM_REG(EAX), TOAST( GetTreeChild( node, 0 ) )->val.identifier );
+	    AsmEmit2( ASM_MOV, 4, EAX, AsmSym( TOAST( GetTreeChild( node, 0 ) )->val.identifier ) );
 	}
 	else
 	{
-	    ASM_LOCAL( str, symbol->location );	
-	    EMITASM_MOVL( ASM_REG(EAX), str );
+	    AsmEmit2( ASM_MOV, 4, EAX, AsmMem( REG_EBP, symbol->location ) );
 	}
-	//EMITASM_MOVL( ASM_REG(EAX), ASM_REG(EBX) );
+	//AsmEmit2( ASM_MOV, 4, EAX, EBX );
 	/* Get the left hand side of the expression and put it in EAX. */
 	//GenerateCodeForNode( GetTreeChild( node, 0 ) );
 	/* Move the result of the assignment from EBX to EAX. */
-	//ASM_POINTER( str, ASM_REG(EAX), 0 );
-	//EMITASM_MOVL( ASM_REG(EBX), str );
+	//AsmEmit2( ASM_MOV, 4, EBX, AsmMem( REG_EAX, 0 ) );
 	break;
 
-    /* Generates code that stores the result of an expression 
+    /* Generates code that stores the value of an expression
      * in EAX. */
     case NODE_LIT_INT:
-        EMITASM_MOVL( IntToAsmLit( TOAST(node)->val.uintvalue ), ASM_REG(EAX) );
-        break;
-
-    /* Generates code that stores the value of an identifier
-     * in EAX. */
+    case NODE_LIT_BOOL:
+    case NODE_LIT_CHAR:
     case NODE_LIT_IDENTIFIER:
-	symbol = FindSymbol( GetNameOfIdentifier( node ) );
-	if( symbol->global == TRUE )
-	{
-	    EMITASM_MOVL( symbol->name, ASM_REG(EAX) );
-	}
-	else
-	{
-	    EMITASM_MOVL( ASM_REG(EBP), ASM_REG(ECX) );
-	    EMITASM_ADDL( IntToAsmLit(symbol->location), ASM_REG(ECX) );
-	    EMITASM_MOVL( AsmAddressReg(ECX), ASM_REG(EAX) );
-	}
-	break;
-	
-    /* Generates code that negates the value in EAX. */ 
+    case NODE_INDEXER:
+    case NODE_APPLICATION:
     case NODE_UNARY_SUBTRACT:
-        GenerateCodeForNode( GetTreeChild( node, 0 ) );
-        EMITASM_NEG( ASM_REG(EAX) );
-        break;
-
-    /* Generates code that 'ands' the result of an expression
-     * with the value in EAX. */
-    case NODE_BITWISE_AND:
-	GenerateCodeForNode( GetTreeChild( node, 0 ) );
-	EMITASM_MOVL( ASM_REG(EAX), ASM_REG(EBX) );
-	GenerateCodeForNode( GetTreeChild( node, 1 ) );
-	EMITASM_ANDL( ASM_REG(EBX), ASM_REG(EAX) );
-	break;
-	
-    /* Generates code that 'ors' the result of an expression
-     * with the value in EAX. */
-    case NODE_BITWISE_OR:
-	GenerateCodeForNode( GetTreeChild( node, 0 ) );
-	EMITASM_MOVL( ASM_REG(EAX), ASM_REG(EBX) );
-	GenerateCodeForNode( GetTreeChild( node, 1 ) );
-	EMITASM_ORL( ASM_REG(EBX), ASM_REG(EAX) );
-	break;
-	
-   /* Generates code that 'xors' the result of an expression
-     * with the value in EAX. */
-    case NODE_BITWISE_XOR:
-	GenerateCodeForNode( GetTreeChild( node, 0 ) );
-	EMITASM_MOVL( ASM_REG(EAX), ASM_REG(EBX) );
-	GenerateCodeForNode( GetTreeChild( node, 1 ) );
-	EMITASM_XORL( ASM_REG(EBX), ASM_REG(EAX) );
-	break;
-	
-   /* Generates code that adds the result of an expression
-     * to the value in EAX. */
     case NODE_BINARY_ADD:
-        GenerateCodeForNode( GetTreeChild( node, 0 ) );
-        EMITASM_MOVL( ASM_REG(EAX), ASM_REG(EBX) );
-        GenerateCodeForNode( GetTreeChild( node, 1 ) );
-        EMITASM_ADDL( ASM_REG(EBX), ASM_REG(EAX) );
-        break;
-
-    /* Generates code that subtracts the result of an expression 
-     * from the value in EAX. */
     case NODE_BINARY_SUBTRACT:
-        GenerateCodeForNode( GetTreeChild( node, 0 ) );
-        EMITASM_MOVL( ASM_REG(EAX), ASM_REG(EBX) );
-        GenerateCodeForNode( GetTreeChild( node, 1 ) );
-        EMITASM_XCHGL( ASM_REG(EAX), ASM_REG(EBX) );
-        EMITASM_SUBL( ASM_REG(EBX), ASM_REG(EAX) );
-        break;
-
-    /* Generates code that multiplies the value in EAX with the
-     * result of an expression. */
     case NODE_MULTIPLY:
-        GenerateCodeForNode( GetTreeChild( node, 0 ) );
-        EMITASM_MOVL( ASM_REG(EAX), ASM_REG(EBX) );
-        GenerateCodeForNode( GetTreeChild( node, 1 ) );
-        EMITASM_IMUL( ASM_REG(EBX) );
-        break;
-
-    /* Generates code that divides the value in EAX with the result
-     * of an expression. */
     case NODE_DIVIDE:
-        GenerateCodeForNode( GetTreeChild( node, 0 ) );
-        EMITASM_MOVL( ASM_REG(EAX), ASM_REG(EBX) );
-        GenerateCodeForNode( GetTreeChild( node, 1 ) );
-        EMITASM_XCHGL( ASM_REG(EAX), ASM_REG(EBX) );
-        EMITASM_XORL( ASM_REG(EDX), ASM_REG(EDX) ); /* Set EDX to 0. */
-        EMITASM_IDIV( ASM_REG(EBX) );
-        break;
-
-    /* Generates code that divides the value in EAX with the result of
-     * an expression and stores the remainder in EAX. */
     case NODE_MODULUS:
-        GenerateCodeForNode( GetTreeChild( node, 0 ) );
-        EMITASM_MOVL( ASM_REG(EAX), ASM_REG(EBX) );
-        GenerateCodeForNode( GetTreeChild( node, 1 ) );
-        EMITASM_XCHGL( ASM_REG(EAX), ASM_REG(EBX) );
-        EMITASM_XORL( ASM_REG(EDX), ASM_REG(EDX) );
-        EMITASM_IDIV( ASM_REG(EBX) );
-        EMITASM_MOVL( ASM_REG(EDX), ASM_REG(EAX) );
-        break;
-
-    /* Generates code that compares the result of an expression to see
-     * if it equals the value in EAX. */
+    case NODE_BITWISE_AND:
+    case NODE_BITWISE_OR:
+    case NODE_BITWISE_XOR:
+    case NODE_BITWISE_LSHIFT:
+    case NODE_BITWISE_RSHIFT:
     case NODE_EQUAL:
-	GenerateCodeForNode( GetTreeChild( node, 0 ) );
-        EMITASM_MOVL( ASM_REG(EAX), ASM_REG(EBX) );
-        GenerateCodeForNode( GetTreeChild( node, 1 ) );
-        EMITASM_CMPL( ASM_REG(EAX), ASM_REG(EBX) );
-        GenerateInitializingComparisonCode();
-        EMITASM_CMOVNE( ASM_REG(EBX), ASM_REG(EAX) );
-        EMITASM_CMOVE( ASM_REG(ECX), ASM_REG(EAX) );
-	break;
-	
-    /* Generates code that compares the result of an expression to see
-     * if it does not equal the value in EAX. */
     case NODE_NOTEQUAL:
-	GenerateCodeForNode( GetTreeChild( node, 0 ) );
-        EMITASM_MOVL( ASM_REG(EAX), ASM_REG(EBX) );
-        GenerateCodeForNode( GetTreeChild( node, 1 ) );
-        EMITASM_CMPL( ASM_REG(EAX), ASM_REG(EBX) );
-        GenerateInitializingComparisonCode();
-        EMITASM_CMOVE( ASM_REG(EBX), ASM_REG(EAX) );
-        EMITASM_CMOVNE( ASM_REG(ECX), ASM_REG(EAX) );
-	break;
-	
-    /* Generates code that compares the result of an expression to see if
-     * it is smaller than the value in EAX. */
     case NODE_LESS:
-        GenerateCodeForNode( GetTreeChild( node, 0 ) );
-        EMITASM_MOVL( ASM_REG(EAX), ASM_REG(EBX) );
-        GenerateCodeForNode( GetTreeChild( node, 1 ) );
-        EMITASM_CMPL( ASM_REG(EAX), ASM_REG(EBX) );
-        GenerateInitializingComparisonCode();
-        EMITASM_CMOVNL( ASM_REG(EBX), ASM_REG(EAX) );
-        EMITASM_CMOVL( ASM_REG(ECX), ASM_REG(EAX) );
-        break;
-
-    /* Generates code that compares the result of an expression to see if
-     * it is smaller than or equals the value in EAX. */
     case NODE_LESSEQUAL:
-        GenerateCodeForNode( GetTreeChild( node, 0 ) );
-        EMITASM_MOVL( ASM_REG(EAX), ASM_REG(EBX) );
-        GenerateCodeForNode( GetTreeChild( node, 1 ) );
-        EMITASM_CMPL( ASM_REG(EAX), ASM_REG(EBX) );
-        GenerateInitializingComparisonCode();
-        EMITASM_CMOVNLE( ASM_REG(EBX), ASM_REG(EAX) );
-        EMITASM_CMOVLE( ASM_REG(ECX), ASM_REG(EAX) );
-        break;
-
-    /* Generates code that compares the result of an expression to see if
-     * it is larger than the value in EAX. */
     case NODE_GREATER:
-        GenerateCodeForNode( GetTreeChild( node, 0 ) );
-        EMITASM_MOVL( ASM_REG(EAX), ASM_REG(EBX) );
-        GenerateCodeForNode( GetTreeChild( node, 1 ) );
-        EMITASM_CMPL( ASM_REG(EAX), ASM_REG(EBX) );
-        GenerateInitializingComparisonCode();
-        EMITASM_CMOVNG( ASM_REG(EBX), ASM_REG(EAX) );
-        EMITASM_CMOVG( ASM_REG(ECX), ASM_REG(EAX) );
-        break;
-	
-    /* Generates code that compares the result of an expression to see if
-     * it is larger than or equals the value in EAX. */
     case NODE_GREATEREQUAL:
-        GenerateCodeForNode( GetTreeChild( node, 0 ) );
-        EMITASM_MOVL( ASM_REG(EAX), ASM_REG(EBX) );
-        GenerateCodeForNode( GetTreeChild( node, 1 ) );
-        EMITASM_CMPL( ASM_REG(EAX), ASM_REG(EBX) );
-        GenerateInitializingComparisonCode();
-        EMITASM_CMOVNGE( ASM_REG(EBX), ASM_REG(EAX) );
-        EMITASM_CMOVGE( ASM_REG(ECX), ASM_REG(EAX) );
-        break;
-
-    /* Generates code that bitshifts the value in EAX to the left
-     * where the # of bits is determined by the result of an expression
-     * wich is stored in CL. */
-    case NODE_BITWISE_LSHIFT:
-        GenerateCodeForNode( GetTreeChild( node, 0 ) );
-        EMITASM_MOVL( ASM_REG(EAX), ASM_REG(ECX) );
-        GenerateCodeForNode( GetTreeChild( node, 1 ) );
-        EMITASM_XCHGL( ASM_REG(EAX), ASM_REG(ECX) );
-        EMITASM_SALL( ASM_REG(CL), ASM_REG(EAX) );
-        break;
-	
-   /* Generates code that bitshifts the value in EAX to the right
-    * where the # of bits is determined by the result of an expression
-    * wich is stored in CL. */
-   case NODE_BITWISE_RSHIFT:
-        GenerateCodeForNode( GetTreeChild( node, 0 ) );
-        EMITASM_MOVL( ASM_REG(EAX), ASM_REG(ECX) );
-        GenerateCodeForNode( GetTreeChild( node, 1 ) );
-        EMITASM_XCHGL( ASM_REG(EAX), ASM_REG(ECX) );
-        EMITASM_SARL( ASM_REG(CL), ASM_REG(EAX) );
+    case NODE_LOGICAL_AND:
+    case NODE_LOGICAL_OR:
+    case NODE_NOT:
+        GenerateExpressionCode( node );
         break;
 
     /* Generate no code for other nodes, but recurse for all
@@ -715,19 +3558,35 @@ void GenerateCode( TreeNode *node )
     GotoSymbolRoot();
 
     /* Generate global declaration code. */
-    fprintf( g_outFile, ".data\n" );
+    AsmEmitDirective( ".data" );
     GenerateGlobalDeclCodeForNode( node );
 
     /* Generate code for text section. */
-    fprintf( g_outFile, ".text\n" );
-    fprintf( g_outFile, "\t.align 4\n" );
+    AsmEmitDirective( ".text" );
+    AsmEmitDirective( "\t.align 4" );
 
     /* Go back to the root node in the symbol table. */
     GotoSymbolRoot();
 
     /* Generate actual program code. */
     g_labelCount = 3;
+    g_target = ( GetTarget() == TARGET_X86_64 ) ? &x86_64Target : &i386Target;
+    if( GetOptimizationLevel() >= 1 && GetTarget() == TARGET_I386 )
+    {
+        CollectInternalFunctions( node );
+    }
     GenerateCodeForNode( node );	
+    FreeInternalFunctions();
+    free( g_tailCalls );
+    g_tailCalls = NULL;
+    g_maxTailCalls = 0;
+    GenerateFloatConstants();
+
+    /* Write what is left: the section directives of a
+     * module without function definitions. */
+    AsmWrite( g_outFile );
+    AsmFree();
+    FreeFloatConstants();
 
     /* Generate start stub. */
     /*
@@ -23,8 +23,164 @@
 #define CODEGEN_H
 
 #include "tree.h" /* tree traversal routines */
+#include "asm.h"
+#include "symtab.h"
+
+/* Shorthands for the operands used most. */
+#define EAX                                 AsmReg( REG_EAX )
+#define EBX                                 AsmReg( REG_EBX )
+#define ECX                                 AsmReg( REG_ECX )
+#define EDX                                 AsmReg( REG_EDX )
+#define ESP                                 AsmReg( REG_ESP )
+#define EBP                                 AsmReg( REG_EBP )
+#define CL                                  AsmRegSized( REG_ECX, 1 )
+
+/* Size of a stack slot and of an address. */
+#define WORD_SIZE                           AsmWordSize()
+
+/* Aligns loop heads to 16 bytes, unless that takes
+ * more than 7 bytes of padding. */
+#define LOOP_ALIGNMENT                      "\t.p2align 4,,7"
 
 void GenerateCode( TreeNode *node );
 
+/*
+ *  The rest is used by the modules that generate
+ *  code for some statements (switchgen.c,
+ *  induction.c, vectorize.c, tailcall.c).
+ */
+
+/* Generates a new label number. */
+int GenerateLabel();
+
+/* The function being generated, the label after its
+ * prologue where a call to itself in tail position
+ * starts over, and the bytes pushed since the start
+ * of its body. */
+TreeNode *GetCurrentFunction();
+int GetRestartLabel();
+int GetStackDepth();
+
+/* Generates the epilogue of a tail call from the
+ * current function. */
+void GenerateTailEpilogue();
+
+/* Pushes [operand] on the stack, or pops it into
+ * register [reg]. */
+void Push( Operand operand );
+void Pop( int reg );
+
+/* Allocates a register from the pool, not one of
+ * the registers in [exclude]. Returns REG_NONE if
+ * no register is free. */
+int AllocateRegister( unsigned int exclude );
+
+/* Marks register [reg] as free, or as holding a
+ * value. */
+void FreeRegister( int reg );
+void ReserveRegister( int reg );
+BOOL IsRegisterUsed( int reg );
+
+/* Returns a register other than [reg] for a scratch
+ * value. If none is free, one is saved on the stack
+ * and [saved] is set to TRUE. ReturnRegister gives it
+ * back. */
+int BorrowRegister( int reg, BOOL *saved );
+void ReturnRegister( int temp, BOOL saved );
+
+/* Returns the mask of the registers that code for
+ * [node] takes for fixed uses (calls, divisions and
+ * shifts). */
+unsigned int GetFixedRegisters( TreeNode *node );
+
+/* Allocates a register that lives through a loop and
+ * is not in [fixed], or returns REG_NONE. */
+int AllocatePointerRegister( unsigned int fixed );
+
+/* If [node] is an int literal, stores its value in
+ * [value] and returns TRUE. */
+BOOL GetIntConstant( TreeNode *node, int *value );
+
+/* Returns k if [value] is 2^k, and -1 otherwise. */
+int GetLog2( unsigned int value );
+
+/* Checks whether expressions [a] and [b] are the
+ * same. Either may be NULL. */
+BOOL IsSameExpression( TreeNode *a, TreeNode *b );
+
+/* Checks whether [node] is variable [symbol]. */
+BOOL IsVariable( TreeNode *node, Symbol *symbol );
+
+/* Checks whether expression [node] is an array, or a
+ * row of one. */
+BOOL IsAddress( TreeNode *node );
+
+/* Array elements: the size of an element of [type],
+ * the number of indexes of indexer [node], the
+ * variable it indexes, and the stride in elements of
+ * index [index] of [symbol]. SplitIndex splits an
+ * index into an expression (NULL for a constant) and
+ * a constant [offset] added to it. */
+int GetElementSize( Type *type );
+int CountIndexes( TreeNode *node );
+TreeNode *GetIndexedVariable( TreeNode *node );
+int GetStride( Symbol *symbol, int index );
+TreeNode *SplitIndex( TreeNode *node, int *offset );
+
+/* Returns the displacement, in bytes, of the
+ * constants added to the indexes of indexer [node]
+ * of [symbol]. */
+int GetIndexDisplacement( Symbol *symbol, TreeNode *node );
+
+/* Returns the register that serves as the index of
+ * indexer [node] of [symbol] as it is, with its
+ * [scale], or REG_NONE. */
+int GetIndexRegister( Symbol *symbol, TreeNode *node, int *scale );
+
+/* Generates code for the address of the element that
+ * indexer [node] selects, using [reg] if needed, and
+ * returns it as a memory operand. */
+Operand GenerateElementOperand( TreeNode *node, int reg );
+
+/* Generates code for statement [node]. */
+void GenerateCodeForNode( TreeNode *node );
+
+/* Generates code that stores the value of expression
+ * [node] in EAX, at statement level. */
+void GenerateExpressionCode( TreeNode *node );
+
+/* Generates code that stores the value of expression
+ * [node] in register [reg], or of float expression
+ * [node] in SSE register [reg]. [reg] must be
+ * allocated by the caller. */
+void GenerateExpression( TreeNode *node, int reg );
+void GenerateFloatExpression( TreeNode *node, int reg );
+
+/* Checks whether expression [node] is a float. */
+BOOL IsFloat( TreeNode *node );
+
+/* Checks whether expression [node] reads variable
+ * [symbol]. */
+BOOL ReadsVariable( TreeNode *node, Symbol *symbol );
+
+/* Returns the register entry point of function
+ * [name], or NULL if it is called the C way. */
+char *GetInternalEntry( char *name );
+
+/* Assigns registers to the [count] arguments of a
+ * call to function [name], of which [floats] tells
+ * which are floats: regs[i] is the register of
+ * argument i, or REG_NONE if it is passed on the
+ * stack. */
+void AssignArgumentRegisters( char *name, int count, BOOL *floats, int *regs );
+
+/* Allocates a free SSE register. Returns REG_NONE if
+ * none is free. */
+int AllocateFloatRegister();
+
+/* If [node] is a literal or a variable, stores the
+ * operand for it in [operand] and returns TRUE. */
+BOOL GetLeafOperand( TreeNode *node, Operand *operand );
+
 
 #endif
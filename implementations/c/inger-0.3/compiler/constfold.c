@@ -0,0 +1,649 @@
+/*************************************************
+ *                                               *
+ *  Module: constfold.c                          *
+ *  Description:                                 *
+ *      Constant folding and algebraic           *
+ *      simplification of the AST.               *
+ *  Modifications:                               *
+ *                                               *
+ *************************************************
+ *                                               *
+ *   This program is free software; you can      *
+ *   redistribute it and/or modify  it under     *
+ *   the terms of the GNU General Public         *
+ *   License as published by the Free            *
+ *   Software Foundation; either version 2       *
+ *   of the License, or (at your option) any     *
+ *   later version.                              *
+ *                                               *
+ *************************************************/
+
+/*
+ *  The tree is folded bottom-up, so an operator sees
+ *  its operands already folded. Constants are ints,
+ *  chars and bools; they are evaluated the way the
+ *  generated code would: ints wrap at 32 bits, shift
+ *  counts are taken modulo 32, and a division by zero
+ *  is left for run time. Float arithmetic is not
+ *  folded; only a constant converted to float and the
+ *  negation of a float literal are, as these are
+ *  exact or rounded the way cvtsi2ss rounds.
+ *
+ *  Rules that drop an operand (x*0, x&0, ...) only
+ *  apply if the operand has no side effects.
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "defs.h"
+#include "nodenames.h"
+#include "ast.h"
+#include "types.h"
+#include "dataflow.h"
+#include "constfold.h"
+
+/*************************************************
+ *                                               *
+ *  MACROS                                       *
+ *                                               *
+ *************************************************/
+
+/* Truncates [x] to a 32-bit int. */
+#define INT32(x)    ( (long) (int) (unsigned int) (x) )
+
+/* The smallest int. */
+#define INT32_MIN   INT32( 0x80000000UL )
+
+/*************************************************
+ *                                               *
+ *  TYPES                                        *
+ *                                               *
+ *************************************************/
+
+/* Binary operator [id] on [a] and [b], and the result
+ * if it is folded. */
+typedef struct FoldTest
+{
+    int id;
+    long a, b;
+    BOOL folded;
+    long result;
+} FoldTest;
+
+/*************************************************
+ *                                               *
+ *  GLOBALS                                      *
+ *                                               *
+ *************************************************/
+
+/* Folding cases of the self-test: each operator, the
+ * 32-bit wrap-around, shift counts, signed division
+ * and the divisions left for run time. */
+static FoldTest foldTests[] =
+{
+    { NODE_BINARY_ADD,          0x7fffffff, 1, TRUE, INT32_MIN },
+    { NODE_BINARY_SUBTRACT,     INT32_MIN, 1, TRUE, 0x7fffffff },
+    { NODE_MULTIPLY,            65536, 65536, TRUE, 0 },
+    { NODE_MULTIPLY,            -3, 7, TRUE, -21 },
+    { NODE_DIVIDE,              -7, 2, TRUE, -3 },
+    { NODE_DIVIDE,              7, 0, FALSE, 0 },
+    { NODE_DIVIDE,              INT32_MIN, -1, FALSE, 0 },
+    { NODE_MODULUS,             -7, 2, TRUE, -1 },
+    { NODE_MODULUS,             7, 0, FALSE, 0 },
+    { NODE_BITWISE_AND,         12, 10, TRUE, 8 },
+    { NODE_BITWISE_OR,          12, 10, TRUE, 14 },
+    { NODE_BITWISE_XOR,         12, 10, TRUE, 6 },
+    { NODE_BITWISE_LSHIFT,      1, 31, TRUE, INT32_MIN },
+    { NODE_BITWISE_LSHIFT,      1, 33, TRUE, 2 },
+    { NODE_BITWISE_RSHIFT,      -8, 1, TRUE, -4 },
+    { NODE_BITWISE_RSHIFT,      INT32_MIN, 31, TRUE, -1 },
+    { NODE_EQUAL,               3, 3, TRUE, 1 },
+    { NODE_NOTEQUAL,            3, 3, TRUE, 0 },
+    { NODE_GREATER,             -1, 0, TRUE, 0 },
+    { NODE_GREATEREQUAL,        0, 0, TRUE, 1 },
+    { NODE_LESS,                -1, 0, TRUE, 1 },
+    { NODE_LESSEQUAL,           1, 0, TRUE, 0 },
+    { NODE_LOGICAL_AND,         1, 0, TRUE, 0 },
+    { NODE_LOGICAL_OR,          0, 1, TRUE, 1 },
+    { NODE_ASSIGN,              1, 2, FALSE, 0 }
+};
+
+/*************************************************
+ *                                               *
+ *  STATIC FUNCTION DEFINITIONS                  *
+ *                                               *
+ *************************************************/
+
+static BOOL IsConstant( TreeNode *node )
+{
+    switch( TOAST( node )->id )
+    {
+    case NODE_LIT_INT:
+    case NODE_LIT_CHAR:
+    case NODE_LIT_BOOL:
+        return( TRUE );
+    }
+    return( FALSE );
+}
+
+static long GetConstant( TreeNode *node )
+{
+    switch( TOAST( node )->id )
+    {
+    case NODE_LIT_INT:
+        return( INT32( TOAST( node )->val.uintvalue ) );
+    case NODE_LIT_CHAR:
+        return( TOAST( node )->val.charvalue );
+    case NODE_LIT_BOOL:
+        return( TOAST( node )->val.boolvalue == TRUE );
+    }
+    assert( 0 );
+    return( 0 );
+}
+
+/* Checks whether [node] is constant [value]. */
+static BOOL IsValue( TreeNode *node, long value )
+{
+    return( IsConstant( node ) == TRUE && GetConstant( node ) == value );
+}
+
+/* Returns the simple type of [type] if it is an int,
+ * char or bool without dimensions, else UNKNOWN. */
+static SimpleType GetScalarType( Type *type )
+{
+    if( type == NULL || ListSize( type->dimensions ) != 0 ) return( UNKNOWN );
+
+    switch( GetSimpleType( type ) )
+    {
+    case INT:
+        return( INT );
+    case CHAR:
+        return( CHAR );
+    case BOOLEAN:
+        return( BOOLEAN );
+    default:
+        return( UNKNOWN );
+    }
+}
+
+/*
+ *  Replaces [node] by a literal of value [value] and
+ *  of type [type]. Returns the literal, or [node] if
+ *  [type] has no literals.
+ */
+static TreeNode *MakeConstant( TreeNode *node, Type *type, long value )
+{
+    TreeNode *literal;
+
+    switch( GetScalarType( type ) )
+    {
+    case INT:
+        literal = CreateAstNode( NODE_LIT_INT, TOAST( node )->lineno );
+        TOAST( literal )->val.uintvalue = (unsigned long) INT32( value );
+        break;
+    case CHAR:
+        literal = CreateAstNode( NODE_LIT_CHAR, TOAST( node )->lineno );
+        TOAST( literal )->val.charvalue = (char) value;
+        break;
+    case BOOLEAN:
+        literal = CreateAstNode( NODE_LIT_BOOL, TOAST( node )->lineno );
+        TOAST( literal )->val.boolvalue = ( value != 0 ) ? TRUE : FALSE;
+        break;
+    default:
+        return( node );
+    }
+    TOAST( literal )->type = CopyType( type );
+
+    return( ReplaceTreeNode( node, literal ) );
+}
+
+/* Replaces [node] by a float literal of value
+ * [value] and of type [type]. */
+static TreeNode *MakeFloatConstant( TreeNode *node, Type *type, float value )
+{
+    TreeNode *literal;
+
+    literal = CreateAstNode( NODE_LIT_FLOAT, TOAST( node )->lineno );
+    TOAST( literal )->val.floatvalue = value;
+    TOAST( literal )->type = CopyType( type );
+
+    return( ReplaceTreeNode( node, literal ) );
+}
+
+/*
+ *  Replaces [node] by its operand [operand] if they
+ *  are of the same type. Returns what is in the place
+ *  of [node].
+ */
+static TreeNode *KeepOperand( TreeNode *node, TreeNode *operand )
+{
+    SimpleType type;
+
+    type = GetScalarType( TOAST( node )->type );
+    if( type == UNKNOWN || type != GetScalarType( TOAST( operand )->type ) )
+    {
+        return( node );
+    }
+    return( ReplaceTreeNode( node, operand ) );
+}
+
+/* Checks whether evaluating [node] can have an
+ * effect other than its value. */
+static BOOL HasSideEffects( TreeNode *node )
+{
+    ListNode *child;
+
+    switch( TOAST( node )->id )
+    {
+    case NODE_APPLICATION:
+    case NODE_ASSIGN:
+        return( TRUE );
+    }
+
+    for( child = ListFirstEx( node->children ); child != NULL; child = ListNextEx( child ) )
+    {
+        if( HasSideEffects( (TreeNode *) child->data ) == TRUE ) return( TRUE );
+    }
+    return( FALSE );
+}
+
+/*
+ *  Replaces [node] by constant [value] (of the type of
+ *  [node]) if [operand], which is dropped, has no side
+ *  effects.
+ */
+static TreeNode *Absorb( TreeNode *node, TreeNode *operand, long value )
+{
+    if( HasSideEffects( operand ) == TRUE ) return( node );
+    return( MakeConstant( node, TOAST( node )->type, value ) );
+}
+
+/* Checks whether statement [node] may be left out:
+ * it declares no variables and has no labels. */
+static BOOL IsRemovable( TreeNode *node )
+{
+    ListNode *child;
+
+    switch( TOAST( node )->id )
+    {
+    case NODE_DECLARATION:
+    case NODE_LABEL:
+        return( FALSE );
+    }
+
+    for( child = ListFirstEx( node->children ); child != NULL; child = ListNextEx( child ) )
+    {
+        if( IsRemovable( (TreeNode *) child->data ) == FALSE ) return( FALSE );
+    }
+    return( TRUE );
+}
+
+/* Replaces statement [node] by [statement], or by an
+ * empty block if [statement] is NULL. */
+static TreeNode *ReplaceStatement( TreeNode *node, TreeNode *statement )
+{
+    if( statement == NULL )
+    {
+        statement = CreateAstNode( NODE_BLOCK, TOAST( node )->lineno );
+    }
+    return( ReplaceTreeNode( node, statement ) );
+}
+
+/*
+ *  Evaluates binary operator [id] on [a] and [b], and
+ *  stores the result in [result]. Returns FALSE if the
+ *  result is left for run time.
+ */
+static BOOL Evaluate( int id, long a, long b, long *result )
+{
+    switch( id )
+    {
+    case NODE_BINARY_ADD:
+        *result = INT32( (unsigned long) a + (unsigned long) b );
+        break;
+    case NODE_BINARY_SUBTRACT:
+        *result = INT32( (unsigned long) a - (unsigned long) b );
+        break;
+    case NODE_MULTIPLY:
+        *result = INT32( (unsigned long) a * (unsigned long) b );
+        break;
+    case NODE_DIVIDE:
+    case NODE_MODULUS:
+        /* idiv faults on these. */
+        if( b == 0 || ( a == INT32_MIN && b == -1 ) ) return( FALSE );
+        *result = ( id == NODE_DIVIDE ) ? a / b : a % b;
+        break;
+    case NODE_BITWISE_AND:
+        *result = a & b;
+        break;
+    case NODE_BITWISE_OR:
+        *result = a | b;
+        break;
+    case NODE_BITWISE_XOR:
+        *result = a ^ b;
+        break;
+    case NODE_BITWISE_LSHIFT:
+        *result = INT32( (unsigned long) a << ( b & 31 ) );
+        break;
+    case NODE_BITWISE_RSHIFT:
+        *result = INT32( a ) >> ( b & 31 );
+        break;
+    case NODE_EQUAL:
+        *result = ( a == b );
+        break;
+    case NODE_NOTEQUAL:
+        *result = ( a != b );
+        break;
+    case NODE_GREATER:
+        *result = ( a > b );
+        break;
+    case NODE_GREATEREQUAL:
+        *result = ( a >= b );
+        break;
+    case NODE_LESS:
+        *result = ( a < b );
+        break;
+    case NODE_LESSEQUAL:
+        *result = ( a <= b );
+        break;
+    case NODE_LOGICAL_AND:
+        *result = ( a && b );
+        break;
+    case NODE_LOGICAL_OR:
+        *result = ( a || b );
+        break;
+    default:
+        return( FALSE );
+    }
+    return( TRUE );
+}
+
+/*
+ *  Applies identity and absorbing element rules to
+ *  binary operator [node], of which one operand may
+ *  be constant.
+ */
+static TreeNode *SimplifyBinary( TreeNode *node )
+{
+    TreeNode *left, *right;
+
+    left = GetTreeChild( node, 0 );
+    right = GetTreeChild( node, 1 );
+
+    switch( TOAST( node )->id )
+    {
+    case NODE_BINARY_ADD:
+        if( IsValue( left, 0 ) ) return( KeepOperand( node, right ) );
+        /* Fall through. */
+    case NODE_BINARY_SUBTRACT:
+        if( IsValue( right, 0 ) ) return( KeepOperand( node, left ) );
+        break;
+
+    case NODE_MULTIPLY:
+        if( IsValue( left, 1 ) ) return( KeepOperand( node, right ) );
+        if( IsValue( right, 1 ) ) return( KeepOperand( node, left ) );
+        if( IsValue( left, 0 ) ) return( Absorb( node, right, 0 ) );
+        if( IsValue( right, 0 ) ) return( Absorb( node, left, 0 ) );
+        break;
+
+    case NODE_DIVIDE:
+        if( IsValue( right, 1 ) ) return( KeepOperand( node, left ) );
+        break;
+
+    case NODE_MODULUS:
+        if( IsValue( right, 1 ) || IsValue( right, -1 ) ) return( Absorb( node, left, 0 ) );
+        break;
+
+    case NODE_BITWISE_AND:
+        if( IsValue( left, -1 ) ) return( KeepOperand( node, right ) );
+        if( IsValue( right, -1 ) ) return( KeepOperand( node, left ) );
+        if( IsValue( left, 0 ) ) return( Absorb( node, right, 0 ) );
+        if( IsValue( right, 0 ) ) return( Absorb( node, left, 0 ) );
+        break;
+
+    case NODE_BITWISE_OR:
+        if( IsValue( left, 0 ) ) return( KeepOperand( node, right ) );
+        if( IsValue( right, 0 ) ) return( KeepOperand( node, left ) );
+        if( IsValue( left, -1 ) ) return( Absorb( node, right, -1 ) );
+        if( IsValue( right, -1 ) ) return( Absorb( node, left, -1 ) );
+        break;
+
+    case NODE_BITWISE_XOR:
+        if( IsValue( left, 0 ) ) return( KeepOperand( node, right ) );
+        if( IsValue( right, 0 ) ) return( KeepOperand( node, left ) );
+        break;
+
+    case NODE_BITWISE_LSHIFT:
+    case NODE_BITWISE_RSHIFT:
+        if( IsConstant( right ) && ( GetConstant( right ) & 31 ) == 0 )
+        {
+            return( KeepOperand( node, left ) );
+        }
+        if( IsValue( left, 0 ) ) return( Absorb( node, right, 0 ) );
+        break;
+
+    /* The right operand of && and || is evaluated only
+     * if the left one does not decide the result. */
+    case NODE_LOGICAL_AND:
+        if( IsValue( left, 1 ) ) return( KeepOperand( node, right ) );
+        if( IsValue( left, 0 ) ) return( MakeConstant( node, TOAST( node )->type, 0 ) );
+        if( IsValue( right, 1 ) ) return( KeepOperand( node, left ) );
+        if( IsValue( right, 0 ) ) return( Absorb( node, left, 0 ) );
+        break;
+
+    case NODE_LOGICAL_OR:
+        if( IsValue( left, 0 ) ) return( KeepOperand( node, right ) );
+        if( IsValue( left, 1 ) ) return( MakeConstant( node, TOAST( node )->type, 1 ) );
+        if( IsValue( right, 0 ) ) return( KeepOperand( node, left ) );
+        if( IsValue( right, 1 ) ) return( Absorb( node, left, 1 ) );
+        break;
+    }
+    return( node );
+}
+
+static TreeNode *FoldBinary( TreeNode *node )
+{
+    TreeNode *left, *right;
+    long result;
+
+    left = GetTreeChild( node, 0 );
+    right = GetTreeChild( node, 1 );
+
+    if( IsConstant( left ) && IsConstant( right )
+        && Evaluate( TOAST( node )->id, GetConstant( left ), GetConstant( right ), &result ) )
+    {
+        return( MakeConstant( node, TOAST( node )->type, result ) );
+    }
+    return( SimplifyBinary( node ) );
+}
+
+static TreeNode *FoldUnary( TreeNode *node )
+{
+    TreeNode *operand;
+    int id;
+
+    id = TOAST( node )->id;
+    operand = GetTreeChild( node, 0 );
+
+    /* -(-x), !!x and ~~x are x. */
+    if( TOAST( operand )->id == id && id != NODE_CHAR_TO_INT )
+    {
+        return( KeepOperand( node, GetTreeChild( operand, 0 ) ) );
+    }
+
+    switch( id )
+    {
+    case NODE_UNARY_ADD:
+        return( KeepOperand( node, operand ) );
+    case NODE_UNARY_SUBTRACT:
+        if( IsConstant( operand ) )
+        {
+            return( MakeConstant( node, TOAST( node )->type,
+                INT32( 0UL - (unsigned long) GetConstant( operand ) ) ) );
+        }
+        if( TOAST( operand )->id == NODE_LIT_FLOAT )
+        {
+            return( MakeFloatConstant( node, TOAST( node )->type, -TOAST( operand )->val.floatvalue ) );
+        }
+        break;
+    case NODE_NOT:
+        if( IsConstant( operand ) )
+        {
+            return( MakeConstant( node, TOAST( node )->type, !GetConstant( operand ) ) );
+        }
+        break;
+    case NODE_BITWISE_COMPLEMENT:
+        /* The type checker leaves ~ untyped; it has the
+         * type of its operand. */
+        if( IsConstant( operand ) )
+        {
+            return( MakeConstant( node, TOAST( operand )->type, ~GetConstant( operand ) ) );
+        }
+        break;
+    case NODE_CHAR_TO_INT:
+        if( IsConstant( operand ) )
+        {
+            return( MakeConstant( node, TOAST( node )->type, GetConstant( operand ) ) );
+        }
+        break;
+    case NODE_INT_TO_FLOAT:
+    case NODE_CHAR_TO_FLOAT:
+        if( IsConstant( operand ) )
+        {
+            return( MakeFloatConstant( node, TOAST( node )->type, (float) GetConstant( operand ) ) );
+        }
+        break;
+    }
+    return( node );
+}
+
+static TreeNode *FoldIf( TreeNode *node )
+{
+    TreeNode *condition, *taken, *skipped;
+
+    condition = GetExpressionFromIf( node );
+    if( IsConstant( condition ) == FALSE ) return( node );
+
+    if( GetConstant( condition ) != 0 )
+    {
+        taken = GetThenBlockFromIf( node );
+        skipped = GetElseBlockFromIf( node );
+    }
+    else
+    {
+        taken = GetElseBlockFromIf( node );
+        skipped = GetThenBlockFromIf( node );
+    }
+
+    if( skipped != NULL && IsRemovable( skipped ) == FALSE ) return( node );
+    return( ReplaceStatement( node, taken ) );
+}
+
+static TreeNode *FoldWhile( TreeNode *node )
+{
+    TreeNode *condition;
+
+    condition = GetExpressionFromWhile( node );
+    if( IsConstant( condition ) == FALSE || GetConstant( condition ) != 0
+        || IsRemovable( GetBlockFromWhile( node ) ) == FALSE ) return( node );
+
+    return( ReplaceStatement( node, NULL ) );
+}
+
+/*************************************************
+ *                                               *
+ *  EXPORTED FUNCTION DEFINITIONS                *
+ *                                               *
+ *************************************************/
+
+TreeNode *FoldConstants( TreeNode *node )
+{
+    ListNode *child;
+
+    assert( node != NULL );
+
+    /* Replacing a child replaces the data of its list
+     * node, so the list can be walked meanwhile. */
+    for( child = ListFirstEx( node->children ); child != NULL; child = ListNextEx( child ) )
+    {
+        FoldConstants( (TreeNode *) child->data );
+    }
+
+    switch( TOAST( node )->id )
+    {
+    case NODE_BINARY_ADD:
+    case NODE_BINARY_SUBTRACT:
+    case NODE_MULTIPLY:
+    case NODE_DIVIDE:
+    case NODE_MODULUS:
+    case NODE_BITWISE_AND:
+    case NODE_BITWISE_OR:
+    case NODE_BITWISE_XOR:
+    case NODE_BITWISE_LSHIFT:
+    case NODE_BITWISE_RSHIFT:
+    case NODE_EQUAL:
+    case NODE_NOTEQUAL:
+    case NODE_GREATER:
+    case NODE_GREATEREQUAL:
+    case NODE_LESS:
+    case NODE_LESSEQUAL:
+    case NODE_LOGICAL_AND:
+    case NODE_LOGICAL_OR:
+        return( FoldBinary( node ) );
+
+    case NODE_UNARY_ADD:
+    case NODE_UNARY_SUBTRACT:
+    case NODE_NOT:
+    case NODE_BITWISE_COMPLEMENT:
+    case NODE_CHAR_TO_INT:
+    case NODE_INT_TO_FLOAT:
+    case NODE_CHAR_TO_FLOAT:
+        return( FoldUnary( node ) );
+
+    case NODE_IF:
+        return( FoldIf( node ) );
+
+    case NODE_WHILE:
+        return( FoldWhile( node ) );
+
+    case NODE_FUNCTION:
+        InvalidateDataflow( node );
+        break;
+    }
+    return( node );
+}
+
+BOOL TestConstantFolding()
+{
+    FoldTest *test;
+    BOOL passed = TRUE, folded;
+    long result;
+    int i;
+
+    printf( "Testing constant folding...\n" );
+
+    for( i = 0; i < sizeof( foldTests ) / sizeof( FoldTest ); i++ )
+    {
+        test = &foldTests[i];
+        result = 0;
+        folded = Evaluate( test->id, test->a, test->b, &result );
+        if( folded == TRUE )
+        {
+            printf( "%s %ld %ld: %ld", GetNodeName( test->id ), test->a, test->b, result );
+        }
+        else
+        {
+            printf( "%s %ld %ld: not folded", GetNodeName( test->id ), test->a, test->b );
+        }
+        if( folded != test->folded || ( folded == TRUE && result != test->result ) )
+        {
+            printf( ", FAILED" );
+            passed = FALSE;
+        }
+        printf( "\n" );
+    }
+
+    printf( "Constant folding test %s.\n\n", ( passed == TRUE ) ? "passed" : "failed" );
+    return( passed );
+}
@@ -0,0 +1,48 @@
+/*************************************************
+ *                                               *
+ *  Module: constfold.h                          *
+ *  Description:                                 *
+ *      Interface to the constant folding and    *
+ *      algebraic simplification of the AST.     *
+ *  Modifications:                               *
+ *                                               *
+ *************************************************
+ *                                               *
+ *   This program is free software; you can      *
+ *   redistribute it and/or modify  it under     *
+ *   the terms of the GNU General Public         *
+ *   License as published by the Free            *
+ *   Software Foundation; either version 2       *
+ *   of the License, or (at your option) any     *
+ *   later version.                              *
+ *                                               *
+ *************************************************/
+
+#ifndef CONSTFOLD_H
+#define CONSTFOLD_H
+
+#include "tree.h"
+
+/*
+ *  Evaluates the constant int, char and bool
+ *  expressions in [node] and its children, removes
+ *  operations with an identity or absorbing element
+ *  (x+0, x*1, x*0, ...), and replaces if and while
+ *  statements with a constant condition by the code
+ *  that runs. Returns the node that took the place of
+ *  [node] in the tree.
+ *
+ *  Pre: the AST has been decorated with types.
+ */
+TreeNode *FoldConstants( TreeNode *node );
+
+/*
+ *  Tests the evaluation of each operator on a table
+ *  of constants.
+ *
+ *  Post: Returns TRUE if the test was successful,
+ *        FALSE if it failed.
+ */
+BOOL TestConstantFolding();
+
+#endif
@@ -0,0 +1,849 @@
+/*************************************************
+ *                                               *
+ *  Module: dataflow.c                           *
+ *  Description:                                 *
+ *      Liveness and reaching definitions over   *
+ *      the control flow graphs of function      *
+ *      bodies.                                  *
+ *  Modifications:                               *
+ *                                               *
+ *************************************************
+ *                                               *
+ *   This program is free software; you can      *
+ *   redistribute it and/or modify  it under     *
+ *   the terms of the GNU General Public         *
+ *   License as published by the Free            *
+ *   Software Foundation; either version 2       *
+ *   of the License, or (at your option) any     *
+ *   later version.                              *
+ *                                               *
+ *************************************************/
+
+/*
+ *  When the facts of a function are created, each
+ *  statement is walked once in the order it is
+ *  evaluated, and what it does to the tracked
+ *  variables is recorded as events (see Event). The
+ *  analyses only replay the events.
+ *
+ *  Each analysis is a set of bits per block, solved
+ *  with one worklist engine. A block is summed up by
+ *  the bits it generates and kills, so that
+ *  out = gen + ( in - kill ) (in and out swap for
+ *  liveness). The engine starts from the blocks in
+ *  reverse postorder (postorder for liveness) and
+ *  puts a block back on the list when the facts
+ *  flowing into it change. Both analyses meet by
+ *  union.
+ *
+ *  An assignment to a variable defines it after its
+ *  value is evaluated. The right operand of && and ||
+ *  may not be evaluated: its events are conditional,
+ *  and its assignments do not kill definitions or
+ *  liveness. Locals are initialized on function
+ *  entry, so every variable is defined in CFG_ENTRY.
+ *
+ *  Variables are looked up by name and functions by
+ *  node in hashes, so that the work is linear in the
+ *  size of the function (times the size of the sets
+ *  when solving).
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "defs.h"
+#include "nodenames.h"
+#include "symtab.h"
+#include "ast.h"
+#include "cfg.h"
+#include "selftest.h"
+#include "dataflow.h"
+
+/*************************************************
+ *                                               *
+ *  GLOBALS                                      *
+ *                                               *
+ *************************************************/
+
+/* The facts of the functions analysed so far, which
+ * are NULL once invalidated, and the index of each
+ * function in it. */
+static Dataflow **flows = NULL;
+static int nrOfFlows, maxFlows;
+static IndexMap functions = { NULL, NULL, 0, 0, FALSE };
+
+/* The declarations in the function being prepared. */
+static TreeNode **declarations = NULL;
+static int nrOfDeclarations, maxDeclarations;
+
+/* The facts being created or solved, and the block
+ * being walked. */
+static Dataflow *current;
+static Analysis currentAnalysis;
+static int currentBlock;
+
+/*************************************************
+ *                                               *
+ *  STATIC FUNCTION DEFINITIONS                  *
+ *                                               *
+ *************************************************/
+
+static unsigned int Hash( IndexMap *map, void *key )
+{
+    unsigned long k = (unsigned long) key;
+    unsigned int hash = 2166136261u;
+    char *c;
+
+    if( map->names == FALSE ) return( (unsigned int) ( ( k >> 4 ) ^ ( k >> 20 ) ) * 2654435761u );
+
+    for( c = (char *) key; *c != '\0'; c++ )
+    {
+        hash = ( hash ^ (unsigned char) *c ) * 16777619u;
+    }
+    return( hash );
+}
+
+static BOOL IsKey( IndexMap *map, void *a, void *b )
+{
+    return( a == b || ( map->names == TRUE && strcmp( (char *) a, (char *) b ) == 0 ) );
+}
+
+static unsigned int *NewSet( int words )
+{
+    unsigned int *set;
+
+    set = (unsigned int *) calloc( words, sizeof( unsigned int ) );
+    if( set == NULL ) BAILOUT( ERR_NOMEM );
+    return( set );
+}
+
+static void AddToSet( unsigned int *set, int i )
+{
+    set[i / SET_WORD_BITS] |= 1u << ( i % SET_WORD_BITS );
+}
+
+static void RemoveFromSet( unsigned int *set, int i )
+{
+    set[i / SET_WORD_BITS] &= ~( 1u << ( i % SET_WORD_BITS ) );
+}
+
+/* Returns the number of words in a set of [count]
+ * bits; never 0. */
+static int WordsFor( int count )
+{
+    return( ( count == 0 ) ? 1 : ( count + SET_WORD_BITS - 1 ) / SET_WORD_BITS );
+}
+
+/* Records the variables in [node] as escaped: their
+ * names are mapped to -1, so they are not tracked. */
+static void TakeAddress( TreeNode *node )
+{
+    ListNode *child;
+    char *name;
+
+    if( TOAST( node )->id == NODE_LIT_IDENTIFIER )
+    {
+        name = GetNameOfIdentifier( node );
+        if( FindInMap( &current->names, name ) == NULL ) AddToMap( &current->names, name, -1 );
+    }
+    for( child = ListFirstEx( node->children ); child != NULL; child = ListNextEx( child ) )
+    {
+        TakeAddress( (TreeNode *) child->data );
+    }
+}
+
+static int AddDefinition( TreeNode *node, int variable, int block )
+{
+    Definition *definition;
+
+    if( current->nrOfDefinitions == current->maxDefinitions )
+    {
+        current->maxDefinitions = ( current->maxDefinitions == 0 ) ? 16 : current->maxDefinitions * 2;
+        current->definitions = (Definition *) realloc( current->definitions,
+            current->maxDefinitions * sizeof( Definition ) );
+        if( current->definitions == NULL ) BAILOUT( ERR_NOMEM );
+    }
+    definition = &current->definitions[current->nrOfDefinitions];
+    definition->node = node;
+    definition->variable = variable;
+    definition->block = block;
+    return( current->nrOfDefinitions++ );
+}
+
+/*
+ *  Adds [symbol] as a variable defined on entry by
+ *  [declaration], unless it is known, escaped or not
+ *  a local or parameter without dimensions.
+ */
+static void AddVariable( Symbol *symbol, TreeNode *declaration )
+{
+    ListNode *node;
+
+    if( symbol == NULL || symbol->global == TRUE || FindInMap( &current->names, symbol->name ) != NULL )
+    {
+        return;
+    }
+    node = ListFirstEx( symbol->types );
+    if( node == NULL || ListFirstEx( ( (Type *) node->data )->dimensions ) != NULL ) return;
+
+    if( current->nrOfVariables == current->maxVariables )
+    {
+        current->maxVariables = ( current->maxVariables == 0 ) ? 16 : current->maxVariables * 2;
+        current->variables = (Symbol **) realloc( current->variables,
+            current->maxVariables * sizeof( Symbol * ) );
+        if( current->variables == NULL ) BAILOUT( ERR_NOMEM );
+    }
+    AddToMap( &current->names, symbol->name, current->nrOfVariables );
+    current->variables[current->nrOfVariables++] = symbol;
+    AddDefinition( declaration, current->nrOfVariables - 1, CFG_ENTRY );
+}
+
+/* Collects the declarations in [node], and records
+ * the variables whose address is taken. */
+static void CollectVariables( TreeNode *node )
+{
+    ListNode *child;
+
+    switch( TOAST( node )->id )
+    {
+    case NODE_ADDRESS:
+        TakeAddress( node );
+        return;
+
+    case NODE_DECLARATION:
+        if( nrOfDeclarations == maxDeclarations )
+        {
+            maxDeclarations = ( maxDeclarations == 0 ) ? 16 : maxDeclarations * 2;
+            declarations = (TreeNode **) realloc( declarations, maxDeclarations * sizeof( TreeNode * ) );
+            if( declarations == NULL ) BAILOUT( ERR_NOMEM );
+        }
+        declarations[nrOfDeclarations++] = node;
+        return;
+    }
+
+    for( child = ListFirstEx( node->children ); child != NULL; child = ListNextEx( child ) )
+    {
+        CollectVariables( (TreeNode *) child->data );
+    }
+}
+
+/* Returns the variable identifier [node] refers to,
+ * or -1. */
+static int GetVariable( TreeNode *node )
+{
+    int *index;
+
+    index = FindInMap( &current->names, GetNameOfIdentifier( node ) );
+    return( ( index == NULL ) ? -1 : *index );
+}
+
+static void AddEvent( EventKind kind, int variable, int definition, BOOL conditional, TreeNode *node )
+{
+    Event *event;
+
+    if( current->nrOfEvents == current->maxEvents )
+    {
+        current->maxEvents = ( current->maxEvents == 0 ) ? 64 : current->maxEvents * 2;
+        current->events = (Event *) realloc( current->events, current->maxEvents * sizeof( Event ) );
+        if( current->events == NULL ) BAILOUT( ERR_NOMEM );
+    }
+    event = &current->events[current->nrOfEvents++];
+    event->kind = kind;
+    event->variable = variable;
+    event->definition = definition;
+    event->conditional = conditional;
+    event->node = node;
+}
+
+/*
+ *  Walks [node] in the order it is evaluated, and
+ *  records its events. [conditional] is TRUE when
+ *  [node] may not be evaluated. Assignments to
+ *  variables become definitions in currentBlock.
+ */
+static void Walk( TreeNode *node, BOOL conditional )
+{
+    ListNode *child;
+    TreeNode *left;
+    int variable;
+
+    switch( TOAST( node )->id )
+    {
+    case NODE_LIT_IDENTIFIER:
+        variable = GetVariable( node );
+        if( variable >= 0 ) AddEvent( EVENT_USE, variable, -1, conditional, node );
+        return;
+
+    case NODE_ASSIGN:
+        Walk( GetTreeChild( node, 1 ), conditional );
+        left = GetTreeChild( node, 0 );
+        variable = ( TOAST( left )->id == NODE_LIT_IDENTIFIER ) ? GetVariable( left ) : -1;
+        if( variable >= 0 )
+        {
+            AddEvent( EVENT_DEFINE, variable, AddDefinition( node, variable, currentBlock ),
+                conditional, node );
+        }
+        else
+        {
+            Walk( left, conditional );
+        }
+        return;
+
+    case NODE_LOGICAL_AND:
+    case NODE_LOGICAL_OR:
+        Walk( GetTreeChild( node, 0 ), conditional );
+        Walk( GetTreeChild( node, 1 ), TRUE );
+        return;
+
+    case NODE_GOTO:
+    case NODE_LABEL:
+        return;
+    }
+
+    for( child = ListFirstEx( node->children ); child != NULL; child = ListNextEx( child ) )
+    {
+        Walk( (TreeNode *) child->data, conditional );
+    }
+}
+
+/*
+ *  Creates the facts of function [node], with its
+ *  graph, variables, definitions and events. Nothing
+ *  is solved yet.
+ */
+static Dataflow *CreateDataflow( TreeNode *node )
+{
+    BasicBlock *block;
+    TreeNode *header;
+    int *next, statement, i, j;
+
+    current = (Dataflow *) malloc( sizeof( Dataflow ) );
+    if( current == NULL ) BAILOUT( ERR_NOMEM );
+    memset( current, 0, sizeof( Dataflow ) );
+    current->function = node;
+    current->cfg = BuildCfg( node );
+    current->names.names = TRUE;
+
+    nrOfDeclarations = 0;
+    CollectVariables( GetBlockFromFunction( node ) );
+
+    /* Parameters first, then the locals. */
+    header = GetHeaderFromFunction( node );
+    for( i = 0; i < GetParamCountFromHeader( header ); i++ )
+    {
+        AddVariable( FindSymbol( GetParamNameFromHeader( header, i ) ), NULL );
+    }
+    for( i = 0; i < nrOfDeclarations; i++ )
+    {
+        AddVariable( FindSymbol( GetNameFromDecl( declarations[i] ) ), declarations[i] );
+    }
+
+    /* The events of each statement. */
+    for( i = statement = 0; i < current->cfg->nrOfBlocks; i++ )
+    {
+        statement += current->cfg->blocks[i].nrOfNodes;
+    }
+    current->firstStatement = (int *) malloc( ( current->cfg->nrOfBlocks + 1 ) * sizeof( int ) );
+    current->firstEvent = (int *) malloc( ( statement + 1 ) * sizeof( int ) );
+    if( current->firstStatement == NULL || current->firstEvent == NULL ) BAILOUT( ERR_NOMEM );
+    for( i = statement = 0; i < current->cfg->nrOfBlocks; i++ )
+    {
+        block = &current->cfg->blocks[i];
+        current->firstStatement[i] = statement;
+        currentBlock = i;
+        for( j = 0; j < block->nrOfNodes; j++ )
+        {
+            current->firstEvent[statement++] = current->nrOfEvents;
+            Walk( block->nodes[j], FALSE );
+        }
+    }
+    current->firstStatement[i] = statement;
+    current->firstEvent[statement] = current->nrOfEvents;
+
+    /* The definitions of each variable, which an
+     * assignment to it kills. */
+    current->firstDefinitionOf = (int *) calloc( current->nrOfVariables + 1, sizeof( int ) );
+    current->definitionsOf = (int *) malloc( ( current->nrOfDefinitions + 1 ) * sizeof( int ) );
+    next = (int *) malloc( ( current->nrOfVariables + 1 ) * sizeof( int ) );
+    if( current->firstDefinitionOf == NULL || current->definitionsOf == NULL || next == NULL )
+    {
+        BAILOUT( ERR_NOMEM );
+    }
+    for( i = 0; i < current->nrOfDefinitions; i++ )
+    {
+        current->firstDefinitionOf[current->definitions[i].variable + 1]++;
+    }
+    for( i = 0; i < current->nrOfVariables; i++ )
+    {
+        current->firstDefinitionOf[i + 1] += current->firstDefinitionOf[i];
+        next[i] = current->firstDefinitionOf[i];
+    }
+    for( i = 0; i < current->nrOfDefinitions; i++ )
+    {
+        current->definitionsOf[next[current->definitions[i].variable]++] = i;
+    }
+    free( next );
+
+    current->words[DATAFLOW_LIVENESS] = WordsFor( current->nrOfVariables );
+    current->words[DATAFLOW_REACHING] = WordsFor( current->nrOfDefinitions );
+    return( current );
+}
+
+/* Removes the definitions of [variable] from [set],
+ * and adds them to [kill] unless it is NULL. */
+static void KillDefinitions( Dataflow *flow, int variable, unsigned int *set, unsigned int *kill )
+{
+    int i;
+
+    for( i = flow->firstDefinitionOf[variable]; i < flow->firstDefinitionOf[variable + 1]; i++ )
+    {
+        RemoveFromSet( set, flow->definitionsOf[i] );
+        if( kill != NULL ) AddToSet( kill, flow->definitionsOf[i] );
+    }
+}
+
+/* Sums up block [block] in [gen] and [kill]. */
+static void SumBlock( int block, unsigned int *gen, unsigned int *kill )
+{
+    Event *event;
+    int i;
+
+    /* Every variable is defined on entry, by definition
+     * [i] for variable [i]. */
+    if( block == CFG_ENTRY )
+    {
+        for( i = 0; i < current->nrOfVariables; i++ )
+        {
+            AddToSet( ( currentAnalysis == DATAFLOW_REACHING ) ? gen : kill, i );
+        }
+    }
+
+    for( i = current->firstEvent[current->firstStatement[block]];
+         i < current->firstEvent[current->firstStatement[block + 1]]; i++ )
+    {
+        event = &current->events[i];
+        if( currentAnalysis == DATAFLOW_LIVENESS )
+        {
+            if( event->kind == EVENT_USE && IN_SET( kill, event->variable ) == 0 )
+            {
+                AddToSet( gen, event->variable );
+            }
+            else if( event->kind == EVENT_DEFINE && event->conditional == FALSE )
+            {
+                AddToSet( kill, event->variable );
+            }
+        }
+        else if( event->kind == EVENT_DEFINE )
+        {
+            if( event->conditional == FALSE ) KillDefinitions( current, event->variable, gen, kill );
+            AddToSet( gen, event->definition );
+        }
+    }
+}
+
+/* Makes [set] the union of the [count] sets of blocks
+ * [blocks] in [facts]. Unreachable blocks have empty
+ * sets. */
+static void Meet( unsigned int *set, unsigned int **facts, int *blocks, int count )
+{
+    int words = current->words[currentAnalysis], i, j;
+
+    memset( set, 0, words * sizeof( unsigned int ) );
+    for( i = 0; i < count; i++ )
+    {
+        for( j = 0; j < words; j++ )
+        {
+            set[j] |= facts[blocks[i]][j];
+        }
+    }
+}
+
+/*
+ *  Solves [currentAnalysis] for [current] with a
+ *  worklist of blocks, which starts with all
+ *  reachable blocks in the order the facts flow.
+ */
+static void Solve()
+{
+    Cfg *cfg = current->cfg;
+    BasicBlock *b;
+    unsigned int **in, **out, **before, **after, *sets, *set;
+    BOOL *listed, backward = ( currentAnalysis == DATAFLOW_LIVENESS ), changed;
+    int *list, head, tail, words, block, i, j, k;
+
+    words = current->words[currentAnalysis];
+    in = (unsigned int **) malloc( cfg->nrOfBlocks * sizeof( unsigned int * ) );
+    out = (unsigned int **) malloc( cfg->nrOfBlocks * sizeof( unsigned int * ) );
+    list = (int *) malloc( cfg->nrOfBlocks * sizeof( int ) );
+    listed = (BOOL *) malloc( cfg->nrOfBlocks * sizeof( BOOL ) );
+    if( in == NULL || out == NULL || list == NULL || listed == NULL ) BAILOUT( ERR_NOMEM );
+    current->in[currentAnalysis] = in;
+    current->out[currentAnalysis] = out;
+
+    /* The in and out sets of all blocks share one
+     * allocation; the gen and kill sets of all blocks
+     * another, after which comes a spare set. */
+    set = NewSet( 2 * cfg->nrOfBlocks * words );
+    sets = NewSet( ( 2 * cfg->nrOfBlocks + 1 ) * words );
+    for( i = 0; i < cfg->nrOfBlocks; i++ )
+    {
+        in[i] = set + 2 * i * words;
+        out[i] = set + ( 2 * i + 1 ) * words;
+        listed[i] = FALSE;
+    }
+    before = backward ? out : in;
+    after = backward ? in : out;
+
+    for( i = 0; i < cfg->nrOfOrdered; i++ )
+    {
+        block = cfg->order[backward ? cfg->nrOfOrdered - 1 - i : i];
+        SumBlock( block, sets + 2 * block * words, sets + ( 2 * block + 1 ) * words );
+        list[i] = block;
+        listed[block] = TRUE;
+    }
+
+    /* The list is a ring of at most all reachable
+     * blocks. */
+    set = sets + 2 * cfg->nrOfBlocks * words;
+    head = 0;
+    tail = cfg->nrOfOrdered % cfg->nrOfBlocks;
+    for( j = cfg->nrOfOrdered; j > 0; j-- )
+    {
+        block = list[head];
+        head = ( head + 1 ) % cfg->nrOfBlocks;
+        listed[block] = FALSE;
+        b = &cfg->blocks[block];
+
+        if( backward )
+        {
+            Meet( before[block], in, b->successors, b->nrOfSuccessors );
+        }
+        else
+        {
+            Meet( before[block], out, b->predecessors, b->nrOfPredecessors );
+        }
+
+        /* set = gen + ( before - kill ) */
+        changed = FALSE;
+        for( k = 0; k < words; k++ )
+        {
+            set[k] = sets[2 * block * words + k]
+                | ( before[block][k] & ~sets[( 2 * block + 1 ) * words + k] );
+            if( set[k] != after[block][k] ) changed = TRUE;
+        }
+        if( changed == FALSE ) continue;
+        memcpy( after[block], set, words * sizeof( unsigned int ) );
+
+        /* The blocks the facts flow to are examined
+         * again. */
+        for( i = 0; i < ( backward ? b->nrOfPredecessors : b->nrOfSuccessors ); i++ )
+        {
+            block = backward ? b->predecessors[i] : b->successors[i];
+            if( listed[block] == TRUE || cfg->blocks[block].reachable == FALSE ) continue;
+            list[tail] = block;
+            tail = ( tail + 1 ) % cfg->nrOfBlocks;
+            listed[block] = TRUE;
+            j++;
+        }
+    }
+
+    free( sets );
+    free( list );
+    free( listed );
+}
+
+static void DestroyDataflow( Dataflow *flow )
+{
+    int i;
+
+    for( i = 0; i < NR_OF_ANALYSES; i++ )
+    {
+        if( flow->in[i] == NULL ) continue;
+        free( flow->in[i][0] );
+        free( flow->in[i] );
+        free( flow->out[i] );
+    }
+    ClearMap( &flow->names );
+    free( flow->variables );
+    free( flow->definitions );
+    free( flow->definitionsOf );
+    free( flow->firstDefinitionOf );
+    free( flow->events );
+    free( flow->firstStatement );
+    free( flow->firstEvent );
+    FreeCfg( flow->cfg );
+    free( flow );
+}
+
+/*************************************************
+ *                                               *
+ *  EXPORTED FUNCTION DEFINITIONS                *
+ *                                               *
+ *************************************************/
+
+int *FindInMap( IndexMap *map, void *key )
+{
+    unsigned int slot;
+
+    if( map->size == 0 ) return( NULL );
+    for( slot = Hash( map, key ) & ( map->size - 1 ); map->keys[slot] != NULL;
+         slot = ( slot + 1 ) & ( map->size - 1 ) )
+    {
+        if( IsKey( map, map->keys[slot], key ) == TRUE ) return( &map->values[slot] );
+    }
+    return( NULL );
+}
+
+void AddToMap( IndexMap *map, void *key, int value )
+{
+    void **keys = map->keys;
+    int *values = map->values, size = map->size, i;
+    unsigned int slot;
+
+    /* Keep at least half of the slots free. */
+    if( 2 * ( map->count + 1 ) > map->size )
+    {
+        map->size = ( size == 0 ) ? 16 : size * 2;
+        map->keys = (void **) calloc( map->size, sizeof( void * ) );
+        map->values = (int *) malloc( map->size * sizeof( int ) );
+        if( map->keys == NULL || map->values == NULL ) BAILOUT( ERR_NOMEM );
+        map->count = 0;
+        for( i = 0; i < size; i++ )
+        {
+            if( keys[i] != NULL ) AddToMap( map, keys[i], values[i] );
+        }
+        free( keys );
+        free( values );
+    }
+
+    for( slot = Hash( map, key ) & ( map->size - 1 ); map->keys[slot] != NULL;
+         slot = ( slot + 1 ) & ( map->size - 1 ) );
+    map->keys[slot] = key;
+    map->values[slot] = value;
+    map->count++;
+}
+
+void ClearMap( IndexMap *map )
+{
+    free( map->keys );
+    free( map->values );
+    map->keys = NULL;
+    map->values = NULL;
+    map->count = map->size = 0;
+}
+
+Dataflow *GetDataflow( TreeNode *node, Analysis analysis )
+{
+    int *index;
+
+    index = FindInMap( &functions, node );
+    if( index == NULL )
+    {
+        if( nrOfFlows == maxFlows )
+        {
+            maxFlows = ( maxFlows == 0 ) ? 16 : maxFlows * 2;
+            flows = (Dataflow **) realloc( flows, maxFlows * sizeof( Dataflow * ) );
+            if( flows == NULL ) BAILOUT( ERR_NOMEM );
+        }
+        flows[nrOfFlows] = NULL;
+        AddToMap( &functions, node, nrOfFlows++ );
+        index = FindInMap( &functions, node );
+    }
+    if( flows[*index] == NULL ) flows[*index] = CreateDataflow( node );
+
+    current = flows[*index];
+    currentAnalysis = analysis;
+    if( current->in[currentAnalysis] == NULL ) Solve();
+    return( current );
+}
+
+void InvalidateDataflow( TreeNode *node )
+{
+    int *index;
+
+    index = FindInMap( &functions, node );
+    if( index == NULL || flows[*index] == NULL ) return;
+    DestroyDataflow( flows[*index] );
+    flows[*index] = NULL;
+}
+
+void FreeDataflows( )
+{
+    int i;
+
+    for( i = 0; i < nrOfFlows; i++ )
+    {
+        if( flows[i] != NULL ) DestroyDataflow( flows[i] );
+    }
+    nrOfFlows = 0;
+    ClearMap( &functions );
+}
+
+int GetVariableIndex( Dataflow *flow, Symbol *symbol )
+{
+    int *index;
+
+    if( symbol == NULL ) return( -1 );
+    index = FindInMap( &flow->names, symbol->name );
+    if( index == NULL || *index < 0 || flow->variables[*index] != symbol ) return( -1 );
+    return( *index );
+}
+
+void StepDataflow( Dataflow *flow, Analysis analysis, int block, int statement, unsigned int *set )
+{
+    Event *event;
+    int first, last, i;
+
+    assert( flow->in[analysis] != NULL );
+
+    first = flow->firstEvent[flow->firstStatement[block] + statement];
+    last = flow->firstEvent[flow->firstStatement[block] + statement + 1];
+    if( analysis == DATAFLOW_LIVENESS )
+    {
+        /* Backward: a use makes a variable live before
+         * the statement, unless it is set first. */
+        for( i = last - 1; i >= first; i-- )
+        {
+            event = &flow->events[i];
+            if( event->kind == EVENT_USE )
+            {
+                AddToSet( set, event->variable );
+            }
+            else if( event->conditional == FALSE )
+            {
+                RemoveFromSet( set, event->variable );
+            }
+        }
+        return;
+    }
+
+    for( i = first; i < last; i++ )
+    {
+        event = &flow->events[i];
+        if( event->kind != EVENT_DEFINE ) continue;
+        if( event->conditional == FALSE ) KillDefinitions( flow, event->variable, set, NULL );
+        AddToSet( set, event->definition );
+    }
+}
+
+/*************************************************
+ *                                               *
+ *  TEST CODE                                    *
+ *                                               *
+ *************************************************/
+
+/* Program of the self-test: a loop that reads and
+ * sets two variables, and a variable set after it. */
+static char *dataflowTestProgram =
+    "module dataflowtest;\n"
+    "f: int x -> int\n"
+    "{\n"
+    "    int y = 0, z;\n"
+    "    while( x > 0 ) do\n"
+    "    {\n"
+    "        y = y + x;\n"
+    "        x = x - 1;\n"
+    "    }\n"
+    "    z = y * 2;\n"
+    "    return( z );\n"
+    "}\n";
+
+/* The facts of f: gen, kill, in and out of each
+ * reachable block, for liveness and then for reaching
+ * definitions (a definition is written as the
+ * variable and its block). */
+static char *dataflowTestFacts =
+    "0: { } { x y z } { } { x y }\n"
+    "1: { } { } { } { }\n"
+    "2: { } { } { x y } { x y }\n"
+    "3: { x } { } { x y } { x y }\n"
+    "4: { x y } { x y } { x y } { x y }\n"
+    "5: { y } { z } { y } { }\n"
+    "0: { x@0 y@0 z@0 } { } { } { x@0 y@0 z@0 }\n"
+    "1: { } { } { x@0 y@0 y@4 x@4 z@5 } { x@0 y@0 y@4 x@4 z@5 }\n"
+    "2: { } { } { x@0 y@0 z@0 } { x@0 y@0 z@0 }\n"
+    "3: { } { } { x@0 y@0 z@0 y@4 x@4 } { x@0 y@0 z@0 y@4 x@4 }\n"
+    "4: { y@4 x@4 } { x@0 y@0 y@4 x@4 } { x@0 y@0 z@0 y@4 x@4 } { z@0 y@4 x@4 }\n"
+    "5: { z@5 } { z@0 z@5 } { x@0 y@0 z@0 y@4 x@4 } { x@0 y@0 y@4 x@4 z@5 }\n";
+
+/* Writes the members of [set] of the current analysis
+ * to [buffer], and returns the length written. */
+static int PrintSet( char *buffer, unsigned int *set )
+{
+    Definition *definition;
+    int length = 0, i;
+
+    length += sprintf( buffer + length, " {" );
+    if( currentAnalysis == DATAFLOW_LIVENESS )
+    {
+        for( i = 0; i < current->nrOfVariables; i++ )
+        {
+            if( IN_SET( set, i ) ) length += sprintf( buffer + length, " %s", current->variables[i]->name );
+        }
+    }
+    else
+    {
+        for( i = 0; i < current->nrOfDefinitions; i++ )
+        {
+            if( IN_SET( set, i ) == 0 ) continue;
+            definition = &current->definitions[i];
+            length += sprintf( buffer + length, " %s@%d",
+                current->variables[definition->variable]->name, definition->block );
+        }
+    }
+    length += sprintf( buffer + length, " }" );
+    return( length );
+}
+
+BOOL TestDataflow()
+{
+    char actual[4096];
+    unsigned int *gen, *kill;
+    TreeNode *ast, *function;
+    Analysis analysis;
+    BOOL passed;
+    int length = 0, words, i;
+
+    printf( "Testing dataflow analyses...\n" );
+
+    ast = ParseTestProgram( dataflowTestProgram );
+    function = ( ast == NULL ) ? NULL : EnterTestFunction( ast, "f" );
+    if( function == NULL )
+    {
+        printf( "Dataflow test failed.\n\n" );
+        return( FALSE );
+    }
+
+    for( analysis = DATAFLOW_LIVENESS; analysis < NR_OF_ANALYSES; analysis++ )
+    {
+        GetDataflow( function, analysis );
+        words = current->words[analysis];
+        gen = NewSet( words );
+        kill = NewSet( words );
+        for( i = 0; i < current->cfg->nrOfBlocks && i < 16; i++ )
+        {
+            if( current->cfg->blocks[i].reachable == FALSE ) continue;
+            memset( gen, 0, words * sizeof( unsigned int ) );
+            memset( kill, 0, words * sizeof( unsigned int ) );
+            SumBlock( i, gen, kill );
+            length += sprintf( actual + length, "%d:", i );
+            length += PrintSet( actual + length, gen );
+            length += PrintSet( actual + length, kill );
+            length += PrintSet( actual + length, current->in[analysis][i] );
+            length += PrintSet( actual + length, current->out[analysis][i] );
+            length += sprintf( actual + length, "\n" );
+        }
+        free( gen );
+        free( kill );
+    }
+    ExitScope();
+    FreeDataflows();
+
+    printf( "%s", actual );
+    passed = ( strcmp( actual, dataflowTestFacts ) == 0 );
+
+    printf( "Dataflow test %s.\n\n", ( passed == TRUE ) ? "passed" : "failed" );
+    return( passed );
+}
@@ -0,0 +1,201 @@
+/*************************************************
+ *                                               *
+ *  Module: dataflow.h                           *
+ *  Description:                                 *
+ *      Interface to the dataflow analyses of    *
+ *      function bodies: liveness and reaching   *
+ *      definitions.                             *
+ *  Modifications:                               *
+ *                                               *
+ *************************************************
+ *                                               *
+ *   This program is free software; you can      *
+ *   redistribute it and/or modify  it under     *
+ *   the terms of the GNU General Public         *
+ *   License as published by the Free            *
+ *   Software Foundation; either version 2       *
+ *   of the License, or (at your option) any     *
+ *   later version.                              *
+ *                                               *
+ *************************************************/
+
+#ifndef DATAFLOW_H
+#define DATAFLOW_H
+
+#include "defs.h"
+#include "tree.h"
+#include "symtab.h"
+#include "cfg.h"
+
+/* Bits in a word of a set. */
+#define SET_WORD_BITS       ( 8 * sizeof( unsigned int ) )
+
+/* Checks whether [i] is in [set]. */
+#define IN_SET( set, i )    ( ( ( set )[( i ) / SET_WORD_BITS] >> ( ( i ) % SET_WORD_BITS ) ) & 1 )
+
+/* The analyses. Liveness runs backward, reaching
+ * definitions forward. */
+typedef enum
+{
+    DATAFLOW_LIVENESS = 0,      /* sets of variables */
+    DATAFLOW_REACHING,          /* sets of definitions */
+    NR_OF_ANALYSES
+} Analysis;
+
+/*
+ *  A definition of variable [variable]: assignment
+ *  [node] in block [block], or for the definitions
+ *  on entry, the declaration of the variable (NULL
+ *  for a parameter) in CFG_ENTRY.
+ */
+typedef struct Definition
+{
+    TreeNode *node;
+    int variable;
+    int block;
+} Definition;
+
+/*
+ *  What a statement does to a variable: identifier
+ *  [node] uses it, or assignment [node] sets it to
+ *  definition [definition]. A [conditional] event may
+ *  not happen when the statement runs.
+ */
+typedef enum
+{
+    EVENT_USE = 0,
+    EVENT_DEFINE
+} EventKind;
+
+typedef struct Event
+{
+    EventKind kind;
+    int variable;
+    int definition;
+    BOOL conditional;
+    TreeNode *node;
+} Event;
+
+/*
+ *  A hash of pointers, or of strings if [names], to
+ *  indices, which are never removed. [size] is 0 or a
+ *  power of two.
+ */
+typedef struct IndexMap
+{
+    void **keys;
+    int *values;
+    int count, size;
+    BOOL names;
+} IndexMap;
+
+/*
+ *  The dataflow facts of a function. The variables
+ *  are the local variables and parameters without
+ *  dimensions whose address is not taken; others
+ *  (globals, arrays) are not tracked and must be
+ *  assumed to be used and set anywhere. A function
+ *  has one scope, so the tracked variables are found
+ *  by name. Definition i
+ *  for i < nrOfVariables is variable i on entry.
+ *
+ *  The statements of the blocks are numbered one
+ *  after the other: statement j of block b is
+ *  firstStatement[b] + j. The events of statement k,
+ *  in the order they happen, are firstEvent[k] up to
+ *  firstEvent[k + 1]. Both arrays end with the total.
+ *
+ *  in[a][b] and out[a][b] are the facts of analysis a
+ *  at the start and end of block b (in control flow
+ *  order, also for liveness), or NULL while [a] has
+ *  not been solved. The sets of unreachable blocks
+ *  are empty.
+ */
+typedef struct Dataflow
+{
+    TreeNode *function;
+    Cfg *cfg;
+    Symbol **variables;
+    int nrOfVariables, maxVariables;
+    IndexMap names;                     /* to variables, or -1 */
+    Definition *definitions;
+    int nrOfDefinitions, maxDefinitions;
+    int *definitionsOf;                 /* of variable v: from */
+    int *firstDefinitionOf;             /* [v] up to [v + 1] */
+    Event *events;
+    int nrOfEvents, maxEvents;
+    int *firstStatement;
+    int *firstEvent;
+    int words[NR_OF_ANALYSES];          /* words in a set */
+    unsigned int **in[NR_OF_ANALYSES];
+    unsigned int **out[NR_OF_ANALYSES];
+} Dataflow;
+
+/*
+ *  Returns the dataflow facts of function [node] with
+ *  [analysis] solved. The facts are kept until
+ *  InvalidateDataflow or FreeDataflows is called, so
+ *  later queries cost nothing.
+ *
+ *  Pre: [node] is a NODE_FUNCTION with a block, and
+ *       its scope has been entered in the symbol
+ *       table.
+ */
+Dataflow *GetDataflow( TreeNode *node, Analysis analysis );
+
+/*
+ *  Drops the facts of function [node]. Must be called
+ *  when its body changes.
+ */
+void InvalidateDataflow( TreeNode *node );
+
+/*
+ *  Drops the facts of all functions.
+ */
+void FreeDataflows( );
+
+/*
+ *  Returns the index of [symbol] among the variables
+ *  of [flow], or -1 if it is not tracked.
+ */
+int GetVariableIndex( Dataflow *flow, Symbol *symbol );
+
+/*
+ *  Applies the effect of statement [statement] of
+ *  block [block] of [flow] to [set] of [analysis]:
+ *  for reaching definitions, [set] holds before the
+ *  statement and afterwards the facts after it; for
+ *  liveness the other way around. Blocks are walked
+ *  one statement at a time from in[] (backward from
+ *  out[] for liveness).
+ *
+ *  Pre: [analysis] has been solved for [flow].
+ */
+void StepDataflow( Dataflow *flow, Analysis analysis, int block, int statement, unsigned int *set );
+
+/*
+ *  Returns the value of [key] in [map], or NULL if it
+ *  is not there.
+ */
+int *FindInMap( IndexMap *map, void *key );
+
+/*
+ *  Adds [key], which is not in [map], with [value].
+ */
+void AddToMap( IndexMap *map, void *key, int value );
+
+/*
+ *  Frees the slots of [map] and leaves it empty.
+ */
+void ClearMap( IndexMap *map );
+
+/*
+ *  Tests the gen, kill, in and out sets of both
+ *  analyses on a small function.
+ *
+ *  Post: Returns TRUE if the test was successful,
+ *        FALSE if it failed.
+ */
+BOOL TestDataflow();
+
+#endif
@@ -218,6 +218,7 @@ void PrintReport()
         ListAppend( sortedReport, entry );
     }
     ListPurge( report, DeleteReportEntry );
+    report = NULL;
 
     /* Print sortedReport. */
     node = ListFirstEx( sortedReport );
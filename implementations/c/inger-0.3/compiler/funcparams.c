@@ -38,6 +38,8 @@
 /* Include for AddError() function. */
 #include "errors.h"
 
+#include "stats.h"
+
 extern int numErrors;
 List * headerlist;
 TreeNode *mainFunction;
@@ -45,6 +47,7 @@ TreeNode *mainFunction;
 BOOL CheckArgCount( TreeNode * ast )
 {
     headerlist = ListInit( NULL );
+    mainFunction = NULL;
 
     /* Get a list of all function headers */
     CheckFunctionHeader( ast );
@@ -153,6 +156,7 @@ int GetArgumentCount( char * functionName )
     while( listNode != NULL  )
     {
         headerNode = (TreeNode *) listNode->data;
+	STAT_COUNT( STAT_STRCMP );
 	if( strcmp( functionName, GetNameFromHeader( headerNode ) ) == 0 )
 	{
 	    return( GetParamCountFromHeader( headerNode ) );
@@ -69,6 +69,10 @@ void ProcessDeclaration( TreeNode *node )
     {
         AddDimension( type, GetDimensionSizeFromDecl( node, i ) );
     }
+
+    /* A pointer holds an address; an array holds its
+     * elements. */
+    symbol->reference = ( TOAST( GetTreeChild( node, 1 ) )->val.uintvalue > 0 );
     
     /* Add the type to the symbol */
     AddType( symbol, type );
@@ -187,11 +191,13 @@ void ProcessParameters( TreeNode *node )
         type = CreateType();
         AddSimpleType( type, NodeToSimpleType( GetParamTypeFromHeader(node, i) ) );
 
-        /* Determine the dimensioning. */
+        /* Determine the dimensioning. An array is passed
+         * by its address. */
         for( j = 0; j < GetParamDimensionsFromHeader( node, i ); j++ )
         {
             AddDimension( type, 1 );
         }
+        symbol->reference = ( GetParamDimensionsFromHeader( node, i ) > 0 );
 
         /* Add the type to the symbol. */
         AddType( symbol, type );
@@ -280,6 +286,7 @@ void GetSymbols( TreeNode *node )
 void CreateSymbolTable( TreeNode *ast )
 {
     /* Clear the symbol table and perform intialization. */
+    PurgeSymbolTable();
     InitSymbolTable();
 
     /* Gather all symbols from the AST. */
@@ -37,5 +37,14 @@
  */
 extern void CreateSymbolTable( TreeNode *ast  );
 
+/*
+ *  Creates a symbol from a variable declaration and
+ *  adds it to the current scope.
+ *
+ *  Pre: [node] is a valid 'declaration' node
+ *       in the Abstract Syntax Tree.
+ */
+extern void ProcessDeclaration( TreeNode *node );
+
 
 #endif
@@ -0,0 +1,549 @@
+/*************************************************
+ *                                               *
+ *  Module: induction.c                          *
+ *  Description:                                 *
+ *      Array elements reached through           *
+ *      pointers that follow induction           *
+ *      variables.                               *
+ *  Modifications:                               *
+ *                                               *
+ *************************************************
+ *                                               *
+ *   This program is free software; you can      *
+ *   redistribute it and/or modify  it under     *
+ *   the terms of the GNU General Public         *
+ *   License as published by the Free            *
+ *   Software Foundation; either version 2       *
+ *   of the License, or (at your option) any     *
+ *   later version.                              *
+ *                                               *
+ *************************************************/
+
+/*
+ *  At -O1, an element that a loop indexes with an
+ *  induction variable (a local in a register that the
+ *  loop only steps by a constant, or by an invariant
+ *  variable in a register) is reached through a
+ *  pointer in a register instead: the pointer is set
+ *  before the loop and moved wherever the variable is
+ *  stepped, so an access takes no index arithmetic.
+ *  The other indexes must be loop invariant. Elements
+ *  that differ only in constants added to their
+ *  indexes share a pointer. This is only done when it
+ *  saves work: an i386 element indexed by the variable
+ *  alone is already a single scaled access.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "defs.h"
+#include "nodenames.h"
+#include "symtab.h"
+#include "ast.h"
+#include "asm.h"
+#include "errors.h"
+#include "options.h"
+#include "codegen.h"
+#include "selftest.h"
+#include "induction.h"
+
+/*************************************************
+ *                                               *
+ *  GLOBALS                                      *
+ *                                               *
+ *************************************************/
+
+/* Reductions of the loops being generated; the
+ * innermost loop's come last. */
+static Reduction *g_reductions = NULL;
+static int g_nrOfReductions, g_maxReductions;
+
+/*************************************************
+ *                                               *
+ *  STATIC FUNCTION DEFINITIONS                  *
+ *                                               *
+ *************************************************/
+
+/*
+ * Checks whether indexer [node] is an element of
+ * [reduction]: it has the induction variable in the
+ * same index, and the same expressions in the other
+ * indexes, up to constants.
+ */
+static BOOL IsReducedElement( Reduction *reduction, TreeNode *node )
+{
+    TreeNode *element;
+    int offset, i;
+
+    element = reduction->element;
+    i = CountIndexes( node );
+    if( i != CountIndexes( element )
+        || FindSymbol( GetNameOfIdentifier( GetIndexedVariable( node ) ) ) != reduction->array )
+    {
+        return( FALSE );
+    }
+    for( i--; i >= 0; i--, node = GetTreeChild( node, 0 ), element = GetTreeChild( element, 0 ) )
+    {
+        if( i == reduction->position )
+        {
+            if( IsVariable( SplitIndex( GetTreeChild( node, 1 ), &offset ), reduction->variable ) == FALSE )
+            {
+                return( FALSE );
+            }
+        }
+        else if( IsSameExpression( SplitIndex( GetTreeChild( node, 1 ), &offset ),
+                                   SplitIndex( GetTreeChild( element, 1 ), &offset ) ) == FALSE )
+        {
+            return( FALSE );
+        }
+    }
+    return( TRUE );
+}
+
+/* Checks whether [node] assigns to variable
+ * [symbol]. */
+static BOOL IsAssignedIn( TreeNode *node, Symbol *symbol )
+{
+    ListNode *child;
+
+    if( TOAST( node )->id == NODE_ASSIGN && IsVariable( GetTreeChild( node, 0 ), symbol ) == TRUE )
+    {
+        return( TRUE );
+    }
+    for( child = ListFirstEx( node->children ); child != NULL; child = ListNextEx( child ) )
+    {
+        if( IsAssignedIn( (TreeNode *) child->data, symbol ) == TRUE ) return( TRUE );
+    }
+    return( FALSE );
+}
+
+/*
+ * Checks whether int expression [node] has the same
+ * value throughout [loop]: it is made of literals and
+ * locals that [loop] does not assign to.
+ */
+static BOOL IsInvariant( TreeNode *node, TreeNode *loop )
+{
+    Symbol *symbol;
+    ListNode *child;
+
+    switch( TOAST( node )->id )
+    {
+    case NODE_LIT_INT:
+        return( TRUE );
+    case NODE_LIT_IDENTIFIER:
+        symbol = FindSymbol( GetNameOfIdentifier( node ) );
+        return( symbol->global == FALSE && IsAddress( node ) == FALSE
+                && IsAssignedIn( loop, symbol ) == FALSE );
+    case NODE_BINARY_ADD:
+    case NODE_BINARY_SUBTRACT:
+    case NODE_MULTIPLY:
+    case NODE_UNARY_SUBTRACT:
+        for( child = ListFirstEx( node->children ); child != NULL; child = ListNextEx( child ) )
+        {
+            if( IsInvariant( (TreeNode *) child->data, loop ) == FALSE ) return( FALSE );
+        }
+        return( TRUE );
+    }
+    return( FALSE );
+}
+
+/*
+ * Checks whether every assignment to [symbol] in
+ * [node] is a step by a constant, or by a variable in
+ * a register that [loop] does not assign to. Sets
+ * [variableStep] if there is a step by a variable.
+ */
+static BOOL CheckInductionSteps( TreeNode *node, Symbol *symbol, TreeNode *loop, BOOL *variableStep )
+{
+    ListNode *child;
+    Symbol *step;
+    int constant;
+
+    if( TOAST( node )->id == NODE_ASSIGN && IsVariable( GetTreeChild( node, 0 ), symbol ) == TRUE )
+    {
+        if( GetInductionStep( node, &constant, &step ) == FALSE ) return( FALSE );
+        if( step != NULL )
+        {
+            if( step == symbol || step->global == TRUE || step->reg == REG_NONE
+                || IsAssignedIn( loop, step ) == TRUE )
+            {
+                return( FALSE );
+            }
+            *variableStep = TRUE;
+        }
+    }
+    for( child = ListFirstEx( node->children ); child != NULL; child = ListNextEx( child ) )
+    {
+        if( CheckInductionSteps( (TreeNode *) child->data, symbol, loop, variableStep ) == FALSE )
+        {
+            return( FALSE );
+        }
+    }
+    return( TRUE );
+}
+
+/*
+ * Checks whether [symbol] is an induction variable of
+ * while loop [loop]: an int in a register that the
+ * body steps, and the condition does not assign to.
+ */
+static BOOL IsInductionVariable( Symbol *symbol, TreeNode *loop, BOOL *variableStep )
+{
+    Type *type;
+
+    type = GetSymbolType( symbol->name );
+    *variableStep = FALSE;
+    return( symbol->global == FALSE && symbol->reg != REG_NONE && GetSimpleType( type ) == INT
+            && ListSize( type->dimensions ) == 0
+            && IsAssignedIn( GetExpressionFromWhile( loop ), symbol ) == FALSE
+            && IsAssignedIn( GetBlockFromWhile( loop ), symbol ) == TRUE
+            && CheckInductionSteps( GetBlockFromWhile( loop ), symbol, loop, variableStep ) == TRUE );
+}
+
+/*
+ * Adds element [node] of [loop] to the reductions
+ * after g_nrOfReductions, of which there are [count],
+ * if it is indexed by an induction variable.
+ */
+static void AddReduction( TreeNode *node, TreeNode *loop, int *count )
+{
+    TreeNode *indexer, *index;
+    Symbol *symbol, *variable = NULL;
+    Reduction *reduction;
+    int position = 0, step, offset, scale, i;
+    BOOL variableStep, stepped = FALSE;
+
+    symbol = FindSymbol( GetNameOfIdentifier( GetIndexedVariable( node ) ) );
+    if( symbol->reference == TRUE && ListSize( GetSymbolType( symbol->name )->dimensions ) > 1 ) return;
+    if( symbol->reference == FALSE && GetIndexRegister( symbol, node, &scale ) != REG_NONE ) return;
+
+    /* One index holds the variable, the others must be
+     * invariant. */
+    indexer = node;
+    for( i = CountIndexes( node ) - 1; i >= 0; i--, indexer = GetTreeChild( indexer, 0 ) )
+    {
+        index = SplitIndex( GetTreeChild( indexer, 1 ), &offset );
+        if( index == NULL || IsInvariant( index, loop ) == TRUE ) continue;
+        if( variable != NULL || TOAST( index )->id != NODE_LIT_IDENTIFIER ) return;
+        variable = FindSymbol( GetNameOfIdentifier( index ) );
+        if( IsInductionVariable( variable, loop, &variableStep ) == FALSE ) return;
+        stepped = variableStep;
+        position = i;
+    }
+    if( variable == NULL ) return;
+
+    /* A step by a variable is taken with lea. */
+    step = GetStride( symbol, position ) * GetElementSize( TOAST( node )->type );
+    if( stepped == TRUE && ( GetLog2( step ) < 0 || GetLog2( step ) > 3 ) ) return;
+
+    for( i = g_nrOfReductions; i < g_nrOfReductions + *count; i++ )
+    {
+        if( IsReducedElement( &g_reductions[i], node ) == TRUE ) return;
+    }
+
+    if( g_nrOfReductions + *count == g_maxReductions )
+    {
+        g_maxReductions = ( g_maxReductions == 0 ) ? 8 : g_maxReductions * 2;
+        g_reductions = (Reduction *) realloc( g_reductions, g_maxReductions * sizeof( Reduction ) );
+        if( g_reductions == NULL ) BAILOUT( ERR_NOMEM );
+    }
+    reduction = &g_reductions[g_nrOfReductions + ( *count )++];
+    reduction->array = symbol;
+    reduction->variable = variable;
+    reduction->position = position;
+    reduction->element = node;
+    reduction->reg = REG_NONE;
+    reduction->step = step;
+}
+
+/* Adds the elements in [node], part of [loop], to the
+ * reductions (see AddReduction). */
+static void CollectReductions( TreeNode *node, TreeNode *loop, int *count )
+{
+    ListNode *child;
+
+    if( TOAST( node )->id == NODE_INDEXER )
+    {
+        if( IsAddress( node ) == FALSE ) AddReduction( node, loop, count );
+        for( ; TOAST( node )->id == NODE_INDEXER; node = GetTreeChild( node, 0 ) )
+        {
+            CollectReductions( GetTreeChild( node, 1 ), loop, count );
+        }
+        return;
+    }
+    for( child = ListFirstEx( node->children ); child != NULL; child = ListNextEx( child ) )
+    {
+        CollectReductions( (TreeNode *) child->data, loop, count );
+    }
+}
+
+/*************************************************
+ *                                               *
+ *  EXPORTED FUNCTION DEFINITIONS                *
+ *                                               *
+ *************************************************/
+
+/*
+ * Checks whether assignment [node] steps the variable
+ * it assigns to: v = v + c, v = v - c or v = v + w.
+ * Stores c in [constant] and w in [step], or NULL.
+ */
+BOOL GetInductionStep( TreeNode *node, int *constant, Symbol **step )
+{
+    TreeNode *left, *right;
+    Symbol *symbol;
+
+    symbol = FindSymbol( GetNameOfIdentifier( GetTreeChild( node, 0 ) ) );
+    node = GetTreeChild( node, 1 );
+    if( TOAST( node )->id != NODE_BINARY_ADD && TOAST( node )->id != NODE_BINARY_SUBTRACT )
+    {
+        return( FALSE );
+    }
+    left = GetTreeChild( node, 0 );
+    right = GetTreeChild( node, 1 );
+    if( TOAST( node )->id == NODE_BINARY_ADD && IsVariable( right, symbol ) == TRUE )
+    {
+        right = left;
+        left = GetTreeChild( node, 1 );
+    }
+    if( IsVariable( left, symbol ) == FALSE ) return( FALSE );
+
+    *step = NULL;
+    if( GetIntConstant( right, constant ) == TRUE )
+    {
+        if( TOAST( node )->id == NODE_BINARY_SUBTRACT ) *constant = -*constant;
+        return( TRUE );
+    }
+    if( TOAST( node )->id == NODE_BINARY_ADD && TOAST( right )->id == NODE_LIT_IDENTIFIER )
+    {
+        *constant = 0;
+        *step = FindSymbol( GetNameOfIdentifier( right ) );
+        return( TRUE );
+    }
+    return( FALSE );
+}
+
+/* Returns the reduction that indexer [node] is an
+ * element of, or NULL. */
+Reduction *FindReduction( TreeNode *node )
+{
+    int i;
+
+    for( i = g_nrOfReductions - 1; i >= 0; i-- )
+    {
+        if( IsReducedElement( &g_reductions[i], node ) == TRUE ) return( &g_reductions[i] );
+    }
+    return( NULL );
+}
+
+/* Checks whether the pointers of the loops being
+ * generated follow variable [symbol]. */
+BOOL IsReducedVariable( Symbol *symbol )
+{
+    int i;
+
+    for( i = 0; i < g_nrOfReductions; i++ )
+    {
+        if( g_reductions[i].variable == symbol ) return( TRUE );
+    }
+    return( FALSE );
+}
+
+/*
+ * Sets up the pointers for the elements of while
+ * loop [node] that are indexed by an induction
+ * variable, before its first iteration. Returns the
+ * first reduction, for EndReductions.
+ */
+int StartReductions( TreeNode *node )
+{
+    Reduction *reduction;
+    Operand operand;
+    unsigned int fixed;
+    int first, count = 0, i;
+
+    first = g_nrOfReductions;
+    CollectReductions( GetBlockFromWhile( node ), node, &count );
+    fixed = GetFixedRegisters( node );
+    for( i = first; i < first + count; i++ )
+    {
+        reduction = &g_reductions[i];
+        reduction->reg = AllocatePointerRegister( fixed );
+        if( reduction->reg == REG_NONE ) break;
+        operand = GenerateElementOperand( reduction->element, reduction->reg );
+        if( operand.base != reduction->reg || operand.index != REG_NONE || operand.value != 0 )
+        {
+            AsmEmit2( ASM_LEA, WORD_SIZE, operand, AsmReg( reduction->reg ) );
+        }
+    }
+    g_nrOfReductions = i;
+    return( first );
+}
+
+void EndReductions( int first )
+{
+    for( ; g_nrOfReductions > first; g_nrOfReductions-- )
+    {
+        FreeRegister( g_reductions[g_nrOfReductions - 1].reg );
+    }
+}
+
+/*
+ * Moves the pointers that follow the variable that
+ * assignment [node] steps.
+ */
+void GenerateReductionSteps( TreeNode *node )
+{
+    Reduction *reduction;
+    Symbol *symbol, *step;
+    int constant, temp, i;
+    BOOL saved;
+
+    symbol = FindSymbol( GetNameOfIdentifier( GetTreeChild( node, 0 ) ) );
+    for( i = 0; i < g_nrOfReductions; i++ )
+    {
+        reduction = &g_reductions[i];
+        if( reduction->variable != symbol ) continue;
+        GetInductionStep( node, &constant, &step );
+        if( step == NULL )
+        {
+            if( constant != 0 )
+            {
+                AsmEmit2( ASM_ADD, WORD_SIZE, AsmImm( (long) constant * reduction->step ),
+                          AsmReg( reduction->reg ) );
+            }
+        }
+        else if( WORD_SIZE == 8 )
+        {
+            temp = BorrowRegister( REG_NONE, &saved );
+            AsmEmit2( ASM_MOVSLQ, 8, AsmReg( step->reg ), AsmReg( temp ) );
+            AsmEmit2( ASM_LEA, 8, AsmMemIndex( reduction->reg, temp, reduction->step, 0 ),
+                      AsmReg( reduction->reg ) );
+            ReturnRegister( temp, saved );
+        }
+        else
+        {
+            AsmEmit2( ASM_LEA, 4, AsmMemIndex( reduction->reg, step->reg, reduction->step, 0 ),
+                      AsmReg( reduction->reg ) );
+        }
+    }
+}
+
+/*************************************************
+ *                                               *
+ *  TEST CODE                                    *
+ *                                               *
+ *************************************************/
+
+/*
+ *  A loop of the self-test, compiled at -O1 for
+ *  [target], and the code expected from the setup of
+ *  the pointers through the step of the variable.
+ */
+typedef struct InductionTest
+{
+    char *name;
+    char *source;
+    int target;
+    char *expected;
+} InductionTest;
+
+static InductionTest inductionTests[] =
+{
+    { "a[i] and a[i + 1] share a pointer",
+      "module inductiontest;\n"
+      "int a[100];\n"
+      "sum: int n -> int\n"
+      "{\n"
+      "    int i = 0, s = 0;\n"
+      "    while( i < n ) do\n"
+      "    {\n"
+      "        s = s + a[i] * a[i + 1];\n"
+      "        i = i + 1;\n"
+      "    }\n"
+      "    return( s );\n"
+      "}\n",
+      TARGET_X86_64,
+      "\tleaq\ta(,%rsi,4), %rsi\n\t.p2align 4,,7\n.L5:\n"
+      "\tmovl\t(%rsi), %edi\n\timull\t4(%rsi), %edi\n\taddl\t%edi, %r13d\n"
+      "\taddl\t$1, %r12d\n\taddq\t$4, %rsi\n" },
+    { "i386: a[i] stays a scaled access",
+      "module inductiontest;\n"
+      "int a[100];\n"
+      "sum: int n -> int\n"
+      "{\n"
+      "    int i = 0, s = 0;\n"
+      "    while( i < n ) do\n"
+      "    {\n"
+      "        s = s + a[i] * a[i + 1];\n"
+      "        i = i + 1;\n"
+      "    }\n"
+      "    return( s );\n"
+      "}\n",
+      TARGET_I386,
+      "\t.p2align 4,,7\n.L5:\n"
+      "\tmovl\ta(,%esi,4), %ecx\n\timull\ta+4(,%esi,4), %ecx\n\taddl\t%ecx, %edi\n"
+      "\taddl\t$1, %esi\n\tcmpl\t%ebx, %esi\n" },
+    { "i386: m[k][i] stepped by 2",
+      "module inductiontest;\n"
+      "int m[10][100];\n"
+      "row: int k -> int\n"
+      "{\n"
+      "    int i = 0, s = 0;\n"
+      "    while( i < 100 ) do\n"
+      "    {\n"
+      "        s = s + m[k][i];\n"
+      "        i = i + 2;\n"
+      "    }\n"
+      "    return( s );\n"
+      "}\n",
+      TARGET_I386,
+      "\tleal\tm(,%edx,4), %edx\n\t.p2align 4,,7\n.L5:\n"
+      "\taddl\t(%edx), %edi\n\taddl\t$2, %esi\n\taddl\t$8, %edx\n" },
+    { "a[i] stepped by an invariant",
+      "module inductiontest;\n"
+      "int a[100];\n"
+      "fill: int d -> void\n"
+      "{\n"
+      "    int i = 0;\n"
+      "    while( i < 100 ) do\n"
+      "    {\n"
+      "        a[i] = d;\n"
+      "        i = i + d;\n"
+      "    }\n"
+      "}\n",
+      TARGET_X86_64,
+      "\tleaq\ta(,%rsi,4), %rsi\n\t.p2align 4,,7\n.L5:\n"
+      "\tmovl\t%ebx, %r8d\n\tmovl\t%r8d, (%rsi)\n"
+      "\tmovl\t%r12d, %eax\n\taddl\t%ebx, %eax\n\tmovl\t%eax, %r12d\n"
+      "\tmovslq\t%ebx, %rdi\n\tleaq\t(%rsi,%rdi,4), %rsi\n" }
+};
+
+BOOL TestInductionVariables()
+{
+    char *text;
+    BOOL passed = TRUE;
+    int i;
+
+    printf( "Testing induction variables...\n" );
+
+    for( i = 0; i < sizeof( inductionTests ) / sizeof( InductionTest ); i++ )
+    {
+        text = CompileTestProgram( inductionTests[i].source, inductionTests[i].target, 1 );
+        if( text != NULL && strstr( text, inductionTests[i].expected ) != NULL )
+        {
+            printf( "%s: ok\n", inductionTests[i].name );
+        }
+        else
+        {
+            printf( "%s: FAILED, got\n%s", inductionTests[i].name, ( text != NULL ) ? text : "errors\n" );
+            passed = FALSE;
+        }
+        free( text );
+    }
+
+    printf( "Induction variable test %s.\n\n", ( passed == TRUE ) ? "passed" : "failed" );
+    return( passed );
+}
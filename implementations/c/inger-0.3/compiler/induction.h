@@ -0,0 +1,88 @@
+/*************************************************
+ *                                               *
+ *  Module: induction.h                          *
+ *  Description:                                 *
+ *      Interface to the pointers that follow    *
+ *      induction variables in loops.            *
+ *  Modifications:                               *
+ *                                               *
+ *************************************************
+ *                                               *
+ *   This program is free software; you can      *
+ *   redistribute it and/or modify  it under     *
+ *   the terms of the GNU General Public         *
+ *   License as published by the Free            *
+ *   Software Foundation; either version 2       *
+ *   of the License, or (at your option) any     *
+ *   later version.                              *
+ *                                               *
+ *************************************************/
+
+#ifndef INDUCTION_H
+#define INDUCTION_H
+
+#include "tree.h"
+#include "symtab.h"
+
+/* Array elements of a loop that are reached through a
+ * pointer in a register, which moves along with the
+ * induction variable in one of the indexes. */
+typedef struct Reduction
+{
+    Symbol *array;
+    Symbol *variable;       /* the induction variable */
+    int position;           /* the index it is in */
+    TreeNode *element;      /* the element the pointer is at */
+    int reg;                /* the pointer */
+    int step;               /* bytes per unit of the variable */
+} Reduction;
+
+/*
+ *  Sets up the pointers for the elements of while
+ *  loop [node] that are indexed by an induction
+ *  variable, before its first iteration. Returns the
+ *  first reduction, to pass to EndReductions after
+ *  the loop.
+ */
+int StartReductions( TreeNode *node );
+void EndReductions( int first );
+
+/*
+ *  Moves the pointers that follow the variable that
+ *  assignment [node] steps.
+ */
+void GenerateReductionSteps( TreeNode *node );
+
+/*
+ *  Checks whether assignment [node] steps the
+ *  variable it assigns to: v = v + c, v = v - c or
+ *  v = v + w. Stores c in [constant] and w in [step],
+ *  or NULL.
+ */
+BOOL GetInductionStep( TreeNode *node, int *constant, Symbol **step );
+
+/*
+ *  Returns the reduction that indexer [node] is an
+ *  element of, or NULL.
+ */
+Reduction *FindReduction( TreeNode *node );
+
+/*
+ *  Checks whether the pointers of the loops being
+ *  generated follow variable [symbol].
+ */
+BOOL IsReducedVariable( Symbol *symbol );
+
+/*
+ *  Tests the pointers set up for elements indexed by
+ *  an induction variable, shared by neighbouring
+ *  elements and stepped by a constant or an invariant
+ *  variable, and that an i386 element indexed by the
+ *  variable alone keeps its scaled access.
+ *
+ *  Post: Returns TRUE if the test was successful,
+ *        FALSE if it failed.
+ */
+BOOL TestInductionVariables();
+
+#endif
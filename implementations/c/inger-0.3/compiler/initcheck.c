@@ -0,0 +1,221 @@
+/*************************************************
+ *                                               *
+ *  Module: initcheck.c                          *
+ *  Description:                                 *
+ *      Check for variables used before they     *
+ *      are set, on reaching definitions.        *
+ *  Modifications:                               *
+ *                                               *
+ *************************************************
+ *                                               *
+ *   This program is free software; you can      *
+ *   redistribute it and/or modify  it under     *
+ *   the terms of the GNU General Public         *
+ *   License as published by the Free            *
+ *   Software Foundation; either version 2       *
+ *   of the License, or (at your option) any     *
+ *   later version.                              *
+ *                                               *
+ *************************************************/
+
+/*
+ *  Locals declared without an initializer hold
+ *  whatever was on the stack. The definition of such
+ *  a variable on entry stands for that value, so a
+ *  use that it reaches may read it.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "defs.h"
+#include "nodenames.h"
+#include "symtab.h"
+#include "ast.h"
+#include "errors.h"
+#include "dataflow.h"
+#include "selftest.h"
+#include "initcheck.h"
+
+/*************************************************
+ *                                               *
+ *  TYPES                                        *
+ *                                               *
+ *************************************************/
+
+/* The body of a function f: int x -> int, and the
+ * number of warnings expected for it. */
+typedef struct InitTest
+{
+    char *name;
+    char *body;
+    int warnings;
+} InitTest;
+
+/*************************************************
+ *                                               *
+ *  GLOBALS                                      *
+ *                                               *
+ *************************************************/
+
+/* The function being checked, and the definitions
+ * that reach the statement being checked. */
+static Dataflow *flow;
+static unsigned int *reaching;
+
+/* Variables already warned about. */
+static BOOL *warned = NULL;
+
+/* Cases of the self-test. */
+static InitTest initTests[] =
+{
+    { "set on one path",
+      "int y; if( x > 0 ) { y = 1; } return( y );", 1 },
+    { "set on both paths",
+      "int y; if( x > 0 ) { y = 1; } else { y = 2; } return( y );", 0 },
+    { "set in a loop",
+      "int y, i = 0; while( i < x ) do { y = i; i = i + 1; } return( y );", 1 },
+    { "set before a loop",
+      "int y; y = 0; while( y < x ) do { y = y + 1; } return( y );", 0 },
+    { "initialized",
+      "int y = 3; return( y + x );", 0 },
+    { "never set, used twice",
+      "int y; x = y; return( y );", 1 },
+    { "parameter",
+      "return( x );", 0 }
+};
+
+/*************************************************
+ *                                               *
+ *  STATIC FUNCTION DEFINITIONS                  *
+ *                                               *
+ *************************************************/
+
+/* Warns about use [event] if the variable may not be
+ * set. */
+static void CheckUse( Event *event )
+{
+    TreeNode *declaration;
+    char warning[255];
+    int variable = event->variable;
+
+    if( event->kind != EVENT_USE || warned[variable] == TRUE || IN_SET( reaching, variable ) == 0 )
+    {
+        return;
+    }
+
+    /* Parameters have no declaration. */
+    declaration = flow->definitions[variable].node;
+    if( declaration == NULL || GetInitializerFromDecl( declaration ) != NULL ) return;
+
+    sprintf( warning, "`%.200s' may be used before it is set", GetNameOfIdentifier( event->node ) );
+    AddWarning( warning, TOAST( event->node )->lineno );
+    warned[variable] = TRUE;
+}
+
+static void CheckFunction( TreeNode *node )
+{
+    BasicBlock *block;
+    int words, statement, i, j, k;
+
+    flow = GetDataflow( node, DATAFLOW_REACHING );
+    words = flow->words[DATAFLOW_REACHING];
+    reaching = (unsigned int *) malloc( words * sizeof( unsigned int ) );
+    warned = (BOOL *) realloc( warned, ( flow->nrOfVariables + 1 ) * sizeof( BOOL ) );
+    if( reaching == NULL || warned == NULL ) BAILOUT( ERR_NOMEM );
+    for( i = 0; i < flow->nrOfVariables; i++ )
+    {
+        warned[i] = FALSE;
+    }
+
+    /* The blocks were made in the order of the source,
+     * so the first use of a variable is warned about. */
+    for( i = 0; i < flow->cfg->nrOfBlocks; i++ )
+    {
+        block = &flow->cfg->blocks[i];
+        if( block->reachable == FALSE ) continue;
+        memcpy( reaching, flow->in[DATAFLOW_REACHING][i], words * sizeof( unsigned int ) );
+        for( j = 0; j < block->nrOfNodes; j++ )
+        {
+            statement = flow->firstStatement[i] + j;
+            for( k = flow->firstEvent[statement]; k < flow->firstEvent[statement + 1]; k++ )
+            {
+                CheckUse( &flow->events[k] );
+            }
+            StepDataflow( flow, DATAFLOW_REACHING, i, j, reaching );
+        }
+    }
+
+    free( reaching );
+}
+
+/* Checks the functions in [node], entering their
+ * scopes in order. */
+static void CheckFunctions( TreeNode *node )
+{
+    ListNode *child;
+
+    if( TOAST( node )->id == NODE_FUNCTION )
+    {
+        if( GetBlockFromFunction( node ) == NULL ) return;
+        EnterScope();
+        CheckFunction( node );
+        ExitScope();
+        return;
+    }
+
+    for( child = ListFirstEx( node->children ); child != NULL; child = ListNextEx( child ) )
+    {
+        CheckFunctions( (TreeNode *) child->data );
+    }
+}
+
+/*************************************************
+ *                                               *
+ *  EXPORTED FUNCTION DEFINITIONS                *
+ *                                               *
+ *************************************************/
+
+void CheckInitialization( TreeNode *node )
+{
+    GotoSymbolRoot();
+    CheckFunctions( node );
+}
+
+BOOL TestInitialization()
+{
+    char source[256];
+    TreeNode *ast;
+    BOOL passed = TRUE;
+    int warnings, i;
+
+    printf( "Testing the initialization check...\n" );
+
+    for( i = 0; i < sizeof( initTests ) / sizeof( InitTest ); i++ )
+    {
+        sprintf( source, "module initchecktest;\nf: int x -> int\n{\n%s\n}\n", initTests[i].body );
+        ast = ParseTestProgram( source );
+        if( ast == NULL )
+        {
+            printf( "%s: FAILED, not compiled\n", initTests[i].name );
+            passed = FALSE;
+            continue;
+        }
+
+        warnings = GetWarningCount();
+        CheckInitialization( ast );
+        warnings = GetWarningCount() - warnings;
+        FreeDataflows();
+
+        printf( "%s: warnings %d", initTests[i].name, warnings );
+        if( warnings != initTests[i].warnings )
+        {
+            printf( ", FAILED" );
+            passed = FALSE;
+        }
+        printf( "\n" );
+    }
+
+    printf( "Initialization check test %s.\n\n", ( passed == TRUE ) ? "passed" : "failed" );
+    return( passed );
+}
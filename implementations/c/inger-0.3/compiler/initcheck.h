@@ -0,0 +1,45 @@
+/*************************************************
+ *                                               *
+ *  Module: initcheck.h                          *
+ *  Description:                                 *
+ *      Interface to the check for variables     *
+ *      used before they are set.                *
+ *  Modifications:                               *
+ *                                               *
+ *************************************************
+ *                                               *
+ *   This program is free software; you can      *
+ *   redistribute it and/or modify  it under     *
+ *   the terms of the GNU General Public         *
+ *   License as published by the Free            *
+ *   Software Foundation; either version 2       *
+ *   of the License, or (at your option) any     *
+ *   later version.                              *
+ *                                               *
+ *************************************************/
+
+#ifndef INITCHECK_H
+#define INITCHECK_H
+
+#include "tree.h"
+
+/*
+ *  Warns about each local variable in the functions
+ *  of module [node] that is declared without an
+ *  initializer and may be used before a value is
+ *  assigned to it, once per variable.
+ *
+ *  Pre: the symbol table has been created.
+ */
+void CheckInitialization( TreeNode *node );
+
+/*
+ *  Tests the check on small functions that set a
+ *  variable on some or all paths.
+ *
+ *  Post: Returns TRUE if the test was successful,
+ *        FALSE if it failed.
+ */
+BOOL TestInitialization();
+
+#endif
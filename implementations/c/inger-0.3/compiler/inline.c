@@ -0,0 +1,1245 @@
+/*************************************************
+ *                                               *
+ *  Module: inline.c                             *
+ *  Description:                                 *
+ *      Inlining of small functions at their     *
+ *      call sites.                              *
+ *  Modifications:                               *
+ *                                               *
+ *************************************************
+ *                                               *
+ *   This program is free software; you can      *
+ *   redistribute it and/or modify  it under     *
+ *   the terms of the GNU General Public         *
+ *   License as published by the Free            *
+ *   Software Foundation; either version 2       *
+ *   of the License, or (at your option) any     *
+ *   later version.                              *
+ *                                               *
+ *************************************************/
+
+/*
+ *  A call is replaced by a block that assigns the
+ *  arguments to the parameters and then runs a copy
+ *  of the function body. The parameters and locals of
+ *  the copy are renamed (the new names have a '.',
+ *  which no identifier has) and added to the scope of
+ *  the caller. A return must be the last statement
+ *  the body executes; "if( c ) { ... return; } rest"
+ *  is made an if-else with the rest in the else block.
+ *  A return then assigns its value to the variable
+ *  that receives the result of the call.
+ *
+ *  Inlined in place are calls that are a statement,
+ *  the value assigned to a variable, or the value
+ *  returned. Other calls in an expression are inlined
+ *  before the statement if the function assigns only
+ *  its own variables and calls nothing, so that it
+ *  may run earlier; not in a while condition, nor in
+ *  the right operand of && and ||, which does not
+ *  always run.
+ *
+ *  A function is inlined if it is not recursive, has
+ *  no array parameters, and its body has no more AST
+ *  nodes than the threshold. The threshold is doubled
+ *  for a function called once, and again for a call
+ *  in a loop.
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "defs.h"
+#include "nodenames.h"
+#include "symtab.h"
+#include "ast.h"
+#include "types.h"
+#include "getsymbols.h"
+#include "options.h"
+#include "dataflow.h"
+#include "selftest.h"
+#include "inline.h"
+
+/*************************************************
+ *                                               *
+ *  MACROS                                       *
+ *                                               *
+ *************************************************/
+
+/* Factor by which the threshold is raised for a
+ * function called once and for a call in a loop. */
+#define INLINE_BONUS        2
+
+/*************************************************
+ *                                               *
+ *  TYPES                                        *
+ *                                               *
+ *************************************************/
+
+typedef struct Function
+{
+    char *name;
+    TreeNode *node;         /* NODE_FUNCTION with a block */
+    TreeNode *body;         /* copy of the block that is inlined */
+    int size;               /* nodes in body */
+    int calls;              /* call sites in the module */
+    BOOL recursive;
+    BOOL inlinable;
+    BOOL pure;              /* assigns only its own variables and calls nothing */
+    int firstCall;          /* first of its edges in the call graph, or -1 */
+    int order;              /* order of the search for recursion, or -1 */
+    int lowLink;            /* lowest order reachable while on the stack */
+    BOOL onStack;
+} Function;
+
+/* An edge of the call graph: a call to function
+ * [callee], and the next call of the same caller. */
+typedef struct CallEdge
+{
+    int callee;
+    int next;
+} CallEdge;
+
+typedef struct Rename
+{
+    char *from;
+    char *to;
+    TreeNode *value;        /* argument used as it is, or NULL */
+} Rename;
+
+/*************************************************
+ *                                               *
+ *  GLOBALS                                      *
+ *                                               *
+ *************************************************/
+
+static Function *functions = NULL;
+static int nrOfFunctions, maxFunctions;
+static IndexMap functionNames = { NULL, NULL, 0, 0, TRUE };
+
+/* The call graph, and the stack and counter of the
+ * search for its strongly connected components. */
+static CallEdge *callEdges = NULL;
+static int nrOfCallEdges, maxCallEdges;
+static int *stack = NULL;
+static int stackDepth, nrOfOrders;
+
+/* Variables of the function being inlined and their
+ * names in the caller. */
+static Rename *renames = NULL;
+static int nrOfRenames, maxRenames;
+
+static Function *caller;
+static int threshold;
+static int loopDepth;
+
+/* Number of the current call inlined, which is part
+ * of the new names. */
+static int expansion;
+
+/*************************************************
+ *                                               *
+ *  STATIC FUNCTION DEFINITIONS                  *
+ *                                               *
+ *************************************************/
+
+static Function *FindFunction( char *name )
+{
+    int *index;
+
+    index = FindInMap( &functionNames, name );
+    if( index == NULL ) return( NULL );
+    return( &functions[*index] );
+}
+
+/* Records the function definitions in [node]. */
+static void CollectFunctions( TreeNode *node )
+{
+    Function *function;
+    ListNode *child;
+
+    if( TOAST( node )->id == NODE_FUNCTION )
+    {
+        if( GetBlockFromFunction( node ) == NULL ) return;
+
+        if( nrOfFunctions == maxFunctions )
+        {
+            maxFunctions = ( maxFunctions == 0 ) ? 16 : maxFunctions * 2;
+            functions = (Function *) realloc( functions, maxFunctions * sizeof( Function ) );
+            if( functions == NULL ) BAILOUT( ERR_NOMEM );
+        }
+        function = &functions[nrOfFunctions++];
+        function->name = GetNameFromHeader( GetHeaderFromFunction( node ) );
+        function->node = node;
+        function->body = NULL;
+        function->calls = 0;
+        function->recursive = FALSE;
+        function->firstCall = -1;
+        function->order = -1;
+        function->onStack = FALSE;
+        if( FindFunction( function->name ) == NULL )
+        {
+            AddToMap( &functionNames, function->name, nrOfFunctions - 1 );
+        }
+        return;
+    }
+
+    for( child = ListFirstEx( node->children ); child != NULL; child = ListNextEx( child ) )
+    {
+        CollectFunctions( (TreeNode *) child->data );
+    }
+}
+
+/* Adds the edge from [from] to [to] to the call
+ * graph. */
+static void AddCallEdge( Function *from, Function *to )
+{
+    if( nrOfCallEdges == maxCallEdges )
+    {
+        maxCallEdges = ( maxCallEdges == 0 ) ? 16 : maxCallEdges * 2;
+        callEdges = (CallEdge *) realloc( callEdges, maxCallEdges * sizeof( CallEdge ) );
+        if( callEdges == NULL ) BAILOUT( ERR_NOMEM );
+    }
+    callEdges[nrOfCallEdges].callee = to - functions;
+    callEdges[nrOfCallEdges].next = from->firstCall;
+    from->firstCall = nrOfCallEdges++;
+}
+
+/* Counts the call sites of each function in [node],
+ * which is in the body of [from] if that is not
+ * NULL, and builds the call graph. */
+static void CountCalls( TreeNode *node, Function *from )
+{
+    Function *function;
+    ListNode *child;
+
+    if( TOAST( node )->id == NODE_FUNCTION && GetBlockFromFunction( node ) != NULL )
+    {
+        from = FindFunction( GetNameFromHeader( GetHeaderFromFunction( node ) ) );
+    }
+
+    if( TOAST( node )->id == NODE_APPLICATION )
+    {
+        function = FindFunction( GetNameFromApplication( node ) );
+        if( function != NULL )
+        {
+            function->calls++;
+            if( from != NULL ) AddCallEdge( from, function );
+        }
+    }
+
+    for( child = ListFirstEx( node->children ); child != NULL; child = ListNextEx( child ) )
+    {
+        CountCalls( (TreeNode *) child->data, from );
+    }
+}
+
+/*
+ *  Marks the functions that call themselves, directly
+ *  or through others, in the part of the call graph
+ *  reachable from [function]. A function that calls
+ *  another in its strongly connected component, or
+ *  itself, is recursive (Tarjan's search, so every
+ *  edge is followed once).
+ */
+static void FindRecursion( Function *function )
+{
+    Function *callee, *member;
+    int edge;
+
+    function->order = function->lowLink = nrOfOrders++;
+    stack[stackDepth++] = function - functions;
+    function->onStack = TRUE;
+
+    for( edge = function->firstCall; edge != -1; edge = callEdges[edge].next )
+    {
+        callee = &functions[callEdges[edge].callee];
+        if( callee == function ) function->recursive = TRUE;
+        if( callee->order == -1 )
+        {
+            FindRecursion( callee );
+            if( callee->lowLink < function->lowLink ) function->lowLink = callee->lowLink;
+        }
+        else if( callee->onStack == TRUE && callee->order < function->lowLink )
+        {
+            function->lowLink = callee->order;
+        }
+    }
+
+    /* [function] is the first of its component to be
+     * found; the rest are above it on the stack. */
+    if( function->lowLink == function->order )
+    {
+        do
+        {
+            member = &functions[stack[--stackDepth]];
+            member->onStack = FALSE;
+            if( member != function )
+            {
+                member->recursive = TRUE;
+                function->recursive = TRUE;
+            }
+        } while( member != function );
+    }
+}
+
+static int CountNodes( TreeNode *node )
+{
+    ListNode *child;
+    int count = 1;
+
+    for( child = ListFirstEx( node->children ); child != NULL; child = ListNextEx( child ) )
+    {
+        count += CountNodes( (TreeNode *) child->data );
+    }
+    return( count );
+}
+
+/* Returns a copy of [node] and its children. */
+static TreeNode *CopyTree( TreeNode *node )
+{
+    TreeNode *copy;
+    ListNode *child;
+
+    copy = CreateAstNodeVal( TOAST( node )->id, TOAST( node )->val, TOAST( node )->lineno );
+    if( TOAST( node )->type != NULL )
+    {
+        TOAST( copy )->type = CopyType( TOAST( node )->type );
+    }
+
+    for( child = ListFirstEx( node->children ); child != NULL; child = ListNextEx( child ) )
+    {
+        AddAstChild( copy, CopyTree( (TreeNode *) child->data ) );
+    }
+    return( copy );
+}
+
+/* Checks whether evaluating [node] can have an
+ * effect other than its value. */
+static BOOL HasSideEffects( TreeNode *node )
+{
+    ListNode *child;
+
+    switch( TOAST( node )->id )
+    {
+    case NODE_APPLICATION:
+    case NODE_ASSIGN:
+        return( TRUE );
+    }
+
+    for( child = ListFirstEx( node->children ); child != NULL; child = ListNextEx( child ) )
+    {
+        if( HasSideEffects( (TreeNode *) child->data ) == TRUE ) return( TRUE );
+    }
+    return( FALSE );
+}
+
+/* Checks whether statement [node] always ends in a
+ * return. */
+static BOOL EndsInReturn( TreeNode *node )
+{
+    ListNode *last;
+
+    switch( TOAST( node )->id )
+    {
+    case NODE_RETURN:
+        return( TRUE );
+    case NODE_BLOCK:
+        last = ListLastEx( node->children );
+        return( last != NULL && EndsInReturn( (TreeNode *) last->data ) );
+    case NODE_IF:
+        return( GetElseBlockFromIf( node ) != NULL
+            && EndsInReturn( GetThenBlockFromIf( node ) ) == TRUE
+            && EndsInReturn( GetElseBlockFromIf( node ) ) == TRUE );
+    }
+    return( FALSE );
+}
+
+/* Moves the statements of [block] that follow an if
+ * without else whose block ends in a return into an
+ * else block. */
+static void AddElseBlock( TreeNode *block )
+{
+    TreeNode *statement, *rest;
+    ListNode *child;
+    int position = 0, i;
+
+    for( child = ListFirstEx( block->children ); child != NULL; child = ListNextEx( child ) )
+    {
+        statement = (TreeNode *) child->data;
+        if( TOAST( statement )->id == NODE_IF && GetElseBlockFromIf( statement ) == NULL
+            && EndsInReturn( GetThenBlockFromIf( statement ) ) == TRUE
+            && ListNextEx( child ) != NULL )
+        {
+            break;
+        }
+        position++;
+    }
+    if( child == NULL ) return;
+
+    rest = CreateAstNode( NODE_BLOCK, TOAST( statement )->lineno );
+    ListFirst( block->children );
+    for( i = 0; i <= position; i++ )
+    {
+        ListNext( block->children );
+    }
+    while( ListSize( block->children ) > position + 1 )
+    {
+        AddAstChild( rest, (TreeNode *) ListUnlink( block->children ) );
+    }
+    AddAstChild( statement, rest );
+    AddElseBlock( rest );
+}
+
+static void AddElseBlocks( TreeNode *node )
+{
+    ListNode *child;
+
+    for( child = ListFirstEx( node->children ); child != NULL; child = ListNextEx( child ) )
+    {
+        AddElseBlocks( (TreeNode *) child->data );
+    }
+    if( TOAST( node )->id == NODE_BLOCK ) AddElseBlock( node );
+}
+
+/*
+ *  Checks whether the statements of [node] can be
+ *  copied into another function: they have no jumps,
+ *  give variables only an initial value of their type,
+ *  and return only as the last statement executed if
+ *  [last].
+ */
+static BOOL CanCopy( TreeNode *node, BOOL last )
+{
+    TreeNode *value;
+    ListNode *child;
+
+    switch( TOAST( node )->id )
+    {
+    case NODE_GOTO:
+    case NODE_LABEL:
+    case NODE_BREAK:
+    case NODE_CONTINUE:
+        return( FALSE );
+
+    case NODE_RETURN:
+        return( last );
+
+    case NODE_DECLARATION:
+        if( ListSize( GetTreeChild( node, 4 )->children ) == 0 ) return( TRUE );
+        value = GetTreeChild( GetTreeChild( node, 4 ), 0 );
+        return( TOAST( value )->type != NULL && GetDimensionsFromDecl( node ) == 0
+            && ListSize( TOAST( value )->type->dimensions ) == 0
+            && GetSimpleType( TOAST( value )->type ) == GetTypeFromDecl( node ) );
+
+    case NODE_BLOCK:
+        for( child = ListFirstEx( node->children ); child != NULL; child = ListNextEx( child ) )
+        {
+            if( CanCopy( (TreeNode *) child->data, last == TRUE && ListNextEx( child ) == NULL ) == FALSE )
+            {
+                return( FALSE );
+            }
+        }
+        return( TRUE );
+
+    case NODE_IF:
+        return( CanCopy( GetThenBlockFromIf( node ), last ) == TRUE
+            && ( GetElseBlockFromIf( node ) == NULL || CanCopy( GetElseBlockFromIf( node ), last ) == TRUE ) );
+    }
+
+    for( child = ListFirstEx( node->children ); child != NULL; child = ListNextEx( child ) )
+    {
+        if( CanCopy( (TreeNode *) child->data, FALSE ) == FALSE ) return( FALSE );
+    }
+    return( TRUE );
+}
+
+static BOOL Declares( TreeNode *node, char *name )
+{
+    ListNode *child;
+
+    if( TOAST( node )->id == NODE_DECLARATION )
+    {
+        return( strcmp( GetNameFromDecl( node ), name ) == 0 );
+    }
+
+    for( child = ListFirstEx( node->children ); child != NULL; child = ListNextEx( child ) )
+    {
+        if( Declares( (TreeNode *) child->data, name ) == TRUE ) return( TRUE );
+    }
+    return( FALSE );
+}
+
+/* Checks whether [name] is a parameter or local of
+ * [function]. */
+static BOOL IsLocal( Function *function, char *name )
+{
+    TreeNode *header;
+    int i;
+
+    header = GetHeaderFromFunction( function->node );
+    for( i = 0; i < GetParamCountFromHeader( header ); i++ )
+    {
+        if( strcmp( GetParamNameFromHeader( header, i ), name ) == 0 ) return( TRUE );
+    }
+    return( Declares( function->body, name ) );
+}
+
+/* Checks whether [node] of [function] assigns only
+ * variables of the function and calls nothing. */
+static BOOL IsPure( Function *function, TreeNode *node )
+{
+    TreeNode *left;
+    ListNode *child;
+
+    switch( TOAST( node )->id )
+    {
+    case NODE_APPLICATION:
+        return( FALSE );
+    case NODE_ASSIGN:
+        left = GetTreeChild( node, 0 );
+        if( TOAST( left )->id != NODE_LIT_IDENTIFIER
+            || IsLocal( function, GetNameOfIdentifier( left ) ) == FALSE )
+        {
+            return( FALSE );
+        }
+        break;
+    }
+
+    for( child = ListFirstEx( node->children ); child != NULL; child = ListNextEx( child ) )
+    {
+        if( IsPure( function, (TreeNode *) child->data ) == FALSE ) return( FALSE );
+    }
+    return( TRUE );
+}
+
+static BOOL HasArrayParameters( TreeNode *header )
+{
+    int i;
+
+    for( i = 0; i < GetParamCountFromHeader( header ); i++ )
+    {
+        if( GetParamDimensionsFromHeader( header, i ) > 0 ) return( TRUE );
+    }
+    return( FALSE );
+}
+
+/*
+ *  Makes the copy of the body of [function] that is
+ *  inlined, if there is none, and determines whether
+ *  it can be.
+ */
+static void PrepareBody( Function *function )
+{
+    TreeNode *header;
+
+    if( function->body != NULL ) return;
+
+    header = GetHeaderFromFunction( function->node );
+    function->body = CopyTree( GetBlockFromFunction( function->node ) );
+    AddElseBlocks( function->body );
+    function->size = CountNodes( function->body );
+    function->inlinable = ( function->recursive == FALSE
+        && IsStartFromHeader( header ) == FALSE
+        && HasArrayParameters( header ) == FALSE
+        && CanCopy( function->body, TRUE ) == TRUE );
+    function->pure = ( function->inlinable == TRUE && IsPure( function, function->body ) == TRUE );
+}
+
+/*
+ *  Checks whether the names in [node] that are not
+ *  variables of [function] are globals in the scope of
+ *  the caller, and not variables of the caller.
+ */
+static BOOL SeesGlobals( Function *function, TreeNode *node )
+{
+    Symbol *symbol;
+    ListNode *child;
+
+    if( TOAST( node )->id == NODE_LIT_IDENTIFIER
+        && IsLocal( function, GetNameOfIdentifier( node ) ) == FALSE )
+    {
+        symbol = FindSymbol( GetNameOfIdentifier( node ) );
+        if( symbol == NULL || symbol->global == FALSE ) return( FALSE );
+    }
+
+    for( child = ListFirstEx( node->children ); child != NULL; child = ListNextEx( child ) )
+    {
+        if( SeesGlobals( function, (TreeNode *) child->data ) == FALSE ) return( FALSE );
+    }
+    return( TRUE );
+}
+
+/*
+ *  Returns the function called by [application] if
+ *  the call may be inlined and is worth it: the body
+ *  is no larger than the threshold, which is raised
+ *  for a function called once and for a call in a
+ *  loop. Returns NULL otherwise.
+ */
+static Function *GetInlinedFunction( TreeNode *application )
+{
+    Function *function;
+    int limit = threshold;
+
+    function = FindFunction( GetNameFromApplication( application ) );
+    if( function == NULL ) return( NULL );
+    PrepareBody( function );
+    if( function->inlinable == FALSE ) return( NULL );
+
+    if( function->calls == 1 ) limit *= INLINE_BONUS;
+    if( loopDepth > 0 ) limit *= INLINE_BONUS;
+    if( function->size > limit ) return( NULL );
+
+    if( SeesGlobals( function, function->body ) == FALSE ) return( NULL );
+    return( function );
+}
+
+/* Returns the function called by [application] if the
+ * call may be inlined before its statement, or NULL. */
+static Function *GetHoistedFunction( TreeNode *application )
+{
+    Function *function;
+    TreeNode *header;
+
+    function = GetInlinedFunction( application );
+    if( function == NULL || function->pure == FALSE ) return( NULL );
+
+    header = GetHeaderFromFunction( function->node );
+    if( GetReturnTypeFromHeader( header ) == NODE_VOID
+        || GetReturnTypeDimensionsFromHeader( header ) > 0 )
+    {
+        return( NULL );
+    }
+    return( function );
+}
+
+/* Checks whether variable [name] occurs in [node]. */
+static BOOL Mentions( TreeNode *node, char *name )
+{
+    ListNode *child;
+
+    if( TOAST( node )->id == NODE_LIT_IDENTIFIER )
+    {
+        return( strcmp( GetNameOfIdentifier( node ), name ) == 0 );
+    }
+
+    for( child = ListFirstEx( node->children ); child != NULL; child = ListNextEx( child ) )
+    {
+        if( Mentions( (TreeNode *) child->data, name ) == TRUE ) return( TRUE );
+    }
+    return( FALSE );
+}
+
+/* Checks whether [node] assigns variable [name] or
+ * takes its address. */
+static BOOL Modifies( TreeNode *node, char *name )
+{
+    TreeNode *left;
+    ListNode *child;
+
+    switch( TOAST( node )->id )
+    {
+    case NODE_ASSIGN:
+        left = GetTreeChild( node, 0 );
+        if( TOAST( left )->id == NODE_LIT_IDENTIFIER
+            && strcmp( GetNameOfIdentifier( left ), name ) == 0 )
+        {
+            return( TRUE );
+        }
+        break;
+    case NODE_ADDRESS:
+        return( Mentions( node, name ) );
+    }
+
+    for( child = ListFirstEx( node->children ); child != NULL; child = ListNextEx( child ) )
+    {
+        if( Modifies( (TreeNode *) child->data, name ) == TRUE ) return( TRUE );
+    }
+    return( FALSE );
+}
+
+/*
+ *  Checks whether [argument] may take the place of
+ *  parameter [name] of [function] in the body: the
+ *  body does not change the parameter, and the
+ *  argument is a literal, or a variable if the body
+ *  cannot change that either.
+ */
+static BOOL CanSubstitute( Function *function, char *name, TreeNode *argument )
+{
+    switch( TOAST( argument )->id )
+    {
+    case NODE_LIT_INT:
+    case NODE_LIT_CHAR:
+    case NODE_LIT_BOOL:
+    case NODE_LIT_FLOAT:
+        break;
+    case NODE_LIT_IDENTIFIER:
+        if( function->pure == FALSE ) return( FALSE );
+        break;
+    default:
+        return( FALSE );
+    }
+    return( Modifies( function->body, name ) == FALSE );
+}
+
+/* Returns a new name for variable [name] of the call
+ * being inlined. */
+static char *MakeName( char *name )
+{
+    char *newName;
+
+    newName = (char *) malloc( strlen( name ) + 16 );
+    if( newName == NULL ) BAILOUT( ERR_NOMEM );
+    sprintf( newName, "%s.%d", name, expansion );
+    return( newName );
+}
+
+static char *AddRename( char *name )
+{
+    if( nrOfRenames == maxRenames )
+    {
+        maxRenames = ( maxRenames == 0 ) ? 16 : maxRenames * 2;
+        renames = (Rename *) realloc( renames, maxRenames * sizeof( Rename ) );
+        if( renames == NULL ) BAILOUT( ERR_NOMEM );
+    }
+    renames[nrOfRenames].from = name;
+    renames[nrOfRenames].to = MakeName( name );
+    renames[nrOfRenames].value = NULL;
+    return( renames[nrOfRenames++].to );
+}
+
+/* Gives the variables in [node] their new names, or
+ * replaces them by their argument. The name of a
+ * called function stays. */
+static void RenameVariables( TreeNode *node )
+{
+    ListNode *child;
+    int i;
+
+    if( TOAST( node )->id == NODE_LIT_IDENTIFIER )
+    {
+        for( i = 0; i < nrOfRenames; i++ )
+        {
+            if( strcmp( renames[i].from, GetNameOfIdentifier( node ) ) != 0 ) continue;
+            if( renames[i].value != NULL )
+            {
+                ReplaceTreeNode( node, CopyTree( renames[i].value ) );
+            }
+            else
+            {
+                TOAST( node )->val.identifier = renames[i].to;
+            }
+            break;
+        }
+        return;
+    }
+
+    child = ListFirstEx( node->children );
+    if( TOAST( node )->id == NODE_APPLICATION ) child = ListNextEx( child );
+    for( ; child != NULL; child = ListNextEx( child ) )
+    {
+        RenameVariables( (TreeNode *) child->data );
+    }
+}
+
+static TreeNode *MakeIdentifier( char *name, int lineno )
+{
+    TreeNode *identifier;
+
+    identifier = CreateAstNode( NODE_LIT_IDENTIFIER, lineno );
+    TOAST( identifier )->val.identifier = name;
+    TOAST( identifier )->type = CopyType( GetSymbolType( name ) );
+    return( identifier );
+}
+
+static TreeNode *MakeAssignment( TreeNode *left, TreeNode *right )
+{
+    TreeNode *assignment;
+
+    assignment = CreateAstNode( NODE_ASSIGN, TOAST( left )->lineno );
+    AddAstChild( assignment, left );
+    AddAstChild( assignment, right );
+    TOAST( assignment )->type = CopyType( TOAST( left )->type );
+    return( assignment );
+}
+
+/* Declares variable [name] of type [typeNode] (NODE_INT,
+ * ...) in [block] and in the scope of the caller. */
+static void Declare( TreeNode *block, int typeNode, char *name, int lineno )
+{
+    TreeNode *declarations, *declaration;
+
+    declaration = CreateAstNode( NODE_DECLARATION, lineno );
+    AddAstChild( declaration, CreateAstNode( typeNode, lineno ) );
+    AddAstChild( declaration, CreateAstNode( NODE_REFERENCE, lineno ) );
+    AddAstChild( declaration, CreateAstNode( NODE_LIT_IDENTIFIER, lineno ) );
+    TOAST( GetTreeChild( declaration, 2 ) )->val.identifier = name;
+    AddAstChild( declaration, CreateAstNode( NODE_INDEXBLOCK, lineno ) );
+    AddAstChild( declaration, CreateAstNode( NODE_INITIALIZER, lineno ) );
+
+    declarations = CreateAstNode( NODE_DECLBLOCK, lineno );
+    AddAstChild( declarations, declaration );
+    AddAstChild( block, declarations );
+    ProcessDeclaration( declaration );
+}
+
+static void RenameLocals( TreeNode *node )
+{
+    ListNode *child;
+
+    if( TOAST( node )->id == NODE_DECLARATION )
+    {
+        AddRename( GetNameFromDecl( node ) );
+        return;
+    }
+
+    for( child = ListFirstEx( node->children ); child != NULL; child = ListNextEx( child ) )
+    {
+        RenameLocals( (TreeNode *) child->data );
+    }
+}
+
+/*
+ *  Adds the locals declared in [node] to the scope of
+ *  the caller. Their initial values are assigned at
+ *  the end of [block], as they would be on entry of
+ *  the function.
+ */
+static void DeclareLocals( TreeNode *node, TreeNode *block )
+{
+    TreeNode *initializer, *value;
+    ListNode *child;
+
+    if( TOAST( node )->id == NODE_DECLARATION )
+    {
+        ProcessDeclaration( node );
+        initializer = GetTreeChild( node, 4 );
+        if( ListSize( initializer->children ) > 0 )
+        {
+            ListFirst( initializer->children );
+            value = (TreeNode *) ListUnlink( initializer->children );
+            AddAstChild( block, MakeAssignment(
+                MakeIdentifier( GetNameFromDecl( node ), TOAST( node )->lineno ), value ) );
+        }
+        return;
+    }
+
+    for( child = ListFirstEx( node->children ); child != NULL; child = ListNextEx( child ) )
+    {
+        DeclareLocals( (TreeNode *) child->data, block );
+    }
+}
+
+/* Replaces the returns in [node] by an assignment of
+ * their value to [target], or if [target] is NULL, by
+ * their value if it has side effects. */
+static void ReplaceReturns( TreeNode *node, TreeNode *target )
+{
+    TreeNode *value, *statement = NULL;
+    ListNode *child;
+
+    if( TOAST( node )->id != NODE_RETURN )
+    {
+        for( child = ListFirstEx( node->children ); child != NULL; child = ListNextEx( child ) )
+        {
+            ReplaceReturns( (TreeNode *) child->data, target );
+        }
+        return;
+    }
+
+    if( ListSize( node->children ) > 0 )
+    {
+        value = GetTreeChild( node, 0 );
+        if( target != NULL )
+        {
+            statement = MakeAssignment( CopyTree( target ), value );
+        }
+        else if( HasSideEffects( value ) == TRUE )
+        {
+            statement = value;
+        }
+    }
+    if( statement == NULL )
+    {
+        statement = CreateAstNode( NODE_BLOCK, TOAST( node )->lineno );
+    }
+    ReplaceTreeNode( node, statement );
+}
+
+/*
+ *  Returns the block that runs in place of
+ *  [application], a call to [function]: the arguments
+ *  are assigned to the parameters, and then the body
+ *  runs. The value returned is assigned to [target],
+ *  or dropped if it is NULL; with [keepReturns], the
+ *  returns stay.
+ *
+ *  Pre: the arguments have no side effects.
+ */
+static TreeNode *ExpandCall( Function *function, TreeNode *application,
+                             TreeNode *target, BOOL keepReturns )
+{
+    TreeNode *header, *block, *body, *argument;
+    char *name;
+    int lineno, i;
+
+    header = GetHeaderFromFunction( function->node );
+    lineno = TOAST( application )->lineno;
+    block = CreateAstNode( NODE_BLOCK, lineno );
+    nrOfRenames = 0;
+
+    /* A parameter that the body does not change may be
+     * replaced by a simple argument; the others become
+     * variables that are assigned the arguments. */
+    for( i = 0; i < GetParamCountFromHeader( header ); i++ )
+    {
+        name = AddRename( GetParamNameFromHeader( header, i ) );
+        argument = GetArgumentFromApplication( application, i );
+        if( CanSubstitute( function, GetParamNameFromHeader( header, i ), argument ) == TRUE )
+        {
+            renames[i].value = argument;
+            continue;
+        }
+        Declare( block, GetParamTypeFromHeader( header, i ), name, lineno );
+        AddAstChild( block, MakeAssignment( MakeIdentifier( name, lineno ), argument ) );
+    }
+
+    body = CopyTree( function->body );
+    RenameLocals( body );
+    RenameVariables( body );
+    DeclareLocals( body, block );
+    if( keepReturns == FALSE ) ReplaceReturns( body, target );
+    AddAstChild( block, body );
+
+    return( block );
+}
+
+/*
+ *  Checks whether the calls in expression [node],
+ *  other than [root], may all be inlined before the
+ *  statement, and counts them in [count].
+ */
+static BOOL CanHoist( TreeNode *node, TreeNode *root, int *count )
+{
+    ListNode *child;
+
+    switch( TOAST( node )->id )
+    {
+    case NODE_ASSIGN:
+        return( FALSE );
+
+    case NODE_LOGICAL_AND:
+    case NODE_LOGICAL_OR:
+        if( HasSideEffects( GetTreeChild( node, 1 ) ) == TRUE ) return( FALSE );
+        return( CanHoist( GetTreeChild( node, 0 ), root, count ) );
+
+    case NODE_APPLICATION:
+        if( node == root ) break;
+        if( GetHoistedFunction( node ) == NULL ) return( FALSE );
+        (*count)++;
+        break;
+    }
+
+    for( child = ListFirstEx( node->children ); child != NULL; child = ListNextEx( child ) )
+    {
+        if( CanHoist( (TreeNode *) child->data, root, count ) == FALSE ) return( FALSE );
+    }
+    return( TRUE );
+}
+
+/*
+ *  Inlines the calls in expression [node], other than
+ *  [root], innermost first, at the end of [block]. A
+ *  call is replaced by the variable that receives its
+ *  value.
+ *
+ *  Pre: CanHoist( node, root ) holds.
+ */
+static void HoistCalls( TreeNode *node, TreeNode *root, TreeNode *block )
+{
+    Function *function;
+    ListNode *child;
+    char *name;
+    int lineno;
+
+    if( TOAST( node )->id == NODE_LOGICAL_AND || TOAST( node )->id == NODE_LOGICAL_OR )
+    {
+        HoistCalls( GetTreeChild( node, 0 ), root, block );
+        return;
+    }
+
+    for( child = ListFirstEx( node->children ); child != NULL; child = ListNextEx( child ) )
+    {
+        HoistCalls( (TreeNode *) child->data, root, block );
+    }
+    if( TOAST( node )->id != NODE_APPLICATION || node == root ) return;
+
+    function = GetHoistedFunction( node );
+    assert( function != NULL );
+    lineno = TOAST( node )->lineno;
+    expansion++;
+    name = MakeName( "return" );
+    Declare( block, GetReturnTypeFromHeader( GetHeaderFromFunction( function->node ) ), name, lineno );
+    AddAstChild( block, ExpandCall( function, node, MakeIdentifier( name, lineno ), FALSE ) );
+    ReplaceTreeNode( node, MakeIdentifier( name, lineno ) );
+}
+
+/* Checks whether a return in the caller may return
+ * the value of a call to [function] as it is. */
+static BOOL ReturnsSameType( Function *function )
+{
+    TreeNode *header, *callerHeader;
+
+    header = GetHeaderFromFunction( function->node );
+    callerHeader = GetHeaderFromFunction( caller->node );
+    return( GetReturnTypeFromHeader( header ) != NODE_VOID
+        && GetReturnTypeFromHeader( header ) == GetReturnTypeFromHeader( callerHeader )
+        && GetReturnTypeDimensionsFromHeader( header ) == GetReturnTypeDimensionsFromHeader( callerHeader ) );
+}
+
+/*
+ *  Inlines the calls of statement [node] of a block:
+ *  first those that may run before the statement, then
+ *  a call that is the statement itself, the value of
+ *  an assignment to a variable or the value returned.
+ */
+static void InlineStatement( TreeNode *node )
+{
+    TreeNode *left = NULL, *right, *root = NULL, *target = NULL, *block;
+    Function *function;
+    BOOL keepReturns = FALSE;
+    int count = 0;
+
+    switch( TOAST( node )->id )
+    {
+    case NODE_APPLICATION:
+        right = node;
+        root = node;
+        break;
+    case NODE_ASSIGN:
+        left = GetTreeChild( node, 0 );
+        right = GetTreeChild( node, 1 );
+        if( TOAST( left )->id == NODE_LIT_IDENTIFIER && TOAST( right )->id == NODE_APPLICATION
+            && ListSize( TOAST( left )->type->dimensions ) == ListSize( TOAST( right )->type->dimensions ) )
+        {
+            root = right;
+            target = left;
+        }
+        break;
+    case NODE_RETURN:
+        if( ListSize( node->children ) == 0 ) return;
+        right = GetTreeChild( node, 0 );
+        if( TOAST( right )->id == NODE_APPLICATION )
+        {
+            root = right;
+            keepReturns = TRUE;
+        }
+        break;
+    case NODE_IF:
+        right = GetExpressionFromIf( node );
+        break;
+    default:
+        return;
+    }
+
+    if( ( left == NULL || CanHoist( left, root, &count ) == TRUE )
+        && CanHoist( right, root, &count ) == TRUE && count > 0 )
+    {
+        block = CreateAstNode( NODE_BLOCK, TOAST( node )->lineno );
+        ReplaceTreeNode( node, block );
+        if( left != NULL ) HoistCalls( left, root, block );
+        HoistCalls( right, root, block );
+        AddAstChild( block, node );
+    }
+
+    if( root == NULL || HasSideEffects( GetTreeChild( root, 1 ) ) == TRUE ) return;
+    function = GetInlinedFunction( root );
+    if( function == NULL ) return;
+    if( keepReturns == TRUE && ReturnsSameType( function ) == FALSE ) return;
+
+    expansion++;
+    ReplaceTreeNode( node, ExpandCall( function, root, target, keepReturns ) );
+}
+
+/* Inlines the calls in the statements of [node] and
+ * its children. */
+static void InlineStatements( TreeNode *node )
+{
+    ListNode *child;
+
+    if( TOAST( node )->id == NODE_WHILE ) loopDepth++;
+
+    /* Replacing a statement replaces the data of its
+     * list node, so the list can be walked meanwhile. */
+    for( child = ListFirstEx( node->children ); child != NULL; child = ListNextEx( child ) )
+    {
+        InlineStatements( (TreeNode *) child->data );
+        if( TOAST( node )->id == NODE_BLOCK ) InlineStatement( (TreeNode *) child->data );
+    }
+
+    if( TOAST( node )->id == NODE_WHILE ) loopDepth--;
+}
+
+/*************************************************
+ *                                               *
+ *  EXPORTED FUNCTION DEFINITIONS                *
+ *                                               *
+ *************************************************/
+
+int InlineFunctions( TreeNode *node )
+{
+    int first, before, i;
+
+    assert( node != NULL );
+
+    threshold = GetInlineThreshold();
+    if( threshold < 0 ) threshold = INLINE_THRESHOLD;
+    if( threshold == 0 ) return( 0 );
+
+    nrOfFunctions = 0;
+    ClearMap( &functionNames );
+    CollectFunctions( node );
+
+    nrOfCallEdges = 0;
+    CountCalls( node, NULL );
+    stack = (int *) realloc( stack, ( maxFunctions + 1 ) * sizeof( int ) );
+    if( stack == NULL ) BAILOUT( ERR_NOMEM );
+    stackDepth = nrOfOrders = 0;
+    for( i = 0; i < nrOfFunctions; i++ )
+    {
+        if( functions[i].order == -1 ) FindRecursion( &functions[i] );
+    }
+
+    /* Functions are visited in the order of their
+     * scopes. A function inlined into is copied anew
+     * when it is inlined itself. */
+    first = expansion;
+    GotoSymbolRoot();
+    for( i = 0; i < nrOfFunctions; i++ )
+    {
+        caller = &functions[i];
+        loopDepth = 0;
+        before = expansion;
+        EnterScope();
+        InlineStatements( GetBlockFromFunction( caller->node ) );
+        ExitScope();
+        caller->body = NULL;
+        if( expansion != before ) InvalidateDataflow( caller->node );
+    }
+
+    return( expansion - first );
+}
+
+/*************************************************
+ *                                               *
+ *  TEST CODE                                    *
+ *                                               *
+ *************************************************/
+
+/* Program of the self-test: square is inlined at
+ * both calls, factorial is recursive, even and odd
+ * call each other and find breaks out of a loop. */
+static char *inlineTestProgram =
+    "module inlinetest;\n"
+    "square: int x -> int\n"
+    "{\n"
+    "    return( x * x );\n"
+    "}\n"
+    "factorial: int n -> int\n"
+    "{\n"
+    "    if( n < 2 )\n"
+    "    {\n"
+    "        return( 1 );\n"
+    "    }\n"
+    "    return( n * factorial( n - 1 ) );\n"
+    "}\n"
+    "even: int n -> int\n"
+    "{\n"
+    "    if( n == 0 )\n"
+    "    {\n"
+    "        return( 1 );\n"
+    "    }\n"
+    "    return( odd( n - 1 ) );\n"
+    "}\n"
+    "odd: int n -> int\n"
+    "{\n"
+    "    if( n == 0 )\n"
+    "    {\n"
+    "        return( 0 );\n"
+    "    }\n"
+    "    return( even( n - 1 ) );\n"
+    "}\n"
+    "find: int n -> int\n"
+    "{\n"
+    "    int i = 0;\n"
+    "    while( i < n ) do\n"
+    "    {\n"
+    "        if( i == 3 )\n"
+    "        {\n"
+    "            break;\n"
+    "        }\n"
+    "        i = i + 1;\n"
+    "    }\n"
+    "    return( i );\n"
+    "}\n"
+    "start main: void -> void\n"
+    "{\n"
+    "    int a = 2;\n"
+    "    a = square( a ) + square( 3 );\n"
+    "    a = factorial( a );\n"
+    "    a = even( a );\n"
+    "    a = find( a );\n"
+    "}\n";
+
+/* Returns the number of calls of [name] in [node]. */
+static int CountCallsOf( TreeNode *node, char *name )
+{
+    ListNode *child;
+    int count = 0;
+
+    if( TOAST( node )->id == NODE_APPLICATION
+        && strcmp( GetNameFromApplication( node ), name ) == 0 )
+    {
+        count++;
+    }
+    for( child = ListFirstEx( node->children ); child != NULL; child = ListNextEx( child ) )
+    {
+        count += CountCallsOf( (TreeNode *) child->data, name );
+    }
+    return( count );
+}
+
+BOOL TestInlining()
+{
+    TreeNode *ast, *function;
+    BOOL passed;
+    int inlined, squares, factorials, evens, finds;
+
+    printf( "Testing inlining...\n" );
+
+    ast = ParseTestProgram( inlineTestProgram );
+    if( ast == NULL )
+    {
+        printf( "Inlining test failed.\n\n" );
+        return( FALSE );
+    }
+
+    inlined = InlineFunctions( ast );
+    function = EnterTestFunction( ast, "main" );
+    squares = CountCallsOf( function, "square" );
+    factorials = CountCallsOf( function, "factorial" );
+    evens = CountCallsOf( function, "even" );
+    finds = CountCallsOf( function, "find" );
+    ExitScope();
+
+    printf( "calls inlined: %d\n", inlined );
+    printf( "calls left in main: square %d, factorial %d, even %d, find %d\n",
+        squares, factorials, evens, finds );
+    passed = ( inlined == 2 && squares == 0 && factorials == 1 && evens == 1 && finds == 1 );
+
+    printf( "Inlining test %s.\n\n", ( passed == TRUE ) ? "passed" : "failed" );
+    return( passed );
+}
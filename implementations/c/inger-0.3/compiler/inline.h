@@ -0,0 +1,50 @@
+/*************************************************
+ *                                               *
+ *  Module: inline.h                             *
+ *  Description:                                 *
+ *      Interface to the inlining of small       *
+ *      functions at their call sites.           *
+ *  Modifications:                               *
+ *                                               *
+ *************************************************
+ *                                               *
+ *   This program is free software; you can      *
+ *   redistribute it and/or modify  it under     *
+ *   the terms of the GNU General Public         *
+ *   License as published by the Free            *
+ *   Software Foundation; either version 2       *
+ *   of the License, or (at your option) any     *
+ *   later version.                              *
+ *                                               *
+ *************************************************/
+
+#ifndef INLINE_H
+#define INLINE_H
+
+#include "tree.h"
+
+/* Largest function body, in AST nodes, that is
+ * inlined when --inline-threshold is not given. */
+#define INLINE_THRESHOLD    40
+
+/*
+ *  Replaces calls in module [node] to small functions
+ *  of the module by a copy of the function body, with
+ *  the parameters and locals added to the scope of
+ *  the caller. Recursive functions are not inlined.
+ *  Returns the number of calls inlined.
+ *
+ *  Pre: the AST has been decorated with types.
+ */
+int InlineFunctions( TreeNode *node );
+
+/*
+ *  Tests inlining on a small program, in which one
+ *  function may be inlined and two may not.
+ *
+ *  Post: Returns TRUE if the test was successful,
+ *        FALSE if it failed.
+ */
+BOOL TestInlining();
+
+#endif
@@ -81,6 +81,7 @@
 #include "list.h"
 #include "options.h"
 #include "defs.h"
+#include "stats.h"
 
 /*************************************************
  *                                               *
@@ -104,6 +105,7 @@ List *ListInit( DeleteFunction deleteFunction )
     /*
      * Allocate memory for list structure.
      */
+    STAT_COUNT( STAT_ALLOCATION );
     list = ( List * )malloc( sizeof( List ) );
     if ( list == NULL )
     {
@@ -165,6 +167,7 @@ BOOL ListInsert( List *list, void *data )
         p = NULL;
     }
 
+    STAT_COUNT( STAT_ALLOCATION );
     newNode = ( ListNode * )malloc( sizeof( ListNode ) );
     if ( newNode == NULL )
     {
@@ -215,6 +218,7 @@ BOOL ListAppend( List *list, void *data )
     
     assert( list != NULL );
     
+    STAT_COUNT( STAT_ALLOCATION );
     newNode = ( ListNode * )malloc( sizeof( ListNode ) );
     if ( !newNode )
     {
@@ -249,6 +253,7 @@ BOOL ListAppend( List *list, void *data )
 void *ListUnlink( List *list )
 {
     ListNode *n, *p, *c;
+    void *data;
 
     assert( list != NULL );
 
@@ -279,7 +284,11 @@ void *ListUnlink( List *list )
 
     list->current = (n != NULL) ? n : p;
 
-    return( c );
+    /* free the node itself, but not its data */
+    data = c->data;
+    free( c );
+
+    return( data );
 }
 
 BOOL ListRemove( List *list, DeleteFunction deleteFunction )
@@ -406,6 +415,8 @@ int ListSize( List *list )
         node = node->next;
     };
 
+    STAT_COUNT( STAT_LISTSIZE );
+    STAT_SAMPLE( HIST_LIST_LENGTH, i );
     return( i );
 }
 
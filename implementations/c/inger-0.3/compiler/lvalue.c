@@ -52,6 +52,9 @@ void GetValues( TreeNode * node )
         case NODE_DEREFERENCE:
             break;
 
+        case NODE_INDEXER:
+            break;
+
         default:
             /* AddError will add 1 to numErrors for us */
             AddError( "invalid lvalue", TOAST( node )->lineno  );
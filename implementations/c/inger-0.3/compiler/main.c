@@ -39,6 +39,13 @@
 #include "errors.h"
 #include "switchcheck.h"
 #include "returncheck.h"
+#include "trace.h"
+#include "stats.h"
+#include "peephole.h"
+#include "constfold.h"
+#include "inline.h"
+#include "initcheck.h"
+#include "dataflow.h"
 
 /* File to write output code to. */
 extern FILE *g_outFile;    
@@ -72,14 +79,20 @@ int main( int argc, char **argv )
     if( ParseOptions( argc, argv ) == 0 ) return( 0 );
 
     /* Make source file name globaly available */
-    sourceFilename = (char *) malloc( strlen( argv[optind] ) );
+    sourceFilename = (char *) malloc( strlen( argv[optind] ) + 1 );
     strcpy( sourceFilename, argv[optind] );
 
+    /* Start recording phase times if requested. */
+    InitTrace();
+
     /* Process input files */
     while( optind < argc )
     {
         DEBUG( "Source file: %s\n", argv[optind] );
 
+        /* Each input file gets its own trace thread. */
+        BeginTraceThread( argv[optind] );
+
         /* Copy input file name into new memory, and add
          * .p extension.
          */
@@ -91,7 +104,9 @@ int main( int argc, char **argv )
          * preprocessorFilename. If the preprocessor could not
          * open the input file, skip this file.
          */
+        BeginTraceSpan( TRACE_PHASE, "preprocess" );
         result = Preprocess( argv[optind], preprocessorFilename );
+        EndTraceSpan();
         if( result == FALSE )
         {
             free( preprocessorFilename );
@@ -111,13 +126,17 @@ int main( int argc, char **argv )
             InitializeReport();
 
             /* Parse the file and create the abstract syntax tree. */
+            BeginTraceSpan( TRACE_PHASE, "parse" );
             ast = Parse();
+            EndTraceSpan();
 
             /* Process ONLY if no parse errors occurred. */
             if( GetErrorCount() == 0 )
             {
                 /* Create the symbol table. */
+                BeginTraceSpan( TRACE_PHASE, "symbol table" );
                 CreateSymbolTable( ast );
+                EndTraceSpan();
 		if( WantSymbolTable() == TRUE )
 		{
 		    DumpSymbolTable();
@@ -127,14 +146,42 @@ int main( int argc, char **argv )
                 {
 
                     /* Semantic checks */
+                    BeginTraceSpan( TRACE_PHASE, "semantic checks" );
                     CheckLeftValues( ast );
                     CheckArgCount( ast );
                     CheckSwitchStatements( ast );
                     CheckFunctionReturns( ast );
+                    EndTraceSpan();
 
                     if( GetErrorCount() == 0 )
                     {
+                        BeginTraceSpan( TRACE_PHASE, "typecheck" );
                         DecorateAstWithTypes( ast );
+                        EndTraceSpan();
+                    }
+
+                    /* Warn about variables used before they are set. */
+                    if( GetErrorCount() == 0 )
+                    {
+                        BeginTraceSpan( TRACE_PHASE, "initialization check" );
+                        CheckInitialization( ast );
+                        EndTraceSpan();
+                    }
+
+                    /* Inline small functions. */
+                    if( GetErrorCount() == 0 && GetOptimizationLevel() >= 1 )
+                    {
+                        BeginTraceSpan( TRACE_PHASE, "inline" );
+                        InlineFunctions( ast );
+                        EndTraceSpan();
+                    }
+
+                    /* Fold constant expressions. */
+                    if( GetErrorCount() == 0 && GetOptimizationLevel() >= 1 )
+                    {
+                        BeginTraceSpan( TRACE_PHASE, "fold constants" );
+                        FoldConstants( ast );
+                        EndTraceSpan();
                     }
     		    
                     if( GetErrorCount() == 0 )  
@@ -162,6 +209,7 @@ int main( int argc, char **argv )
                         }
     
                         strncpy( outFilename, argv[optind], i );
+                        outFilename[i] = '\0';
                         strcat( outFilename, ".s" );
 
                         /* Open output file for writing. */
@@ -173,7 +221,9 @@ int main( int argc, char **argv )
                         }
 
                         /* Generate some code. */
+                        BeginTraceSpan( TRACE_PHASE, "codegen" );
                         GenerateCode( ast );
+                        EndTraceSpan();
                         
                         /* Close output file. */
                         fclose( g_outFile );
@@ -183,6 +233,9 @@ int main( int argc, char **argv )
 
             /* Print errors and warnings. */
             PrintReport();
+
+            /* The dataflow facts refer to this file's tree. */
+            FreeDataflows();
     
             /* Done, close the input file. */
             fclose( fp );
@@ -196,6 +249,24 @@ int main( int argc, char **argv )
         optind++;
     }
 
+    /* Write trace events and phase times. */
+    if( WantTrace() == TRUE )
+    {
+        WriteTrace( GetTraceFilename() );
+    }
+    if( WantTimeReport() == TRUE )
+    {
+        PrintTimeReport();
+    }
+    if( WantStatistics() == TRUE )
+    {
+        PrintStatistics();
+        if( GetOptimizationLevel() >= 1 )
+        {
+            PrintPeepholeStatistics();
+        }
+    }
+
     /* TODO: Make a better return value for the shell. */
     return( 0 );
 }
@@ -23,6 +23,7 @@
 #include <unistd.h>
 #include <getopt.h>
 #include <assert.h>
+#include <stdlib.h> /* atoi */
 #include <string.h> /* strdup */
 #include "defs.h"
 #include "options.h"
@@ -30,8 +31,24 @@
 #include "tree.h"
 #include "list.h"
 #include "symtab.h"
+#include "benchmark.h"
+#include "peephole.h"
+#include "regalloc.h"
+#include "constfold.h"
+#include "inline.h"
+#include "cfg.h"
+#include "dataflow.h"
+#include "initcheck.h"
+#include "switchgen.h"
+#include "induction.h"
+#include "vectorize.h"
+#include "tailcall.h"
 
 char *astfile;
+char *tracefile;
+int optimizationLevel = 0;
+int targetMachine = TARGET_I386;
+int inlineThreshold = -1;
 
 /*
  *  option_order contains all the flags that the
@@ -44,7 +61,14 @@ enum
     OPTION_TEST,
     OPTION_AST,
     OPTION_ASTFILE,
-    OPTION_INTERNAL_DEBUG
+    OPTION_INTERNAL_DEBUG,
+    OPTION_TRACE,
+    OPTION_TIME,
+    OPTION_STATS,
+    OPTION_BENCH,
+    OPTION_OPTIMIZE,
+    OPTION_TARGET,
+    OPTION_INLINE_THRESHOLD
 } option_order;
 
 /*
@@ -59,6 +83,13 @@ static struct option longoptions[] =
     { "ast",        0, 0, OPTION_AST },
     { "astfile",    1, 0, OPTION_ASTFILE },  /* has file argument */
     { "debug",      0, 0, OPTION_INTERNAL_DEBUG },
+    { "trace",      1, 0, OPTION_TRACE },    /* has file argument */
+    { "time",       0, 0, OPTION_TIME },
+    { "stats",      0, 0, OPTION_STATS },
+    { "bench",      0, 0, OPTION_BENCH },
+    { "optimize",   1, 0, OPTION_OPTIMIZE }, /* has level argument */
+    { "target",     1, 0, OPTION_TARGET },   /* has target argument */
+    { "inline-threshold", 1, 0, OPTION_INLINE_THRESHOLD }, /* has size argument */
     { 0,0,0,0 }
 };
 
@@ -66,7 +97,7 @@ static struct option longoptions[] =
  *  Actual option values (boolean: on or off),
  *  initially set to default values (all off).
  */
-BOOL options[] = { FALSE, FALSE, FALSE, FALSE, FALSE, FALSE };
+BOOL options[] = { FALSE, FALSE, FALSE, FALSE, FALSE, FALSE, FALSE, FALSE, FALSE, FALSE, FALSE, FALSE, FALSE };
 
 /*
  *  Prints help on command line flags and arguments.
@@ -85,9 +116,21 @@ void ShowHelp( char *programName )
       "-h, --help         Display this information\n" \
       "-s, --symbols      Dump symbol table to console\n" \
       "-t, --test         Perform all sorts of selftests\n" \
+      "    --bench        Run data structure micro-benchmarks\n" \
       "-a, --ast          Dump abstract syntax tree to console\n" \
       "    --astfile file Dump abstract syntax tree to file\n" \
       "-d, --debug        Output compiler debug information\n" \
+      "    --trace file   Write Chrome trace events to file\n" \
+      "    --time         Print time spent in each phase\n" \
+      "    --stats        Print internal counters and histograms\n" \
+      "-O, --optimize n   Optimization level (0: none, 1: peephole, register\n" \
+      "                   allocation, constant folding, inlining, branch\n" \
+      "                   fusion, loop rotation, vectorization and tail\n" \
+      "                   calls; see --inline-threshold)\n" \
+      "    --target t     Target machine (i386 or x86_64, default i386)\n" \
+      "    --inline-threshold n\n" \
+      "                   Largest function inlined with -O1, in AST nodes\n" \
+      "                   (default 40, 0: no inlining)\n" \
       "\n", programName
     );
 }
@@ -126,7 +169,7 @@ BOOL ParseOptions( int argc, char **argv )
 {
     int opt;
 
-    while( ( opt = getopt_long( argc, argv, "shtad?",
+    while( ( opt = getopt_long( argc, argv, "shtad?O:",
         longoptions, NULL ) ) != -1 )
     {
         /*  Note: do not allow -? to be used for help.
@@ -147,6 +190,7 @@ BOOL ParseOptions( int argc, char **argv )
         if( opt == 't' ) opt = OPTION_TEST;
         if( opt == 'a' ) opt = OPTION_AST;
         if( opt == 'd' ) opt = OPTION_INTERNAL_DEBUG;
+        if( opt == 'O' ) opt = OPTION_OPTIMIZE;
 
         /* Take appropriate action for each option. */
         switch( opt )
@@ -167,9 +211,26 @@ BOOL ParseOptions( int argc, char **argv )
             TestTree();
             TestAst();
             TestSymbolTable();
+            TestPeephole();
+            TestRegisterAllocation();
+            TestConstantFolding();
+            TestInlining();
+            TestCfg();
+            TestDataflow();
+            TestInitialization();
+            TestSwitchLowering();
+            TestInductionVariables();
+            TestVectorizer();
+            TestTailCalls();
             printf( "[Self test complete]\n" );
             return( FALSE );
             break;
+        case OPTION_BENCH:
+            fprintf( stdout, "--bench: will run micro-benchmarks "
+                "(all other commands ignored).\n" );
+            RunBenchmarks();
+            return( FALSE );
+            break;
         case OPTION_AST:
             fprintf( stdout, "--ast: will dump abstract "
                 "syntax tree to console.\n" );
@@ -186,6 +247,41 @@ BOOL ParseOptions( int argc, char **argv )
                 "debug information.\n" );
             options[opt] = TRUE;
             break;
+        case OPTION_TRACE:
+            fprintf( stdout, "--trace: will write trace "
+                "events to file \"%s\".\n", optarg );
+            options[opt] = TRUE;
+            tracefile = strdup( optarg );
+            break;
+        case OPTION_OPTIMIZE:
+            options[opt] = TRUE;
+            optimizationLevel = atoi( optarg );
+            break;
+        case OPTION_TARGET:
+            if( strcmp( optarg, "i386" ) == 0 )
+            {
+                targetMachine = TARGET_I386;
+            }
+            else if( strcmp( optarg, "x86_64" ) == 0 )
+            {
+                targetMachine = TARGET_X86_64;
+            }
+            else
+            {
+                fprintf( stderr, "%s: unknown target \"%s\".\n", argv[0], optarg );
+                AdviseHelp( argv[0] );
+                return( FALSE );
+            }
+            options[opt] = TRUE;
+            break;
+        case OPTION_INLINE_THRESHOLD:
+            options[opt] = TRUE;
+            inlineThreshold = atoi( optarg );
+            break;
+        case OPTION_TIME:
+        case OPTION_STATS:
+            options[opt] = TRUE;
+            break;
         default:
             fprintf( stderr, "Warning: option "
                 "not implemented.\n" );
@@ -230,3 +326,37 @@ BOOL WantInternalDebug()
     return( options[OPTION_INTERNAL_DEBUG] == TRUE );
 }
 
+BOOL WantTrace()
+{
+    return( options[OPTION_TRACE] == TRUE );
+}
+
+char *GetTraceFilename()
+{
+    return( tracefile );
+}
+
+BOOL WantTimeReport()
+{
+    return( options[OPTION_TIME] == TRUE );
+}
+
+BOOL WantStatistics()
+{
+    return( options[OPTION_STATS] == TRUE );
+}
+
+int GetOptimizationLevel()
+{
+    return( optimizationLevel );
+}
+
+int GetTarget()
+{
+    return( targetMachine );
+}
+
+int GetInlineThreshold()
+{
+    return( inlineThreshold );
+}
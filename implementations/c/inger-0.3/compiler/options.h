@@ -25,6 +25,13 @@
 
 #include "defs.h"           /* BOOL type */
 
+/* Target machines (see GetTarget). */
+enum Targets
+{
+    TARGET_I386 = 0,
+    TARGET_X86_64
+};
+
 /*
  *  Parses command line options. Option values are
  *  stored in the global [options] array. Option values
@@ -85,5 +92,58 @@ char *GetAstFilename();
  */
 BOOL WantInternalDebug();
 
+/*
+ *  Checks whether --trace option was supplied.
+ *
+ *  Return values:
+ *  TRUE  - --trace was supplied
+ *  FALSE - --trace was not supplied.
+ */
+BOOL WantTrace();
+
+/*
+ * If a trace was requested (WantTrace() == TRUE),
+ * then GetTraceFilename() will return the target
+ * file name.
+ */
+char *GetTraceFilename();
+
+/*
+ *  Checks whether --time option was supplied.
+ *
+ *  Return values:
+ *  TRUE  - --time was supplied
+ *  FALSE - --time was not supplied.
+ */
+BOOL WantTimeReport();
+
+/*
+ *  Checks whether --stats option was supplied.
+ *
+ *  Return values:
+ *  TRUE  - --stats was supplied
+ *  FALSE - --stats was not supplied.
+ */
+BOOL WantStatistics();
+
+/*
+ *  Returns the optimization level given with -O
+ *  (or --optimize), or 0 if it was not supplied.
+ */
+int GetOptimizationLevel();
+
+/*
+ *  Returns the target machine given with --target:
+ *  TARGET_I386 (the default) or TARGET_X86_64.
+ */
+int GetTarget();
+
+/*
+ *  Returns the size in AST nodes of the largest
+ *  function to inline, given with --inline-threshold,
+ *  or -1 if it was not supplied.
+ */
+int GetInlineThreshold();
+
 #endif
 
@@ -631,7 +631,7 @@ TreeNode *ParseExprLogicalAnd()
     MAKEFOLLOW( RPAREN, COMMA, SEMICOLON, OP_ASSIGN, OP_LOGICAL_OR );
     SYNC( "expression must start with literal, unary operator, ( or identifier" );
 
-    childNode = ParseExprBitwiseXor();
+    childNode = ParseExprBitwiseOr();
 
     while( token == OP_LOGICAL_AND )
     {
@@ -745,9 +745,16 @@ TreeNode *ParseReference()
 TreeNode *ParseIndexBlock()
 {
     TreeNode *node;
+    int count = 0;
 
     node = CreateAstNode( NODE_INDEXBLOCK, lineCount );
-    while( token == LBRACKET ) AddAstChild( node, ParseIndex() );
+    while( token == LBRACKET )
+    {
+        AddAstChild( node, ParseIndex() );
+        count++;
+    }
+
+    TOAST( node )->val.uintvalue = count;
 
     return( node );
 }
@@ -0,0 +1,994 @@
+/*************************************************
+ *                                               *
+ *  Module: peephole.c                           *
+ *  Description:                                 *
+ *      Peephole optimizer for generated x86     *
+ *      code (-O1).                              *
+ *  Modifications:                               *
+ *                                               *
+ *************************************************
+ *                                               *
+ *   This program is free software; you can      *
+ *   redistribute it and/or modify  it under     *
+ *   the terms of the GNU General Public         *
+ *   License as published by the Free            *
+ *   Software Foundation; either version 2       *
+ *   of the License, or (at your option) any     *
+ *   later version.                              *
+ *                                               *
+ *************************************************/
+
+/*
+ *  The optimizer works on the instruction list of
+ *  one function. Every rewrite in the rewrites table
+ *  is tried at every instruction; a rewrite matches a
+ *  short sequence of consecutive instructions starting
+ *  there and replaces it. Removed instructions are
+ *  marked ASM_DELETED, and the list is compacted when
+ *  no rewrite applies anymore.
+ *
+ *  Rewrites that drop a register write check that the
+ *  register is dead afterwards: it is written again
+ *  before it is read on every path. Jumps are followed
+ *  for a limited number of instructions; when the
+ *  answer is not known, the register counts as live.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "defs.h"
+#include "asm.h"
+#include "peephole.h"
+
+/*************************************************
+ *                                               *
+ *  MACROS                                       *
+ *                                               *
+ *************************************************/
+
+/* Instructions examined when checking whether a
+ * register is dead. */
+#define LIVENESS_BUDGET     64
+
+/* Passes over a function at most. */
+#define MAX_PASSES          8
+
+#define INSTRUCTION( i )    ( &code->instructions[i] )
+
+/*************************************************
+ *                                               *
+ *  TYPES                                        *
+ *                                               *
+ *************************************************/
+
+typedef struct Rewrite
+{
+    char *name;
+    /* Tries to apply the rewrite at instruction [i].
+     * Returns TRUE if it did. */
+    BOOL (*apply)( AsmCode *code, int i );
+    unsigned long count;
+} Rewrite;
+
+/*************************************************
+ *                                               *
+ *  FORWARD DECLARATIONS                         *
+ *                                               *
+ *************************************************/
+
+static BOOL RewriteLoadLocal( AsmCode *code, int i );
+static BOOL RewriteStoreReload( AsmCode *code, int i );
+static BOOL RewriteExchange( AsmCode *code, int i );
+static BOOL RewriteCommutative( AsmCode *code, int i );
+static BOOL RewriteRegisterOperand( AsmCode *code, int i );
+static BOOL RewriteInPlace( AsmCode *code, int i );
+static BOOL RewriteSelfMove( AsmCode *code, int i );
+static BOOL RewriteDeadMove( AsmCode *code, int i );
+static BOOL RewriteCompareZero( AsmCode *code, int i );
+static BOOL RewriteJumpToNext( AsmCode *code, int i );
+static BOOL RewriteJumpToJump( AsmCode *code, int i );
+static BOOL RewriteBranchOverJump( AsmCode *code, int i );
+
+/*************************************************
+ *                                               *
+ *  GLOBALS                                      *
+ *                                               *
+ *************************************************/
+
+static Rewrite rewrites[] =
+{
+    { "load local",             RewriteLoadLocal,       0 },
+    { "store and reload",       RewriteStoreReload,     0 },
+    { "exchange after load",    RewriteExchange,        0 },
+    { "commutative operand",    RewriteCommutative,     0 },
+    { "register operand",       RewriteRegisterOperand, 0 },
+    { "operate in place",       RewriteInPlace,         0 },
+    { "self move",              RewriteSelfMove,        0 },
+    { "dead move",              RewriteDeadMove,        0 },
+    { "compare with zero",      RewriteCompareZero,     0 },
+    { "jump to next",           RewriteJumpToNext,      0 },
+    { "jump to jump",           RewriteJumpToJump,      0 },
+    { "branch over jump",       RewriteBranchOverJump,  0 },
+    { NULL,                     NULL,                   0 }
+};
+
+/* Instructions (labels and directives excluded)
+ * before and after optimization. */
+static unsigned long instructionsBefore = 0;
+static unsigned long instructionsAfter = 0;
+
+/* Index of every local label of the function being
+ * optimized, or -1. */
+static int *labelIndex = NULL;
+static int firstLabel, nrOfLabels;
+
+/*************************************************
+ *                                               *
+ *  STATIC FUNCTION DEFINITIONS                  *
+ *                                               *
+ *************************************************/
+
+/*
+ *  Returns the index of the first instruction after
+ *  [i] that was not deleted, or -1.
+ */
+static int Next( AsmCode *code, int i )
+{
+    for( i++; i < code->count; i++ )
+    {
+        if( INSTRUCTION( i )->opcode != ASM_DELETED ) return( i );
+    }
+    return( -1 );
+}
+
+static void Delete( AsmCode *code, int i )
+{
+    INSTRUCTION( i )->opcode = ASM_DELETED;
+}
+
+/*
+ *  Returns the index of local label [label], or -1 if
+ *  it is not in this function.
+ */
+static int FindLabel( int label )
+{
+    if( label < firstLabel || label >= firstLabel + nrOfLabels ) return( -1 );
+    return( labelIndex[label - firstLabel] );
+}
+
+static void BuildLabelIndex( AsmCode *code )
+{
+    Instruction *instruction;
+    int i, last = -1;
+
+    firstLabel = -1;
+    for( i = 0; i < code->count; i++ )
+    {
+        instruction = INSTRUCTION( i );
+        if( instruction->opcode != ASM_LABEL ) continue;
+        if( instruction->operands[0].kind != OPERAND_LABEL ) continue;
+        if( firstLabel < 0 || instruction->operands[0].value < firstLabel )
+        {
+            firstLabel = instruction->operands[0].value;
+        }
+        if( instruction->operands[0].value > last ) last = instruction->operands[0].value;
+    }
+
+    nrOfLabels = ( firstLabel < 0 ) ? 0 : last - firstLabel + 1;
+    labelIndex = (int *) realloc( labelIndex, ( nrOfLabels + 1 ) * sizeof( int ) );
+    if( labelIndex == NULL ) BAILOUT( ERR_NOMEM );
+    for( i = 0; i < nrOfLabels; i++ )
+    {
+        labelIndex[i] = -1;
+    }
+
+    for( i = 0; i < code->count; i++ )
+    {
+        instruction = INSTRUCTION( i );
+        if( instruction->opcode == ASM_LABEL && instruction->operands[0].kind == OPERAND_LABEL )
+        {
+            labelIndex[instruction->operands[0].value - firstLabel] = i;
+        }
+    }
+}
+
+/*
+ *  Checks whether the registers in [mask] are dead
+ *  after instruction [i]: on every path, each of them
+ *  is written before it is read. [budget] counts down
+ *  the instructions examined.
+ */
+static BOOL IsDeadAfter( AsmCode *code, int i, unsigned int mask, int *budget )
+{
+    Instruction *instruction;
+    int target;
+
+    for( i = Next( code, i ); i >= 0; i = Next( code, i ) )
+    {
+        if( --(*budget) < 0 ) return( FALSE );
+
+        instruction = INSTRUCTION( i );
+        if( AsmRegistersRead( instruction ) & mask ) return( FALSE );
+        mask &= ~AsmRegistersWritten( instruction );
+        if( mask == 0 ) return( TRUE );
+
+        switch( instruction->opcode )
+        {
+        case ASM_JMP:
+            /* Jump tables are not followed. */
+            if( instruction->operands[0].kind != OPERAND_LABEL ) return( FALSE );
+            i = FindLabel( instruction->operands[0].value );
+            if( i < 0 ) return( FALSE );
+            break;
+        case ASM_JCC:
+            target = FindLabel( instruction->operands[0].value );
+            if( target < 0 ) return( FALSE );
+            if( IsDeadAfter( code, target, mask, budget ) == FALSE ) return( FALSE );
+            break;
+        case ASM_RET:
+            return( TRUE );
+        }
+    }
+    return( FALSE );
+}
+
+static BOOL IsDead( AsmCode *code, int i, int reg )
+{
+    int budget = LIVENESS_BUDGET;
+
+    return( IsDeadAfter( code, i, REGISTER_MASK( reg ), &budget ) );
+}
+
+/* Checks whether [operand] is 32-bit register [reg]. */
+static BOOL IsRegister( Operand *operand, int reg )
+{
+    return( operand->kind == OPERAND_REGISTER && operand->size == 4
+        && operand->base == reg );
+}
+
+/* Checks whether [operand] is any 32-bit register. */
+static BOOL IsAnyRegister( Operand *operand )
+{
+    return( operand->kind == OPERAND_REGISTER && operand->size == 4 );
+}
+
+/* Checks whether [operand] reads register [reg]. */
+static BOOL Uses( Operand *operand, int reg )
+{
+    if( operand->kind != OPERAND_REGISTER && operand->kind != OPERAND_MEMORY )
+    {
+        return( FALSE );
+    }
+    return( operand->base == reg || operand->index == reg );
+}
+
+/* Checks whether instruction [i] is a 32-bit
+ * instruction [opcode] with [count] operands. */
+static BOOL Is( AsmCode *code, int i, int opcode, int count )
+{
+    return( i >= 0 && INSTRUCTION( i )->opcode == opcode
+        && INSTRUCTION( i )->size == 4 && INSTRUCTION( i )->operandCount == count );
+}
+
+/*
+ *  movl %ebp, R
+ *  addl $k, R          =>  movl k+d(%ebp), D
+ *  movl d(R), D
+ *
+ *  if R is D or dead afterwards.
+ */
+static BOOL RewriteLoadLocal( AsmCode *code, int i )
+{
+    Instruction *a, *b, *c;
+    int j, k, reg;
+
+    a = INSTRUCTION( i );
+    if( !Is( code, i, ASM_MOV, 2 ) || !IsRegister( &a->operands[0], REG_EBP )
+        || !IsAnyRegister( &a->operands[1] ) ) return( FALSE );
+    reg = a->operands[1].base;
+
+    j = Next( code, i );
+    if( !Is( code, j, ASM_ADD, 2 ) ) return( FALSE );
+    b = INSTRUCTION( j );
+    if( b->operands[0].kind != OPERAND_IMMEDIATE || !IsRegister( &b->operands[1], reg ) ) return( FALSE );
+
+    k = Next( code, j );
+    if( !Is( code, k, ASM_MOV, 2 ) ) return( FALSE );
+    c = INSTRUCTION( k );
+    if( c->operands[0].kind != OPERAND_MEMORY || c->operands[0].base != reg
+        || c->operands[0].index != REG_NONE || c->operands[0].symbol != NULL ) return( FALSE );
+    if( !IsRegister( &c->operands[1], reg ) && !IsDead( code, k, reg ) ) return( FALSE );
+
+    c->operands[0] = AsmMem( REG_EBP, b->operands[0].value + c->operands[0].value );
+    Delete( code, i );
+    Delete( code, j );
+    return( TRUE );
+}
+
+/*
+ *  movl R, M           =>  movl R, M
+ *  movl M, S               movl R, S  (or nothing if S is R)
+ */
+static BOOL RewriteStoreReload( AsmCode *code, int i )
+{
+    Instruction *a, *b;
+    int j;
+
+    a = INSTRUCTION( i );
+    if( !Is( code, i, ASM_MOV, 2 ) || !IsAnyRegister( &a->operands[0] )
+        || a->operands[1].kind != OPERAND_MEMORY ) return( FALSE );
+
+    j = Next( code, i );
+    if( !Is( code, j, ASM_MOV, 2 ) ) return( FALSE );
+    b = INSTRUCTION( j );
+    if( !AsmSameOperand( &a->operands[1], &b->operands[0] )
+        || !IsAnyRegister( &b->operands[1] ) ) return( FALSE );
+
+    if( b->operands[1].base == a->operands[0].base )
+    {
+        Delete( code, j );
+    }
+    else
+    {
+        b->operands[0] = a->operands[0];
+    }
+    return( TRUE );
+}
+
+/*
+ *  movl A, R
+ *  movl S, A           =>  movl S, R
+ *  xchgl A, R
+ *
+ *  if S does not use R.
+ */
+static BOOL RewriteExchange( AsmCode *code, int i )
+{
+    Instruction *a, *b, *c;
+    int j, k, reg, other;
+
+    a = INSTRUCTION( i );
+    if( !Is( code, i, ASM_MOV, 2 ) || !IsAnyRegister( &a->operands[0] )
+        || !IsAnyRegister( &a->operands[1] ) ) return( FALSE );
+    reg = a->operands[0].base;
+    other = a->operands[1].base;
+    if( reg == other ) return( FALSE );
+
+    j = Next( code, i );
+    if( !Is( code, j, ASM_MOV, 2 ) ) return( FALSE );
+    b = INSTRUCTION( j );
+    if( !IsRegister( &b->operands[1], reg ) || Uses( &b->operands[0], other ) ) return( FALSE );
+
+    k = Next( code, j );
+    if( !Is( code, k, ASM_XCHG, 2 ) ) return( FALSE );
+    c = INSTRUCTION( k );
+    if( !( IsRegister( &c->operands[0], reg ) && IsRegister( &c->operands[1], other ) )
+        && !( IsRegister( &c->operands[0], other ) && IsRegister( &c->operands[1], reg ) ) )
+    {
+        return( FALSE );
+    }
+
+    b->operands[1] = AsmReg( other );
+    Delete( code, i );
+    Delete( code, k );
+    return( TRUE );
+}
+
+/*
+ *  movl A, R
+ *  movl S, A           =>  op S, A
+ *  op R, A
+ *
+ *  for commutative op (add, and, or, xor, imul), if S does not use R and R is dead
+ *  afterwards.
+ */
+static BOOL RewriteCommutative( AsmCode *code, int i )
+{
+    Instruction *a, *b, *c;
+    int j, k, reg, other;
+
+    a = INSTRUCTION( i );
+    if( !Is( code, i, ASM_MOV, 2 ) || !IsAnyRegister( &a->operands[0] )
+        || !IsAnyRegister( &a->operands[1] ) ) return( FALSE );
+    reg = a->operands[0].base;
+    other = a->operands[1].base;
+    if( reg == other ) return( FALSE );
+
+    j = Next( code, i );
+    if( !Is( code, j, ASM_MOV, 2 ) ) return( FALSE );
+    b = INSTRUCTION( j );
+    if( !IsRegister( &b->operands[1], reg ) || Uses( &b->operands[0], other ) ) return( FALSE );
+
+    k = Next( code, j );
+    if( k < 0 ) return( FALSE );
+    c = INSTRUCTION( k );
+    switch( c->opcode )
+    {
+    case ASM_ADD:
+    case ASM_AND:
+    case ASM_OR:
+    case ASM_XOR:
+        if( !Is( code, k, c->opcode, 2 ) || !IsRegister( &c->operands[0], other )
+            || !IsRegister( &c->operands[1], reg ) ) return( FALSE );
+        break;
+    case ASM_IMUL:
+        if( c->operandCount == 2 )
+        {
+            if( !Is( code, k, ASM_IMUL, 2 ) || !IsRegister( &c->operands[0], other )
+                || !IsRegister( &c->operands[1], reg ) ) return( FALSE );
+            break;
+        }
+        /* One-operand imul takes no immediate operand. */
+        if( reg != REG_EAX || !Is( code, k, ASM_IMUL, 1 ) || !IsRegister( &c->operands[0], other )
+            || b->operands[0].kind == OPERAND_IMMEDIATE ) return( FALSE );
+        break;
+    default:
+        return( FALSE );
+    }
+    if( !IsDead( code, k, other ) ) return( FALSE );
+
+    c->operands[0] = b->operands[0];
+    Delete( code, i );
+    Delete( code, j );
+    return( TRUE );
+}
+
+/*
+ *  movl S, R           =>  op S, D
+ *  op R, D
+ *
+ *  for op add, sub, imul, and, or, xor, cmp, and sal or sar
+ *  with an immediate S (R is then used as %cl), and
+ *  for imul and idiv with one operand if S is not an
+ *  immediate; if R is dead afterwards.
+ */
+static BOOL RewriteRegisterOperand( AsmCode *code, int i )
+{
+    Instruction *a, *b;
+    int j, reg;
+
+    a = INSTRUCTION( i );
+    if( !Is( code, i, ASM_MOV, 2 ) || !IsAnyRegister( &a->operands[1] ) ) return( FALSE );
+    reg = a->operands[1].base;
+
+    j = Next( code, i );
+    if( j < 0 ) return( FALSE );
+    b = INSTRUCTION( j );
+    switch( b->opcode )
+    {
+    case ASM_ADD:
+    case ASM_SUB:
+    case ASM_AND:
+    case ASM_OR:
+    case ASM_XOR:
+    case ASM_CMP:
+        if( !Is( code, j, b->opcode, 2 ) || !IsRegister( &b->operands[0], reg )
+            || !IsAnyRegister( &b->operands[1] ) || b->operands[1].base == reg ) return( FALSE );
+        break;
+    case ASM_SAL:
+    case ASM_SAR:
+        if( !Is( code, j, b->opcode, 2 ) || b->operands[0].kind != OPERAND_REGISTER
+            || b->operands[0].base != reg || b->operands[1].base == reg ) return( FALSE );
+        if( a->operands[0].kind != OPERAND_IMMEDIATE
+            || a->operands[0].value < 0 || a->operands[0].value > 31 ) return( FALSE );
+        break;
+    case ASM_IMUL:
+        if( b->operandCount == 2 )
+        {
+            if( !Is( code, j, ASM_IMUL, 2 ) || !IsRegister( &b->operands[0], reg )
+                || !IsAnyRegister( &b->operands[1] ) || b->operands[1].base == reg ) return( FALSE );
+            break;
+        }
+        /* Fall through. */
+    case ASM_IDIV:
+        if( !Is( code, j, b->opcode, 1 ) || !IsRegister( &b->operands[0], reg )
+            || reg == REG_EAX || reg == REG_EDX
+            || a->operands[0].kind == OPERAND_IMMEDIATE ) return( FALSE );
+        break;
+    default:
+        return( FALSE );
+    }
+    if( !IsDead( code, j, reg ) ) return( FALSE );
+
+    b->operands[0] = a->operands[0];
+    Delete( code, i );
+    return( TRUE );
+}
+
+/*
+ *  movl R, T           =>  op S, R
+ *  op S, T
+ *  movl T, R
+ *
+ *  for op add, sub, imul, and, or, xor, sal and sar,
+ *  if S does not use T and T is dead afterwards. This
+ *  is how an assignment to a register variable that
+ *  reads the variable itself comes out.
+ */
+static BOOL RewriteInPlace( AsmCode *code, int i )
+{
+    Instruction *a, *b, *c;
+    int j, k, reg, temp;
+
+    a = INSTRUCTION( i );
+    if( !Is( code, i, ASM_MOV, 2 ) || !IsAnyRegister( &a->operands[0] )
+        || !IsAnyRegister( &a->operands[1] ) ) return( FALSE );
+    reg = a->operands[0].base;
+    temp = a->operands[1].base;
+    if( reg == temp ) return( FALSE );
+
+    j = Next( code, i );
+    if( j < 0 ) return( FALSE );
+    b = INSTRUCTION( j );
+    switch( b->opcode )
+    {
+    case ASM_ADD:
+    case ASM_SUB:
+    case ASM_IMUL:
+    case ASM_AND:
+    case ASM_OR:
+    case ASM_XOR:
+    case ASM_SAL:
+    case ASM_SAR:
+        if( !Is( code, j, b->opcode, 2 ) || !IsRegister( &b->operands[1], temp )
+            || Uses( &b->operands[0], temp ) ) return( FALSE );
+        break;
+    default:
+        return( FALSE );
+    }
+
+    k = Next( code, j );
+    if( !Is( code, k, ASM_MOV, 2 ) ) return( FALSE );
+    c = INSTRUCTION( k );
+    if( !IsRegister( &c->operands[0], temp ) || !IsRegister( &c->operands[1], reg ) ) return( FALSE );
+    if( !IsDead( code, k, temp ) ) return( FALSE );
+
+    b->operands[1] = c->operands[1];
+    Delete( code, i );
+    Delete( code, k );
+    return( TRUE );
+}
+
+/*
+ *  movl R, R           =>  (nothing)
+ */
+static BOOL RewriteSelfMove( AsmCode *code, int i )
+{
+    Instruction *a;
+
+    a = INSTRUCTION( i );
+    if( !Is( code, i, ASM_MOV, 2 ) || !IsAnyRegister( &a->operands[0] )
+        || !AsmSameOperand( &a->operands[0], &a->operands[1] ) ) return( FALSE );
+
+    Delete( code, i );
+    return( TRUE );
+}
+
+/*
+ *  movl S, R           =>  (nothing)
+ *
+ *  if R is dead afterwards.
+ */
+static BOOL RewriteDeadMove( AsmCode *code, int i )
+{
+    Instruction *a;
+
+    a = INSTRUCTION( i );
+    if( !Is( code, i, ASM_MOV, 2 ) || !IsAnyRegister( &a->operands[1] )
+        || a->operands[1].base == REG_ESP || a->operands[1].base == REG_EBP ) return( FALSE );
+    if( !IsDead( code, i, a->operands[1].base ) ) return( FALSE );
+
+    Delete( code, i );
+    return( TRUE );
+}
+
+/*
+ *  cmpl $0, R          =>  testl R, R
+ */
+static BOOL RewriteCompareZero( AsmCode *code, int i )
+{
+    Instruction *a;
+
+    a = INSTRUCTION( i );
+    if( !Is( code, i, ASM_CMP, 2 ) || a->operands[0].kind != OPERAND_IMMEDIATE
+        || a->operands[0].value != 0 || !IsAnyRegister( &a->operands[1] ) ) return( FALSE );
+
+    a->opcode = ASM_TEST;
+    a->operands[0] = a->operands[1];
+    return( TRUE );
+}
+
+/*
+ *  jmp L               =>  L:
+ *  L:
+ *
+ *  (also for conditional jumps, and when L is one of
+ *  several labels that follow the jump).
+ */
+static BOOL RewriteJumpToNext( AsmCode *code, int i )
+{
+    Instruction *a, *b;
+    int j;
+
+    a = INSTRUCTION( i );
+    if( a->opcode != ASM_JMP && a->opcode != ASM_JCC ) return( FALSE );
+
+    for( j = Next( code, i ); j >= 0; j = Next( code, j ) )
+    {
+        b = INSTRUCTION( j );
+        if( b->opcode != ASM_LABEL ) return( FALSE );
+        if( AsmSameOperand( &a->operands[0], &b->operands[0] ) )
+        {
+            Delete( code, i );
+            return( TRUE );
+        }
+    }
+    return( FALSE );
+}
+
+/*
+ *  jmp L               =>  jmp M
+ *  ...                     ...
+ *  L:                      L:
+ *  jmp M                   jmp M
+ *
+ *  (also for conditional jumps to L).
+ */
+static BOOL RewriteJumpToJump( AsmCode *code, int i )
+{
+    Instruction *a, *b;
+    int j;
+
+    a = INSTRUCTION( i );
+    if( a->opcode != ASM_JMP && a->opcode != ASM_JCC ) return( FALSE );
+    if( a->operands[0].kind != OPERAND_LABEL ) return( FALSE );
+
+    j = FindLabel( a->operands[0].value );
+    if( j < 0 ) return( FALSE );
+    for( j = Next( code, j ); j >= 0 && INSTRUCTION( j )->opcode == ASM_LABEL; j = Next( code, j ) ) ;
+    if( j < 0 || j == i || INSTRUCTION( j )->opcode != ASM_JMP ) return( FALSE );
+    b = INSTRUCTION( j );
+    if( b->operands[0].kind != OPERAND_LABEL ) return( FALSE );
+    if( AsmSameOperand( &a->operands[0], &b->operands[0] ) ) return( FALSE );
+
+    a->operands[0] = b->operands[0];
+    return( TRUE );
+}
+
+/*
+ *  jcc L               =>  jncc M
+ *  jmp M                   L:
+ *  L:
+ */
+static BOOL RewriteBranchOverJump( AsmCode *code, int i )
+{
+    Instruction *a, *b, *c;
+    int j, k;
+
+    a = INSTRUCTION( i );
+    if( a->opcode != ASM_JCC ) return( FALSE );
+
+    j = Next( code, i );
+    if( j < 0 || INSTRUCTION( j )->opcode != ASM_JMP ) return( FALSE );
+    b = INSTRUCTION( j );
+    if( b->operands[0].kind != OPERAND_LABEL ) return( FALSE );
+
+    for( k = Next( code, j ); k >= 0; k = Next( code, k ) )
+    {
+        c = INSTRUCTION( k );
+        if( c->opcode != ASM_LABEL ) return( FALSE );
+        if( AsmSameOperand( &a->operands[0], &c->operands[0] ) )
+        {
+            a->cond = AsmInvertCondition( a->cond );
+            a->operands[0] = b->operands[0];
+            Delete( code, j );
+            return( TRUE );
+        }
+    }
+    return( FALSE );
+}
+
+/*
+ *  Returns the number of instructions in [code],
+ *  labels and directives excluded.
+ */
+static int CountInstructions( AsmCode *code )
+{
+    int i, count = 0;
+
+    for( i = 0; i < code->count; i++ )
+    {
+        switch( INSTRUCTION( i )->opcode )
+        {
+        case ASM_LABEL:
+        case ASM_DIRECTIVE:
+        case ASM_DELETED:
+            break;
+        default:
+            count++;
+        }
+    }
+    return( count );
+}
+
+/*
+ *  Removes deleted instructions from [code].
+ */
+static void Compact( AsmCode *code )
+{
+    int i, count = 0;
+
+    for( i = 0; i < code->count; i++ )
+    {
+        if( INSTRUCTION( i )->opcode != ASM_DELETED )
+        {
+            code->instructions[count++] = code->instructions[i];
+        }
+    }
+    code->count = count;
+}
+
+/*************************************************
+ *                                               *
+ *  EXPORTED FUNCTION DEFINITIONS                *
+ *                                               *
+ *************************************************/
+
+void OptimizePeephole( AsmCode *code )
+{
+    Rewrite *rewrite;
+    BOOL changed = TRUE;
+    int i, pass;
+
+    instructionsBefore += CountInstructions( code );
+    BuildLabelIndex( code );
+
+    for( pass = 0; pass < MAX_PASSES && changed == TRUE; pass++ )
+    {
+        changed = FALSE;
+        for( i = 0; i < code->count; i++ )
+        {
+            if( INSTRUCTION( i )->opcode == ASM_DELETED ) continue;
+            for( rewrite = rewrites; rewrite->name != NULL; rewrite++ )
+            {
+                if( rewrite->apply( code, i ) == TRUE )
+                {
+                    rewrite->count++;
+                    changed = TRUE;
+                    if( INSTRUCTION( i )->opcode == ASM_DELETED ) break;
+                }
+            }
+        }
+    }
+
+    Compact( code );
+    instructionsAfter += CountInstructions( code );
+}
+
+void PrintPeepholeStatistics()
+{
+    Rewrite *rewrite;
+
+    fprintf( stdout, "\n%-32s %12s\n", "peephole rewrite", "count" );
+    for( rewrite = rewrites; rewrite->name != NULL; rewrite++ )
+    {
+        fprintf( stdout, "%-32s %12lu\n", rewrite->name, rewrite->count );
+    }
+    fprintf( stdout, "%-32s %12lu\n", "instructions before", instructionsBefore );
+    fprintf( stdout, "%-32s %12lu\n", "instructions after", instructionsAfter );
+}
+
+/*************************************************
+ *                                               *
+ *  TEST CODE                                    *
+ *                                               *
+ *************************************************/
+
+static void EmitLoadLocal()
+{
+    AsmEmit2( ASM_MOV, 4, AsmReg( REG_EBP ), AsmReg( REG_EAX ) );
+    AsmEmit2( ASM_ADD, 4, AsmImm( -8 ), AsmReg( REG_EAX ) );
+    AsmEmit2( ASM_MOV, 4, AsmMem( REG_EAX, 4 ), AsmReg( REG_EAX ) );
+}
+
+static void EmitStoreReload()
+{
+    AsmEmit2( ASM_MOV, 4, AsmReg( REG_ECX ), AsmMem( REG_EBP, -4 ) );
+    AsmEmit2( ASM_MOV, 4, AsmMem( REG_EBP, -4 ), AsmReg( REG_EAX ) );
+}
+
+static void EmitExchange()
+{
+    AsmEmit2( ASM_MOV, 4, AsmReg( REG_EAX ), AsmReg( REG_ECX ) );
+    AsmEmit2( ASM_MOV, 4, AsmImm( 5 ), AsmReg( REG_EAX ) );
+    AsmEmit2( ASM_XCHG, 4, AsmReg( REG_EAX ), AsmReg( REG_ECX ) );
+}
+
+static void EmitCommutative()
+{
+    AsmEmit2( ASM_MOV, 4, AsmReg( REG_EAX ), AsmReg( REG_ECX ) );
+    AsmEmit2( ASM_MOV, 4, AsmImm( 3 ), AsmReg( REG_EAX ) );
+    AsmEmit2( ASM_ADD, 4, AsmReg( REG_ECX ), AsmReg( REG_EAX ) );
+}
+
+static void EmitRegisterOperand()
+{
+    AsmEmit2( ASM_MOV, 4, AsmImm( 3 ), AsmReg( REG_ECX ) );
+    AsmEmit2( ASM_SUB, 4, AsmReg( REG_ECX ), AsmReg( REG_EAX ) );
+}
+
+static void EmitInPlace()
+{
+    AsmEmit2( ASM_MOV, 4, AsmReg( REG_EBX ), AsmReg( REG_ECX ) );
+    AsmEmit2( ASM_ADD, 4, AsmImm( 2 ), AsmReg( REG_ECX ) );
+    AsmEmit2( ASM_MOV, 4, AsmReg( REG_ECX ), AsmReg( REG_EBX ) );
+}
+
+static void EmitSelfMove()
+{
+    AsmEmit2( ASM_MOV, 4, AsmReg( REG_EAX ), AsmReg( REG_EAX ) );
+}
+
+static void EmitDeadMove()
+{
+    AsmEmit2( ASM_MOV, 4, AsmImm( 1 ), AsmReg( REG_ECX ) );
+}
+
+static void EmitCompareZero()
+{
+    AsmEmit2( ASM_CMP, 4, AsmImm( 0 ), AsmReg( REG_EAX ) );
+}
+
+static void EmitJumpToNext()
+{
+    AsmEmitJump( COND_NONE, 1 );
+    AsmEmitLabel( 1 );
+}
+
+static void EmitJumpToJump()
+{
+    AsmEmitJump( COND_E, 1 );
+    AsmEmit0( ASM_RET );
+    AsmEmitLabel( 1 );
+    AsmEmitJump( COND_NONE, 2 );
+    AsmEmitLabel( 2 );
+}
+
+static void EmitBranchOverJump()
+{
+    AsmEmitJump( COND_E, 1 );
+    AsmEmitJump( COND_NONE, 2 );
+    AsmEmitLabel( 1 );
+    AsmEmit0( ASM_RET );
+    AsmEmitLabel( 2 );
+}
+
+/*
+ *  Code that a rewrite applies to, and the code after
+ *  applying only that rewrite. Both end in a ret,
+ *  which is left out.
+ */
+typedef struct RewriteTest
+{
+    void (*emit)();
+    char *expected;
+} RewriteTest;
+
+/* A test for each rewrite, in the order of the
+ * rewrites table. */
+static RewriteTest rewriteTests[] =
+{
+    { EmitLoadLocal,        "\tmovl\t-4(%ebp), %eax\n" },
+    { EmitStoreReload,      "\tmovl\t%ecx, -4(%ebp)\n\tmovl\t%ecx, %eax\n" },
+    { EmitExchange,         "\tmovl\t$5, %ecx\n" },
+    { EmitCommutative,      "\taddl\t$3, %eax\n" },
+    { EmitRegisterOperand,  "\tsubl\t$3, %eax\n" },
+    { EmitInPlace,          "\taddl\t$2, %ebx\n" },
+    { EmitSelfMove,         "" },
+    { EmitDeadMove,         "" },
+    { EmitCompareZero,      "\ttestl\t%eax, %eax\n" },
+    { EmitJumpToNext,       ".L1:\n" },
+    { EmitJumpToJump,       "\tje\t.L2\n\tret\n.L1:\n\tjmp\t.L2\n.L2:\n" },
+    { EmitBranchOverJump,   "\tjne\t.L2\n.L1:\n\tret\n.L2:\n" }
+};
+
+/*
+ *  Writes the current code list to [text], which has
+ *  room for [size] characters, and clears the list.
+ */
+static void WriteCode( char *text, int size )
+{
+    FILE *fp;
+    int length;
+
+    fp = tmpfile();
+    if( fp == NULL ) BAILOUT( ERR_NOMEM );
+    AsmWrite( fp );
+    rewind( fp );
+    length = fread( text, 1, size - 1, fp );
+    text[length] = '\0';
+    fclose( fp );
+}
+
+/*
+ *  Applies only [rewrite] to the current code list,
+ *  until it no longer applies.
+ */
+static void ApplyRewrite( Rewrite *rewrite )
+{
+    AsmCode *code = AsmGetCode();
+    BOOL changed = TRUE;
+    int i;
+
+    BuildLabelIndex( code );
+    while( changed == TRUE )
+    {
+        changed = FALSE;
+        for( i = 0; i < code->count; i++ )
+        {
+            if( INSTRUCTION( i )->opcode == ASM_DELETED ) continue;
+            if( rewrite->apply( code, i ) == TRUE ) changed = TRUE;
+        }
+    }
+    Compact( code );
+}
+
+BOOL TestPeephole()
+{
+    char actual[256], expected[256];
+    BOOL passed = TRUE, floatResult;
+    unsigned int xmm0 = REGISTER_MASK( REG_XMM0 );
+    AsmCode *code;
+    int i;
+
+    printf( "Testing peephole optimizer...\n" );
+
+    for( i = 0; rewrites[i].name != NULL; i++ )
+    {
+        if( i == sizeof( rewriteTests ) / sizeof( rewriteTests[0] ) )
+        {
+            printf( "%s: FAILED, no test\n", rewrites[i].name );
+            passed = FALSE;
+            break;
+        }
+
+        rewriteTests[i].emit();
+        AsmEmit0( ASM_RET );
+
+        ApplyRewrite( &rewrites[i] );
+        WriteCode( actual, sizeof( actual ) );
+
+        sprintf( expected, "%s\tret\n", rewriteTests[i].expected );
+        if( strcmp( actual, expected ) == 0 )
+        {
+            printf( "%s: ok\n", rewrites[i].name );
+        }
+        else
+        {
+            printf( "%s: FAILED, got\n%s", rewrites[i].name, actual );
+            passed = FALSE;
+        }
+    }
+
+    /* A float result keeps XMM0 live up to the ret,
+     * whose operand is not printed. */
+    AsmEmit1( ASM_RET, 4, AsmReg( REG_XMM0 ) );
+    AsmEmit0( ASM_RET );
+    code = AsmGetCode();
+    floatResult = ( ( AsmRegistersRead( &code->instructions[0] ) & xmm0 ) != 0
+                    && ( AsmRegistersRead( &code->instructions[1] ) & xmm0 ) == 0 );
+    WriteCode( actual, sizeof( actual ) );
+    if( floatResult == TRUE && strcmp( actual, "\tret\n\tret\n" ) == 0 )
+    {
+        printf( "float result: ok\n" );
+    }
+    else
+    {
+        printf( "float result: FAILED, got\n%s", actual );
+        passed = FALSE;
+    }
+
+    printf( "Peephole test %s.\n\n", ( passed == TRUE ) ? "passed" : "failed" );
+    return( passed );
+}
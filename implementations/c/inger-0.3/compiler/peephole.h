@@ -0,0 +1,48 @@
+/*************************************************
+ *                                               *
+ *  Module: peephole.h                           *
+ *  Description:                                 *
+ *      Interface to the peephole optimizer      *
+ *      for generated x86 code (-O1).            *
+ *  Modifications:                               *
+ *                                               *
+ *************************************************
+ *                                               *
+ *   This program is free software; you can      *
+ *   redistribute it and/or modify  it under     *
+ *   the terms of the GNU General Public         *
+ *   License as published by the Free            *
+ *   Software Foundation; either version 2       *
+ *   of the License, or (at your option) any     *
+ *   later version.                              *
+ *                                               *
+ *************************************************/
+
+#ifndef PEEPHOLE_H
+#define PEEPHOLE_H
+
+#include "asm.h"
+
+/*
+ *  Rewrites short instruction sequences in [code]
+ *  (the code of one function) into shorter or cheaper
+ *  equivalents, until no rewrite applies anymore.
+ */
+void OptimizePeephole( AsmCode *code );
+
+/*
+ *  Prints how often each rewrite was applied, and the
+ *  instruction counts before and after optimization.
+ */
+void PrintPeepholeStatistics();
+
+/*
+ *  Tests each rewrite on a short sequence it applies
+ *  to.
+ *
+ *  Post: Returns TRUE if the test was successful,
+ *        FALSE if it failed.
+ */
+BOOL TestPeephole();
+
+#endif
@@ -24,6 +24,8 @@
 #include <malloc.h>
 #include <assert.h>
 #include "defs.h"
+#include "trace.h"
+#include "stats.h"
 
 
 /*************************************************
@@ -166,6 +168,7 @@ static BOOL IsInImportList(
     itr = importList;
     while( itr )
     {
+        STAT_COUNT( STAT_STRCMP );
         if( strcmp( fileName, itr->fileName ) == 0 )
         {
             return( TRUE );
@@ -238,6 +241,7 @@ static BOOL ImportListPop( ImportFile **importList )
         }
         else
         {
+            *importList = NULL;
             return( FALSE );
         }
     }
@@ -321,6 +325,8 @@ static void Import( char *fileName, FILE *fpOut )
         return;
     }
 
+    BeginTraceSpan( TRACE_IMPORT, fileName );
+
     /* Create new import file structure for the list. */
     importFile = ( ImportFile * )
         malloc( sizeof( ImportFile ) );
@@ -367,6 +373,8 @@ static void Import( char *fileName, FILE *fpOut )
     free( currentFile );
     currentFile = tmpFile;
     ImportListPop( &importedFilesLocal );
+
+    EndTraceSpan();
 }
 
 /*
@@ -0,0 +1,648 @@
+/*************************************************
+ *                                               *
+ *  Module: regalloc.c                           *
+ *  Description:                                 *
+ *      Linear-scan register allocator for       *
+ *      local variables and parameters.          *
+ *  Modifications:                               *
+ *                                               *
+ *************************************************
+ *                                               *
+ *   This program is free software; you can      *
+ *   redistribute it and/or modify  it under     *
+ *   the terms of the GNU General Public         *
+ *   License as published by the Free            *
+ *   Software Foundation; either version 2       *
+ *   of the License, or (at your option) any     *
+ *   later version.                              *
+ *                                               *
+ *************************************************/
+
+/*
+ *  The body of a function is numbered in evaluation
+ *  order, and each variable gets one range: from the
+ *  first to the last position where it is live. A
+ *  variable is live at its references, at the start
+ *  of each block it is live into and at the end of
+ *  each block it is live out of (see dataflow.h).
+ *  Blocks without statements have no positions; what
+ *  is live in them is also live at the end of a block
+ *  before them. Parameters and initialized locals are
+ *  set on entry, at 0. A call of the function itself
+ *  in a return jumps back to the start after setting
+ *  the parameters, so they (and whatever is live on
+ *  entry) are live across it.
+ *
+ *  Ranges are then visited in order of their start.
+ *  Each gets a free register; when none is free, the
+ *  range with the fewest uses (this one or an active
+ *  one) stays in memory. Uses in loops count more.
+ *  Variables in registers must survive calls, so EBX,
+ *  ESI and EDI are used, plus EDX for ranges without
+ *  calls or divisions. EAX and ECX are left for
+ *  expression temporaries. On x86_64 the registers
+ *  are RBX and R12 up to R15, plus R10 for ranges
+ *  without calls or divisions.
+ *
+ *  Only int, char and bool variables without
+ *  dimensions are considered, and not when their
+ *  address is taken.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "defs.h"
+#include "nodenames.h"
+#include "symtab.h"
+#include "ast.h"
+#include "asm.h"
+#include "options.h"
+#include "cfg.h"
+#include "dataflow.h"
+#include "regalloc.h"
+
+/*************************************************
+ *                                               *
+ *  MACROS                                       *
+ *                                               *
+ *************************************************/
+
+/* Most registers for variables on any target. */
+#define MAX_VARIABLE_REGISTERS      6
+
+/* A use in a loop counts as LOOP_WEIGHT uses outside
+ * it; depths beyond MAX_LOOP_DEPTH weigh the same. */
+#define LOOP_WEIGHT                 8
+#define MAX_LOOP_DEPTH              5
+
+/*************************************************
+ *                                               *
+ *  TYPES                                        *
+ *                                               *
+ *************************************************/
+
+typedef struct Interval
+{
+    Symbol *symbol;
+    int start;              /* greater than end while empty */
+    int end;
+    int weight;             /* uses, weighted by loop depth */
+    BOOL candidate;         /* may live in a register */
+} Interval;
+
+/* An interval of the self-test, and the register it
+ * should get. */
+typedef struct IntervalTest
+{
+    char *name;
+    int start, end, weight;
+    BOOL candidate;
+    int reg;
+} IntervalTest;
+
+/* A statement of block [block] of the graph. */
+typedef struct Statement
+{
+    TreeNode *node;
+    int block;
+} Statement;
+
+/*************************************************
+ *                                               *
+ *  GLOBALS                                      *
+ *                                               *
+ *************************************************/
+
+/* Registers for variables, in order of preference. The
+ * last one of each target does not survive calls. */
+static int i386Registers[] =
+{
+    REG_EBX, REG_ESI, REG_EDI, REG_EDX
+};
+
+static int x86_64Registers[MAX_VARIABLE_REGISTERS] =
+{
+    REG_EBX, REG_R12, REG_R13, REG_R14, REG_R15, REG_R10
+};
+
+/* The registers of the target. */
+static int *variableRegisters;
+static int nrOfVariableRegisters;
+
+/* The range of each variable of the dataflow facts. */
+static Interval *intervals = NULL;
+static int nrOfIntervals, maxIntervals;
+
+/* Positions of calls and divisions, which
+ * destroy EDX, in increasing order. */
+static int *clobbers = NULL;
+static int nrOfClobbers, maxClobbers;
+
+/* The statements of the graph, sorted by node, and the
+ * first and last positions of each block (-1 when the
+ * block has no statements). */
+static Statement *statements = NULL;
+static int nrOfStatements, maxStatements;
+static int *blockStart = NULL, *blockEnd = NULL;
+
+/* The positions of the calls of the function itself
+ * that are returned, from and to. */
+static int *selfCalls = NULL;
+static int nrOfSelfCalls, maxSelfCalls;
+
+/*
+ *  Intervals of the self-test, on the i386 registers
+ *  with a division at position 6. They fill the
+ *  registers, take EDX only without the division,
+ *  reuse registers that became free, and spill the
+ *  new interval (h) or an active one (f) when it is
+ *  the cheapest.
+ */
+static IntervalTest intervalTests[] =
+{
+    { "a", 0, 20, 10, TRUE, REG_EBX },
+    { "b", 1, 5, 4, TRUE, REG_ESI },
+    { "c", 2, 4, 9, TRUE, REG_EDI },
+    { "d", 3, 5, 2, TRUE, REG_EDX },
+    { "e", 5, 9, 7, TRUE, REG_EDI },
+    { "f", 7, 12, 3, TRUE, REG_NONE },
+    { "g", 8, 10, 5, TRUE, REG_EDX },
+    { "h", 8, 11, 1, TRUE, REG_NONE },
+    { "i", 9, 13, 8, TRUE, REG_ESI },
+    { "j", 2, 3, 50, FALSE, REG_NONE }
+};
+
+static Dataflow *flow;
+static char *functionName;
+static int position;
+static int loopDepth;
+
+/*************************************************
+ *                                               *
+ *  STATIC FUNCTION DEFINITIONS                  *
+ *                                               *
+ *************************************************/
+
+/*
+ *  Checks whether [symbol] is a variable that may be
+ *  kept in a register: a local int, char or bool
+ *  without dimensions.
+ */
+static BOOL IsScalar( Symbol *symbol )
+{
+    Type *type;
+    SimpleType simpleType;
+    ListNode *node;
+
+    if( symbol->global == TRUE ) return( FALSE );
+
+    node = ListFirstEx( symbol->types );
+    if( node == NULL ) return( FALSE );
+    type = (Type *) node->data;
+    if( ListFirstEx( type->dimensions ) != NULL ) return( FALSE );
+
+    simpleType = GetSimpleType( type );
+    return( simpleType == INT || simpleType == CHAR || simpleType == BOOLEAN );
+}
+
+/* Makes the range of variable [variable] include
+ * [where]. */
+static void Extend( int variable, int where )
+{
+    Interval *interval = &intervals[variable];
+
+    if( interval->start > interval->end )
+    {
+        interval->start = interval->end = where;
+    }
+    else if( where < interval->start )
+    {
+        interval->start = where;
+    }
+    else if( where > interval->end )
+    {
+        interval->end = where;
+    }
+}
+
+/* Records a reference to [name] at [where]; [use] is
+ * TRUE if the reference is a use in the body. */
+static void Reference( char *name, int where, BOOL use )
+{
+    int variable, weight = 1, i;
+
+    variable = GetVariableIndex( flow, FindSymbol( name ) );
+    if( variable < 0 ) return;
+    Extend( variable, where );
+
+    if( use == TRUE )
+    {
+        for( i = 0; i < loopDepth && i < MAX_LOOP_DEPTH; i++ )
+        {
+            weight *= LOOP_WEIGHT;
+        }
+        intervals[variable].weight += weight;
+    }
+}
+
+/* Appends [value] to [array], which has [count] of
+ * [max] elements. */
+static void Append( int **array, int *count, int *max, int value )
+{
+    if( *count == *max )
+    {
+        *max = ( *max == 0 ) ? 16 : *max * 2;
+        *array = (int *) realloc( *array, *max * sizeof( int ) );
+        if( *array == NULL ) BAILOUT( ERR_NOMEM );
+    }
+    ( *array )[( *count )++] = value;
+}
+
+static int CompareNodes( const void *a, const void *b )
+{
+    TreeNode *x = ( (Statement *) a )->node, *y = ( (Statement *) b )->node;
+
+    return( ( x < y ) ? -1 : ( x > y ) );
+}
+
+/* Collects the statements of the graph of [flow]. */
+static void CollectStatements()
+{
+    Cfg *cfg = flow->cfg;
+    int i, j;
+
+    blockStart = (int *) realloc( blockStart, cfg->nrOfBlocks * sizeof( int ) );
+    blockEnd = (int *) realloc( blockEnd, cfg->nrOfBlocks * sizeof( int ) );
+    if( blockStart == NULL || blockEnd == NULL ) BAILOUT( ERR_NOMEM );
+
+    nrOfStatements = 0;
+    for( i = 0; i < cfg->nrOfBlocks; i++ )
+    {
+        blockStart[i] = blockEnd[i] = -1;
+        for( j = 0; j < cfg->blocks[i].nrOfNodes; j++ )
+        {
+            if( nrOfStatements == maxStatements )
+            {
+                maxStatements = ( maxStatements == 0 ) ? 64 : maxStatements * 2;
+                statements = (Statement *) realloc( statements, maxStatements * sizeof( Statement ) );
+                if( statements == NULL ) BAILOUT( ERR_NOMEM );
+            }
+            statements[nrOfStatements].node = cfg->blocks[i].nodes[j];
+            statements[nrOfStatements++].block = i;
+        }
+    }
+    if( nrOfStatements > 1 )
+    {
+        qsort( statements, nrOfStatements, sizeof( Statement ), CompareNodes );
+    }
+}
+
+/* Returns the block of statement [node], or -1 if it
+ * is not a statement of the graph. */
+static int GetBlockOf( TreeNode *node )
+{
+    Statement key, *statement;
+
+    key.node = node;
+    statement = (Statement *) bsearch( &key, statements, nrOfStatements, sizeof( Statement ),
+        CompareNodes );
+    return( ( statement == NULL ) ? -1 : statement->block );
+}
+
+/* Checks whether [node] returns a call of the function
+ * itself, which is a jump back to its start. */
+static BOOL IsSelfTailCall( TreeNode *node )
+{
+    TreeNode *value;
+
+    if( TOAST( node )->id != NODE_RETURN || ListSize( node->children ) == 0 ) return( FALSE );
+    value = GetTreeChild( node, 0 );
+    return( TOAST( value )->id == NODE_APPLICATION
+        && strcmp( GetNameFromApplication( value ), functionName ) == 0 );
+}
+
+/*
+ *  Numbers [node] and its children in evaluation
+ *  order, and records variable references and the
+ *  positions of the statements.
+ */
+static void BuildIntervals( TreeNode *node )
+{
+    ListNode *child;
+    int block, start;
+
+    start = ++position;
+    block = GetBlockOf( node );
+
+    switch( TOAST( node )->id )
+    {
+    case NODE_DECLARATION:
+        /* Locals are initialized on function entry. */
+        if( GetInitializerFromDecl( node ) != NULL )
+        {
+            Reference( GetNameFromDecl( node ), 0, FALSE );
+        }
+        return;
+
+    case NODE_LIT_IDENTIFIER:
+        Reference( GetNameOfIdentifier( node ), position, TRUE );
+        break;
+
+    case NODE_APPLICATION:
+    case NODE_DIVIDE:
+    case NODE_MODULUS:
+        Append( &clobbers, &nrOfClobbers, &maxClobbers, position );
+        break;
+
+    case NODE_WHILE:
+        loopDepth++;
+        break;
+    }
+
+    for( child = ListFirstEx( node->children ); child != NULL; child = ListNextEx( child ) )
+    {
+        BuildIntervals( (TreeNode *) child->data );
+    }
+
+    if( TOAST( node )->id == NODE_WHILE ) loopDepth--;
+    if( IsSelfTailCall( node ) == TRUE )
+    {
+        Append( &selfCalls, &nrOfSelfCalls, &maxSelfCalls, start );
+        Append( &selfCalls, &nrOfSelfCalls, &maxSelfCalls, position );
+    }
+    if( block >= 0 )
+    {
+        if( blockStart[block] < 0 ) blockStart[block] = start;
+        blockEnd[block] = position;
+    }
+}
+
+/* Makes the ranges of the variables in [set] include
+ * [where]. */
+static void ExtendLive( unsigned int *set, int where )
+{
+    int i;
+
+    for( i = 0; i < flow->nrOfVariables; i++ )
+    {
+        if( IN_SET( set, i ) ) Extend( i, where );
+    }
+}
+
+/*
+ *  Makes the ranges cover the blocks the variables are
+ *  live in, and the returned calls of the function
+ *  itself.
+ */
+static void ExtendIntervals( TreeNode *header )
+{
+    unsigned int **in = flow->in[DATAFLOW_LIVENESS], **out = flow->out[DATAFLOW_LIVENESS];
+    int i, j, k;
+
+    ExtendLive( out[CFG_ENTRY], 0 );
+    for( i = 0; i < flow->cfg->nrOfBlocks; i++ )
+    {
+        if( flow->cfg->blocks[i].reachable == FALSE || blockStart[i] < 0 ) continue;
+        ExtendLive( in[i], blockStart[i] );
+        ExtendLive( out[i], blockEnd[i] );
+    }
+
+    for( i = 0; i < nrOfSelfCalls; i += 2 )
+    {
+        for( j = 0; j < 2; j++ )
+        {
+            ExtendLive( out[CFG_ENTRY], selfCalls[i + j] );
+            for( k = 0; k < GetParamCountFromHeader( header ); k++ )
+            {
+                Reference( GetParamNameFromHeader( header, k ), selfCalls[i + j], FALSE );
+            }
+        }
+    }
+}
+
+/* Checks whether no call or division falls within
+ * [interval]. */
+static BOOL IsClobberFree( Interval *interval )
+{
+    int low = 0, high = nrOfClobbers, middle;
+
+    /* Find the first clobber at or after the start. */
+    while( low < high )
+    {
+        middle = ( low + high ) / 2;
+        if( clobbers[middle] < interval->start )
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+    return( low == nrOfClobbers || clobbers[low] > interval->end );
+}
+
+/* Checks whether [interval] may use register [r] of
+ * variableRegisters. */
+static BOOL MayUse( Interval *interval, int r )
+{
+    return( r < nrOfVariableRegisters - 1 || IsClobberFree( interval ) );
+}
+
+static int CompareStart( const void *a, const void *b )
+{
+    Interval *x = (Interval *) a, *y = (Interval *) b;
+
+    if( x->start != y->start ) return( x->start - y->start );
+    return( x->end - y->end );
+}
+
+/*
+ *  Assigns registers to the candidates among the
+ *  intervals by linear scan, and returns the mask of
+ *  the registers assigned.
+ */
+static unsigned int ScanIntervals()
+{
+    Interval *interval, *active[MAX_VARIABLE_REGISTERS], *cheapest;
+    unsigned int assigned = 0;
+    int i, j, r;
+
+    for( i = 0; i < nrOfIntervals; i++ )
+    {
+        intervals[i].symbol->reg = REG_NONE;
+    }
+    if( nrOfIntervals > 1 )
+    {
+        qsort( intervals, nrOfIntervals, sizeof( Interval ), CompareStart );
+    }
+
+    /* active[r] is the interval in variableRegisters[r]. */
+    for( r = 0; r < nrOfVariableRegisters; r++ )
+    {
+        active[r] = NULL;
+    }
+
+    for( i = 0; i < nrOfIntervals; i++ )
+    {
+        interval = &intervals[i];
+        if( interval->candidate == FALSE || interval->start > interval->end ) continue;
+
+        /* Expire ranges that ended. */
+        for( r = 0; r < nrOfVariableRegisters; r++ )
+        {
+            if( active[r] != NULL && active[r]->end < interval->start ) active[r] = NULL;
+        }
+
+        for( r = 0; r < nrOfVariableRegisters; r++ )
+        {
+            if( active[r] == NULL && MayUse( interval, r ) ) break;
+        }
+
+        if( r == nrOfVariableRegisters )
+        {
+            /* No register free: the range with the fewest
+             * uses stays in memory, or of equal ranges the
+             * one that ends last. */
+            cheapest = interval;
+            for( j = 0; j < nrOfVariableRegisters; j++ )
+            {
+                if( active[j] == NULL || MayUse( interval, j ) == FALSE )
+                {
+                    continue;
+                }
+                if( active[j]->weight < cheapest->weight
+                    || ( active[j]->weight == cheapest->weight && active[j]->end > cheapest->end ) )
+                {
+                    cheapest = active[j];
+                    r = j;
+                }
+            }
+            if( cheapest == interval ) continue;
+            cheapest->symbol->reg = REG_NONE;
+        }
+
+        active[r] = interval;
+        interval->symbol->reg = variableRegisters[r];
+        assigned |= REGISTER_MASK( variableRegisters[r] );
+    }
+
+    return( assigned );
+}
+
+static void SelectRegisters()
+{
+    if( GetTarget() == TARGET_X86_64 )
+    {
+        variableRegisters = x86_64Registers;
+        nrOfVariableRegisters = sizeof( x86_64Registers ) / sizeof( int );
+    }
+    else
+    {
+        variableRegisters = i386Registers;
+        nrOfVariableRegisters = sizeof( i386Registers ) / sizeof( int );
+    }
+}
+
+/*************************************************
+ *                                               *
+ *  EXPORTED FUNCTION DEFINITIONS                *
+ *                                               *
+ *************************************************/
+
+unsigned int AllocateVariableRegisters( TreeNode *node )
+{
+    TreeNode *header;
+    int i;
+
+    SelectRegisters();
+    flow = GetDataflow( node, DATAFLOW_LIVENESS );
+    header = GetHeaderFromFunction( node );
+    functionName = GetNameFromHeader( header );
+
+    nrOfIntervals = flow->nrOfVariables;
+    if( nrOfIntervals > maxIntervals )
+    {
+        maxIntervals = nrOfIntervals;
+        intervals = (Interval *) realloc( intervals, maxIntervals * sizeof( Interval ) );
+        if( intervals == NULL ) BAILOUT( ERR_NOMEM );
+    }
+    for( i = 0; i < nrOfIntervals; i++ )
+    {
+        intervals[i].symbol = flow->variables[i];
+        intervals[i].start = 1;
+        intervals[i].end = 0;
+        intervals[i].weight = 0;
+        intervals[i].candidate = IsScalar( flow->variables[i] );
+    }
+    nrOfClobbers = 0;
+    nrOfSelfCalls = 0;
+    position = 0;
+    loopDepth = 0;
+
+    /* Parameters are defined on entry. */
+    for( i = 0; i < GetParamCountFromHeader( header ); i++ )
+    {
+        Reference( GetParamNameFromHeader( header, i ), 0, FALSE );
+    }
+    CollectStatements();
+    BuildIntervals( GetBlockFromFunction( node ) );
+    ExtendIntervals( header );
+
+    return( ScanIntervals() );
+}
+
+BOOL TestRegisterAllocation()
+{
+    Symbol *symbols[sizeof( intervalTests ) / sizeof( IntervalTest )];
+    BOOL passed = TRUE;
+    unsigned int assigned;
+    int i;
+
+    printf( "Testing register allocation...\n" );
+
+    variableRegisters = i386Registers;
+    nrOfVariableRegisters = sizeof( i386Registers ) / sizeof( int );
+    nrOfIntervals = sizeof( intervalTests ) / sizeof( IntervalTest );
+    if( nrOfIntervals > maxIntervals )
+    {
+        maxIntervals = nrOfIntervals;
+        intervals = (Interval *) realloc( intervals, maxIntervals * sizeof( Interval ) );
+        if( intervals == NULL ) BAILOUT( ERR_NOMEM );
+    }
+    for( i = 0; i < nrOfIntervals; i++ )
+    {
+        symbols[i] = CreateSymbol( intervalTests[i].name );
+        intervals[i].symbol = symbols[i];
+        intervals[i].start = intervalTests[i].start;
+        intervals[i].end = intervalTests[i].end;
+        intervals[i].weight = intervalTests[i].weight;
+        intervals[i].candidate = intervalTests[i].candidate;
+    }
+    nrOfClobbers = 0;
+    Append( &clobbers, &nrOfClobbers, &maxClobbers, 6 );
+
+    assigned = ScanIntervals();
+
+    for( i = 0; i < nrOfIntervals; i++ )
+    {
+        printf( "%s [%d,%d]: %d", intervalTests[i].name, intervalTests[i].start,
+            intervalTests[i].end, symbols[i]->reg );
+        if( symbols[i]->reg != intervalTests[i].reg )
+        {
+            printf( ", FAILED (expected %d)", intervalTests[i].reg );
+            passed = FALSE;
+        }
+        printf( "\n" );
+    }
+    if( assigned != ( REGISTER_MASK( REG_EBX ) | REGISTER_MASK( REG_ESI )
+        | REGISTER_MASK( REG_EDI ) | REGISTER_MASK( REG_EDX ) ) )
+    {
+        printf( "register mask %x: FAILED\n", assigned );
+        passed = FALSE;
+    }
+
+    printf( "Register allocation test %s.\n\n", ( passed == TRUE ) ? "passed" : "failed" );
+    return( passed );
+}
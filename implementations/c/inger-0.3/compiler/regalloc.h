@@ -0,0 +1,50 @@
+/*************************************************
+ *                                               *
+ *  Module: regalloc.h                           *
+ *  Description:                                 *
+ *      Interface to the linear-scan register    *
+ *      allocator for local variables and        *
+ *      parameters.                              *
+ *  Modifications:                               *
+ *                                               *
+ *************************************************
+ *                                               *
+ *   This program is free software; you can      *
+ *   redistribute it and/or modify  it under     *
+ *   the terms of the GNU General Public         *
+ *   License as published by the Free            *
+ *   Software Foundation; either version 2       *
+ *   of the License, or (at your option) any     *
+ *   later version.                              *
+ *                                               *
+ *************************************************/
+
+#ifndef REGALLOC_H
+#define REGALLOC_H
+
+#include "tree.h"
+
+/*
+ *  Assigns registers to the scalar local variables
+ *  and parameters of function [node], by linear scan
+ *  over their live ranges. The register of each
+ *  variable is stored in its symbol (reg); variables
+ *  that stay in memory get REG_NONE.
+ *  Returns the mask (see REGISTER_MASK) of all
+ *  registers assigned.
+ *
+ *  Pre: the function's scope has been entered in
+ *       the symbol table.
+ */
+unsigned int AllocateVariableRegisters( TreeNode *node );
+
+/*
+ *  Tests the linear scan on a small set of live
+ *  ranges with known registers.
+ *
+ *  Post: Returns TRUE if the test was successful,
+ *        FALSE if it failed.
+ */
+BOOL TestRegisterAllocation();
+
+#endif
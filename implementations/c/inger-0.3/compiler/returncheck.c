@@ -2,8 +2,8 @@
 *                                               *
 *  Module: returncheck.c                        *
 *  Description:                                 *
-*      Check function code block for return     *
-*      keyword as last statement in block       *
+*      Check on the control flow graph that     *
+*      functions return a value on every path   *
 *  Author: Haaring, J.W.                        *
 *  Modifications:                               *
 *    [JWH] : Added unreachable code check       *
@@ -20,6 +20,8 @@
 *                                               *
 ************************************************/
 
+/* malloc need this */
+#include <stdlib.h>
 /* Include assertion macro. */
 #include <assert.h>
 /* Need strcmp */
@@ -34,14 +36,66 @@
 #include "ast.h"
 /* Include func param interface */
 #include "returncheck.h"
+/* Include control flow graph interface. */
+#include "cfg.h"
 /* Include for AddError() function. */
 #include "errors.h"
 #include "options.h"
 
+/*
+ * Warns once for each region of unreachable code in
+ * [cfg]: the first unreachable block with statements,
+ * in the order the blocks were made, and then all the
+ * blocks it leads to are taken as warned about. Every
+ * block is looked at once.
+ */
+static void CheckUnreachableCode( Cfg *cfg )
+{
+    BasicBlock *block;
+    BOOL *warned;
+    int *stack, top, i, j;
+
+    warned = (BOOL *) malloc( cfg->nrOfBlocks * sizeof( BOOL ) );
+    stack = (int *) malloc( cfg->nrOfBlocks * sizeof( int ) );
+    if( warned == NULL || stack == NULL ) BAILOUT( ERR_NOMEM );
+    for( i = 0; i < cfg->nrOfBlocks; i++ )
+    {
+        warned[i] = FALSE;
+    }
+
+    for( i = 0; i < cfg->nrOfBlocks; i++ )
+    {
+        block = &cfg->blocks[i];
+        if( block->reachable == TRUE || warned[i] == TRUE || block->nrOfNodes == 0 ) continue;
+
+        AddWarning( "unreachable code", TOAST( block->nodes[0] )->lineno );
+        warned[i] = TRUE;
+        stack[0] = i;
+        top = 1;
+        while( top > 0 )
+        {
+            block = &cfg->blocks[stack[--top]];
+            for( j = 0; j < block->nrOfSuccessors; j++ )
+            {
+                if( cfg->blocks[block->successors[j]].reachable == FALSE
+                    && warned[block->successors[j]] == FALSE )
+                {
+                    warned[block->successors[j]] = TRUE;
+                    stack[top++] = block->successors[j];
+                }
+            }
+        }
+    }
+
+    free( warned );
+    free( stack );
+}
+
 void CheckFunctionReturns( TreeNode * ast )
 {
     ListNode *listNode = NULL;
     TreeNode *codeNode = NULL;
+    Cfg *cfg;
 
     assert( ast != NULL );
 
@@ -51,18 +105,15 @@ void CheckFunctionReturns( TreeNode * ast )
             codeNode = GetBlockFromFunction( ast );
             if( codeNode != NULL )
             {
-                if( GetReturnTypeFromHeader( GetHeaderFromFunction( ast ) ) != NODE_VOID )
-                {
-                    if( CheckReturnCall( codeNode ) == FALSE )
-                    {
-                        AddWarning( "control reaches end of non-void function",
-                                        TOAST( codeNode )->lineno );
-                    }
-                }
-                if( HasUnreachableCode( codeNode ) == TRUE )
+                cfg = BuildCfg( ast );
+                if( GetReturnTypeFromHeader( GetHeaderFromFunction( ast ) ) != NODE_VOID
+                    && cfg->blocks[cfg->end].reachable == TRUE )
                 {
-                    AddWarning( "function has unreachable code", TOAST( codeNode )->lineno );
+                    AddWarning( "control reaches end of non-void function",
+                                    TOAST( codeNode )->lineno );
                 }
+                CheckUnreachableCode( cfg );
+                FreeCfg( cfg );
             }
             break;
 
@@ -77,129 +128,3 @@ void CheckFunctionReturns( TreeNode * ast )
             break;
     }
 }
-
-BOOL CheckReturnCall( TreeNode * codeNode )
-{
-    ListNode *listNode = NULL, *caseNode = NULL;
-    TreeNode *tempNode = NULL, *lastNode = NULL,
-             *thenNode = NULL, *elseNode = NULL;
-
-    assert( codeNode != NULL );
-
-    listNode = ListLastEx( codeNode->children );
-    lastNode = ( TreeNode * ) listNode->data;
-
-    listNode = ListFirstEx( codeNode->children );
-    while( listNode != NULL )
-    {
-        tempNode = ( TreeNode * ) listNode->data;
-        switch( TOAST( tempNode )->id )
-        {
-            case NODE_RETURN:
-                return( TRUE );
-
-            case NODE_IF:
-                thenNode = GetThenBlockFromIf( tempNode );
-                elseNode = GetElseBlockFromIf( tempNode );
-
-                if( ( thenNode != NULL ) && ( elseNode != NULL ) )
-                {
-                    if( ( CheckReturnCall( thenNode ) == TRUE ) &&
-                        ( CheckReturnCall( elseNode ) == TRUE ) )
-                    {
-                        return( TRUE );
-                    }
-                }
-                else if( ( thenNode != NULL ) && ( elseNode == NULL ) )
-                {
-                    if( CheckReturnCall( thenNode ) == TRUE )
-                    {
-                        return( TRUE );
-                    }
-                }
-                else if( ( thenNode == NULL ) && ( elseNode != NULL ) )
-                {
-                    if( CheckReturnCall( elseNode ) == TRUE )
-                    {
-                        return( TRUE );
-                    }
-                }
-                break;
-
-            case NODE_SWITCH:
-                elseNode = GetTreeChild( tempNode, 2 );
-                caseNode = ListFirstEx( elseNode->children ); 
-                thenNode = (TreeNode *) caseNode->data;
-                printf( "nodename of caseNode: %s\n", GetNodeName( TOAST( thenNode )->id ) );
-                
-                caseNode = ListNextEx( caseNode );
-                thenNode = (TreeNode *) caseNode->data;
-                printf( "nodename of caseNode: %s\n", GetNodeName( TOAST( thenNode )->id ) );
-
-                if( elseNode != NULL )
-                {
-                    printf( "nodeNode for elseNode = %s\n", GetNodeName( TOAST( elseNode )->id ) );
-                } 
-                printf( "switch found\n" );
-                break;
-
-            default:
-                break;
-                
-        }
-        listNode = ListNextEx( listNode );
-    }
-
-    return( FALSE );
-}
-
-
-
-BOOL HasUnreachableCode( TreeNode * codeNode )
-{
-    ListNode *listNode = NULL;
-    TreeNode *tempNode = NULL;
-    TreeNode *lastChild = NULL;
-
-    if( codeNode == NULL )
-    {
-        return( FALSE );
-    }
-
-    listNode = ListLastEx( codeNode->children );
-    lastChild = ( TreeNode * ) listNode->data;
-
-    listNode = ListFirstEx( codeNode->children );
-
-    while( listNode != NULL )
-    {
-        tempNode = ( TreeNode * ) listNode->data;
-        switch( TOAST( tempNode )->id )
-        {
-            case NODE_RETURN:
-                if( tempNode != lastChild )
-                {
-                    return( TRUE );
-                }
-                break;
-
-            case NODE_IF:
-                if( HasUnreachableCode( GetThenBlockFromIf( tempNode ) ) == TRUE )
-                {
-                    AddWarning( "unreachable code in then block", TOAST( tempNode )->lineno );
-                }
-                if( HasUnreachableCode( GetElseBlockFromIf( tempNode ) ) == TRUE )
-                {
-                    AddWarning( "unreachable code in else block", TOAST( tempNode )->lineno );
-                }
-                break;
-
-            default:
-                break;
-        } 
-        listNode = ListNextEx( listNode );
-    }
-
-    return( FALSE );
-}
-
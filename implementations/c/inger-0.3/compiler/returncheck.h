@@ -2,8 +2,8 @@
 *                                               *
 *  Module: returncheck.h                        *
 *  Description:                                 *
-*      Check function code block for return     *
-*      keyword as last statement in block       *
+*      Check on the control flow graph that     *
+*      functions return a value on every path   *
 *      Additionally this module checks for      *
 *      unreachable code.                        *
 *  Author: Haaring, J.W.                        *
@@ -32,23 +32,14 @@
 #include "ast.h"
 
 /*
-*  Check all function applications on correct number of
-*  arguments, defined in the function header. Also check
-*  for user of functions without an implementation or
-*  extern declaration.
+*  Check the function definitions in [ast] on the
+*  control flow of their bodies: warn when control
+*  can reach the end of a function that returns a
+*  value, and where code can never run.
 *
 *  Pre:  [ast] is not NULL and a valid TreeNode
 *
-*  Post: TRUE is returned if no invalid arguments # 
-*        were found, otherwise the return value is FALSE
-*
 */
-BOOL CheckReturnCall( TreeNode * codeNode );
-
-
 void CheckFunctionReturns( TreeNode * ast );
 
-
-BOOL HasUnreachableCode( TreeNode * codeNode );
-
 #endif
@@ -0,0 +1,163 @@
+/*************************************************
+ *                                               *
+ *  Module: selftest.c                           *
+ *  Description:                                 *
+ *      Support for self-tests that compile a    *
+ *      small program.                           *
+ *  Modifications:                               *
+ *                                               *
+ *************************************************
+ *                                               *
+ *   This program is free software; you can      *
+ *   redistribute it and/or modify  it under     *
+ *   the terms of the GNU General Public         *
+ *   License as published by the Free            *
+ *   Software Foundation; either version 2       *
+ *   of the License, or (at your option) any     *
+ *   later version.                              *
+ *                                               *
+ *************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "defs.h"
+#include "nodenames.h"
+#include "ast.h"
+#include "tokens.h"
+#include "getsymbols.h"
+#include "symtab.h"
+#include "typechecking.h"
+#include "lvalue.h"
+#include "funcparams.h"
+#include "switchcheck.h"
+#include "returncheck.h"
+#include "errors.h"
+#include "options.h"
+#include "initcheck.h"
+#include "inline.h"
+#include "constfold.h"
+#include "dataflow.h"
+#include "codegen.h"
+#include "selftest.h"
+
+extern FILE *yyin;
+extern FILE *g_outFile;
+extern int optimizationLevel;
+extern int targetMachine;
+
+/*************************************************
+ *                                               *
+ *  STATIC FUNCTION DEFINITIONS                  *
+ *                                               *
+ *************************************************/
+
+/*
+ *  Looks for function [name] in [node], entering and
+ *  leaving the scopes of the functions before it.
+ */
+static TreeNode *FindFunction( TreeNode *node, char *name )
+{
+    TreeNode *function;
+    ListNode *child;
+
+    if( TOAST( node )->id == NODE_FUNCTION )
+    {
+        if( GetBlockFromFunction( node ) == NULL ) return( NULL );
+        EnterScope();
+        if( strcmp( GetNameFromHeader( GetHeaderFromFunction( node ) ), name ) == 0 )
+        {
+            return( node );
+        }
+        ExitScope();
+        return( NULL );
+    }
+
+    for( child = ListFirstEx( node->children ); child != NULL; child = ListNextEx( child ) )
+    {
+        function = FindFunction( (TreeNode *) child->data, name );
+        if( function != NULL ) return( function );
+    }
+    return( NULL );
+}
+
+/*************************************************
+ *                                               *
+ *  EXPORTED FUNCTION DEFINITIONS                *
+ *                                               *
+ *************************************************/
+
+TreeNode *ParseTestProgram( char *source )
+{
+    TreeNode *ast;
+    FILE *fp;
+
+    fp = tmpfile();
+    if( fp == NULL ) BAILOUT( ERR_NOMEM );
+    fputs( source, fp );
+    rewind( fp );
+
+    yyin = fp;
+    InitializeReport();
+    ast = Parse();
+    if( GetErrorCount() == 0 ) CreateSymbolTable( ast );
+    if( GetErrorCount() == 0 )
+    {
+        CheckLeftValues( ast );
+        CheckArgCount( ast );
+        CheckSwitchStatements( ast );
+        CheckFunctionReturns( ast );
+    }
+    if( GetErrorCount() == 0 ) DecorateAstWithTypes( ast );
+    fclose( fp );
+
+    if( GetErrorCount() > 0 )
+    {
+        PrintReport();
+        return( NULL );
+    }
+    return( ast );
+}
+
+TreeNode *EnterTestFunction( TreeNode *ast, char *name )
+{
+    GotoSymbolRoot();
+    return( FindFunction( ast, name ) );
+}
+
+char *CompileTestProgram( char *source, int target, int level )
+{
+    TreeNode *ast;
+    char *text = NULL;
+    int savedTarget = targetMachine, savedLevel = optimizationLevel;
+    long length;
+
+    targetMachine = target;
+    optimizationLevel = level;
+
+    ast = ParseTestProgram( source );
+    if( ast != NULL )
+    {
+        CheckInitialization( ast );
+        if( level >= 1 )
+        {
+            InlineFunctions( ast );
+            FoldConstants( ast );
+        }
+
+        g_outFile = tmpfile();
+        if( g_outFile == NULL ) BAILOUT( ERR_NOMEM );
+        GenerateCode( ast );
+        length = ftell( g_outFile );
+        rewind( g_outFile );
+        text = (char *) malloc( length + 1 );
+        if( text == NULL ) BAILOUT( ERR_NOMEM );
+        text[fread( text, 1, length, g_outFile )] = '\0';
+        fclose( g_outFile );
+        FreeDataflows();
+    }
+
+    targetMachine = savedTarget;
+    optimizationLevel = savedLevel;
+    return( text );
+}
@@ -0,0 +1,50 @@
+/*************************************************
+ *                                               *
+ *  Module: selftest.h                           *
+ *  Description:                                 *
+ *      Support for self-tests that compile a    *
+ *      small program.                           *
+ *  Modifications:                               *
+ *                                               *
+ *************************************************
+ *                                               *
+ *   This program is free software; you can      *
+ *   redistribute it and/or modify  it under     *
+ *   the terms of the GNU General Public         *
+ *   License as published by the Free            *
+ *   Software Foundation; either version 2       *
+ *   of the License, or (at your option) any     *
+ *   later version.                              *
+ *                                               *
+ *************************************************/
+
+#ifndef SELFTEST_H
+#define SELFTEST_H
+
+#include "tree.h"
+
+/*
+ *  Parses program [source], builds its symbol table
+ *  and checks and decorates it with types, as is done
+ *  for a source file. Returns the AST, or NULL if
+ *  there were errors.
+ */
+TreeNode *ParseTestProgram( char *source );
+
+/*
+ *  Returns function [name] of program [ast], with its
+ *  scope entered in the symbol table, or NULL if there
+ *  is no such function with a body.
+ */
+TreeNode *EnterTestFunction( TreeNode *ast, char *name );
+
+/*
+ *  Compiles program [source] for [target] (see
+ *  options.h) at optimization level [level], as is
+ *  done for a source file, and returns the assembly,
+ *  which the caller frees, or NULL if there were
+ *  errors.
+ */
+char *CompileTestProgram( char *source, int target, int level );
+
+#endif
@@ -0,0 +1,159 @@
+/*************************************************
+ *                                               *
+ *  Module: stats.c                              *
+ *  Description:                                 *
+ *      Counts calls to hot functions and keeps  *
+ *      histograms of their costs. Dumped with   *
+ *      --stats; compiled out with NDEBUG.       *
+ *  Modifications:                               *
+ *                                               *
+ *************************************************
+ *                                               *
+ *   This program is free software; you can      *
+ *   redistribute it and/or modify  it under     *
+ *   the terms of the GNU General Public         *
+ *   License as published by the Free            *
+ *   Software Foundation; either version 2       *
+ *   of the License, or (at your option) any     *
+ *   later version.                              *
+ *                                               *
+ *************************************************/
+
+#include <stdio.h>
+#include <assert.h>
+#include "defs.h"
+#include "nodenames.h"
+#include "stats.h"
+
+/*************************************************
+ *                                               *
+ *  MACROS                                       *
+ *                                               *
+ *************************************************/
+
+/* Number of power-of-two buckets per histogram. */
+#define NR_OF_BUCKETS       32
+
+#define MSG_NO_STATS        "Statistics are not available in release builds.\n"
+
+
+/*************************************************
+ *                                               *
+ *  TYPES                                        *
+ *                                               *
+ *************************************************/
+
+/*
+ *  Histogram with power-of-two buckets: bucket 0
+ *  holds value 0, bucket n holds 2^(n-1) .. 2^n - 1.
+ */
+typedef struct Histogram
+{
+    unsigned long samples;
+    unsigned long sum;
+    int max;
+    unsigned long buckets[NR_OF_BUCKETS];
+} Histogram;
+
+
+/*************************************************
+ *                                               *
+ *  GLOBALS                                      *
+ *                                               *
+ *************************************************/
+
+unsigned long g_statCounters[NR_OF_COUNTERS];
+unsigned long g_statNodes[NR_OF_NODES];
+
+static Histogram histograms[NR_OF_HISTOGRAMS];
+
+static char *counterNames[NR_OF_COUNTERS] =
+{
+    "FindSymbol",
+    "FindInSymbolList",
+    "strcmp",
+    "ListSize",
+    "GetTreeChild",
+    "TokenvalueToString",
+    "allocation"
+};
+
+static char *histogramNames[NR_OF_HISTOGRAMS] =
+{
+    "scopes searched per FindSymbol",
+    "list length per ListSize",
+    "nodes skipped per GetTreeChild"
+};
+
+
+/*************************************************
+ *                                               *
+ *  EXPORTED FUNCTION DEFINITIONS                *
+ *                                               *
+ *************************************************/
+
+void SampleHistogram( int hist, int value )
+{
+    Histogram *h;
+    int bucket = 0;
+
+    assert( hist >= 0 && hist < NR_OF_HISTOGRAMS );
+    assert( value >= 0 );
+
+    h = &histograms[hist];
+    h->samples++;
+    h->sum += value;
+    if( value > h->max ) h->max = value;
+
+    while( value > 0 && bucket < NR_OF_BUCKETS - 1 )
+    {
+        value >>= 1;
+        bucket++;
+    }
+    h->buckets[bucket]++;
+}
+
+void PrintStatistics()
+{
+    Histogram *h;
+    int i, b;
+
+#ifdef NDEBUG
+    fprintf( stdout, MSG_NO_STATS );
+    return;
+#endif
+
+    fprintf( stdout, "%-32s %12s\n", "counter", "count" );
+    for( i = 0; i < NR_OF_COUNTERS; i++ )
+    {
+        fprintf( stdout, "%-32s %12lu\n", counterNames[i], g_statCounters[i] );
+    }
+
+    for( i = 0; i < NR_OF_HISTOGRAMS; i++ )
+    {
+        h = &histograms[i];
+        fprintf( stdout, "\n%s: %lu samples, average %.2f, max %d\n",
+            histogramNames[i], h->samples,
+            h->samples > 0 ? (double) h->sum / h->samples : 0.0, h->max );
+        for( b = 0; b < NR_OF_BUCKETS; b++ )
+        {
+            if( h->buckets[b] == 0 ) continue;
+            if( b < 2 )
+            {
+                fprintf( stdout, "  %10d %12lu\n", b, h->buckets[b] );
+            }
+            else
+            {
+                fprintf( stdout, "  %4d..%-4d %12lu\n", 1 << ( b - 1 ),
+                    ( 1 << b ) - 1, h->buckets[b] );
+            }
+        }
+    }
+
+    fprintf( stdout, "\n%-32s %12s\n", "node kind", "count" );
+    for( i = 0; i < NR_OF_NODES; i++ )
+    {
+        if( g_statNodes[i] == 0 ) continue;
+        fprintf( stdout, "%-32s %12lu\n", GetNodeName( i ), g_statNodes[i] );
+    }
+}
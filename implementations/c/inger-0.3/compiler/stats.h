@@ -0,0 +1,92 @@
+/*************************************************
+ *                                               *
+ *  Module: stats.h                              *
+ *  Description:                                 *
+ *      Interface to the compiler statistics     *
+ *      module. Counts calls to hot functions    *
+ *      and keeps histograms of their costs.     *
+ *  Modifications:                               *
+ *                                               *
+ *************************************************
+ *                                               *
+ *   This program is free software; you can      *
+ *   redistribute it and/or modify  it under     *
+ *   the terms of the GNU General Public         *
+ *   License as published by the Free            *
+ *   Software Foundation; either version 2       *
+ *   of the License, or (at your option) any     *
+ *   later version.                              *
+ *                                               *
+ *************************************************/
+
+#ifndef STATS_H
+#define STATS_H
+
+#include "defs.h"
+
+/*
+ *  Counters. Add new counters before NR_OF_COUNTERS,
+ *  and add their names to counterNames in stats.c.
+ */
+enum Counters
+{
+    STAT_FINDSYMBOL = 0,
+    STAT_FINDINSYMBOLLIST,
+    STAT_STRCMP,
+    STAT_LISTSIZE,
+    STAT_GETTREECHILD,
+    STAT_TOKENVALUETOSTRING,
+    STAT_ALLOCATION,
+    NR_OF_COUNTERS
+};
+
+/*
+ *  Histograms. Add new histograms before
+ *  NR_OF_HISTOGRAMS, and add their names to
+ *  histogramNames in stats.c.
+ */
+enum Histograms
+{
+    HIST_SCOPE_DEPTH = 0,
+    HIST_LIST_LENGTH,
+    HIST_TREE_CHILD,
+    NR_OF_HISTOGRAMS
+};
+
+/*
+ *  Statistics macros. In release builds (NDEBUG)
+ *  they compile to nothing, and their arguments
+ *  are never evaluated.
+ *
+ *  STAT_COUNT( counter )        - increment [counter].
+ *  STAT_SAMPLE( hist, value )   - add [value] to histogram [hist].
+ *  STAT_NODE( id )              - count a new AST node of kind [id].
+ */
+#ifdef NDEBUG
+    #define STAT_COUNT( counter )
+    #define STAT_SAMPLE( hist, value )
+    #define STAT_NODE( id )
+#else
+    #define STAT_COUNT( counter )       ( g_statCounters[counter]++ )
+    #define STAT_SAMPLE( hist, value )  ( SampleHistogram( hist, value ) )
+    #define STAT_NODE( id )             ( g_statNodes[id]++ )
+#endif
+
+extern unsigned long g_statCounters[];
+extern unsigned long g_statNodes[];
+
+/*
+ *  Adds [value] to histogram [hist]. Use the
+ *  STAT_SAMPLE macro instead of calling this directly.
+ *
+ *  Pre: [value] >= 0.
+ */
+void SampleHistogram( int hist, int value );
+
+/*
+ *  Prints all counters, histograms and node counts
+ *  to the console.
+ */
+void PrintStatistics();
+
+#endif
@@ -38,6 +38,8 @@
 /* Include for AddError() function. */
 #include "errors.h"
 
+#include "stats.h"
+
 extern int numErrors;
 
 List * switchList;
@@ -161,15 +163,19 @@ int CaseOccurenceCount( char *TokenValueString )
     ListNode * listNode;
     TreeNode * tempNode;
     int duplicateCases = 0;
-    char * stringvalue = malloc( sizeof( TokenValueString ) );
+    char * stringvalue;
 
     assert( TokenValueString != NULL );
-    memcpy( stringvalue, TokenValueString, sizeof( TokenValueString ) );
+    /* TokenvalueToString reuses its buffer: keep a copy. */
+    stringvalue = malloc( strlen( TokenValueString ) + 1 );
+    if( stringvalue == NULL ) BAILOUT( ERR_NOMEM );
+    strcpy( stringvalue, TokenValueString );
 
     listNode = ListFirstEx( caseList );
     while( listNode != NULL  )
     {
         tempNode = (TreeNode *) listNode->data;
+        STAT_COUNT( STAT_STRCMP );
         if( strcmp( stringvalue, TokenvalueToString( 
                                   TOAST( tempNode )->id,
                                   TOAST( tempNode )->val ) ) == 0 )
@@ -0,0 +1,485 @@
+/*************************************************
+ *                                               *
+ *  Module: switchgen.c                          *
+ *  Description:                                 *
+ *      Generates code for switch statements.    *
+ *  Modifications:                               *
+ *                                               *
+ *************************************************
+ *                                               *
+ *   This program is free software; you can      *
+ *   redistribute it and/or modify  it under     *
+ *   the terms of the GNU General Public         *
+ *   License as published by the Free            *
+ *   Software Foundation; either version 2       *
+ *   of the License, or (at your option) any     *
+ *   later version.                              *
+ *                                               *
+ *************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "defs.h"
+#include "nodenames.h"
+#include "ast.h"
+#include "asm.h"
+#include "errors.h"
+#include "options.h"
+#include "codegen.h"
+#include "selftest.h"
+#include "switchgen.h"
+
+/*************************************************
+ *                                               *
+ *  MACROS                                       *
+ *                                               *
+ *************************************************/
+
+/* Switch lowering: a jump table needs at least
+ * MIN_TABLE_CASES cases filling at least 1 in
+ * TABLE_DENSITY of its entries; bit tests cover at
+ * most MAX_BIT_TESTS targets within 32 values; up to
+ * MAX_LINEAR_CASES cases are compared one by one. */
+#define MIN_TABLE_CASES                     4
+#define TABLE_DENSITY                       3
+#define MAX_TABLE_SIZE                      4096
+#define MAX_BIT_TESTS                       3
+#define MAX_LINEAR_CASES                    3
+
+/*************************************************
+ *                                               *
+ *  TYPES                                        *
+ *                                               *
+ *************************************************/
+
+/* A case of a switch statement. */
+typedef struct SwitchCase
+{
+    int value;
+    int label;              /* the case's code */
+} SwitchCase;
+
+/*************************************************
+ *                                               *
+ *  STATIC FUNCTION DEFINITIONS                  *
+ *                                               *
+ *************************************************/
+
+/*
+ * Checks whether statement [node] generates no code:
+ * it only holds blocks and declarations (locals are
+ * initialized on function entry).
+ */
+static BOOL IsEmptyStatement( TreeNode *node )
+{
+    ListNode *child;
+
+    switch( TOAST( node )->id )
+    {
+    case NODE_BLOCK:
+    case NODE_STATEMENT:
+    case NODE_DECLBLOCK:
+        break;
+    case NODE_DECLARATION:
+        return( TRUE );
+    default:
+        return( FALSE );
+    }
+    for( child = ListFirstEx( node->children ); child != NULL; child = ListNextEx( child ) )
+    {
+        if( IsEmptyStatement( (TreeNode *) child->data ) == FALSE ) return( FALSE );
+    }
+    return( TRUE );
+}
+
+static int CompareCases( const void *a, const void *b )
+{
+    int x = ( (SwitchCase *) a )->value, y = ( (SwitchCase *) b )->value;
+
+    return( ( x > y ) - ( x < y ) );
+}
+
+/* Returns the number of values from cases[first]
+ * up to cases[last]. */
+static unsigned long GetCaseRange( SwitchCase *cases, int first, int last )
+{
+    return( (unsigned long) ( (long) cases[last].value - (long) cases[first].value ) + 1 );
+}
+
+/*
+ * Emits a jump to [label] when EAX is case [value].
+ */
+static void GenerateCaseTest( int value, int label )
+{
+    AsmEmit2( ASM_CMP, 4, AsmImm( value ), EAX );
+    AsmEmitJump( COND_E, label );
+}
+
+/*
+ * Dispatches on EAX with a jump table for cases[first]
+ * up to cases[last]; values in between that have no
+ * case go to [defaultLabel]. One unsigned compare
+ * checks both bounds. On x86_64 the table holds
+ * offsets from its own address.
+ */
+static void GenerateJumpTable( SwitchCase *cases, int first, int last, int defaultLabel )
+{
+    unsigned long range, i;
+    int table, label, c;
+
+    range = GetCaseRange( cases, first, last );
+    table = GenerateLabel();
+
+    if( cases[first].value != 0 )
+    {
+        AsmEmit2( ASM_SUB, 4, AsmImm( cases[first].value ), EAX );
+    }
+    AsmEmit2( ASM_CMP, 4, AsmImm( (long) range - 1 ), EAX );
+    AsmEmitJump( COND_A, defaultLabel );
+    if( GetTarget() == TARGET_X86_64 )
+    {
+        AsmEmit2( ASM_LEA, 8, AsmLabel( table ), AsmReg( REG_R11 ) );
+        AsmEmit2( ASM_MOVSLQ, 8, AsmMemIndex( REG_R11, REG_EAX, 4, 0 ), EAX );
+        AsmEmit2( ASM_ADD, 8, AsmReg( REG_R11 ), EAX );
+        AsmEmit1( ASM_JMP, 8, EAX );
+    }
+    else
+    {
+        AsmEmit1( ASM_JMP, 4, AsmTable( table, REG_EAX, 4 ) );
+    }
+
+    AsmEmitDirective( "\t.section\t.rodata" );
+    AsmEmitDirective( "\t.align 4" );
+    AsmEmitDirective( ".L%d:", table );
+    c = first;
+    for( i = 0; i < range; i++ )
+    {
+        if( (unsigned long) ( (long) cases[c].value - (long) cases[first].value ) == i )
+        {
+            label = cases[c++].label;
+        }
+        else
+        {
+            label = defaultLabel;
+        }
+        if( GetTarget() == TARGET_X86_64 )
+        {
+            AsmEmitDirective( "\t.long\t.L%d-.L%d", label, table );
+        }
+        else
+        {
+            AsmEmitDirective( "\t.long\t.L%d", label );
+        }
+    }
+    AsmEmitDirective( "\t.text" );
+}
+
+/*
+ * Dispatches on EAX for cases[first] up to
+ * cases[last], which lie within 32 values and go to
+ * few different labels, with one bit test per label.
+ * Returns FALSE, emitting nothing, if no register is
+ * free for the bit masks.
+ */
+static BOOL GenerateBitTests( SwitchCase *cases, int first, int last, int defaultLabel )
+{
+    unsigned long mask;
+    int maskRegister, i, j;
+
+    maskRegister = AllocateRegister( 0 );
+    if( maskRegister == REG_NONE ) return( FALSE );
+
+    if( cases[first].value != 0 )
+    {
+        AsmEmit2( ASM_SUB, 4, AsmImm( cases[first].value ), EAX );
+    }
+    AsmEmit2( ASM_CMP, 4, AsmImm( (long) GetCaseRange( cases, first, last ) - 1 ), EAX );
+    AsmEmitJump( COND_A, defaultLabel );
+
+    for( i = first; i <= last; i++ )
+    {
+        /* Each label once, with the bits of all its
+         * values. */
+        for( j = first; j < i && cases[j].label != cases[i].label; j++ ) ;
+        if( j < i ) continue;
+
+        mask = 0;
+        for( j = i; j <= last; j++ )
+        {
+            if( cases[j].label == cases[i].label )
+            {
+                mask |= 1UL << ( cases[j].value - cases[first].value );
+            }
+        }
+        AsmEmit2( ASM_MOV, 4, AsmImm( (int) mask ), AsmReg( maskRegister ) );
+        AsmEmit2( ASM_BT, 4, EAX, AsmReg( maskRegister ) );
+        AsmEmitJump( COND_B, cases[i].label );
+    }
+    AsmEmitJump( COND_NONE, defaultLabel );
+
+    FreeRegister( maskRegister );
+    return( TRUE );
+}
+
+/* Returns the number of different labels of
+ * cases[first] up to cases[last]. */
+static int CountCaseLabels( SwitchCase *cases, int first, int last )
+{
+    int i, j, count = 0;
+
+    for( i = first; i <= last; i++ )
+    {
+        for( j = first; j < i && cases[j].label != cases[i].label; j++ ) ;
+        if( j == i ) count++;
+    }
+    return( count );
+}
+
+/*
+ * Generates code that jumps to the label of the case
+ * in cases[first] up to cases[last] (sorted by value)
+ * that EAX matches, or to [defaultLabel]. Dense
+ * ranges get a jump table, small ranges with shared
+ * labels get bit tests, a few cases are compared in
+ * turn, and otherwise the middle case splits the
+ * cases in a binary search.
+ */
+static void GenerateCaseDispatch( SwitchCase *cases, int first, int last, int defaultLabel )
+{
+    unsigned long range;
+    int count, labels, middle, right, i;
+
+    count = last - first + 1;
+    if( count <= 0 )
+    {
+        AsmEmitJump( COND_NONE, defaultLabel );
+        return;
+    }
+    range = GetCaseRange( cases, first, last );
+    labels = CountCaseLabels( cases, first, last );
+
+    if( count >= MIN_TABLE_CASES && range <= MAX_TABLE_SIZE
+        && range <= (unsigned long) count * TABLE_DENSITY )
+    {
+        GenerateJumpTable( cases, first, last, defaultLabel );
+        return;
+    }
+
+    if( range <= 32 && labels < count && labels <= MAX_BIT_TESTS
+        && GenerateBitTests( cases, first, last, defaultLabel ) == TRUE )
+    {
+        return;
+    }
+
+    if( count <= MAX_LINEAR_CASES )
+    {
+        for( i = first; i <= last; i++ )
+        {
+            GenerateCaseTest( cases[i].value, cases[i].label );
+        }
+        AsmEmitJump( COND_NONE, defaultLabel );
+        return;
+    }
+
+    middle = ( first + last ) / 2;
+    right = GenerateLabel();
+    AsmEmit2( ASM_CMP, 4, AsmImm( cases[middle].value ), EAX );
+    AsmEmitJump( COND_E, cases[middle].label );
+    AsmEmitJump( COND_G, right );
+    GenerateCaseDispatch( cases, first, middle - 1, defaultLabel );
+    AsmEmitLabel( right );
+    GenerateCaseDispatch( cases, middle + 1, last, defaultLabel );
+}
+
+/*************************************************
+ *                                               *
+ *  EXPORTED FUNCTION DEFINITIONS                *
+ *                                               *
+ *************************************************/
+
+/*
+ * Generates code for switch statement [node]. Cases
+ * do not fall through: each case's block ends with a
+ * jump past the default block. Cases with an empty
+ * block jump past the switch directly.
+ */
+void GenerateSwitchCode( TreeNode *node )
+{
+    TreeNode *casesNode, *caseNode, *defaultBlock;
+    SwitchCase *cases, *sorted;
+    ListNode *child;
+    int count, i, end, defaultLabel;
+
+    casesNode = GetTreeChild( node, 1 );
+    defaultBlock = GetTreeChild( node, 2 );
+    count = ListSize( casesNode->children );
+    end = GenerateLabel();
+    defaultLabel = IsEmptyStatement( defaultBlock ) ? end : GenerateLabel();
+
+    cases = (SwitchCase *) malloc( ( 2 * count + 1 ) * sizeof( SwitchCase ) );
+    if( cases == NULL ) BAILOUT( ERR_NOMEM );
+    sorted = cases + count;
+
+    i = 0;
+    for( child = ListFirstEx( casesNode->children ); child != NULL; child = ListNextEx( child ) )
+    {
+        caseNode = (TreeNode *) child->data;
+        cases[i].value = (int) TOAST( caseNode )->val.uintvalue;
+        cases[i].label = IsEmptyStatement( GetTreeChild( caseNode, 0 ) ) ? end : GenerateLabel();
+        sorted[i] = cases[i];
+        i++;
+    }
+    if( count > 1 ) qsort( sorted, count, sizeof( SwitchCase ), CompareCases );
+
+    /* The dispatch uses EAX only, plus a register for
+     * bit masks. */
+    GenerateExpressionCode( GetTreeChild( node, 0 ) );
+    ReserveRegister( REG_EAX );
+    GenerateCaseDispatch( sorted, 0, count - 1, defaultLabel );
+    FreeRegister( REG_EAX );
+
+    i = 0;
+    for( child = ListFirstEx( casesNode->children ); child != NULL; child = ListNextEx( child ) )
+    {
+        caseNode = (TreeNode *) child->data;
+        if( cases[i].label != end )
+        {
+            AsmEmitLabel( cases[i].label );
+            GenerateCodeForNode( GetTreeChild( caseNode, 0 ) );
+            AsmEmitJump( COND_NONE, end );
+        }
+        i++;
+    }
+    if( defaultLabel != end )
+    {
+        AsmEmitLabel( defaultLabel );
+        GenerateCodeForNode( defaultBlock );
+    }
+    AsmEmitLabel( end );
+
+    free( cases );
+}
+
+/*************************************************
+ *                                               *
+ *  TEST CODE                                    *
+ *                                               *
+ *************************************************/
+
+/*
+ *  A switch on parameter x of the self-test: its
+ *  cases, the target, and the dispatch expected from
+ *  the load of x up to the code of the first case.
+ */
+typedef struct SwitchTest
+{
+    char *name;
+    char *cases;
+    int target;
+    char *expected;
+} SwitchTest;
+
+static char *switchTestProgram =
+    "module switchtest;\n"
+    "f: int x -> int\n"
+    "{\n"
+    "    int r = 0;\n"
+    "    switch( x )\n"
+    "    {\n"
+    "        %s\n"
+    "        default { r = 99; }\n"
+    "    }\n"
+    "    return( r );\n"
+    "}\n";
+
+/* Cases on both sides of each choice of
+ * GenerateCaseDispatch. 2147483648 is INT_MIN. */
+static SwitchTest switchTests[] =
+{
+    { "4 cases: jump table",
+      "case 0 { r = 1; } case 1 { r = 2; } case 2 { r = 3; } case 3 { r = 4; }",
+      TARGET_I386,
+      "\tmovl\t8(%ebp), %eax\n\tcmpl\t$3, %eax\n\tja\t.L5\n\tjmp\t*.L10(,%eax,4)\n"
+      "\t.section\t.rodata\n\t.align 4\n.L10:\n"
+      "\t.long\t.L6\n\t.long\t.L7\n\t.long\t.L8\n\t.long\t.L9\n\t.text\n.L6:\n" },
+    { "3 cases: compares",
+      "case 0 { r = 1; } case 1 { r = 2; } case 2 { r = 3; }",
+      TARGET_I386,
+      "\tmovl\t8(%ebp), %eax\n\tcmpl\t$0, %eax\n\tje\t.L6\n\tcmpl\t$1, %eax\n\tje\t.L7\n"
+      "\tcmpl\t$2, %eax\n\tje\t.L8\n\tjmp\t.L5\n.L6:\n" },
+    { "range 3 x count: jump table",
+      "case 0 { r = 1; } case 1 { r = 2; } case 2 { r = 3; } case 11 { r = 4; }",
+      TARGET_I386,
+      "\tmovl\t8(%ebp), %eax\n\tcmpl\t$11, %eax\n\tja\t.L5\n\tjmp\t*.L10(,%eax,4)\n"
+      "\t.section\t.rodata\n\t.align 4\n.L10:\n"
+      "\t.long\t.L6\n\t.long\t.L7\n\t.long\t.L8\n\t.long\t.L5\n\t.long\t.L5\n\t.long\t.L5\n"
+      "\t.long\t.L5\n\t.long\t.L5\n\t.long\t.L5\n\t.long\t.L5\n\t.long\t.L5\n\t.long\t.L9\n"
+      "\t.text\n.L6:\n" },
+    { "range 3 x count + 1: binary search",
+      "case 0 { r = 1; } case 1 { r = 2; } case 2 { r = 3; } case 12 { r = 4; }",
+      TARGET_I386,
+      "\tmovl\t8(%ebp), %eax\n\tcmpl\t$1, %eax\n\tje\t.L7\n\tjg\t.L10\n"
+      "\tcmpl\t$0, %eax\n\tje\t.L6\n\tjmp\t.L5\n.L10:\n"
+      "\tcmpl\t$2, %eax\n\tje\t.L8\n\tcmpl\t$12, %eax\n\tje\t.L9\n\tjmp\t.L5\n.L6:\n" },
+    { "shared labels: bit tests",
+      "case 0 { r = 1; } case 20 { } case 31 { }",
+      TARGET_I386,
+      "\tmovl\t8(%ebp), %eax\n\tcmpl\t$31, %eax\n\tja\t.L5\n"
+      "\tmovl\t$1, %ebx\n\tbtl\t%eax, %ebx\n\tjb\t.L6\n"
+      "\tmovl\t$-2146435072, %ebx\n\tbtl\t%eax, %ebx\n\tjb\t.L4\n\tjmp\t.L5\n.L6:\n" },
+    { "INT_MIN and INT_MAX: binary search",
+      "case 2147483648 { r = 1; } case 0 { r = 2; } case 5 { r = 3; } case 2147483647 { r = 4; }",
+      TARGET_I386,
+      "\tmovl\t8(%ebp), %eax\n\tcmpl\t$0, %eax\n\tje\t.L7\n\tjg\t.L10\n"
+      "\tcmpl\t$-2147483648, %eax\n\tje\t.L6\n\tjmp\t.L5\n.L10:\n"
+      "\tcmpl\t$5, %eax\n\tje\t.L8\n\tcmpl\t$2147483647, %eax\n\tje\t.L9\n\tjmp\t.L5\n.L6:\n" },
+    { "from INT_MIN: jump table",
+      "case 2147483648 { r = 1; } case 2147483649 { r = 2; } case 2147483650 { r = 3; } "
+      "case 2147483651 { r = 4; }",
+      TARGET_I386,
+      "\tmovl\t8(%ebp), %eax\n\tsubl\t$-2147483648, %eax\n\tcmpl\t$3, %eax\n\tja\t.L5\n"
+      "\tjmp\t*.L10(,%eax,4)\n" },
+    { "up to INT_MAX: jump table",
+      "case 2147483644 { r = 1; } case 2147483645 { r = 2; } case 2147483646 { r = 3; } "
+      "case 2147483647 { r = 4; }",
+      TARGET_I386,
+      "\tmovl\t8(%ebp), %eax\n\tsubl\t$2147483644, %eax\n\tcmpl\t$3, %eax\n\tja\t.L5\n"
+      "\tjmp\t*.L10(,%eax,4)\n" },
+    { "x86_64: jump table of offsets",
+      "case 0 { r = 1; } case 1 { r = 2; } case 2 { r = 3; } case 3 { r = 4; }",
+      TARGET_X86_64,
+      "\tmovl\t-8(%rbp), %eax\n\tcmpl\t$3, %eax\n\tja\t.L5\n"
+      "\tleaq\t.L10(%rip), %r11\n\tmovslq\t(%r11,%rax,4), %rax\n\taddq\t%r11, %rax\n\tjmp\t*%rax\n"
+      "\t.section\t.rodata\n\t.align 4\n.L10:\n"
+      "\t.long\t.L6-.L10\n\t.long\t.L7-.L10\n\t.long\t.L8-.L10\n\t.long\t.L9-.L10\n\t.text\n.L6:\n" }
+};
+
+BOOL TestSwitchLowering()
+{
+    char source[1024];
+    char *text;
+    BOOL passed = TRUE;
+    int i;
+
+    printf( "Testing switch lowering...\n" );
+
+    for( i = 0; i < sizeof( switchTests ) / sizeof( SwitchTest ); i++ )
+    {
+        sprintf( source, switchTestProgram, switchTests[i].cases );
+        text = CompileTestProgram( source, switchTests[i].target, 0 );
+        if( text != NULL && strstr( text, switchTests[i].expected ) != NULL )
+        {
+            printf( "%s: ok\n", switchTests[i].name );
+        }
+        else
+        {
+            printf( "%s: FAILED, got\n%s", switchTests[i].name, ( text != NULL ) ? text : "errors\n" );
+            passed = FALSE;
+        }
+        free( text );
+    }
+
+    printf( "Switch lowering test %s.\n\n", ( passed == TRUE ) ? "passed" : "failed" );
+    return( passed );
+}
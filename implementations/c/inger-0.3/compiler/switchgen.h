@@ -0,0 +1,45 @@
+/*************************************************
+ *                                               *
+ *  Module: switchgen.h                          *
+ *  Description:                                 *
+ *      Interface to the code generation of      *
+ *      switch statements.                       *
+ *  Modifications:                               *
+ *                                               *
+ *************************************************
+ *                                               *
+ *   This program is free software; you can      *
+ *   redistribute it and/or modify  it under     *
+ *   the terms of the GNU General Public         *
+ *   License as published by the Free            *
+ *   Software Foundation; either version 2       *
+ *   of the License, or (at your option) any     *
+ *   later version.                              *
+ *                                               *
+ *************************************************/
+
+#ifndef SWITCHGEN_H
+#define SWITCHGEN_H
+
+#include "tree.h"
+
+/*
+ *  Generates code for switch statement [node]. Cases
+ *  do not fall through: each case's block ends with a
+ *  jump past the default block. Cases with an empty
+ *  block jump past the switch directly.
+ */
+void GenerateSwitchCode( TreeNode *node );
+
+/*
+ *  Tests the choice between a jump table, bit tests,
+ *  compares and a binary search, and the code of
+ *  each, at the bounds of the choices and for cases
+ *  at INT_MIN and INT_MAX.
+ *
+ *  Post: Returns TRUE if the test was successful,
+ *        FALSE if it failed.
+ */
+BOOL TestSwitchLowering();
+
+#endif
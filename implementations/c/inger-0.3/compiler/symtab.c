@@ -35,6 +35,7 @@
 #include "defs.h"
 #include "options.h"
 #include "typenames.h"
+#include "stats.h"
 
 typedef struct ScopeNode
 {
@@ -170,6 +171,7 @@ BOOL InitSymbolTable( )
         return( FALSE );
 
     /* Allocate memory for root node */
+    STAT_COUNT( STAT_ALLOCATION );
     g_symtab = ( ScopeNode * ) malloc( sizeof( ScopeNode ) );
     if ( !g_symtab )
         BAILOUT( ERR_NOMEM );
@@ -197,8 +199,13 @@ BOOL InitSymbolTable( )
 /* Deletes the scope tree */
 BOOL PurgeSymbolTable( )
 {
+    if( g_symtab == NULL )
+        return( FALSE );
+
     /* abuse the callback to purge the tree */
-    return( DeleteScopeNode( ( void * ) g_symtab ) );
+    DeleteScopeNode( ( void * ) g_symtab );
+    g_symtab = g_scope = NULL;
+    return( TRUE );
 }
 
 BOOL AddSymbol( Symbol * symbol )
@@ -216,6 +223,7 @@ Symbol *CreateSymbol( char * name )
 
     assert( name != NULL );
     
+    STAT_COUNT( STAT_ALLOCATION );
     symbol = ( Symbol * ) malloc( sizeof( Symbol ) );
     if( !symbol )
         BAILOUT( ERR_NOMEM );
@@ -224,10 +232,14 @@ Symbol *CreateSymbol( char * name )
     if( ! symbol->types )
         BAILOUT( "List initialization failed." );
 
+    STAT_COUNT( STAT_ALLOCATION );
     symbol->name = strdup( name );
     if( !symbol->name )
         BAILOUT( ERR_NOMEM );
 
+    symbol->reg = -1;
+    symbol->reference = FALSE;
+
     return( symbol );
 }
 
@@ -269,10 +281,13 @@ Symbol *FindInSymbolList( char *name, List * symbols )
     assert( name != NULL );
     assert( symbols != NULL );
     
+    STAT_COUNT( STAT_FINDINSYMBOLLIST );
+
     node = ListLastEx( symbols );
     while( node != NULL )
     {
 	symbol = ( Symbol * ) node->data;
+	STAT_COUNT( STAT_STRCMP );
 	if( strcmp( symbol->name, name ) == 0 )
 	{
 	    return( symbol );
@@ -282,6 +297,24 @@ Symbol *FindInSymbolList( char *name, List * symbols )
     return( NULL );
 }
 
+#ifndef NDEBUG
+/*
+ * Returns the number of scopes from the current scope up
+ * to and including [node]. Used for statistics only.
+ */
+static int ScopeDistance( ScopeNode *node )
+{
+    ScopeNode *scope;
+    int distance = 1;
+
+    for( scope = g_scope; scope != node && scope != NULL; scope = scope->parent )
+    {
+        distance++;
+    }
+    return( distance );
+}
+#endif
+
 /*
  * Finds a symbol in the tree by recursively going up the tree.
  */
@@ -310,10 +343,13 @@ static Symbol *FindSymbolR( char *name, ScopeNode *node )
 	     * This happens when the symbol 
 	     * is not found.
 	     */
+	    STAT_SAMPLE( HIST_SCOPE_DEPTH, ScopeDistance( node ) );
 	    return( NULL );
 	}
     }
 
+    STAT_SAMPLE( HIST_SCOPE_DEPTH, ScopeDistance( node ) );
+
     /* Set a flag if the symbol came from the root node. */
     if( node == g_symtab )
     {
@@ -332,6 +368,7 @@ Symbol *FindSymbol( char *name )
 {
     assert( name != NULL );
     assert( g_symtab != NULL );
+    STAT_COUNT( STAT_FINDSYMBOL );
     return( FindSymbolR( name, g_scope ) );
 }
 
@@ -392,6 +429,7 @@ BOOL CreateScope( )
     if ( !g_scope )
         g_scope = g_symtab;
     
+    STAT_COUNT( STAT_ALLOCATION );
     node = ( ScopeNode * ) malloc( sizeof( ScopeNode ) );
     if ( !node )
         BAILOUT( ERR_NOMEM );
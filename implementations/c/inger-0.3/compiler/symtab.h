@@ -36,6 +36,8 @@ typedef struct
     List    *types;
     BOOL     global;
     int      location;
+    int      reg;        /* register holding the variable, or -1 */
+    BOOL     reference;  /* holds the address of its elements */
 /*    List    *modifiers; */
 } Symbol;
 
@@ -0,0 +1,390 @@
+/*************************************************
+ *                                               *
+ *  Module: tailcall.c                           *
+ *  Description:                                 *
+ *      Generates calls in tail position as      *
+ *      jumps.                                   *
+ *  Modifications:                               *
+ *                                               *
+ *************************************************
+ *                                               *
+ *   This program is free software; you can      *
+ *   redistribute it and/or modify  it under     *
+ *   the terms of the GNU General Public         *
+ *   License as published by the Free            *
+ *   Software Foundation; either version 2       *
+ *   of the License, or (at your option) any     *
+ *   later version.                              *
+ *                                               *
+ *************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "defs.h"
+#include "nodenames.h"
+#include "symtab.h"
+#include "ast.h"
+#include "asm.h"
+#include "errors.h"
+#include "options.h"
+#include "codegen.h"
+#include "selftest.h"
+#include "tailcall.h"
+
+/*************************************************
+ *                                               *
+ *  STATIC FUNCTION DEFINITIONS                  *
+ *                                               *
+ *************************************************/
+
+/*
+ * Checks whether expression [node] contains a call.
+ */
+static BOOL HasApplication( TreeNode *node )
+{
+    ListNode *child;
+
+    if( TOAST( node )->id == NODE_APPLICATION ) return( TRUE );
+    for( child = ListFirstEx( node->children ); child != NULL; child = ListNextEx( child ) )
+    {
+        if( HasApplication( (TreeNode *) child->data ) == TRUE ) return( TRUE );
+    }
+    return( FALSE );
+}
+
+/*
+ * Stores the value in EAX in parameter [symbol].
+ */
+static void StoreParameter( Symbol *symbol )
+{
+    if( symbol->reg != REG_NONE )
+    {
+        AsmEmit2( ASM_MOV, 4, EAX, AsmReg( symbol->reg ) );
+        return;
+    }
+    AsmEmit2( ASM_MOV, ( symbol->reference == TRUE ) ? WORD_SIZE : 4, EAX,
+        AsmMem( REG_EBP, symbol->location ) );
+}
+
+/*
+ * Generates a call [node] of the current function to
+ * itself, in tail position, as a jump back to the
+ * start of its body once the parameters hold the
+ * arguments. The arguments are evaluated straight
+ * into the parameters, in an order where a parameter
+ * is assigned after the other arguments that read it;
+ * where there is no such order (as when two
+ * parameters swap), an argument is evaluated first
+ * and kept on the stack. With a call among the
+ * arguments, all are evaluated first, from right to
+ * left as for any call.
+ */
+static void GenerateSelfTailCall( TreeNode *node )
+{
+    TreeNode *header = GetHeaderFromFunction( GetCurrentFunction() ), *argument;
+    Symbol **params;
+    BOOL *stacked, *pending, calls = FALSE;
+    int *order, count, nrOfOrdered = 0, i, j;
+
+    count = GetArgumentCountFromApplication( node );
+    params = (Symbol **) malloc( ( count + 1 ) * sizeof( Symbol * ) );
+    stacked = (BOOL *) malloc( ( count + 1 ) * sizeof( BOOL ) );
+    pending = (BOOL *) malloc( ( count + 1 ) * sizeof( BOOL ) );
+    order = (int *) malloc( ( count + 1 ) * sizeof( int ) );
+    if( params == NULL || stacked == NULL || pending == NULL || order == NULL ) BAILOUT( ERR_NOMEM );
+    for( i = 0; i < count; i++ )
+    {
+        params[i] = FindSymbol( GetParamNameFromHeader( header, i ) );
+        argument = GetArgumentFromApplication( node, i );
+        if( HasApplication( argument ) == TRUE ) calls = TRUE;
+
+        /* A parameter passed on unchanged needs no code. */
+        pending[i] = ( TOAST( argument )->id != NODE_LIT_IDENTIFIER
+            || FindSymbol( GetNameOfIdentifier( argument ) ) != params[i] );
+        stacked[i] = FALSE;
+    }
+
+    while( calls == FALSE )
+    {
+        for( i = 0; i < count; i++ )
+        {
+            if( pending[i] == FALSE ) continue;
+            for( j = 0; j < count; j++ )
+            {
+                if( j != i && pending[j] == TRUE
+                    && ReadsVariable( GetArgumentFromApplication( node, j ), params[i] ) == TRUE ) break;
+            }
+            if( j == count ) break;
+        }
+        if( i < count )
+        {
+            order[nrOfOrdered++] = i;
+            pending[i] = FALSE;
+            continue;
+        }
+        for( i = 0; i < count && pending[i] == FALSE; i++ ) ;
+        if( i == count ) break;
+        stacked[i] = TRUE;
+        pending[i] = FALSE;
+    }
+    for( i = 0; i < count; i++ )
+    {
+        if( pending[i] == TRUE ) stacked[i] = TRUE;
+    }
+
+    for( i = count - 1; i >= 0; i-- )
+    {
+        if( stacked[i] == FALSE ) continue;
+        GenerateExpressionCode( GetArgumentFromApplication( node, i ) );
+        Push( EAX );
+    }
+    for( j = 0; j < nrOfOrdered; j++ )
+    {
+        i = order[j];
+        argument = GetArgumentFromApplication( node, i );
+        if( params[i]->reg != REG_NONE && ReadsVariable( argument, params[i] ) == FALSE )
+        {
+            GenerateExpression( argument, params[i]->reg );
+            continue;
+        }
+        GenerateExpressionCode( argument );
+        StoreParameter( params[i] );
+    }
+    for( i = 0; i < count; i++ )
+    {
+        if( stacked[i] == FALSE ) continue;
+        if( params[i]->reg != REG_NONE )
+        {
+            Pop( params[i]->reg );
+            continue;
+        }
+        Pop( REG_EAX );
+        StoreParameter( params[i] );
+    }
+    free( params );
+    free( stacked );
+    free( pending );
+    free( order );
+
+    AsmEmitJump( COND_NONE, GetRestartLabel() );
+}
+
+/*************************************************
+ *                                               *
+ *  EXPORTED FUNCTION DEFINITIONS                *
+ *                                               *
+ *************************************************/
+
+/*
+ * If expression [node] returned by the current
+ * function is a call, generates it as a tail call and
+ * returns TRUE. A call of the function itself jumps
+ * back to its start. Another call jumps to the callee
+ * after the epilogue, so that the callee returns to
+ * our caller, if all the arguments go in registers:
+ * arguments on the stack would need our caller's
+ * frame. Only the return types must agree, which the
+ * coercions inserted by the type checker ensure.
+ */
+BOOL GenerateTailCall( TreeNode *node )
+{
+    int count, i;
+    int *regs;
+    BOOL *floats, registers = TRUE;
+    char *name, *entry, *current;
+
+    if( TOAST( node )->id != NODE_APPLICATION ) return( FALSE );
+
+    name = GetNameFromApplication( node );
+    current = GetNameFromHeader( GetHeaderFromFunction( GetCurrentFunction() ) );
+    if( strcmp( name, current ) == 0 )
+    {
+        GenerateSelfTailCall( node );
+        return( TRUE );
+    }
+
+    /* On i386 a float comes back in XMM0 from a
+     * register entry point, and on the x87 stack from a
+     * C one; the callee must return it where our caller
+     * expects it. */
+    entry = GetInternalEntry( name );
+    if( GetTarget() == TARGET_I386 && IsFloat( node ) == TRUE
+        && ( entry == NULL ) != ( GetInternalEntry( current ) == NULL ) )
+    {
+        return( FALSE );
+    }
+    count = GetArgumentCountFromApplication( node );
+    regs = (int *) malloc( ( count + 1 ) * sizeof( int ) );
+    floats = (BOOL *) malloc( ( count + 1 ) * sizeof( BOOL ) );
+    if( regs == NULL || floats == NULL ) BAILOUT( ERR_NOMEM );
+    for( i = 0; i < count; i++ )
+    {
+        floats[i] = IsFloat( GetArgumentFromApplication( node, i ) );
+    }
+    AssignArgumentRegisters( name, count, floats, regs );
+    for( i = 0; i < count; i++ )
+    {
+        if( regs[i] == REG_NONE ) registers = FALSE;
+    }
+    if( registers == FALSE || GetStackDepth() != 0 )
+    {
+        free( regs );
+        free( floats );
+        return( FALSE );
+    }
+
+    for( i = count - 1; i >= 0; i-- )
+    {
+        ReserveRegister( regs[i] );
+        if( regs[i] >= REG_XMM0 )
+        {
+            GenerateFloatExpression( GetArgumentFromApplication( node, i ), regs[i] );
+        }
+        else
+        {
+            GenerateExpression( GetArgumentFromApplication( node, i ), regs[i] );
+        }
+    }
+    for( i = 0; i < count; i++ )
+    {
+        FreeRegister( regs[i] );
+    }
+    free( regs );
+    free( floats );
+
+    /* The epilogue, whose saves are removed along with
+     * those of the function's own. */
+    GenerateTailEpilogue();
+    AsmEmit1( ASM_JMP, 4, AsmSym( entry != NULL ? entry : name ) );
+    return( TRUE );
+}
+
+/*************************************************
+ *                                               *
+ *  TEST CODE                                    *
+ *                                               *
+ *************************************************/
+
+/* The callees of the self-test call themselves, so
+ * that they are not inlined. */
+#define TAIL_TEST_CALLEES \
+    "module tailcalltest;\n" \
+    "down: int x -> int\n" \
+    "{\n" \
+    "    if( x == 0 )\n" \
+    "    {\n" \
+    "        return( 0 );\n" \
+    "    }\n" \
+    "    return( down( x - 1 ) );\n" \
+    "}\n" \
+    "sum: int a; int b; int c; int d -> int\n" \
+    "{\n" \
+    "    if( a == 0 )\n" \
+    "    {\n" \
+    "        return( b + c + d );\n" \
+    "    }\n" \
+    "    return( sum( a - 1, b, c, d ) );\n" \
+    "}\n"
+
+/*
+ *  A function of the self-test, compiled at -O1 for
+ *  [target] after the callees, and the code expected
+ *  for it.
+ */
+typedef struct TailCallTest
+{
+    char *name;
+    char *source;
+    int target;
+    char *expected;
+} TailCallTest;
+
+static TailCallTest tailCallTests[] =
+{
+    { "self call passing parameters on",
+      TAIL_TEST_CALLEES,
+      TARGET_I386,
+      "\tmovl\t%ecx, %edi\n.L6:\n\ttestl\t%ebx, %ebx\n\tjne\t.L8\n"
+      "\tmovl\t%esi, %eax\n\taddl\t%edi, %eax\n\taddl\t16(%esp), %eax\n\tjmp\t.L7\n"
+      ".L8:\n\tsubl\t$1, %ebx\n\tjmp\t.L6\n.L7:\n" },
+    { "swapping self call",
+      TAIL_TEST_CALLEES
+      "gcd: int a; int b -> int\n"
+      "{\n"
+      "    if( b == 0 )\n"
+      "    {\n"
+      "        return( a );\n"
+      "    }\n"
+      "    return( gcd( b, a % b ) );\n"
+      "}\n",
+      TARGET_I386,
+      "\tmovl\t%eax, %ebx\n\tmovl\t%edx, %esi\n.L9:\n\ttestl\t%esi, %esi\n\tjne\t.L11\n"
+      "\tmovl\t%ebx, %eax\n\tjmp\t.L10\n.L11:\n"
+      "\tmovl\t%esi, %eax\n\tpushl\t%eax\n"
+      "\tmovl\t%ebx, %eax\n\tcltd\n\tidivl\t%esi\n\tmovl\t%edx, %eax\n\tmovl\t%eax, %esi\n"
+      "\tpopl\t%ebx\n\tjmp\t.L9\n.L10:\n" },
+    { "call in registers",
+      TAIL_TEST_CALLEES
+      "f: int x; int y -> int\n"
+      "{\n"
+      "    return( down( x + y ) );\n"
+      "}\n",
+      TARGET_I386,
+      ".L9:\n\tmovl\t%ebx, %eax\n\taddl\t%esi, %eax\n"
+      "\tpopl\t%esi\n\tpopl\t%ebx\n\tjmp\tdown.fast\n" },
+    { "x86_64: call in registers",
+      TAIL_TEST_CALLEES
+      "f: int x -> int\n"
+      "{\n"
+      "    return( sum( x, x, x, x ) );\n"
+      "}\n",
+      TARGET_X86_64,
+      ".L9:\n\tmovl\t%ebx, %ecx\n\tmovl\t%ebx, %edx\n\tmovl\t%ebx, %esi\n\tmovl\t%ebx, %edi\n"
+      "\tpopq\t%rbx\n\tjmp\tsum\n" },
+    { "argument on the stack",
+      TAIL_TEST_CALLEES
+      "f: int x -> int\n"
+      "{\n"
+      "    return( sum( x, x, x, x ) );\n"
+      "}\n",
+      TARGET_I386,
+      ".L9:\n\tmovl\t%ebx, %eax\n\tpushl\t%eax\n"
+      "\tmovl\t%ebx, %ecx\n\tmovl\t%ebx, %edx\n\tmovl\t%ebx, %eax\n"
+      "\tcall\tsum.fast\n\taddl\t$4, %esp\n.L10:\n" },
+    { "call not in tail position",
+      TAIL_TEST_CALLEES
+      "f: int x -> int\n"
+      "{\n"
+      "    return( down( x ) + 1 );\n"
+      "}\n",
+      TARGET_I386,
+      ".L9:\n\tmovl\t%ebx, %eax\n\tcall\tdown.fast\n\taddl\t$1, %eax\n.L10:\n" }
+};
+
+BOOL TestTailCalls()
+{
+    char *text;
+    BOOL passed = TRUE;
+    int i;
+
+    printf( "Testing tail calls...\n" );
+
+    for( i = 0; i < sizeof( tailCallTests ) / sizeof( TailCallTest ); i++ )
+    {
+        text = CompileTestProgram( tailCallTests[i].source, tailCallTests[i].target, 1 );
+        if( text != NULL && strstr( text, tailCallTests[i].expected ) != NULL )
+        {
+            printf( "%s: ok\n", tailCallTests[i].name );
+        }
+        else
+        {
+            printf( "%s: FAILED, got\n%s", tailCallTests[i].name, ( text != NULL ) ? text : "errors\n" );
+            passed = FALSE;
+        }
+        free( text );
+    }
+
+    printf( "Tail call test %s.\n\n", ( passed == TRUE ) ? "passed" : "failed" );
+    return( passed );
+}
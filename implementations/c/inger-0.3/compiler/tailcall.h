@@ -0,0 +1,48 @@
+/*************************************************
+ *                                               *
+ *  Module: tailcall.h                           *
+ *  Description:                                 *
+ *      Interface to the code generation of      *
+ *      calls in tail position.                  *
+ *  Modifications:                               *
+ *                                               *
+ *************************************************
+ *                                               *
+ *   This program is free software; you can      *
+ *   redistribute it and/or modify  it under     *
+ *   the terms of the GNU General Public         *
+ *   License as published by the Free            *
+ *   Software Foundation; either version 2       *
+ *   of the License, or (at your option) any     *
+ *   later version.                              *
+ *                                               *
+ *************************************************/
+
+#ifndef TAILCALL_H
+#define TAILCALL_H
+
+#include "tree.h"
+
+/*
+ *  If expression [node] returned by the current
+ *  function is a call, generates it as a tail call
+ *  and returns TRUE. A call of the function itself
+ *  jumps back to its start; another call jumps to
+ *  the callee after the epilogue, if all the
+ *  arguments go in registers.
+ */
+BOOL GenerateTailCall( TreeNode *node );
+
+/*
+ *  Tests the jumps of calls of the function itself,
+ *  which pass parameters on or swap them, and the jumps
+ *  to other functions with the arguments in
+ *  registers, and that calls with an argument on the
+ *  stack or outside tail position stay calls.
+ *
+ *  Post: Returns TRUE if the test was successful,
+ *        FALSE if it failed.
+ */
+BOOL TestTailCalls();
+
+#endif
@@ -22,11 +22,14 @@
 
 #include "tokenvalue.h"
 #include "nodenames.h"
+#include "stats.h"
 
 char *TokenvalueToString( int node, Tokenvalue tokenvalue )
 {
     static char value[100];
 
+    STAT_COUNT( STAT_TOKENVALUETOSTRING );
+
     switch( node )
     {
     case NODE_LIT_INT:
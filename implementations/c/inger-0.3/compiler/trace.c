@@ -0,0 +1,338 @@
+/*************************************************
+ *                                               *
+ *  Module: trace.c                              *
+ *  Description:                                 *
+ *      Records timed spans for compiler phases  *
+ *      and functions, and writes them as a      *
+ *      summary table or as Chrome trace events. *
+ *  Modifications:                               *
+ *                                               *
+ *************************************************
+ *                                               *
+ *   This program is free software; you can      *
+ *   redistribute it and/or modify  it under     *
+ *   the terms of the GNU General Public         *
+ *   License as published by the Free            *
+ *   Software Foundation; either version 2       *
+ *   of the License, or (at your option) any     *
+ *   later version.                              *
+ *                                               *
+ *************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <unistd.h>
+#include <time.h>
+#include "defs.h"
+#include "options.h"
+#include "list.h"
+#include "trace.h"
+
+/*************************************************
+ *                                               *
+ *  MACROS                                       *
+ *                                               *
+ *************************************************/
+
+/* Maximum nesting depth of open spans. */
+#define MAX_SPAN_DEPTH      64
+
+#define ERR_SPAN_DEPTH      "Trace span nesting too deep.\n"
+#define ERR_SPAN_UNDERFLOW  "Trace span closed but none open.\n"
+#define ERR_TRACE_OPEN      "Error: could not open %s for writing.\n"
+
+
+/*************************************************
+ *                                               *
+ *  TYPES                                        *
+ *                                               *
+ *************************************************/
+
+/*
+ *  A single recorded span. Times are in microseconds,
+ *  relative to the moment tracing was started.
+ */
+typedef struct TraceEvent
+{
+    char *category;
+    char *name;
+    int thread;
+    double start;
+    double duration;
+} TraceEvent;
+
+/*
+ *  Trace thread: one per input file.
+ */
+typedef struct TraceThread
+{
+    int id;
+    char *name;
+} TraceThread;
+
+/*
+ *  Accumulated time for one phase, used by the
+ *  summary table.
+ */
+typedef struct PhaseTime
+{
+    char *name;
+    double total;
+    int count;
+} PhaseTime;
+
+
+/*************************************************
+ *                                               *
+ *  GLOBALS                                      *
+ *                                               *
+ *************************************************/
+
+/* Is tracing active? */
+static BOOL tracing = FALSE;
+
+/* Time tracing was started (microseconds). */
+static double traceEpoch;
+
+/* All closed spans, in order of closing. */
+static List *events;
+
+/* All trace threads, in order of creation. */
+static List *threads;
+
+/* Currently open spans. */
+static TraceEvent *spanStack[MAX_SPAN_DEPTH];
+static int spanDepth = 0;
+
+/* Thread id of the current input file. */
+static int currentThread = 0;
+
+
+/*************************************************
+ *                                               *
+ *  STATIC FUNCTION DEFINITIONS                  *
+ *                                               *
+ *************************************************/
+
+/*
+ *  Returns a monotonic time stamp in microseconds.
+ */
+static double Now()
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return( ts.tv_sec * 1e6 + ts.tv_nsec / 1e3 );
+}
+
+/*
+ *  Writes [str] to [fp] as a JSON string literal,
+ *  escaping quotes, backslashes and control characters.
+ */
+static void WriteJsonString( FILE *fp, char *str )
+{
+    fputc( '"', fp );
+    for( ; *str != '\0'; str++ )
+    {
+        if( *str == '"' || *str == '\\' )
+        {
+            fprintf( fp, "\\%c", *str );
+        }
+        else if( (unsigned char) *str < 0x20 )
+        {
+            fprintf( fp, "\\u%04x", (unsigned char) *str );
+        }
+        else
+        {
+            fputc( *str, fp );
+        }
+    }
+    fputc( '"', fp );
+}
+
+/*
+ *  Finds the PhaseTime for [name] in [phases], or
+ *  appends a new one if it does not exist yet.
+ */
+static PhaseTime *GetPhaseTime( List *phases, char *name )
+{
+    PhaseTime *phase;
+
+    ListFirst( phases );
+    while( ( phase = ListGet( phases ) ) != NULL )
+    {
+        if( strcmp( phase->name, name ) == 0 )
+        {
+            return( phase );
+        }
+        ListNext( phases );
+    }
+
+    phase = (PhaseTime *) malloc( sizeof( PhaseTime ) );
+    if( phase == NULL ) BAILOUT( ERR_NOMEM );
+    phase->name = name;
+    phase->total = 0;
+    phase->count = 0;
+    ListAppend( phases, phase );
+    return( phase );
+}
+
+
+/*************************************************
+ *                                               *
+ *  EXPORTED FUNCTION DEFINITIONS                *
+ *                                               *
+ *************************************************/
+
+void InitTrace()
+{
+    if( WantTrace() == FALSE && WantTimeReport() == FALSE )
+    {
+        return;
+    }
+
+    tracing = TRUE;
+    traceEpoch = Now();
+    events = ListInit( NULL );
+    threads = ListInit( NULL );
+}
+
+void BeginTraceThread( char *name )
+{
+    TraceThread *thread;
+
+    assert( name != NULL );
+    if( tracing == FALSE ) return;
+
+    thread = (TraceThread *) malloc( sizeof( TraceThread ) );
+    if( thread == NULL ) BAILOUT( ERR_NOMEM );
+    thread->id = ++currentThread;
+    thread->name = strdup( name );
+    ListAppend( threads, thread );
+}
+
+void BeginTraceSpan( char *category, char *name )
+{
+    TraceEvent *event;
+
+    assert( category != NULL && name != NULL );
+    if( tracing == FALSE ) return;
+
+    if( spanDepth == MAX_SPAN_DEPTH ) BAILOUT( ERR_SPAN_DEPTH );
+
+    event = (TraceEvent *) malloc( sizeof( TraceEvent ) );
+    if( event == NULL ) BAILOUT( ERR_NOMEM );
+    event->category = category;
+    event->name = strdup( name );
+    event->thread = currentThread;
+    event->start = Now() - traceEpoch;
+    event->duration = 0;
+    spanStack[spanDepth++] = event;
+}
+
+void EndTraceSpan()
+{
+    TraceEvent *event;
+
+    if( tracing == FALSE ) return;
+
+    if( spanDepth == 0 ) BAILOUT( ERR_SPAN_UNDERFLOW );
+
+    event = spanStack[--spanDepth];
+    event->duration = ( Now() - traceEpoch ) - event->start;
+    ListAppend( events, event );
+}
+
+BOOL WriteTrace( char *filename )
+{
+    FILE *fp;
+    TraceEvent *event;
+    TraceThread *thread;
+    int pid;
+    BOOL first = TRUE;
+
+    assert( filename != NULL );
+    if( tracing == FALSE ) return( TRUE );
+
+    fp = fopen( filename, "w" );
+    if( fp == NULL )
+    {
+        fprintf( stderr, ERR_TRACE_OPEN, filename );
+        return( FALSE );
+    }
+
+    /* The process id keeps traces of parallel compiler
+     * runs apart when their files are concatenated. */
+    pid = getpid();
+
+    fprintf( fp, "{\"traceEvents\":[\n" );
+
+    ListFirst( threads );
+    while( ( thread = ListGet( threads ) ) != NULL )
+    {
+        fprintf( fp, "%s{\"ph\":\"M\",\"name\":\"thread_name\","
+            "\"pid\":%d,\"tid\":%d,\"args\":{\"name\":",
+            first ? "" : ",\n", pid, thread->id );
+        WriteJsonString( fp, thread->name );
+        fprintf( fp, "}}" );
+        first = FALSE;
+        ListNext( threads );
+    }
+
+    ListFirst( events );
+    while( ( event = ListGet( events ) ) != NULL )
+    {
+        fprintf( fp, "%s{\"ph\":\"X\",\"cat\":\"%s\",\"name\":",
+            first ? "" : ",\n", event->category );
+        WriteJsonString( fp, event->name );
+        fprintf( fp, ",\"pid\":%d,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+            pid, event->thread, event->start, event->duration );
+        first = FALSE;
+        ListNext( events );
+    }
+
+    fprintf( fp, "\n],\"displayTimeUnit\":\"ms\"}\n" );
+    fclose( fp );
+    return( TRUE );
+}
+
+void PrintTimeReport()
+{
+    List *phases;
+    PhaseTime *phase;
+    TraceEvent *event;
+    double total = 0;
+
+    if( tracing == FALSE ) return;
+
+    /* Sum phase spans by name, in order of first appearance. */
+    phases = ListInit( NULL );
+    ListFirst( events );
+    while( ( event = ListGet( events ) ) != NULL )
+    {
+        if( strcmp( event->category, TRACE_PHASE ) == 0 )
+        {
+            phase = GetPhaseTime( phases, event->name );
+            phase->total += event->duration;
+            phase->count++;
+            total += event->duration;
+        }
+        ListNext( events );
+    }
+
+    fprintf( stdout, "%-20s %12s %8s %6s\n", "phase", "seconds", "percent", "calls" );
+    ListFirst( phases );
+    while( ( phase = ListGet( phases ) ) != NULL )
+    {
+        fprintf( stdout, "%-20s %12.6f %7.1f%% %6d\n", phase->name,
+            phase->total / 1e6,
+            total > 0 ? 100.0 * phase->total / total : 0.0,
+            phase->count );
+        ListNext( phases );
+    }
+    fprintf( stdout, "%-20s %12.6f\n", "total", total / 1e6 );
+
+    ListPurge( phases, NULL );
+}
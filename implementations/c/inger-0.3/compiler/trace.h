@@ -0,0 +1,84 @@
+/*************************************************
+ *                                               *
+ *  Module: trace.h                              *
+ *  Description:                                 *
+ *      Interface to the compiler trace module.  *
+ *      Records timed spans for compiler phases  *
+ *      and functions, and writes them as a      *
+ *      summary table or as Chrome trace events. *
+ *  Modifications:                               *
+ *                                               *
+ *************************************************
+ *                                               *
+ *   This program is free software; you can      *
+ *   redistribute it and/or modify  it under     *
+ *   the terms of the GNU General Public         *
+ *   License as published by the Free            *
+ *   Software Foundation; either version 2       *
+ *   of the License, or (at your option) any     *
+ *   later version.                              *
+ *                                               *
+ *************************************************/
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "defs.h"
+
+/*
+ *  Span categories. Spans in the TRACE_PHASE category
+ *  are also accumulated into the --time summary table.
+ */
+#define TRACE_PHASE         "phase"
+#define TRACE_FUNCTION      "function"
+#define TRACE_IMPORT        "import"
+
+/*
+ *  Start recording spans. Tracing is only active
+ *  if --trace or --time was supplied; otherwise all
+ *  trace functions return immediately.
+ */
+void InitTrace();
+
+/*
+ *  Start a new trace thread named [name]. All spans
+ *  that follow are recorded on this thread, until
+ *  the next call to BeginTraceThread. The compiler
+ *  starts a new thread for every input file.
+ *
+ *  Pre: [name] is not the NULL string.
+ */
+void BeginTraceThread( char *name );
+
+/*
+ *  Open a span named [name] in category [category].
+ *  Spans nest: every BeginTraceSpan must be matched
+ *  by an EndTraceSpan.
+ *
+ *  Pre: [category] and [name] are not the NULL string.
+ */
+void BeginTraceSpan( char *category, char *name );
+
+/*
+ *  Close the most recently opened span.
+ */
+void EndTraceSpan();
+
+/*
+ *  Write all recorded spans to [filename] in the
+ *  Chrome trace event format (readable by
+ *  chrome://tracing and Perfetto).
+ *
+ *  Return values:
+ *  TRUE  - the trace was written.
+ *  FALSE - the file could not be opened.
+ */
+BOOL WriteTrace( char *filename );
+
+/*
+ *  Print the time spent in each compiler phase,
+ *  summed over all input files, to the console.
+ */
+void PrintTimeReport();
+
+#endif
@@ -26,6 +26,7 @@
 #include "tree.h"
 #include "defs.h"
 #include "options.h"
+#include "stats.h"
 
 /*************************************************
  *                                               *
@@ -77,6 +78,7 @@ static void *MallocEx( size_t size )
 {
     void *ptr;
     
+    STAT_COUNT( STAT_ALLOCATION );
     ptr = malloc( size );
     memset( ptr, 0, size );
     return( ptr );
@@ -147,6 +149,9 @@ TreeNode *GetTreeChild( TreeNode *parentnode, int childNum )
     size = ListSize( parentnode->children );
     assert( childNum >= 0 && childNum < size );
 
+    STAT_COUNT( STAT_GETTREECHILD );
+    STAT_SAMPLE( HIST_TREE_CHILD, childNum );
+
     listNode = ListFirstEx( parentnode->children );
     for( i = 0; i < childNum; i++ )
     {
@@ -215,30 +220,40 @@ void RemoveTreeNode( TreeNode *node )
 
 TreeNode *InsertAboveTreeNode( TreeNode *node, TreeNode *new )
 {
-    TreeNode *parent;
-    int i = 0;
+    assert( node != NULL );
+    assert( node->parent != NULL );
+
+    /* [new] takes the place of [node] among its parent's
+     * children, so that the order of operands is kept. */
+    ReplaceTreeNode( node, new );
+    AddTreeChild( new, node );
+
+    return( node );
+}
+
+TreeNode *ReplaceTreeNode( TreeNode *node, TreeNode *new )
+{
+    ListNode *listNode;
 
     assert( node != NULL );
-    
-    parent = node->parent;
+    assert( new != NULL );
 
-    
-    /* find node under consideration in parent child list */
-    ListFirst( parent->children );
-    for( i = 0 ; i < ListSize( parent->children ) ; i++ )
+    if( node->parent == NULL ) return( new );
+
+    listNode = ListFirstEx( node->parent->children );
+    while( listNode != NULL )
     {
-        if( ListGet( parent->children ) == node )
+        if( listNode->data == node )
         {
-            /* unlink child from parent child list */
-            ListUnlink( parent->children );
-            ListAppend( parent->children, new );
-            AddTreeChild( new, node );
-            return( node );
+            listNode->data = new;
+            new->parent = node->parent;
+            node->parent = NULL;
+            break;
         }
-        ListNext( parent->children );
+        listNode = ListNextEx( listNode );
     }
-    
-    return( node );
+
+    return( new );
 }
 
 TreeNode *UnlinkTreeNode( TreeNode *node, DataFunction dataFunction )
@@ -113,6 +113,13 @@ void RemoveTreeNode( TreeNode *node );
 
 TreeNode *InsertAboveTreeNode( TreeNode *node, TreeNode *new );
 
+/*
+ *  Put [new] in the place of [node] in the children
+ *  list of [node]'s parent. [node] is detached from
+ *  the tree, but not freed. Returns [new].
+ */
+TreeNode *ReplaceTreeNode( TreeNode *node, TreeNode *new );
+
 TreeNode* UnlinkTreeNode( TreeNode *node, DataFunction dataFunction );
 
 
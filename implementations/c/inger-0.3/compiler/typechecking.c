@@ -30,6 +30,7 @@
 #include "symtab.h"
 #include "typenames.h"
 #include "errors.h"
+#include "trace.h"
 
 #define ERRLEN  80
 
@@ -41,6 +42,7 @@
 static Type *GetTypeForUnaryExpression( TreeNode *node );
 static Type *GetTypeForBinaryExpression( TreeNode *node );
 static Type *GetTypeForApplication( TreeNode *node );
+static Type *GetTypeForIndexer( TreeNode *node );
 static void CheckTypes( TreeNode *node );
 static BOOL Coerce( TreeNode *node, SimpleType simpleType );
 
@@ -139,6 +141,11 @@ static Type *GetTypeForExpression( TreeNode *node )
     {
         return( GetTypeForApplication( node ) );
     }
+
+    if( AstNodeID == NODE_INDEXER )
+    {
+        return( GetTypeForIndexer( node ) );
+    }
     
     return( NULL );
 }
@@ -281,6 +288,41 @@ static Type *GetTypeForApplication( TreeNode *node )
     return( TOAST( node )->type );
 }
 
+static Type *GetTypeForIndexer( TreeNode *node )
+{
+    TreeNode *index;
+    Type *type;
+
+    assert( node != NULL );
+
+    type = TOAST( GetTreeChild( node, 0 ) )->type;
+    assert( type != NULL );
+
+    /* make our own copy of the type, and strip the
+     * dimension that is indexed */
+    TOAST( node )->type = CopyType( type );
+    if( ListSize( TOAST( node )->type->dimensions ) == 0 )
+    {
+        AddError( "Indexing non-array", TOAST( node )->lineno );
+    }
+    else
+    {
+        RemoveOneDimension( TOAST( node )->type );
+    }
+
+    index = GetTreeChild( node, 1 );
+    assert( TOAST( index )->type != NULL );
+    if( TOAST( index )->type->type != INT )
+    {
+        if( Coerce( index, INT ) == FALSE )
+        {
+            AddError( "Array index must be an integer", TOAST( node )->lineno );
+        }
+    }
+
+    return( TOAST( node )->type );
+}
+
 static Type *GetTypeForLiteralNode( TreeNode *node )
 {
     Type * type;
@@ -376,6 +418,7 @@ static void CheckApplicationParameters( TreeNode *node )
                 AddError( err, TOAST( node )->lineno ); 
             }
         }
+        ListNext( function->types );
     }
 }
 
@@ -472,11 +515,17 @@ static void CheckTypes( TreeNode *node )
             return;
         }
     }
+
+    if( astNode->id == NODE_FUNCTION )
+    {
+        BeginTraceSpan( TRACE_FUNCTION,
+            GetNameFromHeader( GetHeaderFromFunction( node ) ) );
+    }
   
-    if( ( astNode->id == NODE_BLOCK && 
-          TOAST( GetTreeChild( node->parent, 0 ) )->id 
-            != NODE_FUNCTIONHEADER ) ||
-        astNode->id == NODE_FUNCTIONHEADER )
+    /* Only function definitions have a scope in the symbol
+     * table; nested blocks share the scope of their function. */
+    if( astNode->id == NODE_FUNCTIONHEADER &&
+        GetBlockFromFunction( node->parent ) != NULL )
     {
         EnterScope( );
     }
@@ -499,8 +548,14 @@ static void CheckTypes( TreeNode *node )
     /* Check types for this node */
     CheckNodeType( node );
     
-    if( TOAST( node )->id == NODE_BLOCK )
+    if( astNode->id == NODE_BLOCK &&
+        TOAST( node->parent )->id == NODE_FUNCTION )
     {
         ExitScope( );
     }        
+
+    if( astNode->id == NODE_FUNCTION )
+    {
+        EndTraceSpan();
+    }
 }
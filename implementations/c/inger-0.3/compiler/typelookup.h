@@ -48,9 +48,13 @@ const int g_binary_table[][3] =
     { NODE_BITWISE_OR,      INT, UNKNOWN },
     { NODE_BITWISE_XOR,     INT, UNKNOWN },
     { NODE_BITWISE_AND,     INT, UNKNOWN },
+    { NODE_EQUAL,           FLOAT, BOOLEAN },
     { NODE_EQUAL,           INT, BOOLEAN },
+    { NODE_NOTEQUAL,        FLOAT, BOOLEAN },
     { NODE_NOTEQUAL,        INT, BOOLEAN },
+    { NODE_GREATER,         FLOAT, BOOLEAN },
     { NODE_GREATER,         INT, BOOLEAN },
+    { NODE_GREATEREQUAL,    FLOAT, BOOLEAN },
     { NODE_GREATEREQUAL,    INT, BOOLEAN },
     { NODE_LESS,            FLOAT, BOOLEAN },
     { NODE_LESS,            INT, BOOLEAN },
@@ -70,6 +74,7 @@ const int g_binary_table[][3] =
     { NODE_MULTIPLY,        FLOAT, UNKNOWN },
     { NODE_MULTIPLY,        INT, UNKNOWN },
     { NODE_MULTIPLY,        CHAR, UNKNOWN },
+    { NODE_DIVIDE,          FLOAT, UNKNOWN },
     { NODE_DIVIDE,          INT, UNKNOWN },
     { NODE_MODULUS,         INT, UNKNOWN },
     { -1, -1, UNKNOWN }
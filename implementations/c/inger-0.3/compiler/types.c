@@ -25,12 +25,14 @@
 #include <stdlib.h>     /* Required for malloc() */
 #include "types.h"
 #include "defs.h"
+#include "stats.h"
 
 
 Type *CreateType( )
 {
     Type *newType;
     
+    STAT_COUNT( STAT_ALLOCATION );
     newType = ( Type * ) malloc( sizeof( Type ) );
     if( newType == NULL )
     {
@@ -64,6 +66,7 @@ Type *AddDimension( Type *type, int size )
     assert( size >= 0 );
     
     /* allocate memory to store the dimension size in */
+    STAT_COUNT( STAT_ALLOCATION );
     ptr = ( int * ) malloc( sizeof( int ) );
     if( ptr == NULL )
     {
@@ -141,6 +144,7 @@ Type *AddModifier( Type *type, Modifier modifier )
 
     assert( type != NULL );
 
+    STAT_COUNT( STAT_ALLOCATION );
     ptr = ( int * ) malloc( sizeof( Modifier ) );
     if( !ptr )
     {
@@ -0,0 +1,711 @@
+/*************************************************
+ *                                               *
+ *  Module: vectorize.c                          *
+ *  Description:                                 *
+ *      Runs loops over arrays four              *
+ *      iterations at a time with SSE2.          *
+ *  Modifications:                               *
+ *                                               *
+ *************************************************
+ *                                               *
+ *   This program is free software; you can      *
+ *   redistribute it and/or modify  it under     *
+ *   the terms of the GNU General Public         *
+ *   License as published by the Free            *
+ *   Software Foundation; either version 2       *
+ *   of the License, or (at your option) any     *
+ *   later version.                              *
+ *                                               *
+ *************************************************/
+
+/*
+ *  At -O1, a counted loop over int or float arrays
+ *  such as
+ *
+ *      while( i < n ) do
+ *      {
+ *          a[i] = b[i] + c[i];
+ *          i = i + 1;
+ *      }
+ *
+ *  first runs four iterations at a time with packed
+ *  SSE2 instructions, for as long as four are left;
+ *  the loop itself then does the rest. The body must
+ *  be assignments to elements, followed by the step
+ *  of the counter (an int in a register) by one. The
+ *  counter may only be the last index of an element,
+ *  plus a constant; the other indexes must be
+ *  constants. Array parameters, which may share their
+ *  elements, are not handled, and an array that is
+ *  assigned to may only be accessed at the element
+ *  assigned, so that the iterations are independent.
+ *  Values that do not change in the loop are computed
+ *  before it, in all four lanes of a register. SSE2
+ *  has no packed int multiply or divide.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "defs.h"
+#include "nodenames.h"
+#include "symtab.h"
+#include "ast.h"
+#include "asm.h"
+#include "options.h"
+#include "codegen.h"
+#include "induction.h"
+#include "selftest.h"
+#include "vectorize.h"
+
+/*************************************************
+ *                                               *
+ *  MACROS                                       *
+ *                                               *
+ *************************************************/
+
+/* Vectorization: iterations done at a time, and the
+ * most assignments and values computed before the
+ * loop. */
+#define VECTOR_LANES                        4
+#define MAX_VECTOR_STATEMENTS               8
+#define MAX_VECTOR_INVARIANTS               6
+
+/*************************************************
+ *                                               *
+ *  TYPES                                        *
+ *                                               *
+ *************************************************/
+
+/* A loop that runs VECTOR_LANES iterations at a time
+ * (see GenerateVectorLoop). */
+typedef struct VectorLoop
+{
+    Symbol *counter;
+    int index;              /* register with the counter as an address */
+    TreeNode *statements[MAX_VECTOR_STATEMENTS];
+    int nrOfStatements;
+    TreeNode *invariants[MAX_VECTOR_INVARIANTS];
+    int invariantRegisters[MAX_VECTOR_INVARIANTS];
+    int nrOfInvariants;
+} VectorLoop;
+
+/*************************************************
+ *                                               *
+ *  STATIC FUNCTION DEFINITIONS                  *
+ *                                               *
+ *************************************************/
+
+/*
+ * Adds the statements of loop body [node] to [loop].
+ * Returns FALSE if there are too many, or statements
+ * other than assignments.
+ */
+static BOOL CollectVectorStatements( VectorLoop *loop, TreeNode *node )
+{
+    ListNode *child;
+
+    switch( TOAST( node )->id )
+    {
+    case NODE_BLOCK:
+    case NODE_STATEMENT:
+        break;
+    case NODE_DECLBLOCK:
+    case NODE_DECLARATION:
+        return( TRUE );
+    case NODE_ASSIGN:
+        if( loop->nrOfStatements == MAX_VECTOR_STATEMENTS ) return( FALSE );
+        loop->statements[loop->nrOfStatements++] = node;
+        return( TRUE );
+    default:
+        return( FALSE );
+    }
+    for( child = ListFirstEx( node->children ); child != NULL; child = ListNextEx( child ) )
+    {
+        if( CollectVectorStatements( loop, (TreeNode *) child->data ) == FALSE ) return( FALSE );
+    }
+    return( TRUE );
+}
+
+/* Checks whether expression [node] is of simple type
+ * [type]. */
+static BOOL IsOfType( TreeNode *node, SimpleType type )
+{
+    return( TOAST( node )->type != NULL && IsAddress( node ) == FALSE
+            && GetSimpleType( TOAST( node )->type ) == type );
+}
+
+/*
+ * Checks whether [node] is an element of type [type]
+ * that [loop] can access four at a time: of an array
+ * that is not a parameter, indexed by the counter
+ * plus a constant, and by constants otherwise.
+ */
+static BOOL IsVectorElement( VectorLoop *loop, TreeNode *node, SimpleType type )
+{
+    int offset, i;
+
+    if( TOAST( node )->id != NODE_INDEXER || IsOfType( node, type ) == FALSE
+        || FindSymbol( GetNameOfIdentifier( GetIndexedVariable( node ) ) )->reference == TRUE
+        || IsVariable( SplitIndex( GetTreeChild( node, 1 ), &offset ), loop->counter ) == FALSE )
+    {
+        return( FALSE );
+    }
+    for( i = CountIndexes( node ) - 1; i > 0; i-- )
+    {
+        node = GetTreeChild( node, 0 );
+        if( SplitIndex( GetTreeChild( node, 1 ), &offset ) != NULL ) return( FALSE );
+    }
+    return( TRUE );
+}
+
+/*
+ * Checks whether expression [node] has the same value
+ * in every iteration of [loop]: it has no calls,
+ * assignments or elements, and does not read the
+ * counter (the loop assigns nothing else).
+ */
+static BOOL IsVectorInvariant( VectorLoop *loop, TreeNode *node )
+{
+    ListNode *child;
+
+    switch( TOAST( node )->id )
+    {
+    case NODE_LIT_IDENTIFIER:
+        return( IsAddress( node ) == FALSE && IsVariable( node, loop->counter ) == FALSE );
+    case NODE_APPLICATION:
+    case NODE_ASSIGN:
+    case NODE_INDEXER:
+    case NODE_ADDRESS:
+    case NODE_DEREFERENCE:
+        return( FALSE );
+    }
+    for( child = ListFirstEx( node->children ); child != NULL; child = ListNextEx( child ) )
+    {
+        if( IsVectorInvariant( loop, (TreeNode *) child->data ) == FALSE ) return( FALSE );
+    }
+    return( TRUE );
+}
+
+/* Returns the number of loop invariant [node] in
+ * [loop], or -1. */
+static int FindVectorInvariant( VectorLoop *loop, TreeNode *node )
+{
+    int i;
+
+    for( i = 0; i < loop->nrOfInvariants; i++ )
+    {
+        if( IsSameExpression( loop->invariants[i], node ) == TRUE ) return( i );
+    }
+    return( -1 );
+}
+
+/*
+ * Checks whether [loop] can compute expression [node]
+ * of type [type] four iterations at a time, and adds
+ * its loop invariant parts to [loop].
+ */
+static BOOL CheckVectorExpression( VectorLoop *loop, TreeNode *node, SimpleType type )
+{
+    if( IsOfType( node, type ) == FALSE ) return( FALSE );
+    if( IsVectorInvariant( loop, node ) == TRUE )
+    {
+        if( FindVectorInvariant( loop, node ) >= 0 ) return( TRUE );
+        if( loop->nrOfInvariants == MAX_VECTOR_INVARIANTS ) return( FALSE );
+        loop->invariants[loop->nrOfInvariants++] = node;
+        return( TRUE );
+    }
+
+    switch( TOAST( node )->id )
+    {
+    case NODE_INDEXER:
+        return( IsVectorElement( loop, node, type ) );
+    case NODE_UNARY_ADD:
+        return( CheckVectorExpression( loop, GetTreeChild( node, 0 ), type ) );
+    case NODE_BITWISE_LSHIFT:
+    case NODE_BITWISE_RSHIFT:
+        return( TOAST( GetTreeChild( node, 1 ) )->id == NODE_LIT_INT
+                && CheckVectorExpression( loop, GetTreeChild( node, 0 ), type ) );
+    case NODE_MULTIPLY:
+    case NODE_DIVIDE:
+        if( type != FLOAT ) return( FALSE );
+        /* Fall through. */
+    case NODE_BINARY_ADD:
+    case NODE_BINARY_SUBTRACT:
+    case NODE_BITWISE_AND:
+    case NODE_BITWISE_OR:
+    case NODE_BITWISE_XOR:
+        return( CheckVectorExpression( loop, GetTreeChild( node, 0 ), type )
+                && CheckVectorExpression( loop, GetTreeChild( node, 1 ), type ) );
+    }
+    return( FALSE );
+}
+
+/* Checks whether every element of [symbol] in [node]
+ * is at [displacement] from the counter. */
+static BOOL IsOnlyElement( TreeNode *node, Symbol *symbol, int displacement )
+{
+    ListNode *child;
+
+    if( TOAST( node )->id == NODE_INDEXER )
+    {
+        return( FindSymbol( GetNameOfIdentifier( GetIndexedVariable( node ) ) ) != symbol
+                || GetIndexDisplacement( symbol, node ) == displacement );
+    }
+    for( child = ListFirstEx( node->children ); child != NULL; child = ListNextEx( child ) )
+    {
+        if( IsOnlyElement( (TreeNode *) child->data, symbol, displacement ) == FALSE ) return( FALSE );
+    }
+    return( TRUE );
+}
+
+/*
+ * Returns the number of SSE registers needed to
+ * compute [node] of [loop] in a register, as
+ * GetRegisterNeed. A loop invariant right operand is
+ * used in its own register.
+ */
+static int GetVectorNeed( VectorLoop *loop, TreeNode *node )
+{
+    int left, right;
+
+    if( FindVectorInvariant( loop, node ) >= 0 ) return( 1 );
+    switch( TOAST( node )->id )
+    {
+    case NODE_INDEXER:
+        return( 1 );
+    case NODE_UNARY_ADD:
+    case NODE_BITWISE_LSHIFT:
+    case NODE_BITWISE_RSHIFT:
+        return( GetVectorNeed( loop, GetTreeChild( node, 0 ) ) );
+    }
+    left = GetVectorNeed( loop, GetTreeChild( node, 0 ) );
+    if( FindVectorInvariant( loop, GetTreeChild( node, 1 ) ) >= 0 ) return( left );
+    right = GetVectorNeed( loop, GetTreeChild( node, 1 ) );
+    if( left == right ) return( left + 1 );
+    return( ( left > right ) ? left : right );
+}
+
+/* Returns the operand of four elements of [loop] from
+ * element [node] on. */
+static Operand GetVectorOperand( VectorLoop *loop, TreeNode *node )
+{
+    Operand operand;
+
+    GetLeafOperand( GetIndexedVariable( node ), &operand );
+    operand.value += GetIndexDisplacement( FindSymbol( GetNameOfIdentifier( GetIndexedVariable( node ) ) ),
+                                           node );
+    operand.index = loop->index;
+    operand.scale = 4;
+    return( operand );
+}
+
+/* Returns the packed instruction for operator [node]
+ * on [type]. */
+static int GetVectorOpcode( TreeNode *node, SimpleType type )
+{
+    switch( TOAST( node )->id )
+    {
+    case NODE_BINARY_ADD:
+        return( ( type == FLOAT ) ? ASM_ADDPS : ASM_PADDD );
+    case NODE_BINARY_SUBTRACT:
+        return( ( type == FLOAT ) ? ASM_SUBPS : ASM_PSUBD );
+    case NODE_MULTIPLY:
+        return( ASM_MULPS );
+    case NODE_DIVIDE:
+        return( ASM_DIVPS );
+    case NODE_BITWISE_AND:
+        return( ASM_PAND );
+    case NODE_BITWISE_OR:
+        return( ASM_POR );
+    case NODE_BITWISE_XOR:
+        return( ASM_PXOR );
+    case NODE_BITWISE_LSHIFT:
+        return( ASM_PSLLD );
+    }
+    return( ASM_PSRAD );
+}
+
+/*
+ * Generates code that computes [node] of type [type]
+ * for four iterations of [loop] in SSE register
+ * [reg]. The registers GetVectorNeed counts must be
+ * free.
+ */
+static void GenerateVectorExpression( VectorLoop *loop, TreeNode *node, SimpleType type, int reg )
+{
+    TreeNode *left, *right;
+    int move, invariant, temp;
+
+    move = ( type == FLOAT ) ? ASM_MOVUPS : ASM_MOVDQU;
+    invariant = FindVectorInvariant( loop, node );
+    if( invariant >= 0 )
+    {
+        AsmEmit2( move, 4, AsmReg( loop->invariantRegisters[invariant] ), AsmReg( reg ) );
+        return;
+    }
+
+    left = GetTreeChild( node, 0 );
+    switch( TOAST( node )->id )
+    {
+    case NODE_INDEXER:
+        AsmEmit2( move, 4, GetVectorOperand( loop, node ), AsmReg( reg ) );
+        return;
+    case NODE_UNARY_ADD:
+        GenerateVectorExpression( loop, left, type, reg );
+        return;
+    case NODE_BITWISE_LSHIFT:
+    case NODE_BITWISE_RSHIFT:
+        GenerateVectorExpression( loop, left, type, reg );
+        AsmEmit2( GetVectorOpcode( node, type ), 4,
+                  AsmImm( TOAST( GetTreeChild( node, 1 ) )->val.uintvalue & 31 ), AsmReg( reg ) );
+        return;
+    }
+
+    right = GetTreeChild( node, 1 );
+    invariant = FindVectorInvariant( loop, right );
+    if( invariant >= 0 )
+    {
+        GenerateVectorExpression( loop, left, type, reg );
+        AsmEmit2( GetVectorOpcode( node, type ), 4, AsmReg( loop->invariantRegisters[invariant] ),
+                  AsmReg( reg ) );
+        return;
+    }
+
+    if( GetVectorNeed( loop, right ) > GetVectorNeed( loop, left ) )
+    {
+        /* Right operand first. */
+        temp = AllocateFloatRegister();
+        GenerateVectorExpression( loop, right, type, temp );
+        GenerateVectorExpression( loop, left, type, reg );
+    }
+    else
+    {
+        GenerateVectorExpression( loop, left, type, reg );
+        temp = AllocateFloatRegister();
+        GenerateVectorExpression( loop, right, type, temp );
+    }
+    AsmEmit2( GetVectorOpcode( node, type ), 4, AsmReg( temp ), AsmReg( reg ) );
+    FreeRegister( temp );
+}
+
+/*
+ * Generates code that computes the loop invariants of
+ * [loop], each in all lanes of an SSE register.
+ */
+static void GenerateVectorInvariants( VectorLoop *loop )
+{
+    TreeNode *node;
+    Operand operand;
+    int reg, temp, i;
+    BOOL saved;
+
+    for( i = 0; i < loop->nrOfInvariants; i++ )
+    {
+        node = loop->invariants[i];
+        reg = AllocateFloatRegister();
+        loop->invariantRegisters[i] = reg;
+        if( IsFloat( node ) == TRUE )
+        {
+            GenerateFloatExpression( node, reg );
+        }
+        else if( GetLeafOperand( node, &operand ) == TRUE && operand.kind != OPERAND_IMMEDIATE )
+        {
+            AsmEmit2( ASM_MOVD, 4, operand, AsmReg( reg ) );
+        }
+        else
+        {
+            temp = BorrowRegister( REG_NONE, &saved );
+            GenerateExpression( node, temp );
+            AsmEmit2( ASM_MOVD, 4, AsmReg( temp ), AsmReg( reg ) );
+            ReturnRegister( temp, saved );
+        }
+        AsmEmit2( ASM_UNPCKLPS, 4, AsmReg( reg ), AsmReg( reg ) );
+        AsmEmit2( ASM_MOVLHPS, 4, AsmReg( reg ), AsmReg( reg ) );
+    }
+}
+
+/*
+ * Emits a jump to [label] that is taken unless the
+ * counter of [loop] plus VECTOR_LANES - 1 [cond]
+ * [limit]: with the loop's condition, when fewer than
+ * VECTOR_LANES iterations are left. [temp] is a
+ * scratch register.
+ */
+static void GenerateVectorTest( VectorLoop *loop, Operand limit, int cond, int temp, int label )
+{
+    AsmEmit2( ASM_LEA, 4, AsmMem( loop->counter->reg, VECTOR_LANES - 1 ), AsmReg( temp ) );
+    AsmEmit2( ASM_CMP, 4, limit, AsmReg( temp ) );
+    AsmEmitJump( AsmInvertCondition( cond ), label );
+}
+
+/*************************************************
+ *                                               *
+ *  EXPORTED FUNCTION DEFINITIONS                *
+ *                                               *
+ *************************************************/
+
+/*
+ * Checks whether while loop [node] can run
+ * VECTOR_LANES iterations at a time, and if so
+ * generates code that does so as long as that many
+ * are left, and returns TRUE. The code runs after
+ * the loop's guard; the loop must follow it.
+ */
+BOOL GenerateVectorLoop( TreeNode *node )
+{
+    VectorLoop loop;
+    TreeNode *condition, *statement, *element;
+    Symbol *symbol, *step;
+    Operand limit;
+    SimpleType type;
+    int cond, need = 0, free = 0, temp, constant, label, end, reg, i, j;
+
+    /* i < n or i <= n, with i in a register. */
+    condition = GetExpressionFromWhile( node );
+    if( TOAST( condition )->id != NODE_LESS && TOAST( condition )->id != NODE_LESSEQUAL ) return( FALSE );
+    if( TOAST( GetTreeChild( condition, 0 ) )->id != NODE_LIT_IDENTIFIER
+        || IsOfType( GetTreeChild( condition, 0 ), INT ) == FALSE
+        || IsOfType( GetTreeChild( condition, 1 ), INT ) == FALSE
+        || GetLeafOperand( GetTreeChild( condition, 1 ), &limit ) == FALSE )
+    {
+        return( FALSE );
+    }
+    loop.counter = FindSymbol( GetNameOfIdentifier( GetTreeChild( condition, 0 ) ) );
+    if( loop.counter->global == TRUE || loop.counter->reg == REG_NONE
+        || IsVariable( GetTreeChild( condition, 1 ), loop.counter ) == TRUE )
+    {
+        return( FALSE );
+    }
+    cond = ( TOAST( condition )->id == NODE_LESS ) ? COND_L : COND_LE;
+
+    /* An enclosing loop's pointers would not follow the
+     * counter. */
+    if( IsReducedVariable( loop.counter ) == TRUE ) return( FALSE );
+
+    /* Assignments to elements, then i = i + 1. */
+    loop.nrOfStatements = 0;
+    loop.nrOfInvariants = 0;
+    if( CollectVectorStatements( &loop, GetBlockFromWhile( node ) ) == FALSE || loop.nrOfStatements < 2 )
+    {
+        return( FALSE );
+    }
+    statement = loop.statements[--loop.nrOfStatements];
+    if( IsVariable( GetTreeChild( statement, 0 ), loop.counter ) == FALSE
+        || GetInductionStep( statement, &constant, &step ) == FALSE || step != NULL || constant != 1 )
+    {
+        return( FALSE );
+    }
+    for( i = 0; i < loop.nrOfStatements; i++ )
+    {
+        element = GetTreeChild( loop.statements[i], 0 );
+        if( TOAST( element )->id != NODE_INDEXER ) return( FALSE );
+        type = GetSimpleType( TOAST( element )->type );
+        if( ( type != INT && type != FLOAT ) || IsVectorElement( &loop, element, type ) == FALSE
+            || CheckVectorExpression( &loop, GetTreeChild( loop.statements[i], 1 ), type ) == FALSE )
+        {
+            return( FALSE );
+        }
+    }
+
+    /* The iterations must not depend on each other. */
+    for( i = 0; i < loop.nrOfStatements; i++ )
+    {
+        element = GetTreeChild( loop.statements[i], 0 );
+        symbol = FindSymbol( GetNameOfIdentifier( GetIndexedVariable( element ) ) );
+        for( j = 0; j < loop.nrOfStatements; j++ )
+        {
+            if( IsOnlyElement( loop.statements[j], symbol, GetIndexDisplacement( symbol, element ) ) == FALSE )
+            {
+                return( FALSE );
+            }
+        }
+    }
+
+    for( i = 0; i < loop.nrOfStatements; i++ )
+    {
+        j = GetVectorNeed( &loop, GetTreeChild( loop.statements[i], 1 ) );
+        if( j > need ) need = j;
+    }
+    for( reg = REG_XMM0; reg <= REG_XMM7; reg++ )
+    {
+        if( IsRegisterUsed( reg ) == FALSE ) free++;
+    }
+    if( need + loop.nrOfInvariants > free ) return( FALSE );
+    temp = AllocateRegister( 0 );
+    if( temp == REG_NONE ) return( FALSE );
+
+    /* Elements are addressed with the counter as the
+     * index, sign-extended on x86_64. */
+    loop.index = ( WORD_SIZE == 8 ) ? temp : loop.counter->reg;
+    label = GenerateLabel();
+    end = GenerateLabel();
+    GenerateVectorTest( &loop, limit, cond, temp, end );
+    GenerateVectorInvariants( &loop );
+    AsmEmitDirective( LOOP_ALIGNMENT );
+    AsmEmitLabel( label );
+    if( WORD_SIZE == 8 )
+    {
+        AsmEmit2( ASM_MOVSLQ, 8, AsmReg( loop.counter->reg ), AsmReg( temp ) );
+    }
+    for( i = 0; i < loop.nrOfStatements; i++ )
+    {
+        statement = loop.statements[i];
+        element = GetTreeChild( statement, 0 );
+        type = GetSimpleType( TOAST( element )->type );
+        reg = AllocateFloatRegister();
+        GenerateVectorExpression( &loop, GetTreeChild( statement, 1 ), type, reg );
+        AsmEmit2( ( type == FLOAT ) ? ASM_MOVUPS : ASM_MOVDQU, 4, AsmReg( reg ),
+                  GetVectorOperand( &loop, element ) );
+        FreeRegister( reg );
+    }
+    AsmEmit2( ASM_ADD, 4, AsmImm( VECTOR_LANES ), AsmReg( loop.counter->reg ) );
+    GenerateVectorTest( &loop, limit, AsmInvertCondition( cond ), temp, label );
+    AsmEmitLabel( end );
+
+    for( i = 0; i < loop.nrOfInvariants; i++ )
+    {
+        FreeRegister( loop.invariantRegisters[i] );
+    }
+    FreeRegister( temp );
+    return( TRUE );
+}
+
+/*************************************************
+ *                                               *
+ *  TEST CODE                                    *
+ *                                               *
+ *************************************************/
+
+/*
+ *  A loop of the self-test, compiled at -O1 for
+ *  [target], whether it should run four iterations
+ *  at a time and the code expected for it.
+ */
+typedef struct VectorTest
+{
+    char *name;
+    char *source;
+    int target;
+    BOOL vectorized;
+    char *expected;
+} VectorTest;
+
+static VectorTest vectorTests[] =
+{
+    { "int add",
+      "module vectortest;\n"
+      "int a[100];\n"
+      "int b[100];\n"
+      "int c[100];\n"
+      "add: int n -> void\n"
+      "{\n"
+      "    int i = 0;\n"
+      "    while( i < n ) do\n"
+      "    {\n"
+      "        a[i] = b[i] + c[i];\n"
+      "        i = i + 1;\n"
+      "    }\n"
+      "}\n",
+      TARGET_I386, TRUE,
+      "\tleal\t3(%esi), %edi\n\tcmpl\t%ebx, %edi\n\tjge\t.L8\n\t.p2align 4,,7\n.L7:\n"
+      "\tmovdqu\tb(,%esi,4), %xmm0\n\tmovdqu\tc(,%esi,4), %xmm1\n\tpaddd\t%xmm1, %xmm0\n"
+      "\tmovdqu\t%xmm0, a(,%esi,4)\n\taddl\t$4, %esi\n"
+      "\tleal\t3(%esi), %edi\n\tcmpl\t%ebx, %edi\n\tjl\t.L7\n.L8:\n"
+      "\tcmpl\t%ebx, %esi\n\tjge\t.L6\n" },
+    { "x86_64: int add",
+      "module vectortest;\n"
+      "int a[100];\n"
+      "int b[100];\n"
+      "int c[100];\n"
+      "add: int n -> void\n"
+      "{\n"
+      "    int i = 0;\n"
+      "    while( i < n ) do\n"
+      "    {\n"
+      "        a[i] = b[i] + c[i];\n"
+      "        i = i + 1;\n"
+      "    }\n"
+      "}\n",
+      TARGET_X86_64, TRUE,
+      ".L7:\n\tmovslq\t%r12d, %rsi\n"
+      "\tmovdqu\tb(,%rsi,4), %xmm0\n\tmovdqu\tc(,%rsi,4), %xmm1\n\tpaddd\t%xmm1, %xmm0\n"
+      "\tmovdqu\t%xmm0, a(,%rsi,4)\n\taddl\t$4, %r12d\n"
+      "\tleal\t3(%r12), %esi\n\tcmpl\t%ebx, %esi\n\tjl\t.L7\n" },
+    { "float scaled by an invariant",
+      "module vectortest;\n"
+      "float x[100];\n"
+      "float y[100];\n"
+      "scale: float k -> void\n"
+      "{\n"
+      "    int i = 0;\n"
+      "    while( i <= 99 ) do\n"
+      "    {\n"
+      "        x[i] = y[i] * k;\n"
+      "        i = i + 1;\n"
+      "    }\n"
+      "}\n",
+      TARGET_I386, TRUE,
+      "\tmovss\t-8(%ebp), %xmm0\n\tunpcklps\t%xmm0, %xmm0\n\tmovlhps\t%xmm0, %xmm0\n"
+      "\t.p2align 4,,7\n.L7:\n"
+      "\tmovups\ty(,%ebx,4), %xmm1\n\tmulps\t%xmm0, %xmm1\n\tmovups\t%xmm1, x(,%ebx,4)\n"
+      "\taddl\t$4, %ebx\n\tleal\t3(%ebx), %esi\n\tcmpl\t$99, %esi\n\tjle\t.L7\n" },
+    { "iterations that depend on each other",
+      "module vectortest;\n"
+      "int a[101];\n"
+      "shift: int n -> void\n"
+      "{\n"
+      "    int i = 0;\n"
+      "    while( i < n ) do\n"
+      "    {\n"
+      "        a[i] = a[i + 1] + 1;\n"
+      "        i = i + 1;\n"
+      "    }\n"
+      "}\n",
+      TARGET_I386, FALSE,
+      ".L5:\n\tmovl\ta+4(,%esi,4), %ecx\n\taddl\t$1, %ecx\n\tmovl\t%ecx, a(,%esi,4)\n" },
+    { "int multiply",
+      "module vectortest;\n"
+      "int a[100];\n"
+      "int b[100];\n"
+      "square: int n -> void\n"
+      "{\n"
+      "    int i = 0;\n"
+      "    while( i < n ) do\n"
+      "    {\n"
+      "        a[i] = b[i] * b[i];\n"
+      "        i = i + 1;\n"
+      "    }\n"
+      "}\n",
+      TARGET_I386, FALSE,
+      ".L5:\n\tmovl\tb(,%esi,4), %ecx\n\timull\tb(,%esi,4), %ecx\n\tmovl\t%ecx, a(,%esi,4)\n" }
+};
+
+BOOL TestVectorizer()
+{
+    char *text;
+    BOOL passed = TRUE;
+    int i;
+
+    printf( "Testing vectorizer...\n" );
+
+    for( i = 0; i < sizeof( vectorTests ) / sizeof( VectorTest ); i++ )
+    {
+        text = CompileTestProgram( vectorTests[i].source, vectorTests[i].target, 1 );
+        if( text != NULL && strstr( text, vectorTests[i].expected ) != NULL
+            && ( vectorTests[i].vectorized == TRUE
+                 || ( strstr( text, "\tmovdqu" ) == NULL && strstr( text, "\tmovups" ) == NULL ) ) )
+        {
+            printf( "%s: ok\n", vectorTests[i].name );
+        }
+        else
+        {
+            printf( "%s: FAILED, got\n%s", vectorTests[i].name, ( text != NULL ) ? text : "errors\n" );
+            passed = FALSE;
+        }
+        free( text );
+    }
+
+    printf( "Vectorizer test %s.\n\n", ( passed == TRUE ) ? "passed" : "failed" );
+    return( passed );
+}
@@ -0,0 +1,46 @@
+/*************************************************
+ *                                               *
+ *  Module: vectorize.h                          *
+ *  Description:                                 *
+ *      Interface to the vectorization of loops  *
+ *      over arrays.                             *
+ *  Modifications:                               *
+ *                                               *
+ *************************************************
+ *                                               *
+ *   This program is free software; you can      *
+ *   redistribute it and/or modify  it under     *
+ *   the terms of the GNU General Public         *
+ *   License as published by the Free            *
+ *   Software Foundation; either version 2       *
+ *   of the License, or (at your option) any     *
+ *   later version.                              *
+ *                                               *
+ *************************************************/
+
+#ifndef VECTORIZE_H
+#define VECTORIZE_H
+
+#include "tree.h"
+
+/*
+ *  Checks whether while loop [node] can run four
+ *  iterations at a time, and if so generates code
+ *  that does so as long as that many are left, and
+ *  returns TRUE. The code runs after the loop's
+ *  guard; the loop must follow it.
+ */
+BOOL GenerateVectorLoop( TreeNode *node );
+
+/*
+ *  Tests the packed loops run before int and float
+ *  loops, with an invariant in all four lanes, and
+ *  that loops whose iterations depend on each other
+ *  or that multiply ints are left alone.
+ *
+ *  Post: Returns TRUE if the test was successful,
+ *        FALSE if it failed.
+ */
+BOOL TestVectorizer();
+
+#endif